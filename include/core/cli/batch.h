@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdio.h>
+#include "core/config/env.h"
+#include "core/http/request_snapshot.h"
+
+/**
+ * Headless batch runner behind `tcurl run`.
+ *
+ * Executes request definitions in the shape emitted by export_as_json()
+ * without touching ncurses, themes or history, and prints one JSON object
+ * per finished request (JSON Lines) on the output stream.
+ */
+
+#define BATCH_EXIT_OK 0       /**< Every request produced a response below 400 */
+#define BATCH_EXIT_FAILED 1   /**< At least one transport error, template error or status >= 400 */
+#define BATCH_EXIT_USAGE 2    /**< Bad arguments or unreadable collection */
+
+/** Requests loaded from one or more collection files. */
+typedef struct {
+    RequestSnapshot *items;
+    int count;
+    int cap;
+} BatchCollection;
+
+typedef struct {
+    int concurrency;          /**< Transfers in flight, 1..BENCH_CONCURRENCY_MAX */
+    const char *env_name;     /**< Environment for every request; NULL uses each request's own */
+    long timeout_ms;          /**< Default when neither request nor environment sets one */
+    long connect_timeout_ms;
+    int include_body;         /**< Add the response body to each result line */
+} BatchOptions;
+
+void batch_collection_init(BatchCollection *c);
+void batch_collection_free(BatchCollection *c);
+
+/**
+ * Append the requests of a collection document. Accepts a single request
+ * object, an array of them, or an object with a "requests" array. "method"
+ * may be a name ("POST") or the numeric value stored in history.
+ *
+ * @return 0 on success, 1 on malformed JSON or allocation failure
+ *         (the collection is left unchanged)
+ */
+int batch_collection_parse(BatchCollection *c, const char *json);
+
+/**
+ * Append the requests of a collection file; "-" reads standard input.
+ *
+ * @return 0 on success, 1 if the file cannot be read or parsed
+ */
+int batch_collection_load_file(BatchCollection *c, const char *path);
+
+/**
+ * Run every request of a collection and write one result line per request,
+ * in completion order. Each line carries the request's "index" within the
+ * collection.
+ *
+ * @return BATCH_EXIT_OK or BATCH_EXIT_FAILED
+ */
+int batch_run(const BatchCollection *c, const EnvStore *envs, const BatchOptions *opt, FILE *out);
+
+/**
+ * Entry point of `tcurl run`; argv[0] is "run".
+ *
+ * @return Process exit code (BATCH_EXIT_*)
+ */
+int batch_main(int argc, char **argv);
@@ -90,4 +90,23 @@ void cmd_cookies_list(AppState *s);
  */
 void cmd_cookies_clear(AppState *s);
 
+/**
+ * Start a load test of the current request.
+ * 
+ * @param s Application state
+ * @param count Total requests to send (string, validated here)
+ * @param concurrency Requests kept in flight at once (string, validated here)
+ */
+void cmd_bench(AppState *s, const char *count, const char *concurrency);
+
+/**
+ * Show or set the timeouts of the current request, which take precedence
+ * over the environment and session defaults.
+ * 
+ * @param s Application state
+ * @param total Transfer timeout in ms, "off" to clear both, or NULL to show
+ * @param connect Optional connect timeout in ms
+ */
+void cmd_timeout(AppState *s, const char *total, const char *connect);
+
 #endif  // COMMAND_HANDLERS_H
@@ -17,7 +17,57 @@
 #define HTTP_RESPONSE_LINE_MAX 2048
 #define AUTH_VALUE_SIZE 4096
 
+/* Concurrent requests kept in the response panel */
+#define REQUEST_SLOTS_MAX 8
+
+/* Largest Content-Length used to pre-size a response body buffer */
+#define HTTP_BODY_PRESIZE_MAX (64u * 1024u * 1024u)
+
+/* Upper bound accepted by :set max_response_mb and :set spill_mb */
+#define HTTP_MAX_RESPONSE_MB 4096
+
+/* Request timeouts: session defaults and the environment variables that
+   override them per environment */
+#define HTTP_TIMEOUT_MS_DEFAULT 15000
+#define HTTP_CONNECT_TIMEOUT_MS_DEFAULT 10000
+#define HTTP_TIMEOUT_MS_MAX 3600000
+#define ENV_TIMEOUT_MS_KEY "TCURL_TIMEOUT_MS"
+#define ENV_CONNECT_TIMEOUT_MS_KEY "TCURL_CONNECT_TIMEOUT_MS"
+
+/* Bodies above this many MB are spilled to a mapped temp file */
+#define HTTP_SPILL_MB_DEFAULT 32
+
+/* History log: appends go to the newest segment, which is rolled at this size */
+#define HISTORY_SEGMENT_BYTES (1024 * 1024)
+
+/* Response bodies and headers at least this long are stored once, in a
+   directory beside the log, and referenced from entries by content hash */
+#define HISTORY_SHARED_BODY_MIN_BYTES 256
+
+/* history.conf defaults: zlib level for stored bodies (0 keeps them as
+   they are) and the smallest body worth compressing */
+#define HISTORY_COMPRESS_LEVEL_DEFAULT 6
+#define HISTORY_COMPRESS_MIN_BYTES_DEFAULT 512
+
+/* Full-text history index: bytes of each body or header field indexed */
+#define HISTORY_INDEX_MAX_FIELD_BYTES (1024 * 1024)
+
+/* Regex searches of response bodies this long run on a worker thread;
+   the worker checks for cancellation every SEARCH_SCAN_CHECK_LINES lines */
+#define SEARCH_ASYNC_MIN_BYTES (1024 * 1024)
+#define SEARCH_SCAN_CHECK_LINES 1024
+
+/* Pretty-printed history bodies kept for redisplay, least recently shown evicted first */
+#define HISTORY_VIEW_CACHE_ENTRIES 8
+
+/* Streaming display of in-flight bodies (bytes copied per redraw) */
+#define STREAM_PUMP_CHUNK (64 * 1024)
+#define STREAM_PUMP_MAX_PER_CALL (1024 * 1024)
+#define STREAM_PREVIEW_MAX_BYTES (1024 * 1024) /* Past this, or once spilled, bytes are only counted */
+#define STREAM_RATE_WINDOW_MS 250.0
+
 /* UI rendering */
+#define UI_STREAM_REDRAW_MS 100   /* Repaint interval while a request is in flight; idle waits indefinitely */
 #define STATUS_LINE_MAX 512
 #define UI_LINE_MAX 1024
 #define UI_META_MAX 256
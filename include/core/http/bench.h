@@ -0,0 +1,73 @@
+#pragma once
+
+#include "state.h"
+#include <stdint.h>
+
+/* Log-linear buckets: exact below 64us, then 32 sub-buckets per power of two
+   (about 3% relative error) up to ~2^40us. */
+#define LATENCY_HIST_SUB_BUCKETS 32
+#define LATENCY_HIST_BUCKETS (36 * LATENCY_HIST_SUB_BUCKETS)
+
+#define BENCH_COUNT_MAX 100000
+#define BENCH_CONCURRENCY_MAX 64
+
+/** Fixed-size latency histogram; memory does not grow with the sample count. */
+typedef struct {
+    uint32_t counts[LATENCY_HIST_BUCKETS];
+    uint64_t total;
+    double max_ms;
+} LatencyHistogram;
+
+typedef enum {
+    BENCH_PHASE_DNS = 0,
+    BENCH_PHASE_TCP,
+    BENCH_PHASE_TLS,
+    BENCH_PHASE_TTFB,
+    BENCH_PHASE_TRANSFER,
+    BENCH_PHASE_TOTAL,
+    BENCH_PHASE_COUNT
+} BenchPhase;
+
+/** Aggregated results of a benchmark run. */
+typedef struct {
+    LatencyHistogram phases[BENCH_PHASE_COUNT];
+    int requested;
+    int concurrency;
+    int completed;     /**< Transfers that produced an HTTP response */
+    int failed;        /**< Transport errors */
+    int http_errors;   /**< Responses with status >= 400 */
+    double wall_ms;
+} BenchStats;
+
+void latency_hist_init(LatencyHistogram *h);
+void latency_hist_record(LatencyHistogram *h, double ms);
+
+/**
+ * Latency at or below which `pct` percent of samples fall.
+ *
+ * @return Upper bound of the matching bucket (capped at the maximum seen),
+ *         or 0 when the histogram is empty
+ */
+double latency_hist_percentile(const LatencyHistogram *h, double pct);
+
+void bench_stats_init(BenchStats *st, int requested, int concurrency);
+
+/** Add one finished request; failed transfers only count towards `failed`. */
+void bench_stats_record(BenchStats *st, const HttpResponse *r);
+
+/**
+ * Render a plain-text report (percentile table and throughput).
+ *
+ * @return Heap-allocated text, or NULL on allocation failure
+ */
+char *bench_format_report(const BenchStats *st, HttpMethod method, const char *url);
+
+/**
+ * Replay the editor request `count` times with `concurrency` transfers in
+ * flight, publishing the report to the response panel when the run ends.
+ * Requests are not added to history and do not touch the cookie jar.
+ * Must be called with the state lock held.
+ *
+ * @return 0 if the run started, 1 otherwise (the response panel shows why)
+ */
+int bench_start(AppState *s, int count, int concurrency);
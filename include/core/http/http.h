@@ -1,11 +1,70 @@
 #pragma once
 #include "state.h"
+#include <curl/curl.h>
 
-int http_request(
-    const char *url,
-    HttpMethod method,
-    const char *body,
-    const TextBuffer *headers,
-    const char *cookie_jar_path,
-    HttpResponse *out
-);
+/** Upper-case name of a method, e.g. "DELETE"; "GET" for unknown values. */
+const char *http_method_name(HttpMethod m);
+
+/**
+ * A fully resolved request (templates already expanded).
+ * Strings are only borrowed for the duration of the call that takes them.
+ */
+typedef struct {
+    HttpMethod method;
+    const char *url;
+    const char *body;            /**< Payload; NULL sends an empty body */
+    const char *headers_text;    /**< "Key: value" lines separated by '\n' */
+    const char *cookie_jar_path; /**< NULL or "" disables the cookie jar */
+    size_t max_body_bytes;       /**< Fail larger responses; 0 for no limit */
+    size_t spill_threshold_bytes; /**< Larger bodies go to a mapped temp file; 0 keeps all in memory */
+    long timeout_ms;             /**< Whole transfer; 0 for no limit */
+    long connect_timeout_ms;     /**< Connection phase; 0 for libcurl's default */
+} HttpRequestSpec;
+
+/** Per-transfer buffers and header list attached to an easy handle. */
+typedef struct HttpTransfer HttpTransfer;
+
+/**
+ * Configure an easy handle for a request and attach receive buffers.
+ *
+ * @return New transfer, or NULL on allocation failure
+ */
+HttpTransfer *http_transfer_prepare(CURL *curl, const HttpRequestSpec *spec);
+
+/**
+ * Collect the result of a completed transfer into out and free it.
+ * The easy handle itself is left to the caller.
+ *
+ * @return 0 on success, -1 on transport failure (out->error is set)
+ */
+int http_transfer_finish(HttpTransfer *t, CURLcode res, HttpResponse *out);
+
+/**
+ * Copy body bytes received so far, starting at `offset`. May be called from
+ * another thread while the transfer runs; the copy is taken under a lock
+ * private to the transfer.
+ *
+ * @return Number of bytes copied (0 when nothing new has arrived)
+ */
+size_t http_transfer_read_body(HttpTransfer *t, size_t offset, char *dst, size_t cap);
+
+/** Free a transfer that never completed. */
+void http_transfer_free(HttpTransfer *t);
+
+/**
+ * (Re)build the line index of r->body_view. Call whenever body_view is
+ * published; rendering, search and scrolling then reach any line directly.
+ * Also gives the view a new r->view_gen, by which search results for it
+ * are cached.
+ *
+ * A heap body_view is adopted into r->view_map, which owns it from then
+ * on: to replace the view, assign the new text and index again rather
+ * than freeing the old one.
+ *
+ * @return 0 on success (or when there is no body_view), -1 on allocation
+ *         failure, in which case callers fall back to scanning the text
+ */
+int http_response_index_view(HttpResponse *r);
+
+/** Free every buffer owned by a response and zero it. */
+void http_response_free(HttpResponse *r);
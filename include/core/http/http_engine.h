@@ -0,0 +1,105 @@
+#pragma once
+
+#include <curl/curl.h>
+#include "core/http/http.h"
+
+/**
+ * Long-lived request engine.
+ *
+ * Keeps a CURLSH share object (DNS cache, connection cache, TLS session
+ * cache and cookies) plus a small pool of idle easy handles alive for the whole session,
+ * so repeated sends to the same host skip DNS/TCP/TLS setup.
+ *
+ * Asynchronous requests run on a single I/O thread that drives every
+ * in-flight transfer through one curl_multi handle.
+ */
+typedef struct HttpEngine HttpEngine;
+
+/** Byte counters of an in-flight transfer. */
+typedef struct {
+    long long bytes_received;
+    long long bytes_expected; /**< 0 while the size is unknown */
+    long long bytes_sent;
+    long long bytes_to_send;
+} HttpProgress;
+
+/**
+ * Completion callback, invoked on the engine's I/O thread.
+ *
+ * @param id       Id returned by http_engine_submit()
+ * @param result   Response whose buffers now belong to the callee, or NULL
+ *                 when the engine shut down before the transfer finished
+ * @param userdata Pointer given to http_engine_submit()
+ */
+typedef void (*HttpEngineDoneFn)(int id, HttpResponse *result, void *userdata);
+
+/**
+ * Create a request engine.
+ *
+ * @return New engine, or NULL on allocation/libcurl failure
+ */
+HttpEngine *http_engine_create(void);
+
+/**
+ * Destroy an engine, closing pooled handles and cached connections.
+ *
+ * Stops the I/O thread first; transfers still in flight are aborted and
+ * their callbacks run with a NULL result.
+ */
+void http_engine_destroy(HttpEngine *e);
+
+/**
+ * Take an easy handle from the pool (or create one).
+ *
+ * The handle is reset to default options and attached to the engine's
+ * share object. Return it with http_engine_release().
+ *
+ * @param cookies Non-zero if the request uses the cookie jar; handles
+ *                that did are only reused by such requests
+ * @return CURL easy handle, or NULL on failure
+ */
+CURL *http_engine_acquire(HttpEngine *e, int cookies);
+
+/**
+ * Return an easy handle to the pool. Handles beyond the pool size are
+ * cleaned up; their connections stay in the shared connection cache.
+ *
+ * @param cookies The value given to http_engine_acquire()
+ */
+void http_engine_release(HttpEngine *e, CURL *curl, int cookies);
+
+/** Drop the shared cookies. The jar file is left as it is. */
+void http_engine_clear_cookies(HttpEngine *e);
+
+/**
+ * Queue a request on the I/O thread. Returns immediately.
+ *
+ * @return Request id (> 0), or -1 if the request could not be queued
+ */
+int http_engine_submit(HttpEngine *e, const HttpRequestSpec *spec, HttpEngineDoneFn done, void *userdata);
+
+/**
+ * Read the byte counters of an in-flight request.
+ *
+ * @return 0 on success, 1 if the id is not in flight
+ */
+int http_engine_progress(HttpEngine *e, int id, HttpProgress *out);
+
+/**
+ * Copy body bytes of an in-flight request received so far, starting at
+ * `offset`. The I/O thread is only blocked for the copy itself.
+ *
+ * @return Bytes copied (0 when nothing new), or -1 if the id is not in flight
+ */
+long http_engine_stream_read(HttpEngine *e, int id, size_t offset, char *dst, size_t cap);
+
+/**
+ * Abort an in-flight request. The I/O thread is woken and completes it
+ * with the error "Request cancelled" on its next loop iteration.
+ *
+ * @return 0 if the request was still in flight, -1 otherwise
+ */
+int http_engine_cancel(HttpEngine *e, int id);
+
+/** Number of submitted requests whose callback has not run yet. */
+int http_engine_in_flight(HttpEngine *e);
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "state.h"
+
+/**
+ * Per-request result slots of the response panel.
+ *
+ * Every sent request owns a slot from submission until the slot is reused.
+ * The viewed slot's response lives in ResponseState.response so that drawing,
+ * search and export keep reading a single place; switching the view moves
+ * ownership without copying. All functions expect the state lock held.
+ */
+
+/** Reset all slots to empty with nothing viewed. */
+void request_slots_init(ResponseState *r);
+
+/** Free every slot and the viewed response. */
+void request_slots_free(ResponseState *r);
+
+/**
+ * Pick the slot a new request will use: an empty slot, else the oldest
+ * finished one.
+ *
+ * @return Slot index, or -1 if every slot is in flight
+ */
+int request_slots_reserve(const ResponseState *r);
+
+/**
+ * Mark a reserved slot in flight for request `id` and view it.
+ * Any earlier result in the slot is discarded.
+ */
+void request_slots_begin(ResponseState *r, int slot, int id, HttpMethod method, const char *url);
+
+/**
+ * Store the result of request `id`, taking ownership of its buffers.
+ *
+ * @return Where the response now lives (the viewed response if its slot is
+ *         viewed), or NULL if no slot waits for the id (result is freed)
+ */
+HttpResponse *request_slots_complete(ResponseState *r, int id, HttpResponse *result);
+
+/**
+ * Pull body bytes that arrived since the last call for the viewed in-flight
+ * slot into its `stream` buffer and update its byte count and receive rate.
+ * Only the first STREAM_PREVIEW_MAX_BYTES, and nothing past the spill size,
+ * are copied; later bytes are only counted.
+ *
+ * @param now_ms Monotonic clock in milliseconds
+ * @return 1 if new bytes arrived, 0 otherwise
+ */
+int request_slots_pump(ResponseState *r, double now_ms);
+
+/** Show a slot in the response panel, parking the current view. */
+void request_slots_view(ResponseState *r, int slot);
+
+/**
+ * Park the viewed slot's response back in its slot, leaving
+ * ResponseState.response empty. Call before replacing the panel content.
+ */
+void request_slots_detach_view(ResponseState *r);
+
+/**
+ * View the next (+1) or previous (-1) used slot in send order, wrapping.
+ *
+ * @return 1 if the view changed, 0 otherwise
+ */
+int request_slots_cycle(ResponseState *r, int direction);
+
+/** Currently viewed slot, or NULL. */
+const RequestSlot *request_slots_viewed(const ResponseState *r);
+
+/** Count used slots and the 1-based send-order position of `slot`. */
+int request_slots_position(const ResponseState *r, int slot, int *out_total);
@@ -8,8 +8,31 @@ typedef struct {
     char *body_text;
     char *headers_text;
     char *env_name;
+    long timeout_ms;          /* Per-request overrides, 0 to inherit */
+    long connect_timeout_ms;
 } RequestSnapshot;
 
+/* A snapshot with environment templates expanded, ready to send */
+typedef struct {
+    char *url;
+    char *body;
+    char *headers_text;
+    long timeout_ms;          /* Request or environment value, 0 to use the session default */
+    long connect_timeout_ms;
+} ResolvedRequest;
+
 int request_snapshot_build(const AppState *s, RequestSnapshot *out);
 int request_snapshot_build_locked(const AppState *s, RequestSnapshot *out);
 void request_snapshot_free(RequestSnapshot *s);
+
+/**
+ * Expand {{VAR}} templates of a snapshot against an environment store.
+ * Timeouts come from the snapshot, else from the active environment's
+ * ENV_TIMEOUT_MS_KEY / ENV_CONNECT_TIMEOUT_MS_KEY variables.
+ *
+ * @param missing_name Set to the first undefined variable (caller frees);
+ *                     stays NULL when the failure was out of memory
+ * @return 0 on success, 1 on failure
+ */
+int request_snapshot_resolve(const RequestSnapshot *snap, const EnvStore *envs, ResolvedRequest *out, char **missing_name);
+void resolved_request_free(ResolvedRequest *r);
@@ -1,3 +1,30 @@
 #pragma once
 
-void *request_thread(void *arg);
\ No newline at end of file
+#include "state.h"
+
+/**
+ * Send the editor request asynchronously.
+ *
+ * Resolves environment templates, reserves a result slot and submits the
+ * request to the session engine; the response is published into its slot
+ * from the engine's I/O thread. Must be called with the state lock held.
+ *
+ * @return Request id (> 0), or -1 if nothing was sent (the response panel
+ *         shows why)
+ */
+int request_start(AppState *s);
+
+/**
+ * Cancel the viewed request if it is in flight, else the newest one in
+ * flight. Its slot receives a "Request cancelled" error shortly after.
+ * Must be called with the state lock held.
+ *
+ * @return 0 if a request was cancelled, -1 if none is in flight
+ */
+int request_cancel(AppState *s);
+
+/**
+ * Publish the responses still waiting to be formatted and stop the thread
+ * that formats them. Call after the engine is destroyed.
+ */
+void request_thread_stop(AppState *s);
@@ -13,4 +13,5 @@ typedef struct {
     double ttfb_ms;      /**< Time to first byte in milliseconds */
     double transfer_ms;  /**< Data transfer time in milliseconds */
     double total_ms;     /**< Total request time in milliseconds */
+    int connection_reused; /**< 1 if served over an already-open connection */
 } HttpTiming;
@@ -22,6 +22,9 @@ typedef enum {
     ACT_SEARCH_NEXT,
     ACT_SEARCH_PREV,
     ACT_TOGGLE_RESPONSE_VIEW,
+    ACT_NEXT_RESPONSE,
+    ACT_PREV_RESPONSE,
+    ACT_CANCEL_REQUEST,
 
     ACT_COUNT
 } Action;
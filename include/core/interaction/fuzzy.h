@@ -0,0 +1,55 @@
+#ifndef FUZZY_H
+#define FUZZY_H
+
+#include <stddef.h>
+#include "state.h"
+
+/** fuzzy_score() result for text that does not contain the pattern */
+#define FUZZY_NO_MATCH (-1)
+
+/**
+ * Score how well `pattern` matches `text` as a subsequence, ignoring ASCII
+ * case. Matches in a short window, in runs, and at the start of words
+ * (after '/', '.', '-', a space, ...) score higher; gaps cost a little.
+ * Allocates nothing.
+ *
+ * @return Score of 0 or more, or FUZZY_NO_MATCH
+ */
+int fuzzy_score(const char *text, size_t len, const char *pattern, size_t plen);
+
+/** Start a search: remember the selection for fuzzy_finder_cancel(). */
+void fuzzy_finder_begin(AppState *s);
+
+/**
+ * Rank the history for `query` and select the best entry. When `query`
+ * only adds characters to the previous one, only the previous candidates
+ * are scored again, since nothing else can match. An empty query shows
+ * the history as it was.
+ */
+void fuzzy_finder_update(AppState *s, const char *query);
+
+/**
+ * History index of the entry on ranked row `row`, following entries that
+ * were loaded or dropped since the ranking.
+ *
+ * @return Index, or -1 if there is no such row or its entry was dropped
+ */
+int fuzzy_finder_entry(const AppState *s, int row);
+
+/** Move the selection `dir` rows through the ranked entries. */
+void fuzzy_finder_move(AppState *s, int dir);
+
+/**
+ * Leave the ranked view, keeping the selection.
+ *
+ * @return History index of the selected entry, or -1 if nothing was ranked,
+ *         nothing matched or the entry was dropped since
+ */
+int fuzzy_finder_accept(AppState *s);
+
+/** Leave the ranked view and put the selection back where the search began. */
+void fuzzy_finder_cancel(AppState *s);
+
+void fuzzy_finder_free(FuzzyFinder *f);
+
+#endif // FUZZY_H
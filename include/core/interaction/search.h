@@ -3,6 +3,14 @@
 
 #include "state.h"
 
+/** Where the matches of a query stand, for the status line */
+typedef enum {
+    SEARCH_IDLE = 0,        /* Not searched for, or the content changed since */
+    SEARCH_BUSY,            /* Being scanned in the background */
+    SEARCH_BAD_PATTERN,     /* A regular expression that does not compile */
+    SEARCH_READY
+} SearchStatus;
+
 /**
  * Apply a search query to the current search target (history or response).
  * 
@@ -12,11 +20,28 @@
  * - Sets search_not_found if no matches
  * - Updates history_selected or response_scroll to first match
  * 
+ * A query starting with "re:" is a POSIX extended regular expression,
+ * matched line by line and ignoring case; the compiled pattern is kept
+ * while the query is unchanged. On responses of SEARCH_ASYNC_MIN_BYTES or
+ * more the pattern is matched on a worker thread and the first match is
+ * shown when it finishes. Must be called with the state lock held.
+ *
  * @param s Application state (must not be NULL)
  * @param query Search query string (case-insensitive)
  */
 void search_apply(AppState *s, const char *query);
 
+/**
+ * Match a query while it is being typed, without moving the selection, so
+ * the prompt can show how many lines match. Only regular expressions over
+ * the response are matched ahead; any other query just cancels the scan
+ * started for the previous one.
+ */
+void search_preview(AppState *s, const char *query);
+
+/** Cancel a background scan, if one is running. */
+void search_cancel(AppState *s);
+
 /**
  * Step to next/previous search match.
  * 
@@ -37,4 +62,21 @@ void search_step(AppState *s, int dir);
  */
 SearchTarget search_get_effective_target(const AppState *s);
 
+/** @return 1 if `query` is a regular expression ("re:" prefix) */
+int search_is_regex(const char *query);
+
+/**
+ * State of the matches of `query` in the current target. When they are
+ * ready, `*total` is their count and `*position` the 1-based rank of the
+ * current match, or 0 if `query` is not the applied query or nothing is
+ * selected. Either pointer may be NULL.
+ */
+SearchStatus search_status(const AppState *s, const char *query, int *position, int *total);
+
+/**
+ * Stop the background scan worker and free the cached matches and
+ * pattern. Must be called without the state lock held.
+ */
+void search_state_free(AppState *s);
+
 #endif // SEARCH_H
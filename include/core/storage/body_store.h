@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Content address of a stored body: the SHA-256 of its bytes. Bodies come
+ * from the servers queried, so the address must not be forgeable: on disk
+ * a body with the same address is taken to be the same body.
+ */
+typedef struct BodyHash {
+    uint8_t bytes[32];
+} BodyHash;
+
+#define BODY_HASH_HEX_LEN 64
+
+void body_hash(const char *data, size_t len, BodyHash *out);
+
+/** @return 1 if both hashes are the same, 0 otherwise */
+int body_hash_equal(const BodyHash *a, const BodyHash *b);
+
+/** Write the hash as BODY_HASH_HEX_LEN lowercase hex digits plus a NUL. */
+void body_hash_hex(const BodyHash *hash, char *out);
+
+/** @return 0 if `hex` is exactly BODY_HASH_HEX_LEN hex digits, 1 otherwise */
+int body_hash_parse(const char *hex, BodyHash *out);
+
+typedef struct StoredBody StoredBody;
+
+/**
+ * Interning table for response bodies and headers kept in history.
+ *
+ * Identical strings share one reference-counted, NUL-terminated copy, so a
+ * history of repeated responses holds each distinct body once. The strings
+ * handed out are plain `char *` and may be read like any other; they must
+ * only be given back through body_store_release(). Access is serialized by
+ * the owner, like the rest of the History.
+ */
+typedef struct BodyStore {
+    StoredBody **buckets;
+    size_t nbuckets;
+    size_t count;       /* Distinct bodies */
+} BodyStore;
+
+void body_store_init(BodyStore *bs);
+
+/** Free the table and every body still in it. */
+void body_store_free(BodyStore *bs);
+
+/**
+ * Take a reference to the stored copy of the first `len` bytes of `data`,
+ * adding it if needed.
+ *
+ * @return Shared string, or NULL on allocation failure
+ */
+char *body_store_intern(BodyStore *bs, const char *data, size_t len);
+
+/**
+ * body_store_intern() for bytes whose body_hash() is already known, so a
+ * large body can be hashed before the owner's lock is taken.
+ */
+char *body_store_intern_hashed(BodyStore *bs, const char *data, size_t len, const BodyHash *hash);
+
+/** Take another reference to a body from this store; returns `body`. */
+char *body_store_ref(char *body);
+
+/**
+ * Take a reference that also outlives body_store_free(): the body then
+ * leaves the table and is freed by its last body_store_unpin(). For a
+ * body queued for the disk while the history may be cleared.
+ */
+char *body_store_pin(char *body);
+
+/** Drop a body_store_pin() reference. */
+void body_store_unpin(BodyStore *bs, char *body);
+
+/** Take a reference to the body with this hash. @return NULL if not stored */
+char *body_store_find(BodyStore *bs, const BodyHash *hash);
+
+/** Drop a reference from intern() or find(), freeing the body on the last one. */
+void body_store_release(BodyStore *bs, char *body);
+
+/** @return 1 if a body with this hash is stored, 0 otherwise */
+int body_store_contains(const BodyStore *bs, const BodyHash *hash);
@@ -1,9 +1,14 @@
 #pragma once
 
+#include <sys/types.h>
 #include "core/text/textbuf.h"
 #include "core/http/timing.h"
+#include "core/storage/body_store.h"
+#include "core/config/constants.h"
 
 typedef struct HttpResponse HttpResponse;
+typedef struct MappedBody MappedBody;
+typedef struct HistoryIndex HistoryIndex;
 
 typedef struct HistoryItem {
     int method;
@@ -12,23 +17,77 @@ typedef struct HistoryItem {
     char *headers;
 
     long status;
+    /* The response strings belong to the history's BodyStore, except a
+       response_body backed by `response_map`. The displayed view is derived
+       from the body on demand, see history_item_view(). */
     char *response_body;
-    char *response_body_view;
+    MappedBody *response_map; /* Shared with the response when its body was spilled */
     char *response_headers;
     double elapsed_ms;
     HttpTiming timing;
     int is_json;
+
+    /* Entries loaded from disk start with only the fields above the body
+       (method, url, status, timing); the rest is read on demand. */
+    unsigned long seq;        /* Recording order, for the full-text index; 0 if not indexed */
+
+    int paged_in;             /* body, headers and response_* are in memory */
+    int disk_segment;         /* Log segment holding the line (history_storage_segment_path()) */
+    off_t disk_offset;        /* Start of the entry's line in that segment, -1 if none */
 } HistoryItem;
 
+/* A pretty-printed JSON body, keyed by the shared body it was rendered from. */
+typedef struct HistoryView {
+    char *body;               /* Reference into the history's BodyStore */
+    char *view;
+} HistoryView;
+
+/*
+ * Entries live in a ring buffer, oldest first from `head`: logical entry i
+ * is items[(head + i) % capacity]. Use history_get() rather than indexing
+ * `items`. With a limit set, a push into a full history overwrites the
+ * oldest entry and trimming only advances `head`, so both are O(1).
+ */
 typedef struct History {
     HistoryItem *items;
+    int head;
     int count;
     int capacity;
+    int limit;                /* Maximum entries, and the most slots ever allocated; 0 = unbounded */
+    char *backing_path;       /* Log the disk_segment/disk_offset values refer to, or NULL */
+    BodyStore bodies;         /* Response bodies and headers, shared between entries */
+    HistoryView views[HISTORY_VIEW_CACHE_ENTRIES]; /* Most recently shown first */
+    int nviews;
+    unsigned long generation; /* Changes whenever entries are added or removed; never reused */
+    long first_id;            /* Id of entry 0; entry i keeps the id first_id + i while it exists */
+    HistoryIndex *fulltext;   /* Index of entry text, or NULL when full-text search is off */
+    unsigned long next_seq;   /* Given to the next entry pushed while `fulltext` is set */
 } History;
 
 void history_init(History *h);
 void history_free(History *h);
 
+/**
+ * Cap the history at `limit` entries (0 or less removes the cap), dropping
+ * the oldest ones if it holds more.
+ */
+void history_set_limit(History *h, int limit);
+
+/**
+ * Turn full-text indexing on with `idx` (its ownership passes to the
+ * history), or off with NULL. Entries pushed from now on get a seq and are
+ * indexed; entries already present stay searchable through whatever `idx`
+ * holds for their seq.
+ */
+void history_set_fulltext(History *h, HistoryIndex *idx);
+
+/** Never hand out `seq` or anything below it, e.g. because the log holds it. */
+void history_note_seq(History *h, unsigned long seq);
+
+/**
+ * Record a request. With full-text indexing on, the entry gets the next
+ * seq and its bodies and headers are added to the index.
+ */
 void history_push(
     History *h,
     int method,
@@ -38,6 +97,57 @@ void history_push(
     const HttpResponse *response
 );
 
+/**
+ * history_push() with the body_hash() of the response body and headers
+ * already computed, e.g. before the caller took its lock; either may be
+ * NULL to have it hashed here.
+ *
+ * @return 0 if the entry was added, 1 on allocation failure
+ */
+int history_push_hashed(
+    History *h,
+    int method,
+    const char *url,
+    const TextBuffer *body,
+    const TextBuffer *headers,
+    const HttpResponse *response,
+    const BodyHash *body_digest,
+    const BodyHash *headers_digest
+);
+
+/**
+ * Append an entry whose bodies are still on disk. Copies `meta`'s method,
+ * url, status, timing, seq and offset; the bodies are left for
+ * history_storage_page_in().
+ *
+ * @return 0 on success, 1 on allocation failure
+ */
+int history_push_unloaded(History *h, const HistoryItem *meta);
+
+/**
+ * Insert `n` entries, ordered oldest to newest, before the current oldest
+ * one. The history takes ownership of the items' strings; `items` itself is
+ * only copied. The entries must not be paged in, since response strings
+ * cannot move between body stores.
+ *
+ * @return 0 on success, 1 on allocation failure or if the entries would not
+ *         fit under the limit (nothing is inserted)
+ */
+int history_prepend(History *h, const HistoryItem *items, int n);
+
+/**
+ * Response body of an entry as the response panel shows it: pretty-printed
+ * when it is JSON, the body itself otherwise. Rendered views are cached for
+ * the last HISTORY_VIEW_CACHE_ENTRIES bodies shown; entries with identical
+ * bodies share one.
+ *
+ * @return Text valid until the next call or change to the history, or NULL
+ *         if the entry has no body in memory
+ */
+const char *history_item_view(History *h, const HistoryItem *it);
+
+/** Entry `index`, 0 being the oldest. @return NULL if out of range */
 HistoryItem *history_get(History *h, int index);
 
+/** Drop the oldest entries beyond `max_entries`, and their index postings. */
 void history_trim_oldest(History *h, int max_entries);
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * Full-text index over history entries.
+ *
+ * Every three-byte sequence (trigram) of an entry's request body, headers
+ * and response strings, folded to ASCII lower case, maps to the entries
+ * containing it. Entries are identified by their HistoryItem.seq, which
+ * only grows, so posting lists are sorted by construction: adding an entry
+ * appends to them and dropping the oldest entries cuts a prefix off them.
+ * A substring query of three bytes or more is answered by intersecting the
+ * lists of its trigrams; the result can contain entries that hold every
+ * trigram but not the whole query, which the caller checks when it can.
+ *
+ * Access is serialized by the owner, like the rest of the History.
+ */
+
+/** Bytes per indexed sequence; shorter queries cannot use the index */
+#define HISTORY_INDEX_GRAM 3
+
+typedef struct HistoryIndex HistoryIndex;
+
+/** @return Empty index, or NULL on allocation failure */
+HistoryIndex *history_index_new(void);
+
+void history_index_free(HistoryIndex *idx);
+
+/**
+ * Index the `len` bytes at `text` as part of entry `seq`. Call once per
+ * field; trigrams never span two fields. `seq` must not be lower than that
+ * of any entry added before, and at most HISTORY_INDEX_MAX_FIELD_BYTES of
+ * the field are read.
+ *
+ * @return 0 on success, 1 on allocation failure (the entry may then be
+ *         only partly indexed)
+ */
+int history_index_add(HistoryIndex *idx, unsigned long seq, const char *text, size_t len);
+
+/**
+ * Forget entries below `floor`. Their postings stop matching at once and
+ * are freed once they make up half of the index, or immediately with
+ * `compact` set.
+ */
+void history_index_prune(HistoryIndex *idx, unsigned long floor, int compact);
+
+/**
+ * Entries whose indexed text may contain the `len` bytes at `query`,
+ * ignoring ASCII case, in ascending order. Queries shorter than
+ * HISTORY_INDEX_GRAM match every entry and must be answered without the
+ * index.
+ *
+ * @return 0 on success (`*seqs_out` is NULL when nothing matches; free() it
+ *         otherwise), 1 on allocation failure
+ */
+int history_index_query(const HistoryIndex *idx, const char *query, size_t len, unsigned long **seqs_out, size_t *count_out);
+
+/** @return 1 if entry `seq` was added and not pruned, 0 otherwise */
+int history_index_contains(const HistoryIndex *idx, unsigned long seq);
+
+/** One past the highest seq ever added, or 1 for an empty index */
+unsigned long history_index_next_seq(const HistoryIndex *idx);
+
+/** Entries currently indexed. */
+size_t history_index_count(const HistoryIndex *idx);
+
+/**
+ * Write the index to `path` through a temporary file and rename, so a
+ * reader never sees it half written. Pruned postings are compacted away
+ * first.
+ *
+ * @return 0 on success, 1 on error
+ */
+int history_index_save(HistoryIndex *idx, const char *path);
+
+/**
+ * Read an index written by history_index_save().
+ *
+ * @return The index, or NULL if the file is missing, from another version
+ *         or damaged
+ */
+HistoryIndex *history_index_load(const char *path);
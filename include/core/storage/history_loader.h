@@ -0,0 +1,32 @@
+#pragma once
+
+#include "state.h"
+
+/**
+ * Background history load.
+ *
+ * Reads the history index on a worker thread, newest entries first, and
+ * hands them to the history panel in batches under the state lock, so the
+ * UI is usable before the file has been read. `history.loaded_ok` and
+ * `history.skipped_invalid` grow as batches are published and
+ * `history.loading` stays set until the load ends. With `history.fulltext`
+ * set, the saved full-text index is read on the worker as well and
+ * installed once the newest seq in the log is known; until then entries
+ * are recorded without one.
+ *
+ * Clearing `history.loading` (under the state lock) cancels the load: no
+ * further entries are published.
+ */
+
+/**
+ * Start loading `s->history.path` into `s->history.history`. Must be called
+ * before any request can be recorded; entries appended to the file after
+ * this call are not loaded again.
+ *
+ * @return 0 if the worker started, 1 otherwise (history stays empty, and
+ *         full-text search starts with an empty index)
+ */
+int history_loader_start(AppState *s);
+
+/** Cancel a running load and wait for the worker; safe if none was started. */
+void history_loader_stop(AppState *s);
@@ -9,9 +9,219 @@ typedef struct {
 
 char *history_storage_default_path(void);
 
+/** Create the directories leading to `path` (mode 0700). @return 0 on success */
+int history_storage_ensure_parent_dirs(const char *path);
+
+/*
+ * The history is an append-only log of JSONL segments: `path` itself is
+ * segment 0 (the only one written by older versions) and `path.N` are the
+ * later ones, oldest first. Whole old segments are deleted once newer ones
+ * hold max_entries entries.
+ */
+
+/** File name of segment `seq` of the log at `base`. @return Heap string or NULL */
+char *history_storage_segment_path(const char *base, int seq);
+
+/**
+ * Existing segments of the log at `base`, in ascending order.
+ *
+ * @return 0 on success (an empty list if there are none), 1 on error
+ */
+int history_storage_list_segments(const char *base, int **seqs_out, int *count_out);
+
+/** Valid entries in one segment file. @return Count, or -1 on read error */
+int history_storage_count_entries(const char *path);
+
+/**
+ * Load the history index from the log at `path`. Only each entry's method, url, status,
+ * timing and line offset are read; bodies and headers stay on disk until
+ * history_storage_page_in() is called for the entry. `path` becomes the
+ * history's backing file.
+ */
 int history_storage_load(History *h, const char *path);
 int history_storage_load_with_stats(History *h, const char *path, HistoryLoadStats *stats);
-int history_storage_save(const History *h, const char *path);
-int history_storage_append_last(const History *h, const char *path);
 
-int history_config_load_max_entries(const char *path, int fallback);
+/**
+ * Number of threads that parse the index when loading or scanning a log;
+ * 0 (the default) uses one per online CPU. Large files are split at line
+ * boundaries and parsed in parallel, and entries still arrive in order.
+ */
+void history_storage_set_parse_threads(int n);
+
+/**
+ * Called by history_storage_scan_newest() with an entry's index fields
+ * (meta->url is only valid during the call), or with NULL for a line that
+ * cannot be parsed. Returning non-zero stops the scan.
+ */
+typedef int (*HistoryScanFn)(const HistoryItem *meta, void *userdata);
+
+/**
+ * Walk the first `end` bytes of a history file from the newest entry to the
+ * oldest, reading the same index fields as history_storage_load(). Lines have
+ * no length limit. Entries appended after `end` was taken are not visited.
+ *
+ * @return 0 on success or if the file does not exist, 1 on read error
+ */
+int history_storage_scan_newest(const char *path, off_t end, HistoryScanFn fn, void *userdata);
+
+/**
+ * Walk the whole log at `base` from newest to oldest entry, segment by
+ * segment. Segments after `last_segment` are ignored and that segment is
+ * read up to `last_end`, so entries written after the walk began are not
+ * visited.
+ */
+int history_storage_scan_log(const char *base, int last_segment, off_t last_end, HistoryScanFn fn, void *userdata);
+
+/** Where a line copied by history_storage_copy_newest() starts, before and after. */
+typedef struct {
+    off_t from;
+    off_t to;
+} HistoryLineMove;
+
+/**
+ * Copy the newest `keep` (at least 1) entries of a history file to `dest`
+ * and fsync it; the caller renames it over `path`. Lines are copied as they
+ * are, except that the response_body_view field stored by older versions
+ * is dropped. `*moves` lists the old and new offset of every copied line,
+ * in file order; free() it.
+ *
+ * @return 0 on success; `*nmoves` is 0 (and `dest` is not created) when the
+ *         file holds no more than `keep` entries. 1 on I/O error.
+ */
+int history_storage_copy_newest(const char *path, int keep, const char *dest, HistoryLineMove **moves, int *nmoves);
+
+/**
+ * Serialize one entry as a history.jsonl line, without the newline.
+ * Response strings of HISTORY_SHARED_BODY_MIN_BYTES or more are written as
+ * "<field>_ref":"<hash>"; the caller stores them with
+ * history_storage_write_body() before the line. Other bodies worth
+ * compressing are written as "<field>_z" holding base64 of the zlib stream.
+ *
+ * @return Heap string, or NULL on allocation failure
+ */
+char *history_storage_format_entry(const HistoryItem *it);
+
+/**
+ * Add the seq field to a line formatted by history_storage_format_entry()
+ * before the entry was given its seq. Takes ownership of `line`.
+ *
+ * @return New heap line, or NULL on allocation failure
+ */
+char *history_storage_set_line_seq(char *line, unsigned long seq);
+
+/*
+ * Shared bodies live in `<base>.bodies/<hash>`, one file per distinct
+ * content however many entries refer to it, or in `<hash>.z` when stored
+ * compressed. The hash is always that of the original bytes.
+ */
+
+/** @return 1 if the body with this hash is stored for the log at `base`, 0 otherwise */
+int history_storage_has_body(const char *base, const BodyHash *hash);
+
+/** Store a body for the log at `base` unless it is already there, durably. @return 0 on success */
+int history_storage_write_body(const char *base, const char *data, size_t len);
+
+/** history_storage_write_body() for a body whose body_hash() is already known. */
+int history_storage_write_body_hashed(const char *base, const char *data, size_t len, const BodyHash *hash);
+
+/**
+ * Every body hash referenced by the log at `base`, sorted for bsearch().
+ *
+ * @return 0 on success (`*refs_out` is NULL when there are none), 1 on error
+ */
+int history_storage_body_refs(const char *base, BodyHash **refs_out, size_t *count_out);
+
+/**
+ * Delete the stored bodies of the log at `base` that are neither in `refs`
+ * (from history_storage_body_refs()) nor in `live` (may be NULL). Bodies of
+ * entries about to be appended must be in `live` or they may go too.
+ *
+ * @return 0 on success, 1 if some file could not be removed
+ */
+int history_storage_sweep_bodies(const char *base, const BodyHash *refs, size_t nrefs, const BodyStore *live);
+
+/**
+ * Read the bodies and headers of an entry loaded by history_storage_load(),
+ * sharing response strings through the history's body store. Does nothing
+ * for entries already in memory.
+ *
+ * @return 0 on success, 1 if the entry's line cannot be read or no longer
+ *         matches (e.g. the file was rewritten by another instance)
+ */
+int history_storage_page_in(History *h, HistoryItem *it);
+
+/** Check on one field of an entry's text; nonzero accepts it. */
+typedef int (*HistoryTextTest)(const char *text, size_t len, void *userdata);
+
+/**
+ * Run `test` on the request body and headers and the response strings of
+ * an entry that is not paged in, read from disk but not kept, until one is
+ * accepted. Stored bodies already in the history's body store are not read
+ * again.
+ *
+ * @return 1 if a field was accepted, 0 if none was or the entry's line
+ *         cannot be read
+ */
+int history_storage_test_text(History *h, const HistoryItem *it, HistoryTextTest test, void *userdata);
+
+/**
+ * Rewrite the log at `path` as a single segment holding every entry.
+ * Entries that were never paged in are copied from the backing log
+ * verbatim, less the response_body_view field of older versions; when
+ * `path` is the backing log their locations are updated.
+ * Stored bodies no entry refers to any more are deleted.
+ */
+int history_storage_save(History *h, const char *path);
+int history_storage_append_last(History *h, const char *path);
+
+/**
+ * Compress bodies of entries written from now on with zlib at `level`
+ * (0 turns it off) once they are at least `min_bytes` long. Both request
+ * bodies and response strings are covered; entries already on disk keep
+ * their form and stay readable. Call before any thread writes entries.
+ */
+void history_storage_set_compression(int level, size_t min_bytes);
+
+/*
+ * The full-text index (see history_index.h) is kept in `<base>.fulltext`.
+ * It is a cache over the log: entries recorded while it was missing or
+ * after it was last saved are found by method and URL only.
+ */
+
+/** @return Heap path of the full-text index of the log at `base`, or NULL */
+char *history_storage_fulltext_path(const char *base);
+
+/**
+ * Read the index saved beside the log at `base`. Touches no History, so it
+ * can run off the UI thread.
+ *
+ * @return The index, an empty one if it is missing or cannot be read, or
+ *         NULL on allocation failure
+ */
+HistoryIndex *history_storage_read_fulltext(const char *base);
+
+/**
+ * Turn on full-text indexing for `h` with the index saved beside the log at
+ * `base`, or an empty one if it is missing or cannot be read.
+ *
+ * @return 0 on success, 1 on allocation failure (indexing stays off)
+ */
+int history_storage_load_fulltext(History *h, const char *base);
+
+/** Save the index of `h` beside the log at `base`; does nothing when it is off. @return 0 on success */
+int history_storage_save_fulltext(History *h, const char *base);
+
+/** Settings read from history.conf. */
+typedef struct {
+    int max_entries;
+    int compress_level;         /**< zlib level 1-9, or 0 to store bodies as they are */
+    size_t compress_min_bytes;  /**< Shorter bodies are never compressed */
+    int fulltext_index;         /**< Index bodies and headers for search */
+} HistoryConfig;
+
+/**
+ * Read history.conf at `path` into `out`. Settings that are missing or
+ * out of range keep their defaults, as does everything when the file
+ * cannot be read.
+ */
+void history_config_load(const char *path, HistoryConfig *out);
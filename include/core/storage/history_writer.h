@@ -0,0 +1,49 @@
+#pragma once
+
+#include "state.h"
+#include "core/storage/body_store.h"
+
+/**
+ * History persistence thread.
+ *
+ * Callers queue immutable records while holding the state lock and return
+ * at once; the writer thread applies them to history.jsonl in order. Appends
+ * that queue up while the disk is busy are written together and made
+ * durable with a single fsync (group commit). The outcome of each batch is
+ * published in `history.last_save_error`.
+ */
+
+/**
+ * Start the writer for `s->history.path`.
+ *
+ * @return 0 on success, 1 otherwise (callers fall back to writing inline)
+ */
+int history_writer_start(AppState *s);
+
+/** Write everything still queued, then stop the thread; safe if never started. */
+void history_writer_stop(AppState *s);
+
+/**
+ * Queue one serialized entry (see history_storage_format_entry()); the
+ * writer takes ownership of `line`, also on failure.
+ *
+ * @return 0 if queued, 1 on allocation failure
+ */
+int history_writer_append(HistoryWriter *w, char *line);
+
+/**
+ * Queue a shared body for history_storage_write_body(); queue it before
+ * the entry referring to it. Nothing is copied: `body` is either the text
+ * of `map`, of which the job takes a reference, or a string from the
+ * history's body store, which stays pinned until it is written. `hash` is
+ * its body_hash(). Call with the state lock held.
+ *
+ * @return 0 if queued, 1 on allocation failure
+ */
+int history_writer_store_body(HistoryWriter *w, char *body, size_t len, const BodyHash *hash, MappedBody *map);
+
+/** Queue a rewrite that keeps only the newest `keep` entries of the file. */
+int history_writer_trim(HistoryWriter *w, int keep);
+
+/** Queue truncation of the file (:history clear). */
+int history_writer_clear(HistoryWriter *w);
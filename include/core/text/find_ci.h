@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * ASCII case-insensitive substring search, the inner loop of history and
+ * response search. Candidates are found by comparing the case-folded first
+ * and last needle bytes against a whole vector of haystack at once, then
+ * checked byte by byte. Bytes outside A-Z/a-z must match exactly.
+ */
+
+typedef enum {
+    FIND_CI_SCALAR = 0,
+    FIND_CI_SSE2,
+    FIND_CI_AVX2
+} FindCiKernel;
+
+/**
+ * First occurrence of the `needle_n` bytes at `needle` in the `hay_n` bytes
+ * at `hay`, using the fastest kernel this CPU supports. Neither needs to be
+ * NUL-terminated. An empty needle matches at `hay`.
+ *
+ * @return Pointer to the match in `hay`, or NULL
+ */
+const char *find_ci(const char *hay, size_t hay_n, const char *needle, size_t needle_n);
+
+/** Kernel find_ci() dispatches to, chosen once from the CPU's features. */
+FindCiKernel find_ci_kernel(void);
+
+/**
+ * find_ci() through a specific kernel, for tests and benchmarks. A kernel
+ * the CPU or the build lacks falls back to the best one available.
+ */
+const char *find_ci_with(FindCiKernel kernel, const char *hay, size_t hay_n, const char *needle, size_t needle_n);
+
+const char *find_ci_kernel_name(FindCiKernel kernel);
@@ -30,6 +30,8 @@ typedef enum {
     I18N_PANEL_UNKNOWN,
 
     I18N_SENDING_REQUEST,
+    I18N_RECEIVING_META_FMT,
+    I18N_STREAM_PREVIEW_FMT,
     I18N_REQUEST_FAILED,
     I18N_NO_RESPONSE_YET,
     I18N_RESPONSE_META_FMT,
@@ -40,6 +42,13 @@ typedef enum {
     I18N_TOPBAR_FMT,
     I18N_STATUS_NOT_FOUND_FMT,
     I18N_STATUS_DEFAULT_FMT,
+    I18N_STATUS_LOADING_FMT,
+    I18N_STATUS_MATCH_FMT,
+    I18N_STATUS_SEARCHING_FMT,
+    I18N_STATUS_BAD_PATTERN_FMT,
+    I18N_SEARCH_COUNT_FMT,
+    I18N_SEARCH_BUSY,
+    I18N_SEARCH_BAD_PATTERN,
     I18N_ENV_NONE,
     I18N_HINT_FOOTER,
     I18N_WIN_HISTORY,
@@ -48,6 +57,7 @@ typedef enum {
     I18N_WIN_EDITOR_BODY,
     I18N_WIN_EDITOR_HEADERS,
     I18N_WIN_RESPONSE,
+    I18N_WIN_RESPONSE_SLOT_FMT,
 
     I18N_UNKNOWN_ERROR,
     I18N_USAGE_THEME_NAME_SAVE,
@@ -77,6 +87,10 @@ typedef enum {
     I18N_SEARCH_TARGET_UPDATED,
     I18N_USAGE_SET_MAX_ENTRIES,
     I18N_MAX_ENTRIES_UPDATED_SESSION,
+    I18N_USAGE_SET_MAX_RESPONSE_MB,
+    I18N_MAX_RESPONSE_MB_UPDATED_SESSION,
+    I18N_USAGE_SET_SPILL_MB,
+    I18N_SPILL_MB_UPDATED_SESSION,
     I18N_UNKNOWN_SETTING,
     I18N_USAGE_LANG,
     I18N_USAGE_LANG_LIST,
@@ -97,6 +111,7 @@ typedef enum {
     I18N_HELP_HEADER_HISTORY,
     I18N_HELP_HEADER_SETTINGS,
     I18N_HELP_HEADER_COOKIES,
+    I18N_HELP_HEADER_BENCH,
     I18N_HELP_CMD_QUIT,
     I18N_HELP_CMD_HELP,
     I18N_HELP_CMD_LANG_LIST,
@@ -111,9 +126,11 @@ typedef enum {
     I18N_HELP_CMD_AUTH_BASIC,
     I18N_HELP_CMD_FIND,
     I18N_HELP_CMD_SET,
+    I18N_HELP_CMD_TIMEOUT,
     I18N_HELP_CMD_CLEAR,
     I18N_HELP_CMD_COOKIES_LIST,
     I18N_HELP_CMD_COOKIES_CLEAR,
+    I18N_HELP_CMD_BENCH,
     I18N_HELP_NAV_HEADER,
     I18N_HELP_NAV_LINE,
     I18N_HELP_KEYS_HEADER,
@@ -142,9 +159,21 @@ typedef enum {
     I18N_ACT_SEARCH_NEXT_DESC,
     I18N_ACT_SEARCH_PREV_DESC,
     I18N_ACT_TOGGLE_RESPONSE_VIEW_DESC,
+    I18N_ACT_NEXT_RESPONSE_DESC,
+    I18N_ACT_PREV_RESPONSE_DESC,
+    I18N_ACT_CANCEL_REQUEST_DESC,
     
     I18N_COOKIES_CLEARED,
 
+    I18N_USAGE_BENCH,
+    I18N_BENCH_RUNNING_FMT,
+    I18N_BENCH_ALREADY_RUNNING,
+    I18N_USAGE_TIMEOUT,
+    I18N_TIMEOUT_FMT,
+    I18N_TIMEOUT_UPDATED,
+    I18N_USAGE_SET_TIMEOUT_MS,
+    I18N_TIMEOUT_MS_UPDATED_SESSION,
+
     I18N_COUNT
 } I18nKey;
 
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * Start offsets of every line of an immutable text, so line `n` can be
+ * reached in O(1) instead of scanning from the beginning.
+ *
+ * A text of k newlines has k + 1 lines (a trailing newline ends with an
+ * empty line). `starts[count]` is a sentinel equal to the text length plus
+ * one, which makes the length of every line `starts[n + 1] - starts[n] - 1`.
+ *
+ * Indexes are reference-counted so a background scan can keep using one
+ * after the response that built it has moved on.
+ */
+typedef struct LineIndex {
+    size_t *starts;
+    int count;
+    int refs;
+} LineIndex;
+
+/**
+ * Index the first `len` bytes of `text`.
+ *
+ * @return New index with one reference, or NULL on allocation failure or
+ *         if the text has more lines than an int can count
+ */
+LineIndex *line_index_build(const char *text, size_t len);
+
+/** Take another reference; returns `idx`. Safe from any thread. */
+LineIndex *line_index_ref(LineIndex *idx);
+
+/** Drop a reference, freeing the index on the last one. Safe from any thread. */
+void line_index_release(LineIndex *idx);
+
+/**
+ * Locate line `line` of the text the index was built from.
+ *
+ * @param len Set to the line's length, excluding the newline
+ * @return Pointer to the first byte of the line, or NULL if out of range
+ */
+const char *line_index_line(const LineIndex *idx, const char *text, int line, size_t *len);
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "core/utils/bytebuf.h"
+
+#include <stddef.h>
+
+/** Standard base64 with padding. @return Heap string, or NULL on allocation failure */
+char *base64_encode(const void *data, size_t len);
+
+/**
+ * Decode `len` characters of padded base64, appending the bytes to `out`.
+ *
+ * @return 0 on success, 1 on invalid input or allocation failure
+ */
+int base64_decode(const char *text, size_t len, ByteBuf *out);
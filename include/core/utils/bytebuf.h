@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * Growable byte buffer with geometric growth.
+ *
+ * `data` is NUL-terminated whenever it is non-NULL, so text built with the
+ * append functions can be handed out as a C string. A non-zero `limit`
+ * makes appends that would exceed it fail without modifying the buffer.
+ */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    size_t limit; /**< Maximum `len`; 0 means unlimited */
+} ByteBuf;
+
+/** Initialise an empty buffer; no memory is allocated. */
+void bytebuf_init(ByteBuf *b);
+
+/** Release the buffer's memory and reset it (the limit is kept). */
+void bytebuf_free(ByteBuf *b);
+
+/** Empty the buffer but keep its memory for reuse. */
+void bytebuf_clear(ByteBuf *b);
+
+/**
+ * Make room for `extra` more bytes (plus the terminator).
+ *
+ * @return 0 on success, -1 on allocation failure or if the limit would be exceeded
+ */
+int bytebuf_reserve(ByteBuf *b, size_t extra);
+
+/** @return 0 on success, -1 on failure (buffer unchanged) */
+int bytebuf_append(ByteBuf *b, const void *data, size_t n);
+
+/** Append a NUL-terminated string. @return 0 on success, -1 on failure */
+int bytebuf_append_str(ByteBuf *b, const char *s);
+
+/** Append printf-style formatted text. @return 0 on success, -1 on failure */
+int bytebuf_appendf(ByteBuf *b, const char *fmt, ...);
+
+/**
+ * Hand the contents over to the caller and reset the buffer.
+ *
+ * @return Heap string the caller frees (an empty string if nothing was
+ *         appended), or NULL on allocation failure
+ */
+char *bytebuf_take(ByteBuf *b);
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "core/utils/bytebuf.h"
+
+#include <stddef.h>
+
+/**
+ * Compress `len` bytes into a zlib stream appended to `out`.
+ *
+ * @param level zlib level, 1 (fastest) to 9 (smallest)
+ * @return 0 on success, 1 on failure (`out` may hold a partial stream)
+ */
+int compress_deflate(const void *data, size_t len, int level, ByteBuf *out);
+
+/**
+ * Decompress a complete zlib stream, appending the original bytes to `out`.
+ *
+ * @return 0 on success, 1 if the stream is corrupt or truncated or memory
+ *         runs out
+ */
+int compress_inflate(const void *data, size_t len, ByteBuf *out);
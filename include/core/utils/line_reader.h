@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/**
+ * Sequential reader over the lines of a memory-mapped file. Lines are
+ * handed out in place, so they have no length limit and are never copied;
+ * they are not NUL-terminated. The file must not shrink while it is open.
+ */
+typedef struct {
+    const char *data;   /* NULL for an empty file */
+    size_t len;
+    size_t pos;
+} LineReader;
+
+/**
+ * Map `path` for reading.
+ *
+ * @return 0 on success, 1 on failure with errno set
+ */
+int line_reader_open(LineReader *r, const char *path);
+
+/**
+ * Next line, without its newline. A last line with no newline is returned
+ * too.
+ *
+ * @param len Set to the line's length
+ * @param offset Set to the file offset of the line's first byte (may be NULL)
+ * @return Pointer into the mapping, valid until line_reader_close(), or
+ *         NULL at end of file
+ */
+const char *line_reader_next(LineReader *r, size_t *len, off_t *offset);
+
+void line_reader_close(LineReader *r);
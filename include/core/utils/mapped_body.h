@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * Read-only, reference-counted mapping of a response body that was spilled
+ * to a temporary file. `data` is NUL-terminated so it can be used wherever
+ * a heap string is expected; the pages are backed by the file rather than
+ * by anonymous memory. A heap string can be adopted into the same shape so
+ * it is shared the same way.
+ */
+typedef struct MappedBody {
+    char *data;
+    size_t len;   /**< Bytes before the terminating NUL */
+    int refs;
+    int heap;     /**< `data` was adopted from the heap, not mapped */
+} MappedBody;
+
+/**
+ * Create an anonymous temporary file ($TMPDIR or /tmp) that is already
+ * unlinked, so it disappears with its last descriptor or mapping.
+ *
+ * @return File descriptor, or -1 on failure
+ */
+int mapped_body_tmpfile(void);
+
+/**
+ * Map the first `len` bytes of `fd` plus one terminating NUL, which the
+ * caller must already have written at offset `len`. The descriptor can be
+ * closed afterwards.
+ *
+ * @return New mapping with one reference, or NULL on failure
+ */
+MappedBody *mapped_body_map(int fd, size_t len);
+
+/**
+ * Take ownership of a NUL-terminated heap string of `len` bytes; the last
+ * release frees it.
+ *
+ * @return New holder with one reference, or NULL on allocation failure, in
+ *         which case the string stays with the caller
+ */
+MappedBody *mapped_body_adopt(char *data, size_t len);
+
+/** Take another reference; returns `m`. Safe from any thread. */
+MappedBody *mapped_body_ref(MappedBody *m);
+
+/** Drop a reference, unmapping (or freeing) on the last one. Safe from any thread. */
+void mapped_body_release(MappedBody *m);
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stddef.h>
+
+#define SHA256_DIGEST_LEN 32
+
+/** SHA-256 (FIPS 180-4) of the `len` bytes at `data`. */
+void sha256(const void *data, size_t len, unsigned char out[SHA256_DIGEST_LEN]);
@@ -40,10 +40,17 @@ typedef enum {
     PROMPT_SEARCH = 2
 } PromptKind;
 
+typedef struct MappedBody MappedBody;
+typedef struct LineIndex LineIndex;
+
 typedef struct HttpResponse {
     long status;
     char *body; 
     char *body_view;
+    MappedBody *body_map;   /* When set, body points into this mapping (body_view may alias it) */
+    MappedBody *view_map;   /* Holds body_view's bytes once indexed, so searches can share them */
+    LineIndex *view_lines;  /* Line offsets of body_view; NULL until indexed */
+    unsigned long view_gen; /* Unique per indexed body_view, 0 until indexed */
 
     double elapsed_ms;
     HttpTiming timing;
@@ -64,6 +71,18 @@ typedef enum {
 } HttpMethod;
 
 typedef struct History History;
+typedef struct HttpEngine HttpEngine;
+typedef struct RequestFinisher RequestFinisher;
+
+/* Screen regions the next ui_draw() repaints */
+typedef enum {
+    UI_DIRTY_CHROME = 1 << 0,    /* Outer border and top bar; implies every other region */
+    UI_DIRTY_FOOTER = 1 << 1,    /* Status line or prompt */
+    UI_DIRTY_HISTORY = 1 << 2,
+    UI_DIRTY_EDITOR = 1 << 3,
+    UI_DIRTY_RESPONSE = 1 << 4,
+    UI_DIRTY_ALL = (1 << 5) - 1
+} UiDirty;
 
 /* UI State - Mode, layout, theme, language */
 typedef struct {
@@ -80,6 +99,7 @@ typedef struct {
     UiLanguage language;
     ThemeCatalog theme_catalog;
     char active_theme_preset[64];
+    unsigned dirty;              /* UiDirty bits not yet repainted */
 } UIState;
 
 /* Editor State - URL, body, headers, method */
@@ -93,16 +113,52 @@ typedef struct {
     int headers_scroll;
     EditField active_field;
     HttpMethod method;
+    long timeout_ms;         /* :timeout override for this request, 0 = inherit */
+    long connect_timeout_ms;
 } EditorState;
 
+typedef enum {
+    REQUEST_SLOT_EMPTY = 0,
+    REQUEST_SLOT_IN_FLIGHT,
+    REQUEST_SLOT_DONE
+} RequestSlotState;
+
+/* One sent request and, once it lands, its response */
+typedef struct {
+    int id;                 /* Engine request id, 0 when empty */
+    RequestSlotState state;
+    HttpMethod method;
+    char *url;
+    HttpResponse response;  /* Moved into ResponseState.response while viewed */
+    char *stream;           /* Start of the body received so far while in flight (NUL-terminated) */
+    size_t stream_len;
+    size_t stream_cap;
+    size_t received;        /* Body bytes received so far, `stream` or not */
+    double rate_bps;        /* Smoothed receive rate of `received` */
+    double rate_sample_ms;
+    size_t rate_sample_len;
+} RequestSlot;
+
 /* Response State - HTTP response, status, scroll */
 typedef struct {
-    HttpResponse response;
-    int is_request_in_flight;
+    HttpResponse response;  /* What the response panel shows */
+    HttpEngine *engine; /* Created on first send, reused for the session */
+    RequestFinisher *finisher; /* Formats finished responses off the I/O thread */
+    RequestSlot slots[REQUEST_SLOTS_MAX];
+    int view_slot;          /* Slot shown in `response`, -1 for other content */
+    int requests_in_flight;
+    int bench_running;      /* A :bench run owns the panel until it reports */
+    int max_body_mb;        /* Larger response bodies fail the request; 0 = no limit */
+    int spill_mb;           /* Larger bodies are kept in a mapped temp file; 0 = never */
+    long timeout_ms;        /* Session default transfer timeout; 0 = none */
+    long connect_timeout_ms;
     int scroll;
     int show_headers;
 } ResponseState;
 
+typedef struct HistoryLoader HistoryLoader;
+typedef struct HistoryWriter HistoryWriter;
+
 /* History State - History entries, selection, persistence */
 typedef struct {
     History *history;
@@ -112,6 +168,10 @@ typedef struct {
     int loaded_ok;
     int skipped_invalid;
     int last_save_error;
+    int loading;            /* A background load is still adding entries */
+    int fulltext;           /* Full-text search is on; the loader installs the index */
+    HistoryLoader *loader;
+    HistoryWriter *writer;  /* Persists history off the UI thread; NULL writes inline */
 } HistoryState;
 
 /* Config State - Environments, paths, suggestions */
@@ -137,6 +197,44 @@ typedef struct {
     int command_history_index;
 } PromptState;
 
+/* Matches of a query, kept for n/N until the query or the content changes */
+typedef struct {
+    int *items;                 /* History indices or response lines, ascending */
+    int count;
+    int valid;
+    SearchTarget target;
+    const void *source;         /* History or HttpResponse that was searched */
+    unsigned long generation;   /* Its generation / view_gen at the time */
+    char query[PROMPT_MAX];
+} SearchMatches;
+
+/*
+ * History entries ranked by fuzzy match against the query being typed in
+ * search mode. The text matched for each entry is cached until the history
+ * changes, and the buffers are sized for the whole history then, so a
+ * keystroke only scores and sorts.
+ */
+typedef struct {
+    int active;                 /* The history panel shows `items` */
+    int *items;                 /* History indices as of `first_id`, best match first */
+    int count;
+    int cursor;                 /* Row of `items` that is selected */
+    long origin;                /* Id of the selection when the search began, restored on cancel */
+    char query[PROMPT_MAX];     /* Query `items` was ranked for */
+
+    const void *source;         /* History the cache was built for */
+    unsigned long generation;
+    long first_id;              /* History first_id when the cache was built */
+    int capacity;               /* Entries the cache and buffers hold */
+    char *texts;                /* "method url status" of every entry, lower case, back to back */
+    size_t *offsets;            /* Entry i is texts[offsets[i]] .. texts[offsets[i + 1]] */
+    unsigned long long *keys;   /* Sort scratch: score and index of each candidate */
+    unsigned long long *scratch;
+} FuzzyFinder;
+
+typedef struct SearchRegex SearchRegex;
+typedef struct SearchWorker SearchWorker;
+
 /* Search State - Search functionality */
 typedef struct {
     char query[PROMPT_MAX];
@@ -144,12 +242,23 @@ typedef struct {
     int target_override; /* -1 auto, else SearchTarget */
     int match_index;
     int not_found;
+    SearchMatches matches;
+    FuzzyFinder fuzzy;
+
+    /* Regular expression queries ("re:" prefix) */
+    SearchRegex *regex;         /* Last pattern that compiled, reused while it is unchanged */
+    char regex_error[128];      /* Why the last pattern did not compile, or "" */
+    SearchWorker *worker;       /* Scans large responses off the UI thread; NULL until needed */
+    unsigned long scan_id;      /* Id of the wanted scan; bumping it cancels the running one */
+    int scanning;               /* The wanted scan has not finished yet */
+    int scan_jump;              /* Show its first match when it does */
 } SearchState;
 
 /* Main Application State - Composed of sub-states */
 typedef struct {
     int running;
     pthread_mutex_t state_mu;
+    int wake_fds[2];    /* Self-pipe that wakes the main loop; both 0 when absent */
     
     /* Sub-states - organized by concern */
     UIState ui;
@@ -167,3 +276,15 @@ void app_state_destroy(AppState *s);
 
 void app_state_lock(AppState *s);
 void app_state_unlock(AppState *s);
+
+/**
+ * Flag screen regions for repaint and wake the main loop. Safe to call
+ * from worker threads; the state lock must be held.
+ */
+void app_state_mark_dirty(AppState *s, unsigned regions);
+
+/** Descriptor that becomes readable after app_state_mark_dirty(), or -1. */
+int app_state_wake_fd(const AppState *s);
+
+/** Consume pending wake-ups so the descriptor blocks again. */
+void app_state_drain_wake(AppState *s);
@@ -2,4 +2,13 @@
 #include "state.h"
 
 void ui_draw_init_theme(const AppState *state);
+/** Repaint the regions flagged in state->ui.dirty; returns early when none are. */
 void ui_draw(AppState *state);
+
+/**
+ * How long the main loop may wait for input before the next repaint is due.
+ *
+ * @return UI_STREAM_REDRAW_MS while a request is in flight (its progress
+ *         changes without any event), else -1 to wait indefinitely
+ */
+int ui_draw_idle_timeout_ms(AppState *state);
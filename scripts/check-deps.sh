@@ -11,7 +11,7 @@ for cmd in gcc make pkg-config; do
   fi
 done
 
-for pc in ncurses libcurl; do
+for pc in ncurses libcurl zlib; do
   if ! pkg-config --exists "$pc"; then
     echo "Missing pkg-config dependency: $pc"
     missing=1
@@ -26,6 +26,7 @@ install_with_apt() {
     pkg-config \
     libncurses-dev \
     libcurl4-openssl-dev \
+    zlib1g-dev \
     libcjson-dev
 }
 
@@ -38,6 +39,7 @@ install_with_dnf() {
     pkgconf-pkg-config \
     ncurses-devel \
     libcurl-devel \
+    zlib-devel \
     libcjson-devel; then
     echo "Retrying with cjson-devel fallback..."
     $SUDO dnf install -y \
@@ -46,6 +48,8 @@ install_with_dnf() {
       pkgconf-pkg-config \
       ncurses-devel \
       libcurl-devel \
+    zlib-devel \
+      zlib-devel \
       cjson-devel
   fi
 }
@@ -58,6 +62,7 @@ install_with_pacman() {
     pkgconf \
     ncurses \
     curl \
+    zlib \
     cjson
 }
 
@@ -70,6 +75,7 @@ install_with_zypper() {
     pkg-config \
     ncurses-devel \
     libcurl-devel \
+    zlib-devel \
     libcjson-devel
 }
 
@@ -82,6 +88,7 @@ install_with_brew() {
     pkg-config \
     ncurses \
     curl \
+    zlib \
     cjson
 }
 
@@ -95,7 +102,7 @@ validate_environment() {
     fi
   done
 
-  for pc in ncurses libcurl libcjson; do
+  for pc in ncurses libcurl zlib libcjson; do
     if [ "$pc" = "libcjson" ]; then
       if ! pkg-config --exists libcjson && ! pkg-config --exists cjson; then
         echo "Missing pkg-config dependency: libcjson (or cjson)"
@@ -137,6 +144,7 @@ Please install these dependencies manually:
 - pkg-config
 - ncurses (development package)
 - libcurl (development package)
+- zlib (development package)
 - cJSON (development package)
 EOF
     exit 1
@@ -0,0 +1,623 @@
+/*
+ * batch.c - Headless collection runner (`tcurl run`)
+ *
+ * Loads request definitions, expands their templates up front, then keeps
+ * `concurrency` transfers in flight on a private engine. Completions arrive
+ * on the engine's I/O thread, which formats the result line and submits the
+ * next request; the calling thread writes the lines as they come in and
+ * waits for the last one. Nothing here touches ncurses, themes, keymaps or
+ * history.
+ */
+
+#include "core/cli/batch.h"
+#include "core/cjson_compat.h"
+#include "core/config/constants.h"
+#include "core/http/bench.h"
+#include "core/http/http.h"
+#include "core/http/http_engine.h"
+#include "core/storage/paths.h"
+#include "core/utils/bytebuf.h"
+#include "core/utils/mapped_body.h"
+#include "core/utils/utils.h"
+
+#include <curl/curl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int method_from_json(const cJSON *node, HttpMethod *out) {
+    if (!node) {
+        *out = HTTP_GET;
+        return 0;
+    }
+    if (cJSON_IsNumber(node)) {
+        if (node->valueint < 0 || node->valueint >= HTTP_METHOD_COUNT) return 1;
+        *out = (HttpMethod)node->valueint;
+        return 0;
+    }
+    if (!cJSON_IsString(node) || !node->valuestring) return 1;
+
+    for (int m = 0; m < HTTP_METHOD_COUNT; m++) {
+        if (str_eq_ci(node->valuestring, http_method_name((HttpMethod)m))) {
+            *out = (HttpMethod)m;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* ---- Collection ---- */
+
+void batch_collection_init(BatchCollection *c) {
+    if (!c) return;
+    c->items = NULL;
+    c->count = 0;
+    c->cap = 0;
+}
+
+void batch_collection_free(BatchCollection *c) {
+    if (!c) return;
+    for (int i = 0; i < c->count; i++) {
+        request_snapshot_free(&c->items[i]);
+    }
+    free(c->items);
+    batch_collection_init(c);
+}
+
+static char *json_string_dup(const cJSON *obj, const char *key) {
+    const cJSON *v = cJSON_GetObjectItemCaseSensitive(obj, key);
+    if (cJSON_IsString(v) && v->valuestring) return strdup(v->valuestring);
+    return strdup("");
+}
+
+/* Headers are a "Key: value\n" string in exports; an array of lines is accepted too. */
+static char *json_headers_dup(const cJSON *obj) {
+    const cJSON *v = cJSON_GetObjectItemCaseSensitive(obj, "headers");
+    if (!cJSON_IsArray(v)) return json_string_dup(obj, "headers");
+
+    ByteBuf buf;
+    bytebuf_init(&buf);
+    const cJSON *line = NULL;
+    cJSON_ArrayForEach(line, v) {
+        if (!cJSON_IsString(line) || !line->valuestring) continue;
+        if (buf.len > 0 && bytebuf_append_str(&buf, "\n") != 0) goto fail;
+        if (bytebuf_append_str(&buf, line->valuestring) != 0) goto fail;
+    }
+    return bytebuf_take(&buf);
+
+fail:
+    bytebuf_free(&buf);
+    return NULL;
+}
+
+static long json_timeout(const cJSON *obj, const char *key) {
+    const cJSON *v = cJSON_GetObjectItemCaseSensitive(obj, key);
+    if (!cJSON_IsNumber(v) || v->valuedouble <= 0) return 0;
+    if (v->valuedouble > HTTP_TIMEOUT_MS_MAX) return HTTP_TIMEOUT_MS_MAX;
+    return (long)v->valuedouble;
+}
+
+static int snapshot_from_json(const cJSON *obj, RequestSnapshot *out) {
+    memset(out, 0, sizeof(*out));
+    if (!cJSON_IsObject(obj)) return 1;
+
+    const cJSON *url = cJSON_GetObjectItemCaseSensitive(obj, "url");
+    if (!cJSON_IsString(url) || !url->valuestring || !url->valuestring[0]) return 1;
+    if (method_from_json(cJSON_GetObjectItemCaseSensitive(obj, "method"), &out->method) != 0) return 1;
+
+    out->url = strdup(url->valuestring);
+    out->body_text = json_string_dup(obj, "body");
+    out->headers_text = json_headers_dup(obj);
+    out->env_name = json_string_dup(obj, "environment");
+    out->timeout_ms = json_timeout(obj, "timeout_ms");
+    out->connect_timeout_ms = json_timeout(obj, "connect_timeout_ms");
+
+    if (!out->url || !out->body_text || !out->headers_text || !out->env_name) {
+        request_snapshot_free(out);
+        return 1;
+    }
+    return 0;
+}
+
+static int collection_push(BatchCollection *c, const RequestSnapshot *snap) {
+    if (c->count == c->cap) {
+        int next = c->cap ? c->cap * 2 : 8;
+        RequestSnapshot *items = realloc(c->items, (size_t)next * sizeof(*items));
+        if (!items) return 1;
+        c->items = items;
+        c->cap = next;
+    }
+    c->items[c->count++] = *snap;
+    return 0;
+}
+
+int batch_collection_parse(BatchCollection *c, const char *json) {
+    if (!c || !json) return 1;
+
+    cJSON *root = cJSON_Parse(json);
+    if (!root) return 1;
+
+    const cJSON *list = root;
+    if (cJSON_IsObject(root)) {
+        const cJSON *requests = cJSON_GetObjectItemCaseSensitive(root, "requests");
+        if (cJSON_IsArray(requests)) list = requests;
+    }
+
+    int first = c->count;
+    int rc = 0;
+    if (cJSON_IsArray(list)) {
+        const cJSON *item = NULL;
+        cJSON_ArrayForEach(item, list) {
+            RequestSnapshot snap;
+            if (snapshot_from_json(item, &snap) != 0 || collection_push(c, &snap) != 0) {
+                request_snapshot_free(&snap);
+                rc = 1;
+                break;
+            }
+        }
+    } else {
+        RequestSnapshot snap;
+        if (snapshot_from_json(list, &snap) != 0 || collection_push(c, &snap) != 0) {
+            request_snapshot_free(&snap);
+            rc = 1;
+        }
+    }
+    cJSON_Delete(root);
+
+    if (rc != 0) {
+        while (c->count > first) request_snapshot_free(&c->items[--c->count]);
+    }
+    return rc;
+}
+
+static char *read_stream(FILE *f) {
+    ByteBuf buf;
+    bytebuf_init(&buf);
+
+    char chunk[8192];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        if (bytebuf_append(&buf, chunk, n) != 0) {
+            bytebuf_free(&buf);
+            return NULL;
+        }
+    }
+    if (ferror(f)) {
+        bytebuf_free(&buf);
+        return NULL;
+    }
+    return bytebuf_take(&buf);
+}
+
+int batch_collection_load_file(BatchCollection *c, const char *path) {
+    if (!c || !path) return 1;
+
+    char *json = NULL;
+    if (strcmp(path, "-") == 0) {
+        json = read_stream(stdin);
+    } else {
+        FILE *f = fopen(path, "rb");
+        if (!f) return 1;
+        json = read_stream(f);
+        fclose(f);
+    }
+    if (!json) return 1;
+
+    int rc = batch_collection_parse(c, json);
+    free(json);
+    return rc;
+}
+
+/* ---- Runner ---- */
+
+typedef struct {
+    ResolvedRequest resolved;
+    char *error;              /* Template failure; the request is reported, not sent */
+} BatchItem;
+
+/* A result line waiting for the calling thread to write it */
+typedef struct BatchLine {
+    char *text;
+    struct BatchLine *next;
+} BatchLine;
+
+typedef struct {
+    const BatchCollection *collection;
+    BatchItem *items;
+    HttpEngine *engine;
+    int include_body;
+    size_t spill_threshold_bytes;
+
+    pthread_mutex_t mu;       /* Guards everything below */
+    pthread_cond_t cond;
+    BatchLine *lines;         /* Oldest first */
+    BatchLine *lines_tail;
+    int next;
+    int outstanding;
+    int finished;
+    int failed;
+} BatchRun;
+
+typedef struct {
+    BatchRun *run;
+    int index;
+} BatchTicket;
+
+static void add_timing(cJSON *obj, const HttpTiming *t) {
+    cJSON *timing = cJSON_CreateObject();
+    if (!timing) return;
+    cJSON_AddNumberToObject(timing, "dns_ms", t->dns_ms);
+    cJSON_AddNumberToObject(timing, "tcp_ms", t->tcp_ms);
+    cJSON_AddNumberToObject(timing, "tls_ms", t->tls_ms);
+    cJSON_AddNumberToObject(timing, "ttfb_ms", t->ttfb_ms);
+    cJSON_AddNumberToObject(timing, "transfer_ms", t->transfer_ms);
+    cJSON_AddNumberToObject(timing, "total_ms", t->total_ms);
+    cJSON_AddBoolToObject(timing, "connection_reused", t->connection_reused);
+    cJSON_AddItemToObject(obj, "timing", timing);
+}
+
+static int result_ok(const HttpResponse *r) {
+    return r && !r->error && r->status < 400;
+}
+
+/* The JSON line for one request. A NULL response reports `error` instead.
+   Only reads what is fixed for the whole run, so no lock is needed. */
+static char *format_result(const BatchRun *run, int index, const HttpResponse *r, const char *error) {
+    const RequestSnapshot *snap = &run->collection->items[index];
+    const BatchItem *item = &run->items[index];
+
+    cJSON *obj = cJSON_CreateObject();
+    if (!obj) return NULL;
+
+    cJSON_AddNumberToObject(obj, "index", index);
+    cJSON_AddStringToObject(obj, "method", http_method_name(snap->method));
+    cJSON_AddStringToObject(obj, "url", item->resolved.url ? item->resolved.url : snap->url);
+
+    if (r) {
+        size_t bytes = r->body_map ? r->body_map->len : (r->body ? strlen(r->body) : 0);
+        cJSON_AddNumberToObject(obj, "status", (double)r->status);
+        cJSON_AddNumberToObject(obj, "elapsed_ms", r->elapsed_ms);
+        cJSON_AddNumberToObject(obj, "bytes", (double)bytes);
+        add_timing(obj, &r->timing);
+        error = r->error;
+    }
+    if (error) cJSON_AddStringToObject(obj, "error", error);
+    else cJSON_AddNullToObject(obj, "error");
+    if (r && run->include_body) cJSON_AddStringToObject(obj, "body", r->body ? r->body : "");
+
+    char *line = cJSON_PrintUnformatted(obj);
+    cJSON_Delete(obj);
+    return line;
+}
+
+/* Called with run->mu held. Takes `line` (NULL if it could not be built)
+   and queues it for the calling thread. */
+static void queue_result(BatchRun *run, char *line, int ok) {
+    if (!ok) run->failed++;
+    if (!line) return;
+
+    BatchLine *l = malloc(sizeof(*l));
+    if (!l) {
+        free(line);
+        return;
+    }
+    l->text = line;
+    l->next = NULL;
+    if (run->lines_tail) run->lines_tail->next = l;
+    else run->lines = l;
+    run->lines_tail = l;
+}
+
+/* Called with run->mu held; reports a request that was never sent. */
+static void report_unsent(BatchRun *run, int index, const char *error) {
+    queue_result(run, format_result(run, index, NULL, error), 0);
+}
+
+/* Write and free queued lines, flushing once so results still stream. */
+static void write_lines(FILE *out, BatchLine *l) {
+    while (l) {
+        BatchLine *next = l->next;
+        fputs(l->text, out);
+        fputc('\n', out);
+        free(l->text);
+        free(l);
+        l = next;
+    }
+    fflush(out);
+}
+
+static void on_batch_done(int id, HttpResponse *result, void *userdata);
+
+/* Called with run->mu held; reports requests that cannot be sent and
+   submits the next one that can. */
+static void submit_next(BatchRun *run) {
+    while (run->next < run->collection->count) {
+        int index = run->next++;
+        const RequestSnapshot *snap = &run->collection->items[index];
+        BatchItem *item = &run->items[index];
+
+        if (item->error) {
+            report_unsent(run, index, item->error);
+            run->finished++;
+            continue;
+        }
+
+        BatchTicket *ticket = malloc(sizeof(*ticket));
+        HttpRequestSpec spec = {
+            .method = snap->method,
+            .url = item->resolved.url,
+            .body = item->resolved.body,
+            .headers_text = item->resolved.headers_text,
+            .cookie_jar_path = NULL,
+            .max_body_bytes = 0,
+            .spill_threshold_bytes = run->spill_threshold_bytes,
+            .timeout_ms = item->resolved.timeout_ms,
+            .connect_timeout_ms = item->resolved.connect_timeout_ms,
+        };
+
+        if (ticket) {
+            ticket->run = run;
+            ticket->index = index;
+            if (http_engine_submit(run->engine, &spec, on_batch_done, ticket) > 0) {
+                run->outstanding++;
+                return;
+            }
+            free(ticket);
+        }
+        report_unsent(run, index, "Could not start request");
+        run->finished++;
+    }
+}
+
+static void on_batch_done(int id, HttpResponse *result, void *userdata) {
+    (void)id;
+    BatchTicket *ticket = userdata;
+    BatchRun *run = ticket->run;
+
+    char *line = format_result(run, ticket->index, result, result ? NULL : "Engine stopped");
+    int ok = result_ok(result);
+    if (result) http_response_free(result);
+
+    (void)pthread_mutex_lock(&run->mu);
+    queue_result(run, line, ok);
+    run->outstanding--;
+    run->finished++;
+    submit_next(run);
+    (void)pthread_cond_signal(&run->cond);
+    (void)pthread_mutex_unlock(&run->mu);
+
+    free(ticket);
+}
+
+/* Expand templates against the request's own environment, or `forced`. */
+static void resolve_item(const RequestSnapshot *snap, const EnvStore *envs, const char *forced,
+                         const BatchOptions *opt, BatchItem *out) {
+    EnvStore scoped = { 0 };
+    if (envs) scoped = *envs;
+
+    const char *want = forced ? forced : snap->env_name;
+    if (want && want[0]) {
+        for (int i = 0; i < scoped.count; i++) {
+            if (strcmp(scoped.items[i].name, want) == 0) {
+                scoped.active_index = i;
+                break;
+            }
+        }
+    }
+
+    char *missing = NULL;
+    if (request_snapshot_resolve(snap, &scoped, &out->resolved, &missing) != 0) {
+        char msg[256];
+        if (missing) snprintf(msg, sizeof(msg), "Missing variable: %s", missing);
+        else snprintf(msg, sizeof(msg), "Out of memory");
+        free(missing);
+        out->error = strdup(msg);
+        return;
+    }
+
+    if (out->resolved.timeout_ms <= 0) out->resolved.timeout_ms = opt->timeout_ms;
+    if (out->resolved.connect_timeout_ms <= 0) out->resolved.connect_timeout_ms = opt->connect_timeout_ms;
+}
+
+int batch_run(const BatchCollection *c, const EnvStore *envs, const BatchOptions *opt, FILE *out) {
+    if (!c || !opt || !out) return BATCH_EXIT_FAILED;
+    if (c->count == 0) return BATCH_EXIT_OK;
+
+    BatchRun run;
+    memset(&run, 0, sizeof(run));
+    run.collection = c;
+    run.include_body = opt->include_body;
+    run.spill_threshold_bytes = (size_t)HTTP_SPILL_MB_DEFAULT * 1024u * 1024u;
+
+    run.items = calloc((size_t)c->count, sizeof(*run.items));
+    if (!run.items) return BATCH_EXIT_FAILED;
+    for (int i = 0; i < c->count; i++) {
+        resolve_item(&c->items[i], envs, opt->env_name, opt, &run.items[i]);
+    }
+
+    run.engine = http_engine_create();
+    (void)pthread_mutex_init(&run.mu, NULL);
+    (void)pthread_cond_init(&run.cond, NULL);
+
+    int concurrency = opt->concurrency;
+    if (concurrency < 1) concurrency = 1;
+    if (concurrency > BENCH_CONCURRENCY_MAX) concurrency = BENCH_CONCURRENCY_MAX;
+
+    (void)pthread_mutex_lock(&run.mu);
+    if (run.engine) {
+        for (int i = 0; i < concurrency; i++) submit_next(&run);
+    }
+    for (;;) {
+        /* Write outside the lock so completions are never held up by output */
+        BatchLine *lines = run.lines;
+        if (lines) {
+            run.lines = run.lines_tail = NULL;
+            (void)pthread_mutex_unlock(&run.mu);
+            write_lines(out, lines);
+            (void)pthread_mutex_lock(&run.mu);
+            continue;
+        }
+        if (run.finished == c->count) break;
+
+        /* Without an engine, or once submissions run dry, report what is left. */
+        if (run.outstanding == 0) {
+            int index = run.next++;
+            report_unsent(&run, index, run.items[index].error ? run.items[index].error
+                                                              : "Could not start request");
+            run.finished++;
+            continue;
+        }
+        (void)pthread_cond_wait(&run.cond, &run.mu);
+    }
+    int failed = run.failed;
+    (void)pthread_mutex_unlock(&run.mu);
+
+    http_engine_destroy(run.engine);
+    (void)pthread_cond_destroy(&run.cond);
+    (void)pthread_mutex_destroy(&run.mu);
+
+    for (int i = 0; i < c->count; i++) {
+        resolved_request_free(&run.items[i].resolved);
+        free(run.items[i].error);
+    }
+    free(run.items);
+    return failed ? BATCH_EXIT_FAILED : BATCH_EXIT_OK;
+}
+
+/* ---- Command line ---- */
+
+static void print_usage(FILE *f) {
+    fputs("Usage: tcurl run [options] <collection.json>... (\"-\" reads stdin)\n"
+          "  -c, --concurrency <n>       Requests in flight (default 4, max 64)\n"
+          "  -e, --env <name>            Environment for every request\n"
+          "      --envs <file>           Environments file (default: config envs.json)\n"
+          "      --timeout <ms>          Default transfer timeout (default 15000, 0 = none)\n"
+          "      --connect-timeout <ms>  Default connect timeout (default 10000)\n"
+          "      --body                  Include response bodies in the output\n"
+          "  -h, --help                  Show this help\n",
+          f);
+}
+
+static int parse_long_arg(const char *text, long min, long max, long *out) {
+    if (!text || !text[0]) return 1;
+    char *end = NULL;
+    errno = 0;
+    long v = strtol(text, &end, 10);
+    if (errno != 0 || !end || *end != '\0' || v < min || v > max) return 1;
+    *out = v;
+    return 0;
+}
+
+static int load_envs(EnvStore *envs, const char *explicit_path) {
+    if (explicit_path) {
+        FILE *f = fopen(explicit_path, "rb");
+        if (!f) return 1;
+        fclose(f);
+        return env_store_load_file(envs, explicit_path);
+    }
+
+    AppPaths paths;
+    paths_init(&paths);
+    int rc = 0;
+    if (paths_resolve_config_dir(&paths) == 0 && paths_build_file_paths(&paths) == 0) {
+        rc = env_store_load_file(envs, paths.envs_json);
+    } else {
+        rc = env_store_load_file(envs, "config/envs.json");
+    }
+    paths_free(&paths);
+    return rc;
+}
+
+int batch_main(int argc, char **argv) {
+    BatchOptions opt = {
+        .concurrency = 4,
+        .env_name = NULL,
+        .timeout_ms = HTTP_TIMEOUT_MS_DEFAULT,
+        .connect_timeout_ms = HTTP_CONNECT_TIMEOUT_MS_DEFAULT,
+        .include_body = 0,
+    };
+    const char *envs_path = NULL;
+    int first_file = -1;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *next = (i + 1 < argc) ? argv[i + 1] : NULL;
+        long v = 0;
+
+        if (strcmp(a, "-h") == 0 || strcmp(a, "--help") == 0) {
+            print_usage(stdout);
+            return BATCH_EXIT_OK;
+        } else if (strcmp(a, "-c") == 0 || strcmp(a, "--concurrency") == 0) {
+            if (parse_long_arg(next, 1, BENCH_CONCURRENCY_MAX, &v) != 0) goto usage;
+            opt.concurrency = (int)v;
+            i++;
+        } else if (strcmp(a, "-e") == 0 || strcmp(a, "--env") == 0) {
+            if (!next) goto usage;
+            opt.env_name = next;
+            i++;
+        } else if (strcmp(a, "--envs") == 0) {
+            if (!next) goto usage;
+            envs_path = next;
+            i++;
+        } else if (strcmp(a, "--timeout") == 0) {
+            if (parse_long_arg(next, 0, HTTP_TIMEOUT_MS_MAX, &v) != 0) goto usage;
+            opt.timeout_ms = v;
+            i++;
+        } else if (strcmp(a, "--connect-timeout") == 0) {
+            if (parse_long_arg(next, 0, HTTP_TIMEOUT_MS_MAX, &v) != 0) goto usage;
+            opt.connect_timeout_ms = v;
+            i++;
+        } else if (strcmp(a, "--body") == 0) {
+            opt.include_body = 1;
+        } else if (a[0] == '-' && a[1] != '\0') {
+            goto usage;
+        } else {
+            first_file = i;
+            break;
+        }
+    }
+    if (first_file < 0) goto usage;
+
+    EnvStore envs;
+    env_store_init(&envs);
+    if (load_envs(&envs, envs_path) != 0) {
+        fprintf(stderr, "tcurl run: cannot load environments from %s\n", envs_path ? envs_path : "envs.json");
+        env_store_free(&envs);
+        return BATCH_EXIT_USAGE;
+    }
+    if (opt.env_name) {
+        int found = 0;
+        for (int i = 0; i < envs.count && !found; i++) {
+            found = (strcmp(envs.items[i].name, opt.env_name) == 0);
+        }
+        if (!found) {
+            fprintf(stderr, "tcurl run: unknown environment '%s'\n", opt.env_name);
+            env_store_free(&envs);
+            return BATCH_EXIT_USAGE;
+        }
+    }
+
+    BatchCollection c;
+    batch_collection_init(&c);
+    for (int i = first_file; i < argc; i++) {
+        if (batch_collection_load_file(&c, argv[i]) != 0) {
+            fprintf(stderr, "tcurl run: cannot read collection %s\n", argv[i]);
+            batch_collection_free(&c);
+            env_store_free(&envs);
+            return BATCH_EXIT_USAGE;
+        }
+    }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    int rc = batch_run(&c, &envs, &opt, stdout);
+    curl_global_cleanup();
+
+    batch_collection_free(&c);
+    env_store_free(&envs);
+    return rc;
+
+usage:
+    print_usage(stderr);
+    return BATCH_EXIT_USAGE;
+}
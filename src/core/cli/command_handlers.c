@@ -1,9 +1,15 @@
 #include "core/cli/command_handlers.h"
 #include "core/storage/history.h"
+#include "core/storage/history_index.h"
 #include "core/storage/history_persistence.h"
+#include "core/storage/history_writer.h"
 #include "core/config/env.h"
 #include "core/config/layout.h"
 #include "core/http/request_snapshot.h"
+#include "core/http/http.h"
+#include "core/http/http_engine.h"
+#include "core/http/request_slots.h"
+#include "core/http/bench.h"
 #include "core/format/export.h"
 #include "core/interaction/auth.h"
 #include "core/utils/utils.h"
@@ -21,18 +27,9 @@ static void response_set_error(AppState *s, const char *err);
 
 /* Response management helpers */
 static void response_reset_content(AppState *s) {
-    free(s->response.response.body);
-    free(s->response.response.body_view);
-    free(s->response.response.response_headers);
-    free(s->response.response.error);
-
-    s->response.response.body = NULL;
-    s->response.response.body_view = NULL;
-    s->response.response.response_headers = NULL;
-    s->response.response.error = NULL;
-    s->response.response.status = 0;
-    s->response.response.elapsed_ms = 0.0;
-    s->response.response.is_json = 0;
+    /* Keep the viewed request's result in its slot; it can be shown again. */
+    request_slots_detach_view(&s->response);
+    http_response_free(&s->response.response);
     s->response.scroll = 0;
 }
 
@@ -40,6 +37,7 @@ static void response_set_text(AppState *s, const char *text) {
     response_reset_content(s);
     s->response.response.body = strdup(text ? text : "");
     s->response.response.body_view = strdup(text ? text : "");
+    (void)http_response_index_view(&s->response.response);
     s->ui.focused_panel = PANEL_RESPONSE;
 }
 
@@ -126,19 +124,26 @@ void cmd_clear_history(AppState *s) {
         return;
     }
 
-    if (s->response.is_request_in_flight) {
+    if (s->response.requests_in_flight > 0) {
         response_set_error(s, i18n_get(s->ui.language, I18N_CANNOT_CLEAR_HISTORY_IN_FLIGHT));
         return;
     }
 
+    /* Entries still being loaded belong to the file about to be emptied. */
+    s->history.loading = 0;
+    int fulltext = s->history.history->fulltext != NULL;
     history_free(s->history.history);
     history_init(s->history.history);
+    history_set_limit(s->history.history, s->history.max_entries);
+    if (fulltext) history_set_fulltext(s->history.history, history_index_new());
     s->history.selected = 0;
     s->search.match_index = -1;
     s->search.not_found = 0;
 
     int rc = 1;
-    if (s->history.path) {
+    if (s->history.writer) {
+        rc = history_writer_clear(s->history.writer);
+    } else if (s->history.path) {
         rc = history_storage_save(s->history.history, s->history.path);
     } else {
         char *path = history_storage_default_path();
@@ -233,6 +238,16 @@ void cmd_find(AppState *s, const char *query) {
     search_apply(s, query);
 }
 
+/* Milliseconds in 0..HTTP_TIMEOUT_MS_MAX; zero only when allow_zero. */
+static int parse_timeout_ms(const char *text, int allow_zero, long *out) {
+    if (!text || !*text) return 0;
+    char *end = NULL;
+    long n = strtol(text, &end, 10);
+    if (!end || *end != '\0' || n < (allow_zero ? 0 : 1) || n > HTTP_TIMEOUT_MS_MAX) return 0;
+    *out = n;
+    return 1;
+}
+
 void cmd_set(AppState *s, const char *key, const char *value) {
     if (!key || !*key) {
         char msg[256];
@@ -244,7 +259,11 @@ void cmd_set(AppState *s, const char *key, const char *value) {
             sizeof(msg),
             i18n_get(s->ui.language, I18N_SETTINGS_FMT),
             mode,
-            s->history.max_entries
+            s->history.max_entries,
+            s->response.max_body_mb,
+            s->response.spill_mb,
+            s->response.timeout_ms,
+            s->response.connect_timeout_ms
         );
         response_set_text(s, msg);
         return;
@@ -278,11 +297,55 @@ void cmd_set(AppState *s, const char *key, const char *value) {
             return;
         }
         s->history.max_entries = (int)n;
-        if (s->history.history) history_trim_oldest(s->history.history, s->history.max_entries);
+        if (s->history.history) history_set_limit(s->history.history, s->history.max_entries);
         response_set_text(s, i18n_get(s->ui.language, I18N_MAX_ENTRIES_UPDATED_SESSION));
         return;
     }
 
+    if (strcmp(key, "max_response_mb") == 0) {
+        if (!value) {
+            response_set_error(s, i18n_get(s->ui.language, I18N_USAGE_SET_MAX_RESPONSE_MB));
+            return;
+        }
+        char *end = NULL;
+        long n = strtol(value, &end, 10);
+        if (!end || *end != '\0' || n < 0 || n > HTTP_MAX_RESPONSE_MB) {
+            response_set_error(s, i18n_get(s->ui.language, I18N_USAGE_SET_MAX_RESPONSE_MB));
+            return;
+        }
+        s->response.max_body_mb = (int)n;
+        response_set_text(s, i18n_get(s->ui.language, I18N_MAX_RESPONSE_MB_UPDATED_SESSION));
+        return;
+    }
+
+    if (strcmp(key, "spill_mb") == 0) {
+        if (!value) {
+            response_set_error(s, i18n_get(s->ui.language, I18N_USAGE_SET_SPILL_MB));
+            return;
+        }
+        char *end = NULL;
+        long n = strtol(value, &end, 10);
+        if (!end || *end != '\0' || n < 0 || n > HTTP_MAX_RESPONSE_MB) {
+            response_set_error(s, i18n_get(s->ui.language, I18N_USAGE_SET_SPILL_MB));
+            return;
+        }
+        s->response.spill_mb = (int)n;
+        response_set_text(s, i18n_get(s->ui.language, I18N_SPILL_MB_UPDATED_SESSION));
+        return;
+    }
+
+    if (strcmp(key, "timeout_ms") == 0 || strcmp(key, "connect_timeout_ms") == 0) {
+        long ms = 0;
+        if (!parse_timeout_ms(value, 1, &ms)) {
+            response_set_error(s, i18n_get(s->ui.language, I18N_USAGE_SET_TIMEOUT_MS));
+            return;
+        }
+        if (strcmp(key, "timeout_ms") == 0) s->response.timeout_ms = ms;
+        else s->response.connect_timeout_ms = ms;
+        response_set_text(s, i18n_get(s->ui.language, I18N_TIMEOUT_MS_UPDATED_SESSION));
+        return;
+    }
+
     response_set_error(s, i18n_get(s->ui.language, I18N_UNKNOWN_SETTING));
 }
 
@@ -386,7 +449,8 @@ void cmd_cookies_clear(AppState *s) {
         return;
     }
 
-    /* Delete cookie file */
+    /* Forget the cookies the engine holds, then delete the cookie file */
+    http_engine_clear_cookies(s->response.engine);
     if (remove(s->config.paths.cookie_jar) != 0) {
         response_set_text(s, "No cookies to clear");
         return;
@@ -394,3 +458,54 @@ void cmd_cookies_clear(AppState *s) {
 
     response_set_text(s, i18n_get(s->ui.language, I18N_COOKIES_CLEARED));
 }
+
+static int parse_positive_int(const char *text, long max, int *out) {
+    if (!text || !*text) return 0;
+    char *end = NULL;
+    long n = strtol(text, &end, 10);
+    if (!end || *end != '\0' || n <= 0 || n > max) return 0;
+    *out = (int)n;
+    return 1;
+}
+
+void cmd_bench(AppState *s, const char *count, const char *concurrency) {
+    int n = 0;
+    int c = 0;
+    if (!parse_positive_int(count, BENCH_COUNT_MAX, &n) ||
+        !parse_positive_int(concurrency, BENCH_CONCURRENCY_MAX, &c)) {
+        response_set_error(s, i18n_get(s->ui.language, I18N_USAGE_BENCH));
+        return;
+    }
+
+    (void)bench_start(s, n, c);
+    s->ui.focused_panel = PANEL_RESPONSE;
+}
+
+void cmd_timeout(AppState *s, const char *total, const char *connect) {
+    if (!total || !*total) {
+        char msg[256];
+        snprintf(msg, sizeof(msg), i18n_get(s->ui.language, I18N_TIMEOUT_FMT),
+                 s->editor.timeout_ms, s->editor.connect_timeout_ms);
+        response_set_text(s, msg);
+        return;
+    }
+
+    if (strcmp(total, "off") == 0 && !connect) {
+        s->editor.timeout_ms = 0;
+        s->editor.connect_timeout_ms = 0;
+        response_set_text(s, i18n_get(s->ui.language, I18N_TIMEOUT_UPDATED));
+        return;
+    }
+
+    long total_ms = 0;
+    long connect_ms = 0;
+    if (!parse_timeout_ms(total, 0, &total_ms) ||
+        (connect && !parse_timeout_ms(connect, 0, &connect_ms))) {
+        response_set_error(s, i18n_get(s->ui.language, I18N_USAGE_TIMEOUT));
+        return;
+    }
+
+    s->editor.timeout_ms = total_ms;
+    s->editor.connect_timeout_ms = connect ? connect_ms : 0;
+    response_set_text(s, i18n_get(s->ui.language, I18N_TIMEOUT_UPDATED));
+}
@@ -3,6 +3,8 @@
 #include "core/cli/help_builder.h"
 #include "core/text/i18n.h"
 #include "state.h"
+#include "core/http/http.h"
+#include "core/http/request_slots.h"
 #include <ctype.h>
 #include <string.h>
 #include <stdio.h>
@@ -30,18 +32,9 @@ static void finish_command(AppState *s) {
 
 /* Helper: Set response error */
 static void response_reset_content(AppState *s) {
-    free(s->response.response.body);
-    free(s->response.response.body_view);
-    free(s->response.response.response_headers);
-    free(s->response.response.error);
-
-    s->response.response.body = NULL;
-    s->response.response.body_view = NULL;
-    s->response.response.response_headers = NULL;
-    s->response.response.error = NULL;
-    s->response.response.status = 0;
-    s->response.response.elapsed_ms = 0.0;
-    s->response.response.is_json = 0;
+    /* Keep the viewed request's result in its slot; it can be shown again. */
+    request_slots_detach_view(&s->response);
+    http_response_free(&s->response.response);
     s->response.scroll = 0;
 }
 
@@ -49,6 +42,7 @@ static void response_set_text(AppState *s, const char *text) {
     response_reset_content(s);
     s->response.response.body = strdup(text ? text : "");
     s->response.response.body_view = strdup(text ? text : "");
+    (void)http_response_index_view(&s->response.response);
     s->ui.focused_panel = PANEL_RESPONSE;
 }
 
@@ -232,6 +226,42 @@ static void handle_cookies(AppState *s, const Keymap *km, const char *args) {
     }
 }
 
+static void handle_bench(AppState *s, const Keymap *km, const char *args) {
+    (void)km;
+
+    char buf[128];
+    strncpy(buf, args ? args : "", sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    char *count = strtok(buf, " \t");
+    char *concurrency = strtok(NULL, " \t");
+    char *extra = strtok(NULL, " \t");
+
+    if (!count || !concurrency || extra) {
+        response_set_error(s, i18n_get(s->ui.language, I18N_USAGE_BENCH));
+    } else {
+        cmd_bench(s, count, concurrency);
+    }
+}
+
+static void handle_timeout(AppState *s, const Keymap *km, const char *args) {
+    (void)km;
+
+    char buf[128];
+    strncpy(buf, args ? args : "", sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    char *total = strtok(buf, " \t");
+    char *connect = strtok(NULL, " \t");
+    char *extra = strtok(NULL, " \t");
+
+    if (extra) {
+        response_set_error(s, i18n_get(s->ui.language, I18N_USAGE_TIMEOUT));
+    } else {
+        cmd_timeout(s, total, connect);
+    }
+}
+
 /* Command registry */
 static const CommandEntry command_registry[] = {
     {"quit", "q", handle_quit},
@@ -245,6 +275,8 @@ static const CommandEntry command_registry[] = {
     {"layout", NULL, handle_layout},
     {"clear!", "ch!", handle_clear_history},
     {"cookies", NULL, handle_cookies},
+    {"bench", NULL, handle_bench},
+    {"timeout", NULL, handle_timeout},
     {NULL, NULL, NULL}  /* Sentinel */
 };
 
@@ -1,6 +1,6 @@
 #include "core/cli/help_builder.h"
 #include "core/interaction/actions.h"
-#include "core/utils/utils.h"
+#include "core/utils/bytebuf.h"
 #include "core/text/i18n.h"
 #include "state.h"
 #include <ncurses.h>
@@ -43,10 +43,10 @@ static int key_name_from_code(int code, char *out, size_t out_sz) {
  * Append basic commands section to help text buffer.
  * Returns 0 on failure, 1 on success.
  */
-static int append_help_basic(char **buf, size_t *len, size_t *cap, UiLanguage lang) {
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_HEADER_BASIC))) return 0;
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_CMD_QUIT))) return 0;
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_CMD_HELP))) return 0;
+static int append_help_basic(ByteBuf *buf, UiLanguage lang) {
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_HEADER_BASIC)) != 0) return 0;
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_CMD_QUIT)) != 0) return 0;
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_CMD_HELP)) != 0) return 0;
     return 1;
 }
 
@@ -54,10 +54,10 @@ static int append_help_basic(char **buf, size_t *len, size_t *cap, UiLanguage la
  * Append language commands section to help text buffer.
  * Returns 0 on failure, 1 on success.
  */
-static int append_help_lang(char **buf, size_t *len, size_t *cap, UiLanguage lang) {
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_HEADER_LANG))) return 0;
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_CMD_LANG_LIST))) return 0;
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_CMD_LANG_SET))) return 0;
+static int append_help_lang(ByteBuf *buf, UiLanguage lang) {
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_HEADER_LANG)) != 0) return 0;
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_CMD_LANG_LIST)) != 0) return 0;
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_CMD_LANG_SET)) != 0) return 0;
     return 1;
 }
 
@@ -65,10 +65,10 @@ static int append_help_lang(char **buf, size_t *len, size_t *cap, UiLanguage lan
  * Append layout commands section to help text buffer.
  * Returns 0 on failure, 1 on success.
  */
-static int append_help_layout(char **buf, size_t *len, size_t *cap, UiLanguage lang) {
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_HEADER_LAYOUT))) return 0;
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_CMD_LAYOUT_LIST))) return 0;
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_CMD_LAYOUT_SET))) return 0;
+static int append_help_layout(ByteBuf *buf, UiLanguage lang) {
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_HEADER_LAYOUT)) != 0) return 0;
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_CMD_LAYOUT_LIST)) != 0) return 0;
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_CMD_LAYOUT_SET)) != 0) return 0;
     return 1;
 }
 
@@ -76,11 +76,11 @@ static int append_help_layout(char **buf, size_t *len, size_t *cap, UiLanguage l
  * Append theme management section to help text buffer.
  * Returns 0 on failure, 1 on success.
  */
-static int append_help_theme(char **buf, size_t *len, size_t *cap, UiLanguage lang) {
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_HEADER_THEME))) return 0;
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_CMD_THEME_LIST))) return 0;
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_CMD_THEME_APPLY))) return 0;
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_CMD_THEME_SAVE))) return 0;
+static int append_help_theme(ByteBuf *buf, UiLanguage lang) {
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_HEADER_THEME)) != 0) return 0;
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_CMD_THEME_LIST)) != 0) return 0;
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_CMD_THEME_APPLY)) != 0) return 0;
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_CMD_THEME_SAVE)) != 0) return 0;
     return 1;
 }
 
@@ -88,9 +88,9 @@ static int append_help_theme(char **buf, size_t *len, size_t *cap, UiLanguage la
  * Append export section to help text buffer.
  * Returns 0 on failure, 1 on success.
  */
-static int append_help_export(char **buf, size_t *len, size_t *cap, UiLanguage lang) {
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_HEADER_EXPORT))) return 0;
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_CMD_EXPORT))) return 0;
+static int append_help_export(ByteBuf *buf, UiLanguage lang) {
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_HEADER_EXPORT)) != 0) return 0;
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_CMD_EXPORT)) != 0) return 0;
     return 1;
 }
 
@@ -98,10 +98,10 @@ static int append_help_export(char **buf, size_t *len, size_t *cap, UiLanguage l
  * Append authentication section to help text buffer.
  * Returns 0 on failure, 1 on success.
  */
-static int append_help_auth(char **buf, size_t *len, size_t *cap, UiLanguage lang) {
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_HEADER_AUTH))) return 0;
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_CMD_AUTH_BEARER))) return 0;
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_CMD_AUTH_BASIC))) return 0;
+static int append_help_auth(ByteBuf *buf, UiLanguage lang) {
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_HEADER_AUTH)) != 0) return 0;
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_CMD_AUTH_BEARER)) != 0) return 0;
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_CMD_AUTH_BASIC)) != 0) return 0;
     return 1;
 }
 
@@ -109,9 +109,9 @@ static int append_help_auth(char **buf, size_t *len, size_t *cap, UiLanguage lan
  * Append search section to help text buffer.
  * Returns 0 on failure, 1 on success.
  */
-static int append_help_search(char **buf, size_t *len, size_t *cap, UiLanguage lang) {
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_HEADER_SEARCH))) return 0;
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_CMD_FIND))) return 0;
+static int append_help_search(ByteBuf *buf, UiLanguage lang) {
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_HEADER_SEARCH)) != 0) return 0;
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_CMD_FIND)) != 0) return 0;
     return 1;
 }
 
@@ -119,9 +119,9 @@ static int append_help_search(char **buf, size_t *len, size_t *cap, UiLanguage l
  * Append history section to help text buffer.
  * Returns 0 on failure, 1 on success.
  */
-static int append_help_history(char **buf, size_t *len, size_t *cap, UiLanguage lang) {
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_HEADER_HISTORY))) return 0;
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_CMD_CLEAR))) return 0;
+static int append_help_history(ByteBuf *buf, UiLanguage lang) {
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_HEADER_HISTORY)) != 0) return 0;
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_CMD_CLEAR)) != 0) return 0;
     return 1;
 }
 
@@ -129,9 +129,10 @@ static int append_help_history(char **buf, size_t *len, size_t *cap, UiLanguage
  * Append settings section to help text buffer.
  * Returns 0 on failure, 1 on success.
  */
-static int append_help_settings(char **buf, size_t *len, size_t *cap, UiLanguage lang) {
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_HEADER_SETTINGS))) return 0;
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_CMD_SET))) return 0;
+static int append_help_settings(ByteBuf *buf, UiLanguage lang) {
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_HEADER_SETTINGS)) != 0) return 0;
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_CMD_SET)) != 0) return 0;
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_CMD_TIMEOUT)) != 0) return 0;
     return 1;
 }
 
@@ -139,10 +140,20 @@ static int append_help_settings(char **buf, size_t *len, size_t *cap, UiLanguage
  * Append cookies section to help text buffer.
  * Returns 0 on failure, 1 on success.
  */
-static int append_help_cookies(char **buf, size_t *len, size_t *cap, UiLanguage lang) {
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_HEADER_COOKIES))) return 0;
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_CMD_COOKIES_LIST))) return 0;
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_CMD_COOKIES_CLEAR))) return 0;
+static int append_help_cookies(ByteBuf *buf, UiLanguage lang) {
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_HEADER_COOKIES)) != 0) return 0;
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_CMD_COOKIES_LIST)) != 0) return 0;
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_CMD_COOKIES_CLEAR)) != 0) return 0;
+    return 1;
+}
+
+/**
+ * Append benchmark section to help text buffer.
+ * Returns 0 on failure, 1 on success.
+ */
+static int append_help_bench(ByteBuf *buf, UiLanguage lang) {
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_HEADER_BENCH)) != 0) return 0;
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_CMD_BENCH)) != 0) return 0;
     return 1;
 }
 
@@ -150,13 +161,13 @@ static int append_help_cookies(char **buf, size_t *len, size_t *cap, UiLanguage
  * Append navigation and key bindings sections to help text buffer.
  * Returns 0 on failure, 1 on success.
  */
-static int append_help_keys(char **buf, size_t *len, size_t *cap, const Keymap *km, UiLanguage lang) {
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_NAV_HEADER))) return 0;
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_NAV_LINE))) return 0;
-    if (!str_appendf(buf, len, cap, "%s", i18n_get(lang, I18N_HELP_KEYS_HEADER))) return 0;
+static int append_help_keys(ByteBuf *buf, const Keymap *km, UiLanguage lang) {
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_NAV_HEADER)) != 0) return 0;
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_NAV_LINE)) != 0) return 0;
+    if (bytebuf_append_str(buf, i18n_get(lang, I18N_HELP_KEYS_HEADER)) != 0) return 0;
 
     for (int m = 0; m < MODE_COUNT; m++) {
-        if (!str_appendf(buf, len, cap, "[%s]\n", mode_name((Mode)m, lang))) return 0;
+        if (bytebuf_appendf(buf, "[%s]\n", mode_name((Mode)m, lang)) != 0) return 0;
         for (int k = 0; k < KEYMAP_MAX_KEYCODE; k++) {
             Action a = km->table[m][k];
             if (a == ACT_NONE) continue;
@@ -167,9 +178,9 @@ static int append_help_keys(char **buf, size_t *len, size_t *cap, const Keymap *
             if (!desc || !desc[0]) {
                 desc = i18n_get(lang, I18N_HELP_NO_DESC);
             }
-            if (!str_appendf(buf, len, cap, "  %-12s -> %s\n", key_name, desc)) return 0;
+            if (bytebuf_appendf(buf, "  %-12s -> %s\n", key_name, desc) != 0) return 0;
         }
-        if (!str_appendf(buf, len, cap, "\n")) return 0;
+        if (bytebuf_append_str(buf, "\n") != 0) return 0;
     }
 
     return 1;
@@ -178,25 +189,25 @@ static int append_help_keys(char **buf, size_t *len, size_t *cap, const Keymap *
 char *help_build_text(const Keymap *km, UiLanguage lang) {
     if (!km) return strdup(i18n_get(lang, I18N_NO_KEYMAP_LOADED));
 
-    char *buf = NULL;
-    size_t len = 0;
-    size_t cap = 0;
+    ByteBuf buf;
+    bytebuf_init(&buf);
 
-    if (!append_help_basic(&buf, &len, &cap, lang)) goto fail;
-    if (!append_help_lang(&buf, &len, &cap, lang)) goto fail;
-    if (!append_help_layout(&buf, &len, &cap, lang)) goto fail;
-    if (!append_help_theme(&buf, &len, &cap, lang)) goto fail;
-    if (!append_help_export(&buf, &len, &cap, lang)) goto fail;
-    if (!append_help_auth(&buf, &len, &cap, lang)) goto fail;
-    if (!append_help_search(&buf, &len, &cap, lang)) goto fail;
-    if (!append_help_history(&buf, &len, &cap, lang)) goto fail;
-    if (!append_help_settings(&buf, &len, &cap, lang)) goto fail;
-    if (!append_help_cookies(&buf, &len, &cap, lang)) goto fail;
-    if (!append_help_keys(&buf, &len, &cap, km, lang)) goto fail;
+    if (!append_help_basic(&buf, lang)) goto fail;
+    if (!append_help_lang(&buf, lang)) goto fail;
+    if (!append_help_layout(&buf, lang)) goto fail;
+    if (!append_help_theme(&buf, lang)) goto fail;
+    if (!append_help_export(&buf, lang)) goto fail;
+    if (!append_help_auth(&buf, lang)) goto fail;
+    if (!append_help_search(&buf, lang)) goto fail;
+    if (!append_help_history(&buf, lang)) goto fail;
+    if (!append_help_settings(&buf, lang)) goto fail;
+    if (!append_help_cookies(&buf, lang)) goto fail;
+    if (!append_help_bench(&buf, lang)) goto fail;
+    if (!append_help_keys(&buf, km, lang)) goto fail;
 
-    return buf;
+    return bytebuf_take(&buf);
 
 fail:
-    free(buf);
+    bytebuf_free(&buf);
     return NULL;
 }
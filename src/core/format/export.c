@@ -1,25 +1,13 @@
 #include "core/format/export.h"
 #include "core/cjson_compat.h"
-#include "core/utils/utils.h"
+#include "core/http/http.h"
+#include "core/utils/bytebuf.h"
 
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-static const char *method_name(HttpMethod m) {
-    switch (m) {
-        case HTTP_GET: return "GET";
-        case HTTP_POST: return "POST";
-        case HTTP_PUT: return "PUT";
-        case HTTP_DELETE: return "DELETE";
-        case HTTP_PATCH: return "PATCH";
-        case HTTP_HEAD: return "HEAD";
-        case HTTP_OPTIONS: return "OPTIONS";
-        default: return "GET";
-    }
-}
-
 static char *shell_quote_single(const char *in) {
     const char *s = in ? in : "";
     size_t n = 2;
@@ -52,18 +40,18 @@ char *export_as_curl(const RequestSnapshot *req) {
     char *url_q = shell_quote_single(req->url);
     if (!url_q) return NULL;
 
-    char *buf = NULL;
-    size_t len = 0, cap = 0;
-    if (!str_appendf(&buf, &len, &cap, "curl -X %s %s", method_name(req->method), url_q)) {
+    ByteBuf buf;
+    bytebuf_init(&buf);
+    if (bytebuf_appendf(&buf, "curl -X %s %s", http_method_name(req->method), url_q) != 0) {
         free(url_q);
-        free(buf);
+        bytebuf_free(&buf);
         return NULL;
     }
     free(url_q);
 
     char *headers = strdup(req->headers_text ? req->headers_text : "");
     if (!headers) {
-        free(buf);
+        bytebuf_free(&buf);
         return NULL;
     }
 
@@ -74,13 +62,13 @@ char *export_as_curl(const RequestSnapshot *req) {
         char *h_q = shell_quote_single(line);
         if (!h_q) {
             free(headers);
-            free(buf);
+            bytebuf_free(&buf);
             return NULL;
         }
-        if (!str_appendf(&buf, &len, &cap, " -H %s", h_q)) {
+        if (bytebuf_appendf(&buf, " -H %s", h_q) != 0) {
             free(h_q);
             free(headers);
-            free(buf);
+            bytebuf_free(&buf);
             return NULL;
         }
         free(h_q);
@@ -91,22 +79,22 @@ char *export_as_curl(const RequestSnapshot *req) {
         (req->method == HTTP_POST || req->method == HTTP_PUT)) {
         char *body_q = shell_quote_single(req->body_text);
         if (!body_q) {
-            free(buf);
+            bytebuf_free(&buf);
             return NULL;
         }
-        if (!str_appendf(&buf, &len, &cap, " --data-binary %s", body_q)) {
+        if (bytebuf_appendf(&buf, " --data-binary %s", body_q) != 0) {
             free(body_q);
-            free(buf);
+            bytebuf_free(&buf);
             return NULL;
         }
         free(body_q);
     }
 
-    if (!str_appendf(&buf, &len, &cap, "\n")) {
-        free(buf);
+    if (bytebuf_append_str(&buf, "\n") != 0) {
+        bytebuf_free(&buf);
         return NULL;
     }
-    return buf;
+    return bytebuf_take(&buf);
 }
 
 char *export_as_json(const RequestSnapshot *req) {
@@ -115,7 +103,7 @@ char *export_as_json(const RequestSnapshot *req) {
     cJSON *root = cJSON_CreateObject();
     if (!root) return NULL;
 
-    cJSON_AddStringToObject(root, "method", method_name(req->method));
+    cJSON_AddStringToObject(root, "method", http_method_name(req->method));
     cJSON_AddStringToObject(root, "url", req->url ? req->url : "");
     cJSON_AddStringToObject(root, "body", req->body_text ? req->body_text : "");
     cJSON_AddStringToObject(root, "headers", req->headers_text ? req->headers_text : "");
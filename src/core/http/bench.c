@@ -0,0 +1,334 @@
+/*
+ * bench.c - Built-in load test (:bench)
+ *
+ * Replays one resolved request through the session engine, keeping
+ * `concurrency` transfers in flight until `count` have finished. Each
+ * completion (on the engine's I/O thread) records its timing and submits
+ * the next request; the last one publishes the report under the state lock.
+ */
+
+#include "core/http/bench.h"
+#include "core/http/http.h"
+#include "core/http/http_engine.h"
+#include "core/http/request_slots.h"
+#include "core/http/request_snapshot.h"
+#include "core/utils/bytebuf.h"
+#include "core/text/i18n.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    AppState *state;
+    HttpEngine *engine;
+    HttpMethod method;
+    char *label_url;      /* Unexpanded URL, for the report */
+    ResolvedRequest resolved;
+    size_t max_body_bytes;
+    size_t spill_threshold_bytes;
+
+    pthread_mutex_t mu;   /* Guards everything below */
+    int submitted;
+    int outstanding;
+    int aborted;
+    struct timespec started;
+    BenchStats stats;
+} BenchRun;
+
+static double elapsed_ms_since(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) * 1000.0 +
+           (double)(now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+/* ---- Histogram ---- */
+
+static int bucket_index(uint64_t us) {
+    if (us < 2 * LATENCY_HIST_SUB_BUCKETS) return (int)us;
+
+    int msb = 63 - __builtin_clzll(us);
+    int shift = msb - 5;
+    int idx = shift * LATENCY_HIST_SUB_BUCKETS + (int)(us >> shift);
+    return idx < LATENCY_HIST_BUCKETS ? idx : LATENCY_HIST_BUCKETS - 1;
+}
+
+static uint64_t bucket_upper_us(int idx) {
+    if (idx < 2 * LATENCY_HIST_SUB_BUCKETS) return (uint64_t)idx + 1;
+
+    int shift = idx / LATENCY_HIST_SUB_BUCKETS - 1;
+    uint64_t mantissa = (uint64_t)(idx % LATENCY_HIST_SUB_BUCKETS) + LATENCY_HIST_SUB_BUCKETS;
+    return (mantissa + 1) << shift;
+}
+
+void latency_hist_init(LatencyHistogram *h) {
+    if (!h) return;
+    memset(h, 0, sizeof(*h));
+}
+
+void latency_hist_record(LatencyHistogram *h, double ms) {
+    if (!h) return;
+    if (ms < 0) ms = 0;
+
+    h->counts[bucket_index((uint64_t)(ms * 1000.0))]++;
+    h->total++;
+    if (ms > h->max_ms) h->max_ms = ms;
+}
+
+double latency_hist_percentile(const LatencyHistogram *h, double pct) {
+    if (!h || h->total == 0) return 0.0;
+    if (pct < 0) pct = 0;
+    if (pct > 100) pct = 100;
+
+    uint64_t rank = (uint64_t)((pct / 100.0) * (double)h->total + 0.999999);
+    if (rank < 1) rank = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            double ms = (double)bucket_upper_us(i) / 1000.0;
+            return ms < h->max_ms ? ms : h->max_ms;
+        }
+    }
+    return h->max_ms;
+}
+
+/* ---- Stats ---- */
+
+void bench_stats_init(BenchStats *st, int requested, int concurrency) {
+    if (!st) return;
+    memset(st, 0, sizeof(*st));
+    for (int i = 0; i < BENCH_PHASE_COUNT; i++) {
+        latency_hist_init(&st->phases[i]);
+    }
+    st->requested = requested;
+    st->concurrency = concurrency;
+}
+
+void bench_stats_record(BenchStats *st, const HttpResponse *r) {
+    if (!st || !r) return;
+
+    if (r->error) {
+        st->failed++;
+        return;
+    }
+
+    st->completed++;
+    if (r->status >= 400) st->http_errors++;
+
+    const HttpTiming *t = &r->timing;
+    latency_hist_record(&st->phases[BENCH_PHASE_DNS], t->dns_ms);
+    latency_hist_record(&st->phases[BENCH_PHASE_TCP], t->tcp_ms);
+    latency_hist_record(&st->phases[BENCH_PHASE_TLS], t->tls_ms);
+    latency_hist_record(&st->phases[BENCH_PHASE_TTFB], t->ttfb_ms);
+    latency_hist_record(&st->phases[BENCH_PHASE_TRANSFER], t->transfer_ms);
+    latency_hist_record(&st->phases[BENCH_PHASE_TOTAL], t->total_ms);
+}
+
+char *bench_format_report(const BenchStats *st, HttpMethod method, const char *url) {
+    if (!st) return NULL;
+
+    static const char *const phase_names[BENCH_PHASE_COUNT] = {
+        "dns", "tcp", "tls", "ttfb", "transfer", "total"
+    };
+
+    ByteBuf buf;
+    bytebuf_init(&buf);
+
+    double rps = (st->wall_ms > 0) ? (st->completed * 1000.0) / st->wall_ms : 0.0;
+
+    if (bytebuf_appendf(&buf, "Benchmark: %s %s\n", http_method_name(method), url ? url : "") != 0) goto fail;
+    if (bytebuf_appendf(&buf, "Requests: %d  Concurrency: %d  Completed: %d  Failed: %d  HTTP errors: %d\n",
+                        st->requested, st->concurrency, st->completed, st->failed, st->http_errors) != 0) goto fail;
+    if (bytebuf_appendf(&buf, "Wall time: %.1f ms  Throughput: %.1f req/s\n\n", st->wall_ms, rps) != 0) goto fail;
+    if (bytebuf_appendf(&buf, "%-10s %10s %10s %10s %10s\n", "phase (ms)", "p50", "p90", "p99", "max") != 0) goto fail;
+
+    for (int i = 0; i < BENCH_PHASE_COUNT; i++) {
+        const LatencyHistogram *h = &st->phases[i];
+        if (bytebuf_appendf(&buf, "%-10s %10.2f %10.2f %10.2f %10.2f\n",
+                            phase_names[i],
+                            latency_hist_percentile(h, 50.0),
+                            latency_hist_percentile(h, 90.0),
+                            latency_hist_percentile(h, 99.0),
+                            h->max_ms) != 0) goto fail;
+    }
+
+    return bytebuf_take(&buf);
+
+fail:
+    bytebuf_free(&buf);
+    return NULL;
+}
+
+/* ---- Runner ---- */
+
+static void bench_run_free(BenchRun *run) {
+    resolved_request_free(&run->resolved);
+    free(run->label_url);
+    (void)pthread_mutex_destroy(&run->mu);
+    free(run);
+}
+
+static void set_panel_text(AppState *s, const char *text, int is_error) {
+    request_slots_detach_view(&s->response);
+    http_response_free(&s->response.response);
+    s->response.scroll = 0;
+    if (is_error) {
+        s->response.response.error = strdup(text);
+    } else {
+        s->response.response.body = strdup(text);
+        s->response.response.body_view = strdup(text);
+        (void)http_response_index_view(&s->response.response);
+    }
+}
+
+static void on_bench_done(int id, HttpResponse *result, void *userdata);
+
+/* Called with run->mu held. */
+static int submit_next(BenchRun *run) {
+    HttpRequestSpec spec = {
+        .method = run->method,
+        .url = run->resolved.url,
+        .body = run->resolved.body,
+        .headers_text = run->resolved.headers_text,
+        .cookie_jar_path = NULL,
+        .max_body_bytes = run->max_body_bytes,
+        .spill_threshold_bytes = run->spill_threshold_bytes,
+        .timeout_ms = run->resolved.timeout_ms,
+        .connect_timeout_ms = run->resolved.connect_timeout_ms,
+    };
+
+    run->submitted++;
+    if (http_engine_submit(run->engine, &spec, on_bench_done, run) < 0) {
+        run->stats.failed++;
+        return 1;
+    }
+    run->outstanding++;
+    return 0;
+}
+
+static void on_bench_done(int id, HttpResponse *result, void *userdata) {
+    (void)id;
+    BenchRun *run = userdata;
+
+    (void)pthread_mutex_lock(&run->mu);
+    if (result) {
+        bench_stats_record(&run->stats, result);
+        http_response_free(result);
+    } else {
+        run->aborted = 1;
+    }
+    run->outstanding--;
+
+    /* Refill; a failed submit is counted and the next one is tried. */
+    while (!run->aborted && run->outstanding < run->stats.concurrency &&
+           run->submitted < run->stats.requested) {
+        (void)submit_next(run);
+    }
+
+    int finished = (run->outstanding == 0);
+    if (finished) run->stats.wall_ms = elapsed_ms_since(&run->started);
+    (void)pthread_mutex_unlock(&run->mu);
+
+    if (!finished) return;
+
+    if (!run->aborted) {
+        AppState *s = run->state;
+        char *report = bench_format_report(&run->stats, run->method, run->label_url);
+
+        app_state_lock(s);
+        if (report) {
+            set_panel_text(s, report, 0);
+        } else {
+            set_panel_text(s, i18n_get(s->ui.language, I18N_UNKNOWN_ERROR), 1);
+        }
+        s->response.bench_running = 0;
+        app_state_mark_dirty(s, UI_DIRTY_RESPONSE);
+        app_state_unlock(s);
+
+        free(report);
+    }
+
+    bench_run_free(run);
+}
+
+int bench_start(AppState *s, int count, int concurrency) {
+    if (!s) return 1;
+
+    if (s->response.bench_running) {
+        set_panel_text(s, i18n_get(s->ui.language, I18N_BENCH_ALREADY_RUNNING), 1);
+        return 1;
+    }
+
+    if (count < 1 || count > BENCH_COUNT_MAX ||
+        concurrency < 1 || concurrency > BENCH_CONCURRENCY_MAX) {
+        set_panel_text(s, i18n_get(s->ui.language, I18N_USAGE_BENCH), 1);
+        return 1;
+    }
+    if (concurrency > count) concurrency = count;
+
+    BenchRun *run = calloc(1, sizeof(*run));
+    if (!run) {
+        set_panel_text(s, i18n_get(s->ui.language, I18N_UNKNOWN_ERROR), 1);
+        return 1;
+    }
+    (void)pthread_mutex_init(&run->mu, NULL);
+
+    RequestSnapshot snap;
+    if (request_snapshot_build_locked(s, &snap) != 0) {
+        bench_run_free(run);
+        set_panel_text(s, i18n_get(s->ui.language, I18N_UNKNOWN_ERROR), 1);
+        return 1;
+    }
+
+    char *missing = NULL;
+    int rc = request_snapshot_resolve(&snap, &s->config.envs, &run->resolved, &missing);
+    run->method = snap.method;
+    run->label_url = snap.url;
+    snap.url = NULL;
+    request_snapshot_free(&snap);
+
+    if (rc != 0 || !run->label_url) {
+        char msg[256];
+        if (missing) snprintf(msg, sizeof(msg), "Missing variable: %s", missing);
+        else snprintf(msg, sizeof(msg), "%s", i18n_get(s->ui.language, I18N_UNKNOWN_ERROR));
+        free(missing);
+        bench_run_free(run);
+        set_panel_text(s, msg, 1);
+        return 1;
+    }
+
+    if (!s->response.engine) s->response.engine = http_engine_create();
+    run->engine = s->response.engine;
+    run->state = s;
+    run->max_body_bytes = (size_t)s->response.max_body_mb * 1024u * 1024u;
+    run->spill_threshold_bytes = (size_t)s->response.spill_mb * 1024u * 1024u;
+    if (run->resolved.timeout_ms <= 0) run->resolved.timeout_ms = s->response.timeout_ms;
+    if (run->resolved.connect_timeout_ms <= 0) run->resolved.connect_timeout_ms = s->response.connect_timeout_ms;
+    bench_stats_init(&run->stats, count, concurrency);
+    clock_gettime(CLOCK_MONOTONIC, &run->started);
+
+    (void)pthread_mutex_lock(&run->mu);
+    int started = 0;
+    for (int i = 0; i < concurrency; i++) {
+        if (submit_next(run) == 0) started++;
+    }
+    (void)pthread_mutex_unlock(&run->mu);
+
+    /* Nothing reached the engine, so no callback will ever free the run. */
+    if (started == 0) {
+        bench_run_free(run);
+        set_panel_text(s, "Could not start request", 1);
+        return 1;
+    }
+
+    char msg[MESSAGE_BUF_SIZE];
+    snprintf(msg, sizeof(msg), i18n_get(s->ui.language, I18N_BENCH_RUNNING_FMT), count, concurrency);
+    set_panel_text(s, msg, 0);
+    s->response.bench_running = 1;
+    return 0;
+}
@@ -1,44 +1,125 @@
 #include "core/http/http.h"
 #include "core/utils/utils.h"
+#include "core/utils/bytebuf.h"
+#include "core/utils/mapped_body.h"
+#include "core/text/line_index.h"
 #include "core/config/constants.h"
 
 #include <curl/curl.h>
+#include <errno.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <unistd.h>
+
+struct HttpTransfer {
+    CURL *curl;
+    pthread_mutex_t body_mu; /* Lets another thread read the body mid-transfer */
+    ByteBuf body;
+    ByteBuf headers;
+    int body_presized;
+    int over_limit;          /* Body hit spec->max_body_bytes */
+    size_t spill_threshold;  /* Past this size the body moves to spill_fd */
+    int spill_fd;            /* Unlinked temp file holding the body, or -1 */
+    size_t spill_len;
+    struct curl_slist *header_list;
+    char errbuf[CURL_ERROR_SIZE];
+};
 
-typedef struct {
-    char *data;
-    size_t size;
-} Buffer;
+static size_t body_size(const HttpTransfer *t) {
+    return (t->spill_fd >= 0) ? t->spill_len : t->body.len;
+}
 
-static size_t write_cb(void *ptr, size_t size, size_t nmemb, void *userdata) {
-    size_t total = size * nmemb;
-    Buffer *buf = userdata;
+static int write_all(int fd, const char *p, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
 
-    char *newp = realloc(buf->data, buf->size + total + 1);
-    if (!newp) return 0;
+/* Move what was received so far to a temp file; later writes go there. */
+static int start_spill(HttpTransfer *t) {
+    int fd = mapped_body_tmpfile();
+    if (fd < 0) return -1;
 
-    buf->data = newp;
-    memcpy(buf->data + buf->size, ptr, total);
-    buf->size += total;
-    buf->data[buf->size] = '\0';
-    return total;
+    if (t->body.len > 0 && write_all(fd, t->body.data, t->body.len) != 0) {
+        close(fd);
+        return -1;
+    }
+    t->spill_fd = fd;
+    t->spill_len = t->body.len;
+    bytebuf_free(&t->body);
+    return 0;
 }
 
-static size_t header_cb(void *ptr, size_t size, size_t nmemb, void *userdata) {
-    size_t total = size * nmemb;
-    Buffer *buf = userdata;
+/* Size the body once from Content-Length so a large download is not
+   grown in steps. Runs on the first write, when the headers are in. */
+static int presize_body(HttpTransfer *t) {
+    t->body_presized = 1;
+
+    curl_off_t expected = -1;
+    if (curl_easy_getinfo(t->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &expected) != CURLE_OK ||
+        expected <= 0) {
+        return 0;
+    }
+
+    if (t->body.limit && (curl_off_t)t->body.limit < expected) {
+        t->over_limit = 1;
+        return -1;
+    }
 
-    char *newp = realloc(buf->data, buf->size + total + 1);
-    if (!newp) return 0;
+    if (t->spill_threshold && (curl_off_t)t->spill_threshold < expected) {
+        return start_spill(t);
+    }
 
-    buf->data = newp;
-    memcpy(buf->data + buf->size, ptr, total);
-    buf->size += total;
-    buf->data[buf->size] = '\0';
-    return total;
+    size_t want = (size_t)expected;
+    if (want > HTTP_BODY_PRESIZE_MAX) want = HTTP_BODY_PRESIZE_MAX;
+    (void)bytebuf_reserve(&t->body, want);
+    return 0;
+}
+
+static int append_body(HttpTransfer *t, const char *ptr, size_t total) {
+    if (t->body.limit && body_size(t) + total > t->body.limit) {
+        t->over_limit = 1;
+        return -1;
+    }
+
+    if (t->spill_fd < 0 && t->spill_threshold && t->body.len + total > t->spill_threshold) {
+        if (start_spill(t) != 0) return -1;
+    }
+
+    if (t->spill_fd >= 0) {
+        if (write_all(t->spill_fd, ptr, total) != 0) return -1;
+        t->spill_len += total;
+        return 0;
+    }
+    return bytebuf_append(&t->body, ptr, total);
+}
+
+static size_t write_cb(void *ptr, size_t size, size_t nmemb, void *userdata) {
+    size_t total = size * nmemb;
+    HttpTransfer *t = userdata;
+
+    (void)pthread_mutex_lock(&t->body_mu);
+    int rc = 0;
+    if (!t->body_presized) rc = presize_body(t);
+    if (rc == 0) rc = append_body(t, ptr, total);
+    (void)pthread_mutex_unlock(&t->body_mu);
+    return rc == 0 ? total : 0;
+}
+
+static size_t header_cb(void *ptr, size_t size, size_t nmemb, void *userdata) {
+    size_t total = size * nmemb;
+    ByteBuf *buf = userdata;
+    return bytebuf_append(buf, ptr, total) == 0 ? total : 0;
 }
 
 static int starts_with_ci(const char *s, const char *p) {
@@ -51,18 +132,25 @@ static int starts_with_ci(const char *s, const char *p) {
 }
 
 static struct curl_slist *
-headers_from_textbuf(const TextBuffer *tb, int *has_content_type) {
+headers_from_text(const char *text, int *has_content_type) {
     if (has_content_type) *has_content_type = 0;
-    if (!tb) return NULL;
+    if (!text) return NULL;
 
     struct curl_slist *list = NULL;
 
-    for (int i = 0; i < tb->line_count; i++) {
-        const char *line = tb->lines[i];
-        if (!line || !*line) continue;
+    const char *line = text;
+    while (*line) {
+        const char *nl = strchr(line, '\n');
+        size_t len = nl ? (size_t)(nl - line) : strlen(line);
+        const char *next = nl ? nl + 1 : line + len;
+
+        if (len == 0) { line = next; continue; }
 
-        char *tmp = strdup(line);
-        if (!tmp) continue;
+        char *tmp = malloc(len + 1);
+        if (!tmp) { line = next; continue; }
+        memcpy(tmp, line, len);
+        tmp[len] = '\0';
+        line = next;
 
         char *p = str_trim_left(tmp);
         str_trim_right(p);
@@ -95,50 +183,55 @@ headers_from_textbuf(const TextBuffer *tb, int *has_content_type) {
     return list;
 }
 
-int http_request(
-    const char *url,
-    HttpMethod method,
-    const char *body,
-    const TextBuffer *headers_tb,
-    const char *cookie_jar_path,
-    HttpResponse *out
-) {
-    CURL *curl = curl_easy_init();
-    if (!curl) return -1;
+static void set_payload(CURL *curl, const char *payload) {
+    /* Copied so the caller's buffer need not outlive an async transfer. */
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)strlen(payload));
+    curl_easy_setopt(curl, CURLOPT_COPYPOSTFIELDS, payload);
+}
 
-    Buffer buf = {0};
-    Buffer header_buf = {0};
-    char errbuf[CURL_ERROR_SIZE];
-    errbuf[0] = '\0';
+HttpTransfer *http_transfer_prepare(CURL *curl, const HttpRequestSpec *spec) {
+    if (!curl || !spec) return NULL;
 
-    curl_easy_setopt(curl, CURLOPT_URL, url);
+    HttpTransfer *t = calloc(1, sizeof(*t));
+    if (!t) return NULL;
+    t->curl = curl;
+    (void)pthread_mutex_init(&t->body_mu, NULL);
+    bytebuf_init(&t->body);
+    bytebuf_init(&t->headers);
+    t->body.limit = spec->max_body_bytes;
+    t->spill_threshold = spec->spill_threshold_bytes;
+    t->spill_fd = -1;
+
+    curl_easy_setopt(curl, CURLOPT_URL, spec->url ? spec->url : "");
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buf);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, t);
     curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_cb);
-    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &header_buf);
-    curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, errbuf);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &t->headers);
+    curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, t->errbuf);
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 15L);
-
-    /* Enable persistent cookie jar */
-    if (cookie_jar_path && cookie_jar_path[0]) {
-        curl_easy_setopt(curl, CURLOPT_COOKIEFILE, cookie_jar_path);
-        curl_easy_setopt(curl, CURLOPT_COOKIEJAR, cookie_jar_path);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, spec->timeout_ms > 0 ? spec->timeout_ms : 0L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS,
+                     spec->connect_timeout_ms > 0 ? spec->connect_timeout_ms : 0L);
+
+    /* Turn the cookie engine on without reading a file; the engine loads
+       the jar into the shared cookies and writes it back. */
+    if (spec->cookie_jar_path && spec->cookie_jar_path[0]) {
+        curl_easy_setopt(curl, CURLOPT_COOKIEFILE, "");
     }
 
     int has_ct = 0;
-    struct curl_slist *headers =
-        headers_from_textbuf(headers_tb, &has_ct);
+    t->header_list = headers_from_text(spec->headers_text, &has_ct);
 
+    HttpMethod method = spec->method;
     int sends_body = (method == HTTP_POST || method == HTTP_PUT);
 
     if (sends_body && !has_ct)
-        headers = curl_slist_append(headers, "Content-Type: application/json");
+        t->header_list = curl_slist_append(t->header_list, "Content-Type: application/json");
 
-    if (headers)
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    if (t->header_list)
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, t->header_list);
 
-    const char *payload = body ? body : "";
+    const char *payload = spec->body ? spec->body : "";
 
     switch (method) {
         case HTTP_GET:
@@ -147,14 +240,12 @@ int http_request(
 
         case HTTP_POST:
             curl_easy_setopt(curl, CURLOPT_POST, 1L);
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payload);
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)strlen(payload));
+            set_payload(curl, payload);
             break;
 
         case HTTP_PUT:
             curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PUT");
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payload);
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)strlen(payload));
+            set_payload(curl, payload);
             break;
 
         case HTTP_DELETE:
@@ -163,8 +254,7 @@ int http_request(
 
         case HTTP_PATCH:
             curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PATCH");
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payload);
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)strlen(payload));
+            set_payload(curl, payload);
             break;
 
         case HTTP_HEAD:
@@ -180,7 +270,41 @@ int http_request(
             break;
     }
 
-    CURLcode res = curl_easy_perform(curl);
+    return t;
+}
+
+void http_transfer_free(HttpTransfer *t) {
+    if (!t) return;
+    if (t->header_list) curl_slist_free_all(t->header_list);
+    bytebuf_free(&t->body);
+    bytebuf_free(&t->headers);
+    if (t->spill_fd >= 0) close(t->spill_fd);
+    (void)pthread_mutex_destroy(&t->body_mu);
+    free(t);
+}
+
+size_t http_transfer_read_body(HttpTransfer *t, size_t offset, char *dst, size_t cap) {
+    if (!t || !dst || cap == 0) return 0;
+
+    size_t n = 0;
+    (void)pthread_mutex_lock(&t->body_mu);
+    if (offset < body_size(t)) {
+        n = body_size(t) - offset;
+        if (n > cap) n = cap;
+        if (t->spill_fd >= 0) {
+            ssize_t r = pread(t->spill_fd, dst, n, (off_t)offset);
+            n = (r > 0) ? (size_t)r : 0;
+        } else {
+            memcpy(dst, t->body.data + offset, n);
+        }
+    }
+    (void)pthread_mutex_unlock(&t->body_mu);
+    return n;
+}
+
+int http_transfer_finish(HttpTransfer *t, CURLcode res, HttpResponse *out) {
+    if (!t) return -1;
+    CURL *curl = t->curl;
 
     /* Capture detailed timing breakdown */
     double dns, tcp_conn, tls_conn, pre, ttfb, total;
@@ -200,24 +324,99 @@ int http_request(
     out->timing.total_ms = total * 1000.0;
     out->elapsed_ms = out->timing.total_ms;
 
+    /* No new connection on a network transfer means the cache served it. */
+    long num_connects = 0;
+    char *primary_ip = NULL;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &num_connects);
+    curl_easy_getinfo(curl, CURLINFO_PRIMARY_IP, &primary_ip);
+    out->timing.connection_reused =
+        (res == CURLE_OK && num_connects == 0 && primary_ip && primary_ip[0]) ? 1 : 0;
+
+    out->response_headers = t->headers.data;
+    t->headers.data = NULL;
+
+    int rc = 0;
     if (res != CURLE_OK) {
         out->status = 0;
         out->body = NULL;
-        out->response_headers = header_buf.data;
-        out->error = strdup(errbuf[0] ? errbuf : curl_easy_strerror(res));
+        if (t->over_limit) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "Response body exceeds the %zu byte limit", t->body.limit);
+            out->error = strdup(msg);
+        } else {
+            out->error = strdup(t->errbuf[0] ? t->errbuf : curl_easy_strerror(res));
+        }
+        rc = -1;
+    } else {
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &out->status);
+        out->error = NULL;
+        if (t->spill_fd >= 0) {
+            MappedBody *m = NULL;
+            if (write_all(t->spill_fd, "", 1) == 0) m = mapped_body_map(t->spill_fd, t->spill_len);
+            if (m) {
+                out->body = m->data;
+                out->body_map = m;
+            } else {
+                out->status = 0;
+                out->error = strdup("Could not map spilled response body");
+                rc = -1;
+            }
+        } else {
+            out->body = t->body.data;
+            t->body.data = NULL;
+        }
+    }
 
-        if (headers) curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-        free(buf.data);
-        return -1;
+    http_transfer_free(t);
+    return rc;
+}
+
+static unsigned long next_view_gen;
+
+int http_response_index_view(HttpResponse *r) {
+    if (!r) return -1;
+    line_index_release(r->view_lines);
+    r->view_lines = NULL;
+    if (r->view_map && r->view_map->data != r->body_view) {
+        /* body_view was replaced; the holder still owns the old text */
+        mapped_body_release(r->view_map);
+        r->view_map = NULL;
     }
+    /* Requests finish on other threads, so the counter is shared */
+    r->view_gen = __atomic_add_fetch(&next_view_gen, 1, __ATOMIC_RELAXED);
+    if (!r->body_view) return 0;
+
+    if (!r->view_map) {
+        r->view_map = (r->body_map && r->body_view == r->body)
+            ? mapped_body_ref(r->body_map)
+            : mapped_body_adopt(r->body_view, strlen(r->body_view));
+    }
+    size_t len = r->view_map ? r->view_map->len : strlen(r->body_view);
+    r->view_lines = line_index_build(r->body_view, len);
+    return r->view_lines && r->view_map ? 0 : -1;
+}
 
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &out->status);
-    out->body = buf.data;
-    out->response_headers = header_buf.data;
-    out->error = NULL;
+void http_response_free(HttpResponse *r) {
+    if (!r) return;
+    line_index_release(r->view_lines);
+    if (r->view_map) mapped_body_release(r->view_map);
+    else if (!r->body_map || r->body_view != r->body) free(r->body_view);
+    if (r->body_map) mapped_body_release(r->body_map);
+    else free(r->body);
+    free(r->response_headers);
+    free(r->error);
+    memset(r, 0, sizeof(*r));
+}
 
-    if (headers) curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-    return 0;
+const char *http_method_name(HttpMethod m) {
+    switch (m) {
+        case HTTP_GET: return "GET";
+        case HTTP_POST: return "POST";
+        case HTTP_PUT: return "PUT";
+        case HTTP_DELETE: return "DELETE";
+        case HTTP_PATCH: return "PATCH";
+        case HTTP_HEAD: return "HEAD";
+        case HTTP_OPTIONS: return "OPTIONS";
+        default: return "GET";
+    }
 }
@@ -0,0 +1,511 @@
+/*
+ * http_engine.c - Session-wide libcurl state
+ *
+ * Owns the CURLSH share object and a pool of idle easy handles so that
+ * consecutive requests reuse DNS entries, live connections and TLS sessions,
+ * and the I/O thread that runs asynchronous requests on a curl_multi handle.
+ *
+ * Threading: the multi handle is only touched by the I/O thread. Submitters
+ * append to the pending list under `mu` and wake the thread; completion
+ * callbacks run on the I/O thread without `mu` held.
+ *
+ * Cookies live in the share object too, so concurrent transfers see each
+ * other's cookies. The jar file is read once when it is opened and written
+ * from one handle that only the engine uses, under `cookie_mu`.
+ *
+ * See http.c for building and performing a single request.
+ */
+
+#include "core/http/http_engine.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HTTP_ENGINE_POOL_MAX 8
+/* Longest wait while transfers run but libcurl has no timer set */
+#define HTTP_ENGINE_POLL_MS 1000
+/* Wait while nothing is in flight; submit, cancel and stop wake the thread */
+#define HTTP_ENGINE_IDLE_POLL_MS (10 * 60 * 1000)
+
+typedef struct HttpJob {
+    int id;
+    HttpEngine *engine;
+    CURL *curl;
+    HttpTransfer *transfer;
+    HttpProgress progress; /* Guarded by engine->mu */
+    int cancelled;         /* Guarded by engine->mu */
+    int cookies;           /* Uses the cookie jar */
+    HttpEngineDoneFn done;
+    void *userdata;
+    struct HttpJob *next;
+} HttpJob;
+
+struct HttpEngine {
+    CURLSH *share;
+    pthread_mutex_t share_mu[CURL_LOCK_DATA_LAST];
+
+    pthread_mutex_t cookie_mu;
+    CURL *cookie_curl; /* Holds the jar path; never performs a transfer */
+    char *cookie_jar;
+
+    pthread_mutex_t pool_mu;
+    CURL *pool[HTTP_ENGINE_POOL_MAX];
+    int pool_cookies[HTTP_ENGINE_POOL_MAX]; /* Ran with the cookie engine on */
+    int pool_count;
+
+    CURLM *multi;
+    pthread_t io_thread;
+    int io_started;
+
+    pthread_mutex_t mu;
+    HttpJob *pending;  /* Submitted, not yet added to the multi handle */
+    HttpJob *active;   /* Owned by the I/O thread */
+    int in_flight;
+    int next_id;
+    int stopping;
+};
+
+static void share_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr) {
+    (void)handle;
+    (void)access;
+    HttpEngine *e = userptr;
+    if ((int)data < 0 || data >= CURL_LOCK_DATA_LAST) return;
+    (void)pthread_mutex_lock(&e->share_mu[data]);
+}
+
+static void share_unlock(CURL *handle, curl_lock_data data, void *userptr) {
+    (void)handle;
+    HttpEngine *e = userptr;
+    if ((int)data < 0 || data >= CURL_LOCK_DATA_LAST) return;
+    (void)pthread_mutex_unlock(&e->share_mu[data]);
+}
+
+static int xferinfo_cb(void *userdata, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) {
+    HttpJob *job = userdata;
+    (void)pthread_mutex_lock(&job->engine->mu);
+    job->progress.bytes_received = (long long)dlnow;
+    job->progress.bytes_expected = (long long)dltotal;
+    job->progress.bytes_sent = (long long)ulnow;
+    job->progress.bytes_to_send = (long long)ultotal;
+    int cancelled = job->cancelled;
+    (void)pthread_mutex_unlock(&job->engine->mu);
+    return cancelled; /* Non-zero aborts the transfer */
+}
+
+/* Returns 1 if the job used the cookie jar. */
+static int finish_job(HttpEngine *e, HttpJob *job, CURLcode res) {
+    /* Unlink first so progress and stream readers stop seeing the job
+       before its transfer is freed. */
+    (void)pthread_mutex_lock(&e->mu);
+    for (HttpJob **pp = &e->active; *pp; pp = &(*pp)->next) {
+        if (*pp == job) {
+            *pp = job->next;
+            break;
+        }
+    }
+    int cancelled = job->cancelled;
+    (void)pthread_mutex_unlock(&e->mu);
+
+    curl_multi_remove_handle(e->multi, job->curl);
+
+    HttpResponse result;
+    memset(&result, 0, sizeof(result));
+    (void)http_transfer_finish(job->transfer, cancelled ? CURLE_ABORTED_BY_CALLBACK : res, &result);
+    job->transfer = NULL;
+    http_engine_release(e, job->curl, job->cookies);
+    int cookies = job->cookies;
+
+    if (cancelled) {
+        free(result.error);
+        result.error = strdup("Request cancelled");
+    }
+
+    if (job->done) {
+        job->done(job->id, &result, job->userdata);
+    } else {
+        http_response_free(&result);
+    }
+
+    (void)pthread_mutex_lock(&e->mu);
+    e->in_flight--;
+    (void)pthread_mutex_unlock(&e->mu);
+    free(job);
+    return cookies;
+}
+
+/* Load the jar at `path` into the shared cookies, unless it is already
+   open; another path replaces the cookies. */
+static int open_cookie_jar(HttpEngine *e, const char *path) {
+    if (!e || !path || !path[0]) return 1;
+
+    int rc = 0;
+    (void)pthread_mutex_lock(&e->cookie_mu);
+    if (!e->cookie_jar || strcmp(e->cookie_jar, path) != 0) {
+        /* The old handle writes its jar as it goes */
+        if (e->cookie_curl) curl_easy_cleanup(e->cookie_curl);
+        free(e->cookie_jar);
+        e->cookie_jar = strdup(path);
+        e->cookie_curl = curl_easy_init();
+        if (!e->cookie_jar || !e->cookie_curl) {
+            if (e->cookie_curl) curl_easy_cleanup(e->cookie_curl);
+            free(e->cookie_jar);
+            e->cookie_curl = NULL;
+            e->cookie_jar = NULL;
+            rc = 1;
+        } else {
+            CURL *c = e->cookie_curl;
+            curl_easy_setopt(c, CURLOPT_SHARE, e->share);
+            curl_easy_setopt(c, CURLOPT_COOKIELIST, "ALL");
+            curl_easy_setopt(c, CURLOPT_COOKIEFILE, path);
+            curl_easy_setopt(c, CURLOPT_COOKIEJAR, path);
+            curl_easy_setopt(c, CURLOPT_COOKIELIST, "RELOAD");
+        }
+    }
+    (void)pthread_mutex_unlock(&e->cookie_mu);
+    return rc;
+}
+
+/* Write the shared cookies to the open jar, if any. */
+static void flush_cookies(HttpEngine *e) {
+    if (!e) return;
+    (void)pthread_mutex_lock(&e->cookie_mu);
+    if (e->cookie_curl) curl_easy_setopt(e->cookie_curl, CURLOPT_COOKIELIST, "FLUSH");
+    (void)pthread_mutex_unlock(&e->cookie_mu);
+}
+
+/* How long the I/O thread may sleep: until libcurl's next timer while
+   transfers run, otherwise until it is woken. */
+static int poll_timeout(HttpEngine *e, int idle) {
+    if (idle) return HTTP_ENGINE_IDLE_POLL_MS;
+
+    long ms = -1;
+    if (curl_multi_timeout(e->multi, &ms) != CURLM_OK || ms < 0) return HTTP_ENGINE_POLL_MS;
+    return ms > HTTP_ENGINE_IDLE_POLL_MS ? HTTP_ENGINE_IDLE_POLL_MS : (int)ms;
+}
+
+static void *io_thread_main(void *arg) {
+    HttpEngine *e = arg;
+
+    for (;;) {
+        (void)pthread_mutex_lock(&e->mu);
+        if (e->stopping) {
+            (void)pthread_mutex_unlock(&e->mu);
+            break;
+        }
+        /* Adopt newly submitted jobs */
+        while (e->pending) {
+            HttpJob *job = e->pending;
+            e->pending = job->next;
+            job->next = e->active;
+            e->active = job;
+            curl_multi_add_handle(e->multi, job->curl);
+        }
+        /* Take cancelled jobs out now rather than at their next progress
+           callback, which may be a second away on an idle connection. */
+        HttpJob *cancelled = NULL;
+        for (HttpJob **pp = &e->active; *pp;) {
+            HttpJob *job = *pp;
+            if (job->cancelled) {
+                *pp = job->next;
+                job->next = cancelled;
+                cancelled = job;
+            } else {
+                pp = &job->next;
+            }
+        }
+        (void)pthread_mutex_unlock(&e->mu);
+
+        int cookies = 0;
+        while (cancelled) {
+            HttpJob *next = cancelled->next;
+            cookies |= finish_job(e, cancelled, CURLE_ABORTED_BY_CALLBACK);
+            cancelled = next;
+        }
+
+        int running = 0;
+        curl_multi_perform(e->multi, &running);
+
+        CURLMsg *msg;
+        int left = 0;
+        while ((msg = curl_multi_info_read(e->multi, &left))) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            HttpJob *job = NULL;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&job);
+            if (job) cookies |= finish_job(e, job, msg->data.result);
+        }
+        /* Once for every transfer that finished in this pass */
+        if (cookies) flush_cookies(e);
+
+        (void)pthread_mutex_lock(&e->mu);
+        int idle = e->in_flight == 0;
+        (void)pthread_mutex_unlock(&e->mu);
+        curl_multi_poll(e->multi, NULL, 0, poll_timeout(e, idle), NULL);
+    }
+
+    return NULL;
+}
+
+HttpEngine *http_engine_create(void) {
+    HttpEngine *e = calloc(1, sizeof(*e));
+    if (!e) return NULL;
+
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        (void)pthread_mutex_init(&e->share_mu[i], NULL);
+    }
+    (void)pthread_mutex_init(&e->cookie_mu, NULL);
+    (void)pthread_mutex_init(&e->pool_mu, NULL);
+    (void)pthread_mutex_init(&e->mu, NULL);
+
+    e->share = curl_share_init();
+    if (!e->share) {
+        http_engine_destroy(e);
+        return NULL;
+    }
+
+    curl_share_setopt(e->share, CURLSHOPT_LOCKFUNC, share_lock);
+    curl_share_setopt(e->share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+    curl_share_setopt(e->share, CURLSHOPT_USERDATA, e);
+    curl_share_setopt(e->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(e->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(e->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_COOKIE);
+    /* Older libcurl builds lack a shareable connection cache; DNS and TLS
+       session sharing still apply in that case. */
+    (void)curl_share_setopt(e->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+
+    e->multi = curl_multi_init();
+    if (!e->multi) {
+        http_engine_destroy(e);
+        return NULL;
+    }
+
+    if (pthread_create(&e->io_thread, NULL, io_thread_main, e) != 0) {
+        http_engine_destroy(e);
+        return NULL;
+    }
+    e->io_started = 1;
+
+    return e;
+}
+
+static void abort_jobs(HttpEngine *e, HttpJob *list, int attached) {
+    while (list) {
+        HttpJob *next = list->next;
+        if (attached) curl_multi_remove_handle(e->multi, list->curl);
+        http_transfer_free(list->transfer);
+        http_engine_release(e, list->curl, list->cookies);
+        if (list->done) list->done(list->id, NULL, list->userdata);
+        free(list);
+        list = next;
+    }
+}
+
+void http_engine_destroy(HttpEngine *e) {
+    if (!e) return;
+
+    if (e->io_started) {
+        (void)pthread_mutex_lock(&e->mu);
+        e->stopping = 1;
+        (void)pthread_mutex_unlock(&e->mu);
+        curl_multi_wakeup(e->multi);
+        (void)pthread_join(e->io_thread, NULL);
+        e->io_started = 0;
+    }
+
+    abort_jobs(e, e->active, 1);
+    abort_jobs(e, e->pending, 0);
+    e->active = NULL;
+    e->pending = NULL;
+    if (e->multi) curl_multi_cleanup(e->multi);
+
+    for (int i = 0; i < e->pool_count; i++) {
+        curl_easy_cleanup(e->pool[i]);
+    }
+    e->pool_count = 0;
+
+    /* Cleaning up the jar handle writes the jar a last time. */
+    if (e->cookie_curl) curl_easy_cleanup(e->cookie_curl);
+    free(e->cookie_jar);
+
+    /* Share must outlive every handle attached to it. */
+    if (e->share) curl_share_cleanup(e->share);
+
+    (void)pthread_mutex_destroy(&e->mu);
+    (void)pthread_mutex_destroy(&e->pool_mu);
+    (void)pthread_mutex_destroy(&e->cookie_mu);
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        (void)pthread_mutex_destroy(&e->share_mu[i]);
+    }
+    free(e);
+}
+
+CURL *http_engine_acquire(HttpEngine *e, int cookies) {
+    if (!e) return curl_easy_init();
+
+    /* libcurl keeps a handle's cookie engine on across resets, so such a
+       handle would send the shared cookies on a request without the jar. */
+    CURL *curl = NULL;
+    (void)pthread_mutex_lock(&e->pool_mu);
+    for (int i = e->pool_count - 1; i >= 0; i--) {
+        if (cookies || !e->pool_cookies[i]) {
+            curl = e->pool[i];
+            e->pool_count--;
+            e->pool[i] = e->pool[e->pool_count];
+            e->pool_cookies[i] = e->pool_cookies[e->pool_count];
+            break;
+        }
+    }
+    (void)pthread_mutex_unlock(&e->pool_mu);
+
+    if (curl) {
+        /* Drops options but keeps the handle's live connections and caches. */
+        curl_easy_reset(curl);
+    } else {
+        curl = curl_easy_init();
+        if (!curl) return NULL;
+    }
+
+    curl_easy_setopt(curl, CURLOPT_SHARE, e->share);
+    return curl;
+}
+
+void http_engine_release(HttpEngine *e, CURL *curl, int cookies) {
+    if (!curl) return;
+    if (!e) {
+        curl_easy_cleanup(curl);
+        return;
+    }
+
+    (void)pthread_mutex_lock(&e->pool_mu);
+    if (e->pool_count < HTTP_ENGINE_POOL_MAX) {
+        e->pool_cookies[e->pool_count] = cookies;
+        e->pool[e->pool_count++] = curl;
+        curl = NULL;
+    }
+    (void)pthread_mutex_unlock(&e->pool_mu);
+
+    if (curl) curl_easy_cleanup(curl);
+}
+
+void http_engine_clear_cookies(HttpEngine *e) {
+    if (!e) return;
+    (void)pthread_mutex_lock(&e->cookie_mu);
+    if (e->cookie_curl) curl_easy_setopt(e->cookie_curl, CURLOPT_COOKIELIST, "ALL");
+    (void)pthread_mutex_unlock(&e->cookie_mu);
+}
+
+int http_engine_submit(HttpEngine *e, const HttpRequestSpec *spec, HttpEngineDoneFn done, void *userdata) {
+    if (!e || !spec || !e->io_started) return -1;
+
+    int cookies = spec->cookie_jar_path && spec->cookie_jar_path[0];
+    if (cookies && open_cookie_jar(e, spec->cookie_jar_path) != 0) return -1;
+
+    HttpJob *job = calloc(1, sizeof(*job));
+    if (!job) return -1;
+
+    job->curl = http_engine_acquire(e, cookies);
+    if (!job->curl) {
+        free(job);
+        return -1;
+    }
+
+    job->transfer = http_transfer_prepare(job->curl, spec);
+    if (!job->transfer) {
+        http_engine_release(e, job->curl, cookies);
+        free(job);
+        return -1;
+    }
+
+    job->engine = e;
+    job->cookies = cookies;
+    job->done = done;
+    job->userdata = userdata;
+    curl_easy_setopt(job->curl, CURLOPT_PRIVATE, job);
+    curl_easy_setopt(job->curl, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(job->curl, CURLOPT_XFERINFOFUNCTION, xferinfo_cb);
+    curl_easy_setopt(job->curl, CURLOPT_XFERINFODATA, job);
+
+    (void)pthread_mutex_lock(&e->mu);
+    job->id = ++e->next_id;
+    int id = job->id;
+    /* Append so jobs start in submission order */
+    HttpJob **pp = &e->pending;
+    while (*pp) pp = &(*pp)->next;
+    *pp = job;
+    e->in_flight++;
+    (void)pthread_mutex_unlock(&e->mu);
+
+    curl_multi_wakeup(e->multi);
+    return id;
+}
+
+int http_engine_progress(HttpEngine *e, int id, HttpProgress *out) {
+    if (!e || !out) return 1;
+
+    int rc = 1;
+    (void)pthread_mutex_lock(&e->mu);
+    for (int pass = 0; pass < 2 && rc != 0; pass++) {
+        for (HttpJob *job = pass == 0 ? e->active : e->pending; job; job = job->next) {
+            if (job->id == id) {
+                *out = job->progress;
+                rc = 0;
+                break;
+            }
+        }
+    }
+    (void)pthread_mutex_unlock(&e->mu);
+    return rc;
+}
+
+long http_engine_stream_read(HttpEngine *e, int id, size_t offset, char *dst, size_t cap) {
+    if (!e || !dst) return -1;
+
+    long n = -1;
+    (void)pthread_mutex_lock(&e->mu);
+    for (HttpJob *job = e->active; job; job = job->next) {
+        if (job->id == id) {
+            n = (long)http_transfer_read_body(job->transfer, offset, dst, cap);
+            break;
+        }
+    }
+    if (n < 0) {
+        for (HttpJob *job = e->pending; job; job = job->next) {
+            if (job->id == id) {
+                n = 0;
+                break;
+            }
+        }
+    }
+    (void)pthread_mutex_unlock(&e->mu);
+    return n;
+}
+
+int http_engine_cancel(HttpEngine *e, int id) {
+    if (!e) return -1;
+
+    int found = 0;
+    (void)pthread_mutex_lock(&e->mu);
+    HttpJob *lists[2] = { e->pending, e->active };
+    for (int i = 0; i < 2 && !found; i++) {
+        for (HttpJob *job = lists[i]; job; job = job->next) {
+            if (job->id == id) {
+                job->cancelled = 1;
+                found = 1;
+                break;
+            }
+        }
+    }
+    (void)pthread_mutex_unlock(&e->mu);
+
+    if (!found) return -1;
+    curl_multi_wakeup(e->multi);
+    return 0;
+}
+
+int http_engine_in_flight(HttpEngine *e) {
+    if (!e) return 0;
+    (void)pthread_mutex_lock(&e->mu);
+    int n = e->in_flight;
+    (void)pthread_mutex_unlock(&e->mu);
+    return n;
+}
@@ -0,0 +1,241 @@
+/*
+ * request_slots.c - Results of concurrent requests
+ *
+ * Bookkeeping only: no locking and no I/O. Callers hold the state lock.
+ * request_slots_pump() copies partial bodies out of the engine, which takes
+ * the engine's own lock only for the copy. Only the start of a body is
+ * copied, so a large download is not held twice while it spills to disk.
+ */
+
+#include "core/http/request_slots.h"
+#include "core/http/http.h"
+#include "core/http/http_engine.h"
+#include "core/config/constants.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* An empty slot is never viewed; this also covers zero-initialised state. */
+static int viewed_index(const ResponseState *r) {
+    if (r->view_slot < 0 || r->view_slot >= REQUEST_SLOTS_MAX) return -1;
+    if (r->slots[r->view_slot].state == REQUEST_SLOT_EMPTY) return -1;
+    return r->view_slot;
+}
+
+static void slot_clear(RequestSlot *slot) {
+    free(slot->url);
+    free(slot->stream);
+    http_response_free(&slot->response);
+    memset(slot, 0, sizeof(*slot));
+}
+
+void request_slots_init(ResponseState *r) {
+    if (!r) return;
+    memset(r->slots, 0, sizeof(r->slots));
+    r->view_slot = -1;
+    r->requests_in_flight = 0;
+}
+
+void request_slots_free(ResponseState *r) {
+    if (!r) return;
+    for (int i = 0; i < REQUEST_SLOTS_MAX; i++) {
+        slot_clear(&r->slots[i]);
+    }
+    http_response_free(&r->response);
+    r->view_slot = -1;
+    r->requests_in_flight = 0;
+}
+
+int request_slots_reserve(const ResponseState *r) {
+    if (!r) return -1;
+
+    int oldest = -1;
+    for (int i = 0; i < REQUEST_SLOTS_MAX; i++) {
+        const RequestSlot *slot = &r->slots[i];
+        if (slot->state == REQUEST_SLOT_EMPTY) return i;
+        if (slot->state == REQUEST_SLOT_DONE &&
+            (oldest < 0 || slot->id < r->slots[oldest].id)) {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+void request_slots_detach_view(ResponseState *r) {
+    if (!r) return;
+
+    int view = viewed_index(r);
+    r->view_slot = -1;
+    if (view < 0) return;
+
+    RequestSlot *slot = &r->slots[view];
+    http_response_free(&slot->response);
+    slot->response = r->response;
+    memset(&r->response, 0, sizeof(r->response));
+}
+
+void request_slots_view(ResponseState *r, int slot) {
+    if (!r || slot < 0 || slot >= REQUEST_SLOTS_MAX) return;
+    if (viewed_index(r) == slot) return;
+
+    request_slots_detach_view(r);
+    http_response_free(&r->response);
+
+    r->response = r->slots[slot].response;
+    memset(&r->slots[slot].response, 0, sizeof(r->slots[slot].response));
+    r->view_slot = slot;
+    r->scroll = 0;
+}
+
+void request_slots_begin(ResponseState *r, int slot, int id, HttpMethod method, const char *url) {
+    if (!r || slot < 0 || slot >= REQUEST_SLOTS_MAX) return;
+
+    if (viewed_index(r) == slot) request_slots_detach_view(r);
+    slot_clear(&r->slots[slot]);
+
+    RequestSlot *s = &r->slots[slot];
+    s->id = id;
+    s->state = REQUEST_SLOT_IN_FLIGHT;
+    s->method = method;
+    s->url = strdup(url ? url : "");
+    r->requests_in_flight++;
+
+    request_slots_view(r, slot);
+}
+
+HttpResponse *request_slots_complete(ResponseState *r, int id, HttpResponse *result) {
+    if (!r || !result) return NULL;
+
+    for (int i = 0; i < REQUEST_SLOTS_MAX; i++) {
+        RequestSlot *slot = &r->slots[i];
+        if (slot->id != id || slot->state != REQUEST_SLOT_IN_FLIGHT) continue;
+
+        slot->state = REQUEST_SLOT_DONE;
+        if (r->requests_in_flight > 0) r->requests_in_flight--;
+        free(slot->stream);
+        slot->stream = NULL;
+        slot->stream_len = 0;
+        slot->stream_cap = 0;
+        slot->received = 0;
+        slot->rate_bps = 0.0;
+
+        int viewed = (viewed_index(r) == i);
+        HttpResponse *dst = viewed ? &r->response : &slot->response;
+        http_response_free(dst);
+        *dst = *result;
+        memset(result, 0, sizeof(*result));
+        if (viewed) r->scroll = 0;
+        return dst;
+    }
+
+    http_response_free(result);
+    return NULL;
+}
+
+int request_slots_pump(ResponseState *r, double now_ms) {
+    if (!r || !r->engine) return 0;
+
+    int view = viewed_index(r);
+    if (view < 0) return 0;
+    RequestSlot *slot = &r->slots[view];
+    if (slot->state != REQUEST_SLOT_IN_FLIGHT) return 0;
+
+    /* A body that goes to disk is not copied past the point it spills at */
+    size_t limit = STREAM_PREVIEW_MAX_BYTES;
+    if (r->spill_mb > 0 && (size_t)r->spill_mb * 1024 * 1024 < limit) limit = (size_t)r->spill_mb * 1024 * 1024;
+
+    size_t before = slot->stream_len;
+    while (slot->stream_len < limit) {
+        size_t want = limit - slot->stream_len;
+        if (want > STREAM_PUMP_CHUNK) want = STREAM_PUMP_CHUNK;
+        if (slot->stream_cap - slot->stream_len < want + 1) {
+            size_t cap = slot->stream_cap ? slot->stream_cap * 2 : STREAM_PUMP_CHUNK * 2;
+            if (cap > limit + 1) cap = limit + 1;
+            char *p = realloc(slot->stream, cap);
+            if (!p) break;
+            slot->stream = p;
+            slot->stream_cap = cap;
+        }
+
+        long n = http_engine_stream_read(r->engine, slot->id, slot->stream_len,
+                                         slot->stream + slot->stream_len, want);
+        if (n <= 0) break;
+        slot->stream_len += (size_t)n;
+        slot->stream[slot->stream_len] = '\0';
+        if ((size_t)n < want ||
+            slot->stream_len - before >= STREAM_PUMP_MAX_PER_CALL) break;
+    }
+
+    /* Past the preview the transfer's own count is all that moves */
+    size_t received_before = slot->received;
+    HttpProgress progress;
+    slot->received = slot->stream_len;
+    if (slot->stream_len >= limit && http_engine_progress(r->engine, slot->id, &progress) == 0 &&
+        progress.bytes_received > (long long)slot->received) {
+        slot->received = (size_t)progress.bytes_received;
+    }
+
+    /* Rate over windows of at least STREAM_RATE_WINDOW_MS, smoothed so the
+       figure does not jump with every redraw. */
+    if (slot->rate_sample_ms <= 0.0) {
+        slot->rate_sample_ms = now_ms;
+        slot->rate_sample_len = slot->received;
+    } else if (now_ms - slot->rate_sample_ms >= STREAM_RATE_WINDOW_MS) {
+        double bps = (double)(slot->received - slot->rate_sample_len) * 1000.0 /
+                     (now_ms - slot->rate_sample_ms);
+        slot->rate_bps = (slot->rate_bps > 0.0) ? 0.7 * slot->rate_bps + 0.3 * bps : bps;
+        slot->rate_sample_ms = now_ms;
+        slot->rate_sample_len = slot->received;
+    }
+
+    return slot->received != received_before;
+}
+
+int request_slots_cycle(ResponseState *r, int direction) {
+    if (!r) return 0;
+
+    int view = viewed_index(r);
+    int current_id = (view >= 0) ? r->slots[view].id : 0;
+    int best = -1;
+    int wrap = -1;
+
+    for (int i = 0; i < REQUEST_SLOTS_MAX; i++) {
+        const RequestSlot *slot = &r->slots[i];
+        if (slot->state == REQUEST_SLOT_EMPTY || i == view) continue;
+
+        if (direction > 0) {
+            if (slot->id > current_id && (best < 0 || slot->id < r->slots[best].id)) best = i;
+            if (wrap < 0 || slot->id < r->slots[wrap].id) wrap = i;
+        } else {
+            if ((current_id == 0 || slot->id < current_id) &&
+                (best < 0 || slot->id > r->slots[best].id)) best = i;
+            if (wrap < 0 || slot->id > r->slots[wrap].id) wrap = i;
+        }
+    }
+
+    int target = (best >= 0) ? best : wrap;
+    if (target < 0) return 0;
+
+    request_slots_view(r, target);
+    return 1;
+}
+
+const RequestSlot *request_slots_viewed(const ResponseState *r) {
+    if (!r) return NULL;
+    int view = viewed_index(r);
+    return (view >= 0) ? &r->slots[view] : NULL;
+}
+
+int request_slots_position(const ResponseState *r, int slot, int *out_total) {
+    int total = 0;
+    int pos = 0;
+    if (r && slot >= 0 && slot < REQUEST_SLOTS_MAX) {
+        for (int i = 0; i < REQUEST_SLOTS_MAX; i++) {
+            if (r->slots[i].state == REQUEST_SLOT_EMPTY) continue;
+            total++;
+            if (r->slots[i].id <= r->slots[slot].id) pos++;
+        }
+    }
+    if (out_total) *out_total = total;
+    return pos;
+}
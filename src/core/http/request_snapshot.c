@@ -2,7 +2,7 @@
  * request_snapshot.c - Request state capture
  * 
  * Creates immutable snapshots of request state for:
- * - HTTP execution (request_thread.c)
+ * - HTTP execution (request_thread.c, bench.c)
  * - Export operations (export.c)
  * - History storage
  */
@@ -19,6 +19,17 @@ static char *dup_or_empty(const char *s) {
     return strdup(s ? s : "");
 }
 
+/* Positive millisecond value of an environment variable, else 0. */
+static long env_timeout_ms(const EnvStore *envs, const char *key) {
+    const char *v = envs ? env_store_lookup(envs, key) : NULL;
+    if (!v) return 0;
+
+    char *end = NULL;
+    long ms = strtol(v, &end, 10);
+    if (!end || end == v || *end != '\0' || ms <= 0) return 0;
+    return ms;
+}
+
 int request_snapshot_build_locked(const AppState *s_const, RequestSnapshot *out) {
     if (!s_const || !out) return 1;
 
@@ -30,6 +41,8 @@ int request_snapshot_build_locked(const AppState *s_const, RequestSnapshot *out)
     out->body_text = tb_to_string(&s->editor.body);
     out->headers_text = tb_to_string(&s->editor.headers);
     out->env_name = dup_or_empty(env_store_active_name(&s->config.envs));
+    out->timeout_ms = s->editor.timeout_ms;
+    out->connect_timeout_ms = s->editor.connect_timeout_ms;
 
     if (!out->url || !out->body_text || !out->headers_text || !out->env_name) {
         request_snapshot_free(out);
@@ -56,3 +69,32 @@ void request_snapshot_free(RequestSnapshot *s) {
     free(s->env_name);
     memset(s, 0, sizeof(*s));
 }
+
+int request_snapshot_resolve(const RequestSnapshot *snap, const EnvStore *envs, ResolvedRequest *out, char **missing_name) {
+    if (missing_name) *missing_name = NULL;
+    if (!snap || !out) return 1;
+
+    memset(out, 0, sizeof(*out));
+    out->url = env_expand_template(envs, snap->url, missing_name);
+    if (out->url) out->body = env_expand_template(envs, snap->body_text, missing_name);
+    if (out->body) out->headers_text = env_expand_template(envs, snap->headers_text, missing_name);
+
+    if (!out->url || !out->body || !out->headers_text) {
+        resolved_request_free(out);
+        return 1;
+    }
+
+    out->timeout_ms = snap->timeout_ms > 0 ? snap->timeout_ms : env_timeout_ms(envs, ENV_TIMEOUT_MS_KEY);
+    out->connect_timeout_ms = snap->connect_timeout_ms > 0
+        ? snap->connect_timeout_ms
+        : env_timeout_ms(envs, ENV_CONNECT_TIMEOUT_MS_KEY);
+    return 0;
+}
+
+void resolved_request_free(ResolvedRequest *r) {
+    if (!r) return;
+    free(r->url);
+    free(r->body);
+    free(r->headers_text);
+    memset(r, 0, sizeof(*r));
+}
@@ -1,28 +1,69 @@
+/*
+ * request_thread.c - Asynchronous send and completion
+ *
+ * request_start() runs on the UI thread under the state lock. on_request_done()
+ * runs on the engine's I/O thread and only queues the response, so that one
+ * large body does not hold up the other transfers; a finisher thread formats
+ * it, hashes it for history and takes the lock only to publish.
+ */
+
 #include "core/http/request_thread.h"
 #include "state.h"
 #include "core/http/http.h"
+#include "core/http/http_engine.h"
+#include "core/http/request_slots.h"
 #include "core/storage/history.h"
 #include "core/storage/history_persistence.h"
-#include "core/config/env.h"
+#include "core/storage/history_writer.h"
 #include "core/text/textbuf.h"
 #include "core/format/format.h"
 #include "core/http/request_snapshot.h"
+#include "core/config/constants.h"
+#include "core/utils/mapped_body.h"
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+typedef struct {
+    AppState *state;
+    RequestFinisher *finisher;
+    RequestSnapshot snap; /* Unexpanded editor content, as stored in history */
+} PendingRequest;
+
+/* A response received by the I/O thread, waiting for the finisher */
+typedef struct FinishedRequest {
+    int id;
+    HttpResponse result;
+    PendingRequest *pending;
+    struct FinishedRequest *next;
+} FinishedRequest;
+
+struct RequestFinisher {
+    pthread_t thread;
+    pthread_mutex_t mu;
+    pthread_cond_t cv;
+    FinishedRequest *head; /* Oldest first */
+    FinishedRequest *tail;
+    int stopping;
+};
+
+/* Response body and headers, in that order */
+#define RESPONSE_STRINGS 2
+
+/* What the writer thread needs for a finished request, built before taking the lock. */
+typedef struct {
+    char *line;                           /* Serialized entry, owned */
+    BodyHash hashes[RESPONSE_STRINGS];
+    size_t lens[RESPONSE_STRINGS];
+    int shared[RESPONSE_STRINGS];         /* Stored beside the log and referenced by hash */
+} HistoryRecord;
+
 static void fail_with_error(AppState *s, const char *msg) {
-    app_state_lock(s);
-    free(s->response.response.body);
-    free(s->response.response.body_view);
-    free(s->response.response.response_headers);
-    free(s->response.response.error);
-    s->response.response.body = NULL;
-    s->response.response.body_view = NULL;
-    s->response.response.response_headers = NULL;
+    request_slots_detach_view(&s->response);
+    http_response_free(&s->response.response);
     s->response.response.error = strdup(msg ? msg : "Unknown error");
-    s->response.is_request_in_flight = 0;
-    app_state_unlock(s);
+    s->response.scroll = 0;
 }
 
 static void fail_with_missing_var(AppState *s, const char *name) {
@@ -36,151 +77,358 @@ static void fail_with_missing_var(AppState *s, const char *name) {
     fail_with_error(s, msg);
 }
 
-void *request_thread(void *arg) {
-    AppState *s = arg;
 
-    RequestSnapshot snap;
-    if (request_snapshot_build(s, &snap) != 0) {
-        fail_with_error(s, "Out of memory building request snapshot");
-        return NULL;
+/* The history.jsonl line for a finished request, built before taking the lock. */
+static char *format_history_line(const RequestSnapshot *snap, const HttpResponse *response) {
+    HistoryItem it;
+    memset(&it, 0, sizeof(it));
+    it.method = snap->method;
+    it.url = snap->url;
+    it.body = snap->body_text;
+    it.headers = snap->headers_text;
+    it.status = response->status;
+    it.elapsed_ms = response->elapsed_ms;
+    it.timing = response->timing;
+    it.is_json = response->is_json;
+    it.response_body = response->body;
+    it.response_headers = response->response_headers;
+    return history_storage_format_entry(&it);
+}
+
+static void response_strings(const HttpResponse *r, const char **out) {
+    out[0] = r->body;
+    out[1] = r->response_headers;
+}
+
+static size_t response_string_len(const HttpResponse *r, const char *s) {
+    return (r->body_map && s == r->body) ? r->body_map->len : strlen(s);
+}
+
+static void prepare_history_record(const RequestSnapshot *snap, const HttpResponse *response, HistoryRecord *rec) {
+    memset(rec, 0, sizeof(*rec));
+    rec->line = format_history_line(snap, response);
+
+    const char *strings[RESPONSE_STRINGS];
+    response_strings(response, strings);
+    for (int i = 0; i < RESPONSE_STRINGS; i++) {
+        if (!strings[i]) continue;
+        size_t len = response_string_len(response, strings[i]);
+        if (len < HISTORY_SHARED_BODY_MIN_BYTES) continue;
+        body_hash(strings[i], len, &rec->hashes[i]);
+        rec->lens[i] = len;
+        rec->shared[i] = 1;
     }
+}
 
-    char *missing = NULL;
-    char *url = NULL;
-    char *payload = NULL;
-    char *headers_text = NULL;
+/*
+ * Queue the shared bodies of entry `it`; the writer skips those the log
+ * already has, so nothing here touches the disk. The jobs pin the entry's
+ * interned strings rather than copy them. Runs under the state lock, with
+ * the entry already in the history, so that a sweep by the writer either
+ * sees the body in memory or ran before it is written.
+ */
+static int queue_shared_bodies(AppState *s, const HistoryItem *it, const HistoryRecord *rec) {
+    char *strings[RESPONSE_STRINGS] = { it->response_body, it->response_headers };
 
-    app_state_lock(s);
-    url = env_expand_template(&s->config.envs, snap.url, &missing);
-    if (url) payload = env_expand_template(&s->config.envs, snap.body_text, &missing);
-    if (url && payload) headers_text = env_expand_template(&s->config.envs, snap.headers_text, &missing);
-    app_state_unlock(s);
+    for (int i = 0; i < RESPONSE_STRINGS; i++) {
+        if (!rec->shared[i] || !strings[i]) continue;
 
-    if (!url) {
-        request_snapshot_free(&snap);
-        if (missing) {
-            fail_with_missing_var(s, missing);
-            free(missing);
+        int queued = 0;
+        for (int j = 0; j < i; j++) {
+            if (rec->shared[j] && body_hash_equal(&rec->hashes[j], &rec->hashes[i])) {
+                queued = 1;
+            }
+        }
+        if (queued) continue;
+
+        MappedBody *map = (i == 0) ? it->response_map : NULL;
+        if (history_writer_store_body(s->history.writer, strings[i], rec->lens[i], &rec->hashes[i], map) != 0) return 1;
+    }
+    return 0;
+}
+
+/* `rec` is the entry prepared for the writer thread; its line is consumed. */
+static void record_history(AppState *s, const RequestSnapshot *snap, const HttpResponse *response, HistoryRecord *rec) {
+    char *line = rec->line;
+    rec->line = NULL;
+    if (!s->history.history) {
+        free(line);
+        s->history.last_save_error = 0;
+        return;
+    }
+
+    TextBuffer hist_body;
+    TextBuffer hist_headers;
+    tb_init(&hist_body);
+    tb_init(&hist_headers);
+    tb_set_from_string(&hist_body, snap->body_text);
+    tb_set_from_string(&hist_headers, snap->headers_text);
+
+    /* A full history evicts its oldest entry to make room. */
+    int trimmed = s->history.history->count + 1 > s->history.max_entries;
+    unsigned long seq = s->history.history->next_seq;
+    /* The shared strings were hashed before the lock was taken */
+    int pushed = history_push_hashed(
+        s->history.history,
+        snap->method,
+        snap->url,
+        &hist_body,
+        &hist_headers,
+        response,
+        rec->shared[0] ? &rec->hashes[0] : NULL,
+        rec->shared[1] ? &rec->hashes[1] : NULL
+    );
+
+    tb_free(&hist_body);
+    tb_free(&hist_headers);
+
+    /* Disk work happens on the writer thread; its result arrives later. */
+    if (s->history.writer) {
+        /* The line was formatted before the entry was given its seq */
+        if (line && s->history.history->next_seq != seq) line = history_storage_set_line_seq(line, seq);
+
+        const HistoryItem *it = pushed == 0 ? history_get(s->history.history, s->history.history->count - 1) : NULL;
+        int rc = it ? queue_shared_bodies(s, it, rec) : 1;
+        if (rc == 0) rc = history_writer_append(s->history.writer, line);
+        else free(line);
+        if (rc == 0 && trimmed) {
+            rc = history_writer_trim(s->history.writer, s->history.max_entries);
+        }
+        if (rc != 0) s->history.last_save_error = rc;
+        return;
+    }
+    free(line);
+
+    int save_rc = 0;
+    if (s->history.path) {
+        /* While the background load runs, older entries are still only on
+           disk: a rewrite would lose them, so the file is trimmed later. */
+        if (trimmed && !s->history.loading) {
+            save_rc = history_storage_save(s->history.history, s->history.path);
         } else {
-            fail_with_error(s, "Out of memory resolving URL template");
+            save_rc = history_storage_append_last(s->history.history, s->history.path);
+            if (save_rc != 0) {
+                save_rc = history_storage_save(s->history.history, s->history.path);
+            }
         }
-        return NULL;
     }
+    s->history.last_save_error = save_rc;
+}
 
-    if (!payload) {
-        free(url);
-        request_snapshot_free(&snap);
-        if (missing) {
-            fail_with_missing_var(s, missing);
-            free(missing);
+/* Format a received response and publish it into its slot and history. */
+static void finish_request(PendingRequest *p, int id, HttpResponse *result) {
+    AppState *s = p->state;
+
+    if (result->body_map) {
+        /* Spilled bodies are shown as received; formatting would copy them to the heap. */
+        result->body_view = result->body;
+        result->is_json = 0;
+    } else if (result->body) {
+        char *pretty = json_pretty_print(result->body);
+        if (pretty) {
+            result->body_view = pretty;
+            result->is_json = 1;
         } else {
-            fail_with_error(s, "Out of memory resolving body template");
+            result->body_view = strdup(result->body);
+            result->is_json = 0;
         }
+    }
+    (void)http_response_index_view(result);
+
+    /* The writer is started before the first request and stopped after the
+       engine, so reading the pointer here without the lock is safe. */
+    HistoryRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    if (s->history.writer) prepare_history_record(&p->snap, result, &rec);
+
+    app_state_lock(s);
+    const HttpResponse *stored = request_slots_complete(&s->response, id, result);
+    if (stored) record_history(s, &p->snap, stored, &rec);
+    else free(rec.line);
+    app_state_mark_dirty(s, UI_DIRTY_RESPONSE | UI_DIRTY_HISTORY | UI_DIRTY_FOOTER);
+    app_state_unlock(s);
+
+    request_snapshot_free(&p->snap);
+    free(p);
+}
+
+static void *finisher_main(void *arg) {
+    RequestFinisher *f = arg;
+
+    pthread_mutex_lock(&f->mu);
+    for (;;) {
+        FinishedRequest *done = f->head;
+        if (!done) {
+            if (f->stopping) break;
+            pthread_cond_wait(&f->cv, &f->mu);
+            continue;
+        }
+        f->head = done->next;
+        if (!f->head) f->tail = NULL;
+        pthread_mutex_unlock(&f->mu);
+
+        finish_request(done->pending, done->id, &done->result);
+        http_response_free(&done->result);
+        free(done);
+
+        pthread_mutex_lock(&f->mu);
+    }
+    pthread_mutex_unlock(&f->mu);
+    return NULL;
+}
+
+static RequestFinisher *finisher_get(AppState *s) {
+    if (s->response.finisher) return s->response.finisher;
+
+    RequestFinisher *f = calloc(1, sizeof(*f));
+    if (!f) return NULL;
+    pthread_mutex_init(&f->mu, NULL);
+    pthread_cond_init(&f->cv, NULL);
+    if (pthread_create(&f->thread, NULL, finisher_main, f) != 0) {
+        pthread_cond_destroy(&f->cv);
+        pthread_mutex_destroy(&f->mu);
+        free(f);
         return NULL;
     }
+    s->response.finisher = f;
+    return f;
+}
+
+void request_thread_stop(AppState *s) {
+    RequestFinisher *f = s ? s->response.finisher : NULL;
+    if (!f) return;
+
+    /* Responses already queued are still published */
+    pthread_mutex_lock(&f->mu);
+    f->stopping = 1;
+    pthread_cond_signal(&f->cv);
+    pthread_mutex_unlock(&f->mu);
+    pthread_join(f->thread, NULL);
+
+    pthread_cond_destroy(&f->cv);
+    pthread_mutex_destroy(&f->mu);
+    free(f);
+    s->response.finisher = NULL;
+}
+
+static void on_request_done(int id, HttpResponse *result, void *userdata) {
+    PendingRequest *p = userdata;
+
+    /* Engine shut down first; there is no one left to show this to. */
+    if (!result) {
+        request_snapshot_free(&p->snap);
+        free(p);
+        return;
+    }
+
+    FinishedRequest *done = calloc(1, sizeof(*done));
+    if (!done) {
+        finish_request(p, id, result);
+        http_response_free(result);
+        return;
+    }
+    done->id = id;
+    done->result = *result;
+    memset(result, 0, sizeof(*result));
+    done->pending = p;
+
+    RequestFinisher *f = p->finisher;
+    pthread_mutex_lock(&f->mu);
+    if (f->tail) f->tail->next = done;
+    else f->head = done;
+    f->tail = done;
+    pthread_cond_signal(&f->cv);
+    pthread_mutex_unlock(&f->mu);
+}
 
-    if (!headers_text) {
-        free(url);
-        free(payload);
-        request_snapshot_free(&snap);
+int request_start(AppState *s) {
+    if (!s) return -1;
+
+    int slot = request_slots_reserve(&s->response);
+    if (slot < 0) {
+        fail_with_error(s, "Too many requests in flight");
+        return -1;
+    }
+
+    RequestFinisher *finisher = finisher_get(s);
+    if (!finisher) {
+        fail_with_error(s, "Could not start request");
+        return -1;
+    }
+
+    PendingRequest *p = calloc(1, sizeof(*p));
+    if (!p) {
+        fail_with_error(s, "Out of memory building request snapshot");
+        return -1;
+    }
+    p->state = s;
+    p->finisher = finisher;
+
+    if (request_snapshot_build_locked(s, &p->snap) != 0) {
+        free(p);
+        fail_with_error(s, "Out of memory building request snapshot");
+        return -1;
+    }
+
+    char *missing = NULL;
+    ResolvedRequest resolved;
+    if (request_snapshot_resolve(&p->snap, &s->config.envs, &resolved, &missing) != 0) {
+        request_snapshot_free(&p->snap);
+        free(p);
         if (missing) {
             fail_with_missing_var(s, missing);
             free(missing);
         } else {
-            fail_with_error(s, "Out of memory resolving headers template");
+            fail_with_error(s, "Out of memory resolving request template");
         }
-        return NULL;
+        return -1;
     }
 
-    TextBuffer resolved_headers;
-    tb_init(&resolved_headers);
-    tb_set_from_string(&resolved_headers, headers_text);
+    /* A failed create means no I/O thread; reported below as a failed send. */
+    if (!s->response.engine) s->response.engine = http_engine_create();
 
-    HttpResponse response_local;
-    memset(&response_local, 0, sizeof(response_local));
-    http_request(
-        url,
-        snap.method,
-        payload,
-        &resolved_headers,
-        s->config.paths.cookie_jar,
-        &response_local
-    );
+    HttpRequestSpec spec = {
+        .method = p->snap.method,
+        .url = resolved.url,
+        .body = resolved.body,
+        .headers_text = resolved.headers_text,
+        .cookie_jar_path = s->config.paths.cookie_jar,
+        .max_body_bytes = (size_t)s->response.max_body_mb * 1024u * 1024u,
+        .spill_threshold_bytes = (size_t)s->response.spill_mb * 1024u * 1024u,
+        .timeout_ms = resolved.timeout_ms > 0 ? resolved.timeout_ms : s->response.timeout_ms,
+        .connect_timeout_ms = resolved.connect_timeout_ms > 0
+            ? resolved.connect_timeout_ms
+            : s->response.connect_timeout_ms,
+    };
+    int id = http_engine_submit(s->response.engine, &spec, on_request_done, p);
 
-    tb_free(&resolved_headers);
-    free(url);
-    free(payload);
-    free(headers_text);
+    resolved_request_free(&resolved);
 
-    if (response_local.body) {
-        char *pretty = json_pretty_print(response_local.body);
-        if (pretty) {
-            response_local.body_view = pretty;
-            response_local.is_json = 1;
-        } else {
-            response_local.body_view = strdup(response_local.body);
-            response_local.is_json = 0;
-        }
+    if (id < 0) {
+        request_snapshot_free(&p->snap);
+        free(p);
+        fail_with_error(s, "Could not start request");
+        return -1;
     }
 
-    app_state_lock(s);
+    /* The lock is held, so the completion cannot publish before this. */
+    request_slots_begin(&s->response, slot, id, p->snap.method, p->snap.url);
+    return id;
+}
 
-    s->response.scroll = 0;
-    free(s->response.response.body);
-    free(s->response.response.body_view);
-    free(s->response.response.response_headers);
-    free(s->response.response.error);
-    s->response.response.body = response_local.body;
-    s->response.response.body_view = response_local.body_view;
-    s->response.response.response_headers = response_local.response_headers;
-    s->response.response.error = response_local.error;
-    s->response.response.status = response_local.status;
-    s->response.response.elapsed_ms = response_local.elapsed_ms;
-    s->response.response.timing = response_local.timing;
-    s->response.response.is_json = response_local.is_json;
-
-    if (s->history.history) {
-        TextBuffer hist_body;
-        TextBuffer hist_headers;
-        tb_init(&hist_body);
-        tb_init(&hist_headers);
-        tb_set_from_string(&hist_body, snap.body_text);
-        tb_set_from_string(&hist_headers, snap.headers_text);
-
-        history_push(
-            s->history.history,
-            snap.method,
-            snap.url,
-            &hist_body,
-            &hist_headers,
-            &s->response.response
-        );
-
-        tb_free(&hist_body);
-        tb_free(&hist_headers);
-
-        int count_after_push = s->history.history->count;
-        history_trim_oldest(s->history.history, s->history.max_entries);
-
-        int save_rc = 0;
-        if (s->history.path) {
-            if (s->history.history->count < count_after_push) {
-                save_rc = history_storage_save(s->history.history, s->history.path);
-            } else {
-                save_rc = history_storage_append_last(s->history.history, s->history.path);
-                if (save_rc != 0) {
-                    save_rc = history_storage_save(s->history.history, s->history.path);
-                }
-            }
+int request_cancel(AppState *s) {
+    if (!s || !s->response.engine) return -1;
+
+    const RequestSlot *target = request_slots_viewed(&s->response);
+    if (!target || target->state != REQUEST_SLOT_IN_FLIGHT) {
+        target = NULL;
+        for (int i = 0; i < REQUEST_SLOTS_MAX; i++) {
+            const RequestSlot *slot = &s->response.slots[i];
+            if (slot->state != REQUEST_SLOT_IN_FLIGHT) continue;
+            if (!target || slot->id > target->id) target = slot;
         }
-        s->history.last_save_error = save_rc;
-    } else {
-        s->history.last_save_error = 0;
     }
+    if (!target) return -1;
 
-    s->response.is_request_in_flight = 0;
-    app_state_unlock(s);
-
-    request_snapshot_free(&snap);
-    return NULL;
+    return http_engine_cancel(s->response.engine, target->id);
 }
@@ -26,6 +26,9 @@ static const ActionEntry ACTIONS[] = {
     {"search_next", ACT_SEARCH_NEXT},
     {"search_prev", ACT_SEARCH_PREV},
     {"toggle_response_view", ACT_TOGGLE_RESPONSE_VIEW},
+    {"next_response", ACT_NEXT_RESPONSE},
+    {"prev_response", ACT_PREV_RESPONSE},
+    {"cancel_request", ACT_CANCEL_REQUEST},
 };
 
 Action action_from_string(const char *name) {
@@ -63,6 +66,9 @@ const char *action_description(Action a, UiLanguage lang) {
         case ACT_SEARCH_NEXT: return i18n_get(lang, I18N_ACT_SEARCH_NEXT_DESC);
         case ACT_SEARCH_PREV: return i18n_get(lang, I18N_ACT_SEARCH_PREV_DESC);
         case ACT_TOGGLE_RESPONSE_VIEW: return i18n_get(lang, I18N_ACT_TOGGLE_RESPONSE_VIEW_DESC);
+        case ACT_NEXT_RESPONSE: return i18n_get(lang, I18N_ACT_NEXT_RESPONSE_DESC);
+        case ACT_PREV_RESPONSE: return i18n_get(lang, I18N_ACT_PREV_RESPONSE_DESC);
+        case ACT_CANCEL_REQUEST: return i18n_get(lang, I18N_ACT_CANCEL_REQUEST_DESC);
         default: return "";
     }
 }
@@ -1,4 +1,5 @@
 #include "core/interaction/auth.h"
+#include "core/utils/base64.h"
 #include "core/utils/utils.h"
 
 #include <ctype.h>
@@ -88,27 +89,6 @@ static int set_header_value(TextBuffer *headers, const char *key, const char *va
     return 0;
 }
 
-static char *base64_encode(const unsigned char *data, size_t len) {
-    static const char tbl[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-    size_t out_len = ((len + 2) / 3) * 4;
-    char *out = malloc(out_len + 1);
-    if (!out) return NULL;
-
-    size_t p = 0;
-    for (size_t i = 0; i < len; i += 3) {
-        unsigned v = data[i] << 16;
-        if (i + 1 < len) v |= data[i + 1] << 8;
-        if (i + 2 < len) v |= data[i + 2];
-
-        out[p++] = tbl[(v >> 18) & 0x3F];
-        out[p++] = tbl[(v >> 12) & 0x3F];
-        out[p++] = (i + 1 < len) ? tbl[(v >> 6) & 0x3F] : '=';
-        out[p++] = (i + 2 < len) ? tbl[v & 0x3F] : '=';
-    }
-    out[p] = '\0';
-    return out;
-}
-
 int auth_apply_bearer(TextBuffer *headers, const char *token) {
     if (!token || !token[0]) return 1;
     char value[2048];
@@ -124,7 +104,7 @@ int auth_apply_basic(TextBuffer *headers, const char *user, const char *pass) {
     if (!plain) return 1;
     snprintf(plain, n, "%s:%s", user, pass);
 
-    char *b64 = base64_encode((const unsigned char *)plain, strlen(plain));
+    char *b64 = base64_encode(plain, strlen(plain));
     free(plain);
     if (!b64) return 1;
 
@@ -0,0 +1,319 @@
+/*
+ * fuzzy.c - Incremental fuzzy finder over history
+ *
+ * Each keystroke in search mode scores the history entries' cached
+ * "METHOD URL STATUS" lines, kept in lower case, and sorts the ones that
+ * match by a radix sort on (score, index), with no allocation once the
+ * cache is built. As the query grows, only the entries that matched before
+ * are scored again.
+ */
+
+#include "core/interaction/fuzzy.h"
+#include "core/http/http.h"
+#include "core/storage/history.h"
+#include "core/utils/bytebuf.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Scoring, in the spirit of fzf's first algorithm */
+#define SCORE_MATCH 16
+#define BONUS_BOUNDARY 8      /* Match at the start of a word */
+#define BONUS_CONSECUTIVE 6   /* Match right after the previous one */
+#define PENALTY_GAP_START 3
+#define PENALTY_GAP_EXTEND 1
+#define SCORE_MAX 0xffff
+
+static unsigned char fold(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c | 0x20) : c;
+}
+
+static int is_word_char(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+/* `folded`: the text is already in lower case, as in the finder's cache */
+static int score_match(const unsigned char *t, size_t len, const unsigned char *p, size_t plen, int folded) {
+    if (plen == 0) return 0;
+    if (len < plen) return FUZZY_NO_MATCH;
+
+    /* Earliest end of a match... */
+    size_t pi = 0;
+    size_t end = 0;
+    if (folded) {
+        unsigned char want = fold(p[0]);
+        for (size_t i = 0; i < len; i++) {
+            if (t[i] == want) {
+                if (++pi == plen) {
+                    end = i + 1;
+                    break;
+                }
+                want = fold(p[pi]);
+            }
+        }
+    } else {
+        for (size_t i = 0; i < len; i++) {
+            if (fold(t[i]) == fold(p[pi]) && ++pi == plen) {
+                end = i + 1;
+                break;
+            }
+        }
+    }
+    if (pi < plen) return FUZZY_NO_MATCH;
+
+    /* ...and the latest start before it, for the shortest window */
+    size_t start = end;
+    while (pi > 0) {
+        start--;
+        if ((folded ? t[start] : fold(t[start])) == fold(p[pi - 1])) pi--;
+    }
+
+    int score = 0;
+    int prev_matched = 0;
+    int in_gap = 0;
+    for (size_t i = start; i < end; i++) {
+        if ((folded ? t[i] : fold(t[i])) != fold(p[pi])) {
+            score -= in_gap ? PENALTY_GAP_EXTEND : PENALTY_GAP_START;
+            in_gap = 1;
+            prev_matched = 0;
+            continue;
+        }
+
+        int bonus = 0;
+        if (i == 0 || !is_word_char(t[i - 1])) bonus = BONUS_BOUNDARY;
+        if (prev_matched && bonus < BONUS_CONSECUTIVE) bonus = BONUS_CONSECUTIVE;
+        if (pi == 0) bonus *= 2;
+        score += SCORE_MATCH + bonus;
+
+        in_gap = 0;
+        prev_matched = 1;
+        if (++pi == plen) break;
+    }
+
+    if (score < 0) return 0;
+    return score > SCORE_MAX ? SCORE_MAX : score;
+}
+
+int fuzzy_score(const char *text, size_t len, const char *pattern, size_t plen) {
+    if (!pattern || plen == 0) return 0;
+    if (!text) return FUZZY_NO_MATCH;
+    return score_match((const unsigned char *)text, len, (const unsigned char *)pattern, plen, 0);
+}
+
+static void drop_cache(FuzzyFinder *f) {
+    free(f->texts);
+    free(f->offsets);
+    free(f->keys);
+    free(f->scratch);
+    free(f->items);
+    f->texts = NULL;
+    f->offsets = NULL;
+    f->keys = NULL;
+    f->scratch = NULL;
+    f->items = NULL;
+    f->capacity = 0;
+    f->count = 0;
+    f->source = NULL;
+}
+
+static int append_status(ByteBuf *b, long status) {
+    char digits[24];
+    int n = 0;
+    unsigned long v = status < 0 ? 0 : (unsigned long)status;
+    do {
+        digits[sizeof(digits) - 1 - n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v > 0 && n < (int)sizeof(digits) - 1);
+    digits[sizeof(digits) - 1 - n++] = ' ';
+    return bytebuf_append(b, digits + sizeof(digits) - n, (size_t)n);
+}
+
+/* Text of every entry, and buffers big enough to rank all of them. */
+static int build_cache(FuzzyFinder *f, History *h) {
+    drop_cache(f);
+
+    int n = h->count;
+    ByteBuf text;
+    bytebuf_init(&text);
+    f->offsets = malloc(((size_t)n + 1) * sizeof(*f->offsets));
+    f->keys = malloc(((size_t)n + 1) * sizeof(*f->keys));
+    f->scratch = malloc(((size_t)n + 1) * sizeof(*f->scratch));
+    f->items = malloc(((size_t)n + 1) * sizeof(*f->items));
+    if (!f->offsets || !f->keys || !f->scratch || !f->items) {
+        drop_cache(f);
+        return 1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        const HistoryItem *it = history_get(h, i);
+        f->offsets[i] = text.len;
+        if (bytebuf_append_str(&text, http_method_name(it->method)) != 0 ||
+            bytebuf_append(&text, " ", 1) != 0 ||
+            bytebuf_append_str(&text, it->url ? it->url : "") != 0 ||
+            (it->status && append_status(&text, it->status) != 0)) {
+            bytebuf_free(&text);
+            drop_cache(f);
+            return 1;
+        }
+    }
+    f->offsets[n] = text.len;
+    for (size_t i = 0; i < text.len; i++) text.data[i] = (char)fold((unsigned char)text.data[i]);
+    f->texts = bytebuf_take(&text);
+    if (!f->texts) {
+        drop_cache(f);
+        return 1;
+    }
+
+    f->capacity = n;
+    f->source = h;
+    f->generation = h->generation;
+    f->first_id = h->first_id;
+    return 0;
+}
+
+#define RADIX_BITS 11
+#define RADIX_SIZE (1 << RADIX_BITS)
+
+/* Sort `n` keys of `bits` bits ascending, RADIX_BITS at a time. */
+static void radix_sort(unsigned long long *keys, unsigned long long *tmp, int n, int bits) {
+    for (int shift = 0; shift < bits; shift += RADIX_BITS) {
+        size_t count[RADIX_SIZE + 1] = { 0 };
+        for (int i = 0; i < n; i++) count[((keys[i] >> shift) & (RADIX_SIZE - 1)) + 1]++;
+        if (count[((keys[0] >> shift) & (RADIX_SIZE - 1)) + 1] == (size_t)n) continue;
+
+        for (int d = 0; d < RADIX_SIZE; d++) count[d + 1] += count[d];
+        for (int i = 0; i < n; i++) tmp[count[(keys[i] >> shift) & (RADIX_SIZE - 1)]++] = keys[i];
+        memcpy(keys, tmp, (size_t)n * sizeof(*keys));
+    }
+}
+
+/* 1 if `a` is a subsequence of `b`, ignoring ASCII case */
+static int is_subsequence(const char *a, const char *b) {
+    for (; *a; a++) {
+        while (*b && fold((unsigned char)*b) != fold((unsigned char)*a)) b++;
+        if (!*b) return 0;
+        b++;
+    }
+    return 1;
+}
+
+void fuzzy_finder_begin(AppState *s) {
+    if (!s) return;
+    FuzzyFinder *f = &s->search.fuzzy;
+    f->active = 0;
+    f->count = 0;
+    f->cursor = 0;
+    f->query[0] = '\0';
+    f->origin = s->history.history ? s->history.history->first_id + s->history.selected : 0;
+}
+
+/* An evicted origin falls back to the oldest entry left */
+static void restore_origin(AppState *s) {
+    const History *h = s->history.history;
+    if (!h || h->count <= 0) return;
+    long origin = s->search.fuzzy.origin - h->first_id;
+    s->history.selected = origin < 0 ? 0 : (origin >= h->count ? h->count - 1 : (int)origin);
+}
+
+int fuzzy_finder_entry(const AppState *s, int row) {
+    if (!s) return -1;
+    const FuzzyFinder *f = &s->search.fuzzy;
+    const History *h = s->history.history;
+    if (!h || !f->active || row < 0 || row >= f->count) return -1;
+
+    /* Entries loaded or dropped since the ranking shift the indices */
+    long idx = f->items[row] + (f->first_id - h->first_id);
+    return idx >= 0 && idx < h->count ? (int)idx : -1;
+}
+
+void fuzzy_finder_update(AppState *s, const char *query) {
+    if (!s) return;
+    FuzzyFinder *f = &s->search.fuzzy;
+    History *h = s->history.history;
+
+    if (!h || !query || !query[0]) {
+        if (f->active) restore_origin(s);
+        f->active = 0;
+        f->count = 0;
+        f->query[0] = '\0';
+        return;
+    }
+
+    int fresh = f->source != h || f->generation != h->generation || f->capacity != h->count || !f->texts;
+    if (fresh && build_cache(f, h) != 0) {
+        f->active = 0;
+        return;
+    }
+
+    /* A query that only gained characters, wherever they were typed, can
+       only match entries the previous one matched */
+    size_t plen = strlen(query);
+    int refine = !fresh && f->active && f->query[0] && is_subsequence(f->query, query);
+
+    /* Keys are (score, index) packed into as few bits as the history needs */
+    int idx_bits = 1;
+    while (idx_bits < 31 && (1 << idx_bits) < f->capacity) idx_bits++;
+
+    int total = refine ? f->count : f->capacity;
+    int n = 0;
+    for (int k = 0; k < total; k++) {
+        int idx = refine ? f->items[k] : k;
+        size_t off = f->offsets[idx];
+        int score = score_match((const unsigned char *)f->texts + off, f->offsets[idx + 1] - off,
+                                (const unsigned char *)query, plen, 1);
+        if (score == FUZZY_NO_MATCH) continue;
+        f->keys[n++] = ((unsigned long long)score << idx_bits) | (unsigned int)idx;
+    }
+    if (n > 1) radix_sort(f->keys, f->scratch, n, idx_bits + 16);
+
+    /* Best score first; among equals the newest entry */
+    unsigned long long idx_mask = (1ULL << idx_bits) - 1;
+    for (int k = 0; k < n; k++) f->items[k] = (int)(f->keys[n - 1 - k] & idx_mask);
+    f->count = n;
+    f->cursor = 0;
+    f->active = 1;
+    strncpy(f->query, query, sizeof(f->query) - 1);
+    f->query[sizeof(f->query) - 1] = '\0';
+
+    if (n > 0) s->history.selected = f->items[0];
+}
+
+void fuzzy_finder_move(AppState *s, int dir) {
+    if (!s) return;
+    FuzzyFinder *f = &s->search.fuzzy;
+    if (!f->active || f->count <= 0) return;
+
+    int cursor = f->cursor + (dir >= 0 ? 1 : -1);
+    if (cursor < 0) cursor = 0;
+    if (cursor >= f->count) cursor = f->count - 1;
+    f->cursor = cursor;
+
+    int idx = fuzzy_finder_entry(s, cursor);
+    if (idx >= 0) s->history.selected = idx;
+}
+
+static void leave(FuzzyFinder *f) {
+    f->active = 0;
+    f->count = 0;
+    f->query[0] = '\0';
+}
+
+int fuzzy_finder_accept(AppState *s) {
+    if (!s) return -1;
+    int picked = fuzzy_finder_entry(s, s->search.fuzzy.cursor);
+    if (picked >= 0) s->history.selected = picked;
+    leave(&s->search.fuzzy);
+    return picked;
+}
+
+void fuzzy_finder_cancel(AppState *s) {
+    if (!s) return;
+    if (s->search.fuzzy.active) restore_origin(s);
+    leave(&s->search.fuzzy);
+}
+
+void fuzzy_finder_free(FuzzyFinder *f) {
+    if (!f) return;
+    drop_cache(f);
+    f->active = 0;
+    f->query[0] = '\0';
+}
@@ -1,9 +1,68 @@
 #include "core/interaction/search.h"
 #include "core/storage/history.h"
+#include "core/storage/history_index.h"
+#include "core/storage/history_persistence.h"
+#include "core/utils/mapped_body.h"
+#include "core/text/line_index.h"
+#include "core/text/find_ci.h"
+#include "core/config/constants.h"
+#include <pthread.h>
+#include <regex.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <ctype.h>
+
+#define REGEX_PREFIX "re:"
+#define REGEX_PREFIX_LEN 3
+
+/* A compiled pattern, shared by the search state and the scans using it */
+struct SearchRegex {
+    int refs;
+    regex_t re;
+    char pattern[PROMPT_MAX];
+};
+
+/* Response view a background scan reads: references to the text and line
+   index the response already holds. Reused by later scans of the same view. */
+typedef struct {
+    int refs;
+    MappedBody *map;
+    LineIndex *lines;       /* NULL if the view could not be indexed */
+    const void *source;
+    unsigned long generation;
+} ScanText;
+
+typedef struct ScanJob {
+    unsigned long id;
+    SearchRegex *regex;
+    ScanText *text;
+    char query[PROMPT_MAX];
+} ScanJob;
+
+struct SearchWorker {
+    AppState *state;
+    pthread_t thread;
+    pthread_mutex_t mu;
+    pthread_cond_t cv;
+    ScanJob *next;          /* Waiting to run; a newer job replaces it */
+    int stopping;
+
+    /* UI thread only, under the state lock */
+    ScanText *text;         /* Text of the newest job */
+    char query[PROMPT_MAX]; /* Query of the newest job */
+};
+
+/* Lets a scan notice that it is no longer wanted */
+typedef struct {
+    const unsigned long *current;
+    unsigned long id;
+} ScanTicket;
+
+/* A literal query, matched ignoring case, or a compiled pattern */
+typedef struct {
+    const char *literal;
+    const regex_t *re;
+} Matcher;
 
 /**
  * Case-insensitive substring search within a bounded string.
@@ -15,20 +74,17 @@
  */
 static int contains_ci_n(const char *hay, size_t hay_n, const char *needle) {
     if (!needle || !needle[0]) return 1;
-    size_t n = strlen(needle);
-    if (n > hay_n) return 0;
-
-    for (size_t i = 0; i + n <= hay_n; i++) {
-        size_t j = 0;
-        while (j < n) {
-            unsigned char a = (unsigned char)hay[i + j];
-            unsigned char b = (unsigned char)needle[j];
-            if (tolower(a) != tolower(b)) break;
-            j++;
-        }
-        if (j == n) return 1;
-    }
-    return 0;
+    return find_ci(hay, hay_n, needle, strlen(needle)) != NULL;
+}
+
+static int matcher_test(const Matcher *m, const char *text, size_t len) {
+    if (!m->re) return contains_ci_n(text, len, m->literal);
+
+    /* The line need not end in a NUL; the span bounds it */
+    regmatch_t span;
+    span.rm_so = 0;
+    span.rm_eo = (regoff_t)len;
+    return regexec(m->re, text, 1, &span, REG_STARTEND) == 0;
 }
 
 /**
@@ -49,33 +105,73 @@ static const char *method_short(int method) {
  * 
  * Matches against "METHOD URL" format (case-insensitive).
  */
-static int history_item_matches(const HistoryItem *it, const char *query) {
+static int history_item_matches(const HistoryItem *it, const Matcher *m) {
     char line[2048];
     snprintf(line, sizeof(line), "%s %s", method_short(it->method), it->url ? it->url : "");
-    return contains_ci_n(line, strlen(line), query);
+    return matcher_test(m, line, strlen(line));
+}
+
+static int text_contains(const char *text, size_t len, void *query) {
+    return contains_ci_n(text, len, query);
+}
+
+/**
+ * Check a full-text candidate against its text. The index only knows that
+ * every trigram of the query occurs, so entries whose bodies are still on
+ * disk are read back to check, without paging them in.
+ */
+static int history_item_text_matches(History *h, const HistoryItem *it, const char *query) {
+    if (!it->paged_in) return history_storage_test_text(h, it, text_contains, (void *)query);
+
+    size_t body_len = it->response_map ? it->response_map->len : (it->response_body ? strlen(it->response_body) : 0);
+    return (it->body && contains_ci_n(it->body, strlen(it->body), query)) ||
+           (it->headers && contains_ci_n(it->headers, strlen(it->headers), query)) ||
+           (it->response_body && contains_ci_n(it->response_body, body_len, query)) ||
+           (it->response_headers && contains_ci_n(it->response_headers, strlen(it->response_headers), query));
+}
+
+static int cmp_seq(const void *a, const void *b) {
+    unsigned long x = *(const unsigned long *)a;
+    unsigned long y = *(const unsigned long *)b;
+    return (x > y) - (x < y);
 }
 
 /**
  * Collect indices of all history items matching a query.
+ *
+ * With the full-text index on, entries whose bodies or headers contain a
+ * literal query match too; patterns only see method and URL.
  * 
- * @param s Application state
- * @param query Search query
+ * @param h History to search
+ * @param m Query to match
  * @param out_count Output: number of matches
  * @return Array of indices (caller must free), or NULL if no matches
  */
-static int *collect_history_matches(const AppState *s, const char *query, int *out_count) {
+static int *collect_history_matches(History *h, const Matcher *m, int *out_count) {
     *out_count = 0;
-    if (!s->history.history || s->history.history->count <= 0 || !query || !*query) return NULL;
+    if (!h || h->count <= 0) return NULL;
 
-    int *matches = malloc((size_t)s->history.history->count * sizeof(*matches));
+    int *matches = malloc((size_t)h->count * sizeof(*matches));
     if (!matches) return NULL;
 
+    /* Short queries and a failed lookup fall back to method and URL */
+    unsigned long *hits = NULL;
+    size_t nhits = 0;
+    size_t qlen = m->re ? 0 : strlen(m->literal);
+    if (h->fulltext && qlen >= HISTORY_INDEX_GRAM) {
+        (void)history_index_query(h->fulltext, m->literal, qlen, &hits, &nhits);
+    }
+
     int mcount = 0;
-    for (int i = 0; i < s->history.history->count; i++) {
-        if (history_item_matches(&s->history.history->items[i], query)) {
-            matches[mcount++] = i;
+    for (int i = 0; i < h->count; i++) {
+        const HistoryItem *it = history_get(h, i);
+        int hit = history_item_matches(it, m);
+        if (!hit && nhits > 0 && it->seq && bsearch(&it->seq, hits, nhits, sizeof(*hits), cmp_seq)) {
+            hit = history_item_text_matches(h, it, m->literal);
         }
+        if (hit) matches[mcount++] = i;
     }
+    free(hits);
 
     if (mcount == 0) {
         free(matches);
@@ -90,13 +186,18 @@ static int *collect_history_matches(const AppState *s, const char *query, int *o
  * Collect line numbers of all lines in body matching a query.
  * 
  * @param body Response body text
- * @param query Search query
+ * @param lines Line index of body, or NULL to split it while scanning
+ * @param m Query to match
+ * @param ticket When set, the scan gives up (and sets `*cancelled`) once
+ *        `*ticket->current` moves on from `ticket->id`
  * @param out_count Output: number of matches
  * @return Array of line numbers (caller must free), or NULL if no matches
  */
-static int *collect_response_matches(const char *body, const char *query, int *out_count) {
+static int *collect_response_matches(const char *body, const LineIndex *lines_idx, const Matcher *m,
+                                     const ScanTicket *ticket, int *cancelled, int *out_count) {
     *out_count = 0;
-    if (!body || !query || !*query) return NULL;
+    if (cancelled) *cancelled = 0;
+    if (!body) return NULL;
 
     int cap = 16;
     int count = 0;
@@ -106,10 +207,24 @@ static int *collect_response_matches(const char *body, const char *query, int *o
     int line_no = 0;
     const char *p = body;
     while (1) {
-        const char *nl = strchr(p, '\n');
-        size_t len = nl ? (size_t)(nl - p) : strlen(p);
+        const char *nl = NULL;
+        size_t len = 0;
+        if (lines_idx) {
+            p = line_index_line(lines_idx, body, line_no, &len);
+            if (!p) break;
+        } else {
+            nl = strchr(p, '\n');
+            len = nl ? (size_t)(nl - p) : strlen(p);
+        }
+
+        if (ticket && line_no % SEARCH_SCAN_CHECK_LINES == 0 &&
+            __atomic_load_n(ticket->current, __ATOMIC_RELAXED) != ticket->id) {
+            free(lines);
+            *cancelled = 1;
+            return NULL;
+        }
 
-        if (contains_ci_n(p, len, query)) {
+        if (matcher_test(m, p, len)) {
             if (count == cap) {
                 int new_cap = cap * 2;
                 int *n = realloc(lines, (size_t)new_cap * sizeof(*n));
@@ -123,9 +238,10 @@ static int *collect_response_matches(const char *body, const char *query, int *o
             lines[count++] = line_no;
         }
 
+        line_no++;
+        if (lines_idx) continue;
         if (!nl) break;
         p = nl + 1;
-        line_no++;
     }
 
     if (count == 0) {
@@ -137,125 +253,357 @@ static int *collect_response_matches(const char *body, const char *query, int *o
     return lines;
 }
 
-/**
- * Pick next/previous match with wrapping.
- * 
- * @param matches Array of match indices
- * @param count Number of matches
- * @param current Current index
- * @param dir Direction: positive for next, negative for previous
- * @return Next match index, or -1 if no matches
- */
-static int pick_match_with_wrap(const int *matches, int count, int current, int dir) {
-    if (!matches || count <= 0) return -1;
+/* Content `target` is searched in, and its version (0 when it has none) */
+static const void *target_source(const AppState *s, SearchTarget target, unsigned long *generation) {
+    if (target == SEARCH_TARGET_HISTORY) {
+        *generation = s->history.history ? s->history.history->generation : 0;
+        return s->history.history;
+    }
+    *generation = s->response.response.view_gen;
+    return &s->response.response;
+}
 
-    if (current < 0) return dir >= 0 ? matches[0] : matches[count - 1];
+/* 1 if `m` holds the matches of `query` in the current content of `target` */
+static int matches_fresh(const AppState *s, const SearchMatches *m, SearchTarget target, const char *query) {
+    unsigned long generation;
+    const void *source = target_source(s, target, &generation);
+    return m->valid && m->target == target && m->source == source && generation != 0 &&
+           m->generation == generation && strcmp(m->query, query) == 0;
+}
 
-    if (dir >= 0) {
-        for (int i = 0; i < count; i++) {
-            if (matches[i] > current) return matches[i];
-        }
-        return matches[0];
-    }
+static void store_matches(SearchMatches *m, int *items, int count, SearchTarget target,
+                          const void *source, unsigned long generation, const char *query) {
+    free(m->items);
+    m->items = items;
+    m->count = count;
+    m->valid = 1;
+    m->target = target;
+    m->source = source;
+    m->generation = generation;
+    snprintf(m->query, sizeof(m->query), "%s", query);
+}
 
-    for (int i = count - 1; i >= 0; i--) {
-        if (matches[i] < current) return matches[i];
-    }
-    return matches[count - 1];
+static void regex_release(SearchRegex *r) {
+    if (!r) return;
+    if (__atomic_sub_fetch(&r->refs, 1, __ATOMIC_ACQ_REL) != 0) return;
+    regfree(&r->re);
+    free(r);
 }
 
 /**
- * Apply search to history.
+ * Compiled form of `pattern`, compiling it only when it differs from the
+ * last pattern that compiled. Patterns are POSIX extended expressions and
+ * ignore case, like plain queries.
+ *
+ * @return The pattern (owned by the search state), or NULL with
+ *         `regex_error` set
  */
-static void apply_history_search(AppState *s, const char *query) {
-    int mcount = 0;
-    int *matches = collect_history_matches(s, query, &mcount);
-    if (!matches) {
+static SearchRegex *regex_for(AppState *s, const char *pattern) {
+    SearchRegex *cached = s->search.regex;
+    if (cached && strcmp(cached->pattern, pattern) == 0) {
+        s->search.regex_error[0] = '\0';
+        return cached;
+    }
+
+    SearchRegex *r = calloc(1, sizeof(*r));
+    if (!r) {
+        snprintf(s->search.regex_error, sizeof(s->search.regex_error), "out of memory");
+        return NULL;
+    }
+    int rc = regcomp(&r->re, pattern, REG_EXTENDED | REG_ICASE | REG_NOSUB);
+    if (rc != 0) {
+        regerror(rc, &r->re, s->search.regex_error, sizeof(s->search.regex_error));
+        free(r);
+        return NULL;
+    }
+    r->refs = 1;
+    strncpy(r->pattern, pattern, sizeof(r->pattern) - 1);
+
+    regex_release(cached);
+    s->search.regex = r;
+    s->search.regex_error[0] = '\0';
+    return r;
+}
+
+/* Move the selection of `target` to `line`, or record that nothing matched. */
+static void show_match(AppState *s, SearchTarget target, int line) {
+    if (line < 0) {
         s->search.not_found = 1;
         s->search.match_index = -1;
         return;
     }
 
-    s->history.selected = matches[0];
-    s->search.match_index = matches[0];
+    if (target == SEARCH_TARGET_HISTORY) s->history.selected = line;
+    else s->response.scroll = line;
+    s->search.match_index = line;
     s->search.not_found = 0;
-    free(matches);
+}
+
+/* Background scans */
+
+static void scan_text_release(ScanText *t) {
+    if (!t) return;
+    if (__atomic_sub_fetch(&t->refs, 1, __ATOMIC_ACQ_REL) != 0) return;
+    mapped_body_release(t->map);
+    line_index_release(t->lines);
+    free(t);
+}
+
+static void job_free(ScanJob *job) {
+    if (!job) return;
+    regex_release(job->regex);
+    scan_text_release(job->text);
+    free(job);
+}
+
+/* Hand the lines found by `job` to the UI, unless a newer scan was started
+   or the response changed meanwhile. */
+static void publish_scan(AppState *s, const ScanJob *job, int *lines, int count) {
+    app_state_lock(s);
+    unsigned long generation;
+    const void *source = target_source(s, SEARCH_TARGET_RESPONSE, &generation);
+    if (s->search.scan_id != job->id) {
+        app_state_unlock(s);
+        free(lines);
+        return;
+    }
+
+    s->search.scanning = 0;
+    int jump = s->search.scan_jump;
+    s->search.scan_jump = 0;
+    if (source == job->text->source && generation == job->text->generation) {
+        store_matches(&s->search.matches, lines, count, SEARCH_TARGET_RESPONSE, source, generation, job->query);
+        if (jump && strcmp(s->search.query, job->query) == 0) {
+            show_match(s, SEARCH_TARGET_RESPONSE, count > 0 ? lines[0] : -1);
+        }
+    } else {
+        free(lines);
+    }
+    app_state_mark_dirty(s, UI_DIRTY_FOOTER | UI_DIRTY_RESPONSE);
+    app_state_unlock(s);
+}
+
+static void run_job(SearchWorker *w, ScanJob *job) {
+    Matcher m = { NULL, &job->regex->re };
+    ScanTicket ticket = { &w->state->search.scan_id, job->id };
+    int cancelled = 0;
+    int count = 0;
+    int *lines = collect_response_matches(job->text->map->data, job->text->lines, &m, &ticket, &cancelled, &count);
+    if (!cancelled) publish_scan(w->state, job, lines, count);
+}
+
+static void *worker_main(void *arg) {
+    SearchWorker *w = arg;
+
+    pthread_mutex_lock(&w->mu);
+    while (!w->stopping) {
+        if (!w->next) {
+            pthread_cond_wait(&w->cv, &w->mu);
+            continue;
+        }
+        ScanJob *job = w->next;
+        w->next = NULL;
+        pthread_mutex_unlock(&w->mu);
+
+        run_job(w, job);
+        job_free(job);
+
+        pthread_mutex_lock(&w->mu);
+    }
+    pthread_mutex_unlock(&w->mu);
+    return NULL;
+}
+
+static SearchWorker *worker_get(AppState *s) {
+    if (s->search.worker) return s->search.worker;
+
+    SearchWorker *w = calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    w->state = s;
+    pthread_mutex_init(&w->mu, NULL);
+    pthread_cond_init(&w->cv, NULL);
+    if (pthread_create(&w->thread, NULL, worker_main, w) != 0) {
+        pthread_cond_destroy(&w->cv);
+        pthread_mutex_destroy(&w->mu);
+        free(w);
+        return NULL;
+    }
+    s->search.worker = w;
+    return w;
+}
+
+/* The response view as a ScanText, shared with earlier scans of it */
+static ScanText *scan_text_for(SearchWorker *w, const HttpResponse *r) {
+    ScanText *t = w->text;
+    if (t && t->source == r && t->generation == r->view_gen) {
+        __atomic_add_fetch(&t->refs, 1, __ATOMIC_RELAXED);
+        return t;
+    }
+
+    if (!r->view_map) return NULL;
+    t = calloc(1, sizeof(*t));
+    if (!t) return NULL;
+    t->map = mapped_body_ref(r->view_map);
+    t->lines = line_index_ref(r->view_lines);
+    t->refs = 2; /* The job's and ours */
+    t->source = r;
+    t->generation = r->view_gen;
+
+    scan_text_release(w->text);
+    w->text = t;
+    return t;
 }
 
 /**
- * Apply search to response body.
+ * Match `regex` against the response view on the worker thread, replacing
+ * any scan waiting or running.
+ *
+ * @return 0 if the scan was queued, 1 if it must run inline
  */
-static void apply_response_search(AppState *s, const char *query) {
-    int mcount = 0;
-    int *matches = collect_response_matches(s->response.response.body_view, query, &mcount);
-    if (!matches) {
-        s->search.not_found = 1;
-        s->search.match_index = -1;
-        return;
+static int start_scan(AppState *s, SearchRegex *regex, const char *query, int jump) {
+    SearchWorker *w = worker_get(s);
+    if (!w) return 1;
+
+    ScanJob *job = calloc(1, sizeof(*job));
+    if (!job) return 1;
+    job->text = scan_text_for(w, &s->response.response);
+    if (!job->text) {
+        free(job);
+        return 1;
     }
+    __atomic_add_fetch(&regex->refs, 1, __ATOMIC_RELAXED);
+    job->regex = regex;
+    strncpy(job->query, query, sizeof(job->query) - 1);
+    strncpy(w->query, query, sizeof(w->query) - 1);
+
+    job->id = __atomic_add_fetch(&s->search.scan_id, 1, __ATOMIC_RELAXED);
+    s->search.scanning = 1;
+    s->search.scan_jump = jump;
+
+    pthread_mutex_lock(&w->mu);
+    job_free(w->next);
+    w->next = job;
+    pthread_cond_signal(&w->cv);
+    pthread_mutex_unlock(&w->mu);
+    return 0;
+}
 
-    s->response.scroll = matches[0];
-    s->search.match_index = matches[0];
-    s->search.not_found = 0;
-    free(matches);
+/* 1 if the running scan is for `query` in the current response view */
+static int scan_running_for(const AppState *s, const char *query) {
+    const SearchWorker *w = s->search.worker;
+    const ScanText *t = w ? w->text : NULL;
+    return s->search.scanning && t && t->source == &s->response.response &&
+           t->generation == s->response.response.view_gen && strcmp(w->query, query) == 0;
+}
+
+static void cancel_scan(AppState *s) {
+    if (!s->search.scanning) return;
+    __atomic_add_fetch(&s->search.scan_id, 1, __ATOMIC_RELAXED);
+    s->search.scanning = 0;
+    s->search.scan_jump = 0;
 }
 
 /**
- * Step to next/previous match in history.
+ * Matches of `query` in `target`, scanning only when the cached set was
+ * built for another query, target or version of the content. Responses
+ * whose view was never indexed have no version and are always scanned.
+ * A pattern over a large response is matched on the worker thread; its
+ * matches replace the cached set when it finishes, showing the first one
+ * if `jump` is set.
+ *
+ * @return The match set (possibly empty), or NULL while a scan runs or
+ *         when the pattern does not compile
  */
-static void step_history_search(AppState *s, int dir) {
-    int mcount = 0;
-    int *matches = collect_history_matches(s, s->search.query, &mcount);
-    if (!matches) {
-        s->search.not_found = 1;
-        s->search.match_index = -1;
-        return;
+static const SearchMatches *current_matches(AppState *s, SearchTarget target, const char *query, int jump) {
+    SearchMatches *m = &s->search.matches;
+    if (matches_fresh(s, m, target, query)) return m;
+
+    Matcher matcher = { query, NULL };
+    SearchRegex *regex = NULL;
+    if (search_is_regex(query)) {
+        regex = regex_for(s, query + REGEX_PREFIX_LEN);
+        if (!regex) {
+            cancel_scan(s);
+            return NULL;
+        }
+        matcher.re = &regex->re;
     }
 
-    int next = pick_match_with_wrap(matches, mcount, s->search.match_index, dir);
-    if (next >= 0) {
-        s->history.selected = next;
-        s->search.match_index = next;
-        s->search.not_found = 0;
-    } else {
-        s->search.not_found = 1;
-        s->search.match_index = -1;
+    if (target == SEARCH_TARGET_RESPONSE && scan_running_for(s, query)) {
+        if (jump) s->search.scan_jump = 1;
+        return NULL;
+    }
+    cancel_scan(s);
+
+    const HttpResponse *r = &s->response.response;
+    if (target == SEARCH_TARGET_RESPONSE && regex && r->view_map && r->view_map->data == r->body_view &&
+        r->view_map->len >= SEARCH_ASYNC_MIN_BYTES && start_scan(s, regex, query, jump) == 0) {
+        return NULL;
+    }
+
+    unsigned long generation;
+    const void *source = target_source(s, target, &generation);
+    int count = 0;
+    int *items = target == SEARCH_TARGET_HISTORY
+        ? collect_history_matches(s->history.history, &matcher, &count)
+        : collect_response_matches(r->body_view, r->view_lines, &matcher, NULL, NULL, &count);
+    store_matches(m, items, count, target, source, generation, query);
+    return m;
+}
+
+/* Index of the first match greater than `value` */
+static int upper_bound(const int *matches, int count, int value) {
+    int lo = 0;
+    int hi = count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (matches[mid] <= value) lo = mid + 1;
+        else hi = mid;
     }
-    free(matches);
+    return lo;
 }
 
 /**
- * Step to next/previous match in response.
+ * Pick next/previous match with wrapping.
+ * 
+ * @param matches Array of match indices, ascending
+ * @param count Number of matches
+ * @param current Current index
+ * @param dir Direction: positive for next, negative for previous
+ * @return Next match index, or -1 if no matches
  */
-static void step_response_search(AppState *s, int dir) {
-    int mcount = 0;
-    int *matches = collect_response_matches(s->response.response.body_view, s->search.query, &mcount);
-    if (!matches) {
-        s->search.not_found = 1;
-        s->search.match_index = -1;
-        return;
-    }
+static int pick_match_with_wrap(const int *matches, int count, int current, int dir) {
+    if (!matches || count <= 0) return -1;
 
-    int next = pick_match_with_wrap(matches, mcount, s->search.match_index, dir);
-    if (next >= 0) {
-        s->response.scroll = next;
-        s->search.match_index = next;
-        s->search.not_found = 0;
-    } else {
-        s->search.not_found = 1;
-        s->search.match_index = -1;
+    if (current < 0) return dir >= 0 ? matches[0] : matches[count - 1];
+
+    if (dir >= 0) {
+        int i = upper_bound(matches, count, current);
+        return i < count ? matches[i] : matches[0];
     }
-    free(matches);
+
+    /* Last match below `current`: the one before the first that is >= it */
+    int i = upper_bound(matches, count, current - 1);
+    return i > 0 ? matches[i - 1] : matches[count - 1];
 }
 
 // Public API implementation
 
+int search_is_regex(const char *query) {
+    return query && strncmp(query, REGEX_PREFIX, REGEX_PREFIX_LEN) == 0;
+}
+
 SearchTarget search_get_effective_target(const AppState *s) {
     if (s->search.target_override == SEARCH_TARGET_HISTORY) return SEARCH_TARGET_HISTORY;
     if (s->search.target_override == SEARCH_TARGET_RESPONSE) return SEARCH_TARGET_RESPONSE;
     return (s->ui.focused_panel == PANEL_HISTORY) ? SEARCH_TARGET_HISTORY : SEARCH_TARGET_RESPONSE;
 }
 
+/* Queries with nothing to match: empty, or a bare "re:" */
+static int query_empty(const char *query) {
+    return query[0] == '\0' || (search_is_regex(query) && query[REGEX_PREFIX_LEN] == '\0');
+}
+
 void search_apply(AppState *s, const char *query) {
     if (!s) return;
 
@@ -264,21 +612,91 @@ void search_apply(AppState *s, const char *query) {
     s->search.query[sizeof(s->search.query) - 1] = '\0';
     s->search.match_index = -1;
     s->search.not_found = 0;
+    s->search.regex_error[0] = '\0';
+
+    if (query_empty(s->search.query)) {
+        cancel_scan(s);
+        return;
+    }
+
+    const SearchMatches *m = current_matches(s, s->search.target, s->search.query, 1);
+    if (m) show_match(s, s->search.target, m->count > 0 ? m->items[0] : -1);
+}
 
-    if (s->search.query[0] == '\0') return;
+void search_preview(AppState *s, const char *query) {
+    if (!s || !query) return;
 
-    if (s->search.target == SEARCH_TARGET_HISTORY) {
-        apply_history_search(s, s->search.query);
+    if (query_empty(query) || !search_is_regex(query) || s->search.target != SEARCH_TARGET_RESPONSE) {
+        cancel_scan(s);
         return;
     }
-    apply_response_search(s, s->search.query);
+    (void)current_matches(s, s->search.target, query, 0);
 }
 
 void search_step(AppState *s, int dir) {
-    if (!s || s->search.query[0] == '\0') return;
-    if (s->search.target == SEARCH_TARGET_HISTORY) {
-        step_history_search(s, dir);
-    } else {
-        step_response_search(s, dir);
+    if (!s || query_empty(s->search.query)) return;
+
+    /* A scan that has to run first shows its first match */
+    const SearchMatches *m = current_matches(s, s->search.target, s->search.query, 1);
+    if (!m) return;
+    show_match(s, s->search.target, pick_match_with_wrap(m->items, m->count, s->search.match_index, dir));
+}
+
+void search_cancel(AppState *s) {
+    if (!s) return;
+    cancel_scan(s);
+}
+
+SearchStatus search_status(const AppState *s, const char *query, int *position, int *total) {
+    if (position) *position = 0;
+    if (total) *total = 0;
+    if (!s || !query || query_empty(query)) return SEARCH_IDLE;
+
+    if (search_is_regex(query)) {
+        const SearchRegex *r = s->search.regex;
+        if (!r || strcmp(r->pattern, query + REGEX_PREFIX_LEN) != 0) {
+            return s->search.regex_error[0] ? SEARCH_BAD_PATTERN : SEARCH_IDLE;
+        }
     }
+    if (s->search.target == SEARCH_TARGET_RESPONSE && scan_running_for(s, query)) return SEARCH_BUSY;
+
+    const SearchMatches *m = &s->search.matches;
+    if (!matches_fresh(s, m, s->search.target, query)) return SEARCH_IDLE;
+
+    if (total) *total = m->count;
+    if (position && s->search.match_index >= 0 && strcmp(query, s->search.query) == 0) {
+        int i = upper_bound(m->items, m->count, s->search.match_index - 1);
+        if (i < m->count && m->items[i] == s->search.match_index) *position = i + 1;
+    }
+    return SEARCH_READY;
+}
+
+void search_state_free(AppState *s) {
+    if (!s) return;
+
+    SearchWorker *w = s->search.worker;
+    if (w) {
+        __atomic_add_fetch(&s->search.scan_id, 1, __ATOMIC_RELAXED);
+        pthread_mutex_lock(&w->mu);
+        w->stopping = 1;
+        pthread_cond_signal(&w->cv);
+        pthread_mutex_unlock(&w->mu);
+        (void)pthread_join(w->thread, NULL);
+
+        job_free(w->next);
+        scan_text_release(w->text);
+        pthread_cond_destroy(&w->cv);
+        pthread_mutex_destroy(&w->mu);
+        free(w);
+        s->search.worker = NULL;
+    }
+    s->search.scanning = 0;
+    s->search.scan_jump = 0;
+
+    regex_release(s->search.regex);
+    s->search.regex = NULL;
+    s->search.regex_error[0] = '\0';
+
+    free(s->search.matches.items);
+    memset(&s->search.matches, 0, sizeof(s->search.matches));
 }
@@ -0,0 +1,230 @@
+/*
+ * body_store.c - Shared, reference-counted history bodies
+ *
+ * Each body is one allocation: a header followed by the NUL-terminated
+ * text, so the `char *` handed out leads back to its header without a
+ * lookup. Bodies are chained in buckets by hash; the table doubles when it
+ * holds more bodies than buckets.
+ */
+
+#include "core/storage/body_store.h"
+#include "core/utils/sha256.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct StoredBody {
+    StoredBody *next;
+    BodyHash hash;
+    size_t len;
+    int refs;
+    int pins;           /* Of `refs`, those that outlive body_store_free() */
+    int detached;       /* Left the table in body_store_free(); only pins remain */
+    char data[];
+};
+
+#define BODY_STORE_MIN_BUCKETS 64
+
+void body_hash(const char *data, size_t len, BodyHash *out) {
+    sha256(data, len, out->bytes);
+}
+
+int body_hash_equal(const BodyHash *a, const BodyHash *b) {
+    return memcmp(a->bytes, b->bytes, sizeof(a->bytes)) == 0;
+}
+
+void body_hash_hex(const BodyHash *hash, char *out) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < sizeof(hash->bytes); i++) {
+        out[2 * i] = digits[hash->bytes[i] >> 4];
+        out[2 * i + 1] = digits[hash->bytes[i] & 0xf];
+    }
+    out[BODY_HASH_HEX_LEN] = '\0';
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+int body_hash_parse(const char *hex, BodyHash *out) {
+    if (!hex || !out) return 1;
+
+    BodyHash h;
+    for (size_t i = 0; i < sizeof(h.bytes); i++) {
+        int hi = hex_value(hex[2 * i]);
+        int lo = hi < 0 ? -1 : hex_value(hex[2 * i + 1]);
+        if (lo < 0) return 1;
+        h.bytes[i] = (uint8_t)(hi << 4 | lo);
+    }
+    if (hex[BODY_HASH_HEX_LEN] != '\0') return 1;
+
+    *out = h;
+    return 0;
+}
+
+static StoredBody *body_of(char *data) {
+    return (StoredBody *)(data - offsetof(StoredBody, data));
+}
+
+/* Any bits of a SHA-256 are as good as any other */
+static size_t bucket_bits(const BodyHash *hash) {
+    size_t v;
+    memcpy(&v, hash->bytes, sizeof(v));
+    return v;
+}
+
+static size_t bucket_of(const BodyStore *bs, const BodyHash *hash) {
+    return bucket_bits(hash) & (bs->nbuckets - 1);
+}
+
+void body_store_init(BodyStore *bs) {
+    if (!bs) return;
+    bs->buckets = NULL;
+    bs->nbuckets = 0;
+    bs->count = 0;
+}
+
+void body_store_free(BodyStore *bs) {
+    if (!bs) return;
+
+    for (size_t i = 0; i < bs->nbuckets; i++) {
+        StoredBody *b = bs->buckets[i];
+        while (b) {
+            StoredBody *next = b->next;
+            if (b->pins > 0) {
+                b->detached = 1;
+                b->refs = b->pins;
+                b->next = NULL;
+            } else {
+                free(b);
+            }
+            b = next;
+        }
+    }
+    free(bs->buckets);
+    body_store_init(bs);
+}
+
+static int grow(BodyStore *bs) {
+    size_t n = bs->nbuckets ? bs->nbuckets * 2 : BODY_STORE_MIN_BUCKETS;
+    StoredBody **buckets = calloc(n, sizeof(*buckets));
+    if (!buckets) return 1;
+
+    for (size_t i = 0; i < bs->nbuckets; i++) {
+        StoredBody *b = bs->buckets[i];
+        while (b) {
+            StoredBody *next = b->next;
+            size_t k = bucket_bits(&b->hash) & (n - 1);
+            b->next = buckets[k];
+            buckets[k] = b;
+            b = next;
+        }
+    }
+    free(bs->buckets);
+    bs->buckets = buckets;
+    bs->nbuckets = n;
+    return 0;
+}
+
+char *body_store_intern(BodyStore *bs, const char *data, size_t len) {
+    if (!bs || !data) return NULL;
+
+    BodyHash hash;
+    body_hash(data, len, &hash);
+    return body_store_intern_hashed(bs, data, len, &hash);
+}
+
+char *body_store_intern_hashed(BodyStore *bs, const char *data, size_t len, const BodyHash *hash) {
+    if (!bs || !data || !hash) return NULL;
+
+    if (bs->nbuckets > 0) {
+        for (StoredBody *b = bs->buckets[bucket_of(bs, hash)]; b; b = b->next) {
+            if (b->len == len && body_hash_equal(&b->hash, hash) &&
+                memcmp(b->data, data, len) == 0) {
+                b->refs++;
+                return b->data;
+            }
+        }
+    }
+
+    if (bs->count >= bs->nbuckets && grow(bs) != 0 && bs->nbuckets == 0) return NULL;
+
+    StoredBody *b = malloc(sizeof(*b) + len + 1);
+    if (!b) return NULL;
+    b->hash = *hash;
+    b->len = len;
+    b->refs = 1;
+    b->pins = 0;
+    b->detached = 0;
+    memcpy(b->data, data, len);
+    b->data[len] = '\0';
+
+    size_t k = bucket_of(bs, hash);
+    b->next = bs->buckets[k];
+    bs->buckets[k] = b;
+    bs->count++;
+    return b->data;
+}
+
+char *body_store_ref(char *body) {
+    if (body) body_of(body)->refs++;
+    return body;
+}
+
+char *body_store_pin(char *body) {
+    if (body) {
+        body_of(body)->refs++;
+        body_of(body)->pins++;
+    }
+    return body;
+}
+
+void body_store_unpin(BodyStore *bs, char *body) {
+    if (!body) return;
+
+    StoredBody *b = body_of(body);
+    b->pins--;
+    if (!b->detached) {
+        body_store_release(bs, body);
+    } else if (--b->refs == 0) {
+        free(b);
+    }
+}
+
+char *body_store_find(BodyStore *bs, const BodyHash *hash) {
+    if (!bs || !hash || bs->nbuckets == 0) return NULL;
+
+    for (StoredBody *b = bs->buckets[bucket_of(bs, hash)]; b; b = b->next) {
+        if (body_hash_equal(&b->hash, hash)) {
+            b->refs++;
+            return b->data;
+        }
+    }
+    return NULL;
+}
+
+void body_store_release(BodyStore *bs, char *body) {
+    if (!bs || !body || bs->nbuckets == 0) return;
+
+    StoredBody *b = body_of(body);
+    if (--b->refs > 0) return;
+
+    StoredBody **link = &bs->buckets[bucket_of(bs, &b->hash)];
+    while (*link && *link != b) link = &(*link)->next;
+    if (*link) *link = b->next;
+    bs->count--;
+    free(b);
+}
+
+int body_store_contains(const BodyStore *bs, const BodyHash *hash) {
+    if (!bs || !hash || bs->nbuckets == 0) return 0;
+
+    for (const StoredBody *b = bs->buckets[bucket_of(bs, hash)]; b; b = b->next) {
+        if (body_hash_equal(&b->hash, hash)) return 1;
+    }
+    return 0;
+}
@@ -8,48 +8,170 @@
  */
 
 #include "core/storage/history.h"
+#include "core/storage/history_index.h"
+#include "core/format/format.h"
+#include "core/utils/mapped_body.h"
 #include "state.h"
 
 #include <stdlib.h>
 #include <string.h>
 
+static unsigned long next_generation;
+
+/* Histories are built on loader threads too, so the counter is shared */
+static void touch(History *h) {
+    h->generation = __atomic_add_fetch(&next_generation, 1, __ATOMIC_RELAXED);
+}
+
 static char *dup_or_empty(const char *s) {
     return s ? strdup(s) : strdup("");
 }
 
-static char *dup_or_null(const char *s) {
-    return s ? strdup(s) : NULL;
+/* Shared copy of a response string, or NULL. */
+static char *share(History *h, const char *s, const BodyHash *digest) {
+    if (!s) return NULL;
+    return digest ? body_store_intern_hashed(&h->bodies, s, strlen(s), digest) : body_store_intern(&h->bodies, s, strlen(s));
 }
 
-static void free_history_item(HistoryItem *it) {
+static void free_history_item(History *h, HistoryItem *it) {
     if (!it) return;
     free(it->url);
     free(it->body);
     free(it->headers);
-    free(it->response_body);
-    free(it->response_body_view);
-    free(it->response_headers);
+    if (it->response_map) mapped_body_release(it->response_map);
+    else body_store_release(&h->bodies, it->response_body);
+    body_store_release(&h->bodies, it->response_headers);
 }
 
 void history_init(History *h) {
     if (!h) return;
 
     h->items = NULL;
+    h->head = 0;
     h->count = 0;
     h->capacity = 0;
+    h->limit = 0;
+    h->backing_path = NULL;
+    body_store_init(&h->bodies);
+    h->nviews = 0;
+    h->fulltext = NULL;
+    h->next_seq = 1;
+    h->first_id = 0;
+    touch(h);
+}
+
+/* Storage slot of logical entry `index` (0 is the oldest). */
+static HistoryItem *slot(const History *h, int index) {
+    int i = h->head + index;
+    if (i >= h->capacity) i -= h->capacity;
+    return &h->items[i];
 }
 
 void history_free(History *h) {
     if (!h) return;
 
     for (int i = 0; i < h->count; i++) {
-        free_history_item(&h->items[i]);
+        free_history_item(h, slot(h, i));
     }
+    for (int i = 0; i < h->nviews; i++) {
+        body_store_release(&h->bodies, h->views[i].body);
+        free(h->views[i].view);
+    }
+    h->nviews = 0;
+    body_store_free(&h->bodies);
 
     free(h->items);
     h->items = NULL;
+    h->head = 0;
     h->count = 0;
     h->capacity = 0;
+    free(h->backing_path);
+    h->backing_path = NULL;
+    history_index_free(h->fulltext);
+    h->fulltext = NULL;
+}
+
+/* Move the entries, oldest first, into a new array of `newcap` slots. */
+static int relayout(History *h, int newcap) {
+    HistoryItem *n = malloc((size_t)newcap * sizeof(*n));
+    if (!n) return 1;
+
+    for (int i = 0; i < h->count; i++) n[i] = *slot(h, i);
+    free(h->items);
+    h->items = n;
+    h->head = 0;
+    h->capacity = newcap;
+    return 0;
+}
+
+/* Room for `extra` more entries; grows geometrically up to the limit. */
+static int reserve(History *h, int extra) {
+    int need = h->count + extra;
+    if (need <= h->capacity) return 0;
+
+    int newcap = h->capacity ? h->capacity * 2 : 8;
+    while (newcap < need) newcap *= 2;
+    if (h->limit > 0 && newcap > h->limit) newcap = h->limit > need ? h->limit : need;
+    return relayout(h, newcap);
+}
+
+void history_note_seq(History *h, unsigned long seq) {
+    if (h && seq >= h->next_seq) h->next_seq = seq + 1;
+}
+
+static void drop_oldest(History *h) {
+    touch(h);
+    HistoryItem *oldest = slot(h, 0);
+    if (h->fulltext && oldest->seq) history_index_prune(h->fulltext, oldest->seq + 1, 0);
+    free_history_item(h, oldest);
+    h->head = h->head + 1 == h->capacity ? 0 : h->head + 1;
+    h->count--;
+    h->first_id++;
+}
+
+/*
+ * Zeroed slot after the newest entry, or NULL when it cannot grow. A full
+ * history drops its oldest entry to make room, without moving the others.
+ */
+static HistoryItem *append_slot(History *h) {
+    while (h->limit > 0 && h->count >= h->limit) drop_oldest(h);
+    if (reserve(h, 1) != 0) return NULL;
+
+    HistoryItem *it = slot(h, h->count);
+    memset(it, 0, sizeof(*it));
+    it->disk_offset = -1;
+    touch(h);
+    return it;
+}
+
+void history_set_limit(History *h, int limit) {
+    if (!h) return;
+
+    h->limit = limit > 0 ? limit : 0;
+    if (h->limit == 0) return;
+
+    while (h->count > limit) drop_oldest(h);
+    /* Best effort: an oversized array still works, it just wastes slots. */
+    if (h->capacity > limit) (void)relayout(h, limit);
+}
+
+void history_set_fulltext(History *h, HistoryIndex *idx) {
+    if (!h) return;
+
+    history_index_free(h->fulltext);
+    h->fulltext = idx;
+    if (idx) history_note_seq(h, history_index_next_seq(idx) - 1);
+}
+
+/* Best effort: an entry the index could not take is still found by URL. */
+static void index_entry(History *h, const HistoryItem *it) {
+    size_t body_len = it->response_map ? it->response_map->len : (it->response_body ? strlen(it->response_body) : 0);
+    (void)history_index_add(h->fulltext, it->seq, it->body, strlen(it->body));
+    (void)history_index_add(h->fulltext, it->seq, it->headers, strlen(it->headers));
+    (void)history_index_add(h->fulltext, it->seq, it->response_body, body_len);
+    if (it->response_headers) {
+        (void)history_index_add(h->fulltext, it->seq, it->response_headers, strlen(it->response_headers));
+    }
 }
 
 void history_push(
@@ -60,57 +182,143 @@ void history_push(
     const TextBuffer *headers,
     const HttpResponse *response
 ) {
-    if (!h) return;
+    (void)history_push_hashed(h, method, url, body, headers, response, NULL, NULL);
+}
 
-    if (h->count == h->capacity) {
-        int newcap = h->capacity ? h->capacity * 2 : 8;
-        HistoryItem *n = realloc(h->items, (size_t)newcap * sizeof(*n));
-        if (!n) return;
-        h->items = n;
-        h->capacity = newcap;
-    }
+int history_push_hashed(
+    History *h,
+    int method,
+    const char *url,
+    const TextBuffer *body,
+    const TextBuffer *headers,
+    const HttpResponse *response,
+    const BodyHash *body_digest,
+    const BodyHash *headers_digest
+) {
+    if (!h) return 1;
 
-    HistoryItem *it = &h->items[h->count];
-    memset(it, 0, sizeof(*it));
+    HistoryItem *it = append_slot(h);
+    if (!it) return 1;
 
+    it->paged_in = 1;
     it->method = method;
     it->url = dup_or_empty(url);
 
-    char *body_str = tb_to_string(body);
-    it->body = dup_or_empty(body_str);
-    free(body_str);
-
-    char *headers_str = tb_to_string(headers);
-    it->headers = dup_or_empty(headers_str);
-    free(headers_str);
+    /* tb_to_string() already hands out a heap copy */
+    it->body = tb_to_string(body);
+    if (!it->body) it->body = strdup("");
+    it->headers = tb_to_string(headers);
+    if (!it->headers) it->headers = strdup("");
 
     if (response) {
         it->status = response->status;
         it->elapsed_ms = response->elapsed_ms;
         it->is_json = response->is_json;
-        it->response_body = dup_or_null(response->body);
-        it->response_body_view = dup_or_null(response->body_view);
-        it->response_headers = dup_or_null(response->response_headers);
+        if (response->body_map) {
+            /* Share the spilled body instead of copying it to the heap */
+            it->response_map = mapped_body_ref(response->body_map);
+            it->response_body = response->body;
+        } else {
+            it->response_body = share(h, response->body, body_digest);
+        }
+        it->response_headers = share(h, response->response_headers, headers_digest);
         it->timing = response->timing;
     }
 
+    if (h->fulltext) {
+        it->seq = h->next_seq++;
+        index_entry(h, it);
+    }
+
+    h->count++;
+    return 0;
+}
+
+int history_push_unloaded(History *h, const HistoryItem *meta) {
+    if (!h || !meta) return 1;
+
+    HistoryItem *it = append_slot(h);
+    if (!it) return 1;
+
+    it->url = dup_or_empty(meta->url);
+    if (!it->url) return 1;
+
+    it->method = meta->method;
+    it->status = meta->status;
+    it->elapsed_ms = meta->elapsed_ms;
+    it->timing = meta->timing;
+    it->is_json = meta->is_json;
+    it->paged_in = 0;
+    it->disk_segment = meta->disk_segment;
+    it->disk_offset = meta->disk_offset;
+    it->seq = meta->seq;
+    history_note_seq(h, meta->seq);
+
     h->count++;
+    return 0;
+}
+
+int history_prepend(History *h, const HistoryItem *items, int n) {
+    if (!h || (!items && n > 0) || n < 0) return 1;
+    if (n == 0) return 0;
+    if (h->limit > 0 && h->count + n > h->limit) return 1;
+    if (reserve(h, n) != 0) return 1;
+
+    h->head -= n;
+    if (h->head < 0) h->head += h->capacity;
+    for (int i = 0; i < n; i++) {
+        *slot(h, i) = items[i];
+        history_note_seq(h, items[i].seq);
+    }
+    h->count += n;
+    h->first_id -= n;
+    touch(h);
+    return 0;
+}
+
+const char *history_item_view(History *h, const HistoryItem *it) {
+    if (!h || !it || !it->response_body) return NULL;
+    /* Spilled bodies are always shown as received */
+    if (!it->is_json || it->response_map) return it->response_body;
+
+    int found = -1;
+    for (int i = 0; i < h->nviews; i++) {
+        if (h->views[i].body == it->response_body) {
+            found = i;
+            break;
+        }
+    }
+
+    HistoryView v;
+    if (found >= 0) {
+        v = h->views[found];
+    } else {
+        v.view = json_pretty_print(it->response_body);
+        if (!v.view) return it->response_body;
+        v.body = body_store_ref(it->response_body);
+
+        if (h->nviews == HISTORY_VIEW_CACHE_ENTRIES) {
+            HistoryView *last = &h->views[--h->nviews];
+            body_store_release(&h->bodies, last->body);
+            free(last->view);
+        }
+        found = h->nviews++;
+    }
+
+    /* Move to the front */
+    memmove(&h->views[1], &h->views[0], (size_t)found * sizeof(h->views[0]));
+    h->views[0] = v;
+    return v.view;
 }
 
 HistoryItem *history_get(History *h, int index) {
     if (!h || index < 0 || index >= h->count) return NULL;
-    return &h->items[index];
+    return slot(h, index);
 }
 
 void history_trim_oldest(History *h, int max_entries) {
     if (!h || max_entries < 0) return;
-    if (h->count <= max_entries) return;
-
-    int drop = h->count - max_entries;
-    for (int i = 0; i < drop; i++) {
-        free_history_item(&h->items[i]);
-    }
 
-    memmove(h->items, h->items + drop, (size_t)(h->count - drop) * sizeof(*h->items));
-    h->count -= drop;
+    while (h->count > max_entries) drop_oldest(h);
+    history_index_prune(h->fulltext, 0, 1);
 }
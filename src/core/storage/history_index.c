@@ -0,0 +1,533 @@
+/*
+ * history_index.c - Trigram index over history entry text
+ *
+ * Posting lists hold entry seqs as LEB128 varints, each the difference to
+ * the previous one (the first is the seq itself), so a list of entries
+ * recorded one after another costs about a byte per entry. Lists live in a
+ * dense array found through an open-addressing table keyed by trigram.
+ *
+ * Pruning only raises `floor`; the bytes of dropped entries are reclaimed
+ * by compact(), which cuts the dead prefix off every list and re-encodes
+ * the first survivor relative to 0.
+ */
+
+#include "core/storage/history_index.h"
+#include "core/config/constants.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+    uint32_t gram;
+    uint32_t count;         /* Postings, pruned ones included until compacted */
+    unsigned long last;     /* Highest seq in the list */
+    unsigned char *data;
+    size_t len;
+    size_t cap;
+} Postings;
+
+typedef struct {
+    unsigned long seq;
+    size_t postings;        /* Lists the entry was added to */
+} IndexedEntry;
+
+struct HistoryIndex {
+    Postings *lists;
+    size_t nlists;
+    size_t lists_cap;
+    uint32_t *table;        /* Index into `lists` plus 1; 0 is an empty bucket */
+    size_t nbuckets;        /* Power of two, at least twice nlists */
+
+    IndexedEntry *entries;  /* Ascending by seq; the live ones start at `head` */
+    size_t head;
+    size_t nentries;
+    size_t entries_cap;
+
+    unsigned long floor;
+    unsigned long next_seq;
+    size_t total_postings;
+    size_t dead_postings;   /* Belong to entries below `floor` */
+};
+
+#define INDEX_MIN_BUCKETS 1024
+#define INDEX_FILE_MAGIC "tcurlFT1"
+
+static unsigned char fold(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c | 0x20) : c;
+}
+
+static uint32_t gram_at(const unsigned char *p) {
+    return ((uint32_t)fold(p[0]) << 16) | ((uint32_t)fold(p[1]) << 8) | fold(p[2]);
+}
+
+static size_t bucket_of(uint32_t gram, size_t nbuckets) {
+    return (size_t)((gram * 2654435761u) ^ (gram >> 13)) & (nbuckets - 1);
+}
+
+static Postings *find_list(const HistoryIndex *idx, uint32_t gram) {
+    if (!idx->table) return NULL;
+    for (size_t b = bucket_of(gram, idx->nbuckets);; b = (b + 1) & (idx->nbuckets - 1)) {
+        uint32_t slot = idx->table[b];
+        if (slot == 0) return NULL;
+        if (idx->lists[slot - 1].gram == gram) return &idx->lists[slot - 1];
+    }
+}
+
+/* Rebuild the table for the current lists with at least `nbuckets` buckets. */
+static int rehash(HistoryIndex *idx, size_t nbuckets) {
+    while (nbuckets < idx->nlists * 2) nbuckets *= 2;
+    uint32_t *table = calloc(nbuckets, sizeof(*table));
+    if (!table) return 1;
+
+    for (size_t i = 0; i < idx->nlists; i++) {
+        size_t b = bucket_of(idx->lists[i].gram, nbuckets);
+        while (table[b]) b = (b + 1) & (nbuckets - 1);
+        table[b] = (uint32_t)(i + 1);
+    }
+    free(idx->table);
+    idx->table = table;
+    idx->nbuckets = nbuckets;
+    return 0;
+}
+
+static Postings *add_list(HistoryIndex *idx, uint32_t gram) {
+    if ((idx->nlists + 1) * 2 > idx->nbuckets) {
+        if (rehash(idx, idx->nbuckets ? idx->nbuckets * 2 : INDEX_MIN_BUCKETS) != 0) return NULL;
+    }
+    if (idx->nlists == idx->lists_cap) {
+        size_t cap = idx->lists_cap ? idx->lists_cap * 2 : 256;
+        Postings *n = realloc(idx->lists, cap * sizeof(*n));
+        if (!n) return NULL;
+        idx->lists = n;
+        idx->lists_cap = cap;
+    }
+
+    Postings *p = &idx->lists[idx->nlists++];
+    memset(p, 0, sizeof(*p));
+    p->gram = gram;
+
+    size_t b = bucket_of(gram, idx->nbuckets);
+    while (idx->table[b]) b = (b + 1) & (idx->nbuckets - 1);
+    idx->table[b] = (uint32_t)idx->nlists;
+    return p;
+}
+
+static size_t varint_put(unsigned char *out, unsigned long v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (unsigned char)v;
+    return n;
+}
+
+/* Decode one varint at `*pos`. @return 0 on success, 1 if it runs past `len` */
+static int varint_get(const unsigned char *data, size_t len, size_t *pos, unsigned long *out) {
+    unsigned long v = 0;
+    int shift = 0;
+    while (*pos < len && shift < 64) {
+        unsigned char c = data[(*pos)++];
+        v |= (unsigned long)(c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            *out = v;
+            return 0;
+        }
+        shift += 7;
+    }
+    return 1;
+}
+
+static int postings_append(Postings *p, unsigned long seq) {
+    if (p->len + 10 > p->cap) {
+        size_t cap = p->cap ? p->cap * 2 : 16;
+        unsigned char *n = realloc(p->data, cap);
+        if (!n) return 1;
+        p->data = n;
+        p->cap = cap;
+    }
+    p->len += varint_put(p->data + p->len, seq - p->last);
+    p->last = seq;
+    p->count++;
+    return 0;
+}
+
+HistoryIndex *history_index_new(void) {
+    HistoryIndex *idx = calloc(1, sizeof(*idx));
+    if (!idx) return NULL;
+    idx->next_seq = 1;
+    return idx;
+}
+
+void history_index_free(HistoryIndex *idx) {
+    if (!idx) return;
+    for (size_t i = 0; i < idx->nlists; i++) free(idx->lists[i].data);
+    free(idx->lists);
+    free(idx->table);
+    free(idx->entries);
+    free(idx);
+}
+
+/* Live entry `seq`, appended if it is new. */
+static IndexedEntry *entry_for(HistoryIndex *idx, unsigned long seq) {
+    if (idx->nentries > idx->head && idx->entries[idx->nentries - 1].seq == seq) {
+        return &idx->entries[idx->nentries - 1];
+    }
+    if (idx->nentries == idx->entries_cap) {
+        size_t cap = idx->entries_cap ? idx->entries_cap * 2 : 64;
+        IndexedEntry *n = realloc(idx->entries, cap * sizeof(*n));
+        if (!n) return NULL;
+        idx->entries = n;
+        idx->entries_cap = cap;
+    }
+    IndexedEntry *e = &idx->entries[idx->nentries++];
+    e->seq = seq;
+    e->postings = 0;
+    if (seq >= idx->next_seq) idx->next_seq = seq + 1;
+    return e;
+}
+
+int history_index_add(HistoryIndex *idx, unsigned long seq, const char *text, size_t len) {
+    if (!idx || seq == 0 || seq < idx->floor) return 1;
+    if (idx->nentries > 0 && seq < idx->entries[idx->nentries - 1].seq) return 1;
+
+    IndexedEntry *e = entry_for(idx, seq);
+    if (!e) return 1;
+    if (!text || len < HISTORY_INDEX_GRAM) return 0;
+    if (len > HISTORY_INDEX_MAX_FIELD_BYTES) len = HISTORY_INDEX_MAX_FIELD_BYTES;
+
+    const unsigned char *p = (const unsigned char *)text;
+    for (size_t i = 0; i + HISTORY_INDEX_GRAM <= len; i++) {
+        uint32_t gram = gram_at(p + i);
+        Postings *list = find_list(idx, gram);
+        if (!list) list = add_list(idx, gram);
+        if (!list) return 1;
+        /* Already listed through an earlier trigram or field of this entry */
+        if (list->count > 0 && list->last == seq) continue;
+
+        if (postings_append(list, seq) != 0) return 1;
+        e->postings++;
+        idx->total_postings++;
+    }
+    return 0;
+}
+
+/*
+ * Cut the prefix below `floor` off `p`; `pos` is the end of the first
+ * surviving posting, whose absolute value is `v`.
+ * @return 0 on success, 1 on allocation failure (the list is unchanged)
+ */
+static int drop_prefix(Postings *p, size_t pos, unsigned long v) {
+    unsigned char head[10];
+    size_t hlen = varint_put(head, v);
+    size_t rest = p->len - pos;
+
+    if (hlen <= pos) {
+        memcpy(p->data + pos - hlen, head, hlen);
+        memmove(p->data, p->data + pos - hlen, hlen + rest);
+    } else {
+        unsigned char *data = malloc(hlen + rest + 10);
+        if (!data) return 1;
+        memcpy(data, head, hlen);
+        memcpy(data + hlen, p->data + pos, rest);
+        free(p->data);
+        p->data = data;
+        p->cap = hlen + rest + 10;
+    }
+    p->len = hlen + rest;
+    return 0;
+}
+
+/* Drop the postings below `floor` from every list, and lists left empty. */
+static void compact(HistoryIndex *idx) {
+    size_t kept = 0;
+    for (size_t i = 0; i < idx->nlists; i++) {
+        Postings *p = &idx->lists[i];
+        size_t pos = 0;
+        unsigned long v = 0;
+        uint32_t dropped = 0;
+        int found = 0;
+        while (pos < p->len) {
+            unsigned long delta;
+            if (varint_get(p->data, p->len, &pos, &delta) != 0) break;
+            v += delta;
+            if (v >= idx->floor) {
+                found = 1;
+                break;
+            }
+            dropped++;
+        }
+
+        if (!found) {
+            free(p->data);
+            continue;
+        }
+        /* Without memory the list keeps its dead prefix; queries skip it */
+        if (dropped > 0 && drop_prefix(p, pos, v) == 0) p->count -= dropped;
+        idx->lists[kept++] = *p;
+    }
+    idx->nlists = kept;
+
+    /* Positions in `lists` moved; the table is big enough to reuse */
+    memset(idx->table, 0, idx->nbuckets * sizeof(*idx->table));
+    for (size_t i = 0; i < idx->nlists; i++) {
+        size_t b = bucket_of(idx->lists[i].gram, idx->nbuckets);
+        while (idx->table[b]) b = (b + 1) & (idx->nbuckets - 1);
+        idx->table[b] = (uint32_t)(i + 1);
+    }
+
+    memmove(idx->entries, idx->entries + idx->head, (idx->nentries - idx->head) * sizeof(*idx->entries));
+    idx->nentries -= idx->head;
+    idx->head = 0;
+    idx->total_postings -= idx->dead_postings;
+    idx->dead_postings = 0;
+}
+
+void history_index_prune(HistoryIndex *idx, unsigned long floor, int compact_now) {
+    if (!idx) return;
+    if (floor > idx->floor) idx->floor = floor;
+
+    while (idx->head < idx->nentries && idx->entries[idx->head].seq < idx->floor) {
+        idx->dead_postings += idx->entries[idx->head].postings;
+        idx->head++;
+    }
+    if (idx->dead_postings > 0 && (compact_now || idx->dead_postings * 2 > idx->total_postings)) {
+        compact(idx);
+    }
+}
+
+static int cmp_list_count(const void *a, const void *b) {
+    uint32_t x = (*(const Postings *const *)a)->count;
+    uint32_t y = (*(const Postings *const *)b)->count;
+    return (x > y) - (x < y);
+}
+
+/* Keep the `*n` seqs of `seqs` that are also in `p`, in place. */
+static void intersect(unsigned long *seqs, size_t *n, const Postings *p) {
+    size_t kept = 0;
+    size_t i = 0;
+    size_t pos = 0;
+    unsigned long v = 0;
+    int have = 0;
+
+    while (i < *n) {
+        if (!have || v < seqs[i]) {
+            unsigned long delta;
+            if (varint_get(p->data, p->len, &pos, &delta) != 0) break;
+            v += delta;
+            have = 1;
+            continue;
+        }
+        if (v == seqs[i]) seqs[kept++] = seqs[i];
+        i++;
+    }
+    *n = kept;
+}
+
+int history_index_query(const HistoryIndex *idx, const char *query, size_t len, unsigned long **seqs_out, size_t *count_out) {
+    if (!seqs_out || !count_out) return 1;
+    *seqs_out = NULL;
+    *count_out = 0;
+    if (!idx || !query || len < HISTORY_INDEX_GRAM) return 0;
+
+    size_t ngrams = len - HISTORY_INDEX_GRAM + 1;
+    const Postings **lists = malloc(ngrams * sizeof(*lists));
+    if (!lists) return 1;
+
+    /* Every trigram of the query must be listed; repeats add nothing */
+    size_t nlists = 0;
+    for (size_t i = 0; i < ngrams; i++) {
+        const Postings *p = find_list(idx, gram_at((const unsigned char *)query + i));
+        if (!p) {
+            free(lists);
+            return 0;
+        }
+        int seen = 0;
+        for (size_t j = 0; j < nlists && !seen; j++) seen = lists[j] == p;
+        if (!seen) lists[nlists++] = p;
+    }
+    qsort(lists, nlists, sizeof(*lists), cmp_list_count);
+
+    unsigned long *seqs = malloc((size_t)(lists[0]->count ? lists[0]->count : 1) * sizeof(*seqs));
+    if (!seqs) {
+        free(lists);
+        return 1;
+    }
+
+    /* Start from the shortest list and narrow it down with the others */
+    size_t n = 0;
+    size_t pos = 0;
+    unsigned long v = 0;
+    while (pos < lists[0]->len) {
+        unsigned long delta;
+        if (varint_get(lists[0]->data, lists[0]->len, &pos, &delta) != 0) break;
+        v += delta;
+        if (v >= idx->floor) seqs[n++] = v;
+    }
+    for (size_t i = 1; i < nlists && n > 0; i++) intersect(seqs, &n, lists[i]);
+    free(lists);
+
+    if (n == 0) {
+        free(seqs);
+        return 0;
+    }
+    *seqs_out = seqs;
+    *count_out = n;
+    return 0;
+}
+
+int history_index_contains(const HistoryIndex *idx, unsigned long seq) {
+    if (!idx) return 0;
+
+    size_t lo = idx->head;
+    size_t hi = idx->nentries;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (idx->entries[mid].seq < seq) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < idx->nentries && idx->entries[lo].seq == seq;
+}
+
+unsigned long history_index_next_seq(const HistoryIndex *idx) {
+    return idx ? idx->next_seq : 1;
+}
+
+size_t history_index_count(const HistoryIndex *idx) {
+    return idx ? idx->nentries - idx->head : 0;
+}
+
+/*
+ * File layout, in native byte order (the file is a cache: one that does
+ * not load is rebuilt from new entries):
+ *   magic[8] next_seq floor nentries nlists           (uint64)
+ *   nentries x { seq postings }                       (uint64)
+ *   nlists x { gram count (uint32) last len (uint64) data[len] }
+ * Only live entries and lists are written.
+ */
+
+static int put_u64(FILE *f, uint64_t v) {
+    return fwrite(&v, sizeof(v), 1, f) == 1 ? 0 : 1;
+}
+
+static int put_u32(FILE *f, uint32_t v) {
+    return fwrite(&v, sizeof(v), 1, f) == 1 ? 0 : 1;
+}
+
+static int get_u64(FILE *f, uint64_t *v) {
+    return fread(v, sizeof(*v), 1, f) == 1 ? 0 : 1;
+}
+
+static int get_u32(FILE *f, uint32_t *v) {
+    return fread(v, sizeof(*v), 1, f) == 1 ? 0 : 1;
+}
+
+static int write_index(const HistoryIndex *idx, FILE *f) {
+    size_t live = idx->nentries - idx->head;
+    if (fwrite(INDEX_FILE_MAGIC, 8, 1, f) != 1 ||
+        put_u64(f, idx->next_seq) != 0 ||
+        put_u64(f, idx->floor) != 0 ||
+        put_u64(f, live) != 0 ||
+        put_u64(f, idx->nlists) != 0) {
+        return 1;
+    }
+    for (size_t i = idx->head; i < idx->nentries; i++) {
+        if (put_u64(f, idx->entries[i].seq) != 0 || put_u64(f, idx->entries[i].postings) != 0) return 1;
+    }
+    for (size_t i = 0; i < idx->nlists; i++) {
+        const Postings *p = &idx->lists[i];
+        if (put_u32(f, p->gram) != 0 || put_u32(f, p->count) != 0 ||
+            put_u64(f, p->last) != 0 || put_u64(f, p->len) != 0 ||
+            (p->len > 0 && fwrite(p->data, p->len, 1, f) != 1)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int history_index_save(HistoryIndex *idx, const char *path) {
+    if (!idx || !path) return 1;
+    if (idx->dead_postings > 0) compact(idx);
+
+    size_t tlen = strlen(path) + 5;
+    char *tmp_path = malloc(tlen);
+    if (!tmp_path) return 1;
+    snprintf(tmp_path, tlen, "%s.tmp", path);
+
+    FILE *f = fopen(tmp_path, "wb");
+    int rc = f ? write_index(idx, f) : 1;
+    if (f) {
+        if (fflush(f) != 0 || fsync(fileno(f)) != 0) rc = 1;
+        if (fclose(f) != 0) rc = 1;
+    }
+    if (rc == 0 && rename(tmp_path, path) != 0) rc = 1;
+    if (rc != 0) unlink(tmp_path);
+    free(tmp_path);
+    return rc;
+}
+
+static int read_index(HistoryIndex *idx, FILE *f) {
+    char magic[8];
+    uint64_t next_seq, floor, nentries, nlists;
+    if (fread(magic, sizeof(magic), 1, f) != 1 || memcmp(magic, INDEX_FILE_MAGIC, 8) != 0) return 1;
+    if (get_u64(f, &next_seq) != 0 || get_u64(f, &floor) != 0 ||
+        get_u64(f, &nentries) != 0 || get_u64(f, &nlists) != 0) {
+        return 1;
+    }
+    if (nentries > SIZE_MAX / sizeof(IndexedEntry) || nlists > UINT32_MAX - 1) return 1;
+
+    idx->next_seq = next_seq ? (unsigned long)next_seq : 1;
+    idx->floor = (unsigned long)floor;
+
+    if (nentries > 0) {
+        idx->entries = malloc((size_t)nentries * sizeof(*idx->entries));
+        if (!idx->entries) return 1;
+        idx->entries_cap = (size_t)nentries;
+    }
+    for (uint64_t i = 0; i < nentries; i++) {
+        uint64_t seq, postings;
+        if (get_u64(f, &seq) != 0 || get_u64(f, &postings) != 0) return 1;
+        if (seq < floor || seq >= next_seq || (i > 0 && seq <= idx->entries[i - 1].seq)) return 1;
+        idx->entries[i].seq = (unsigned long)seq;
+        idx->entries[i].postings = (size_t)postings;
+        idx->nentries++;
+        idx->total_postings += (size_t)postings;
+    }
+
+    for (uint64_t i = 0; i < nlists; i++) {
+        uint32_t gram, count;
+        uint64_t last, len;
+        if (get_u32(f, &gram) != 0 || get_u32(f, &count) != 0 ||
+            get_u64(f, &last) != 0 || get_u64(f, &len) != 0) {
+            return 1;
+        }
+        if (len == 0 || len > (uint64_t)count * 10 || last >= next_seq || find_list(idx, gram)) return 1;
+
+        Postings *p = add_list(idx, gram);
+        if (!p) return 1;
+        p->data = malloc((size_t)len);
+        if (!p->data) return 1;
+        if (fread(p->data, (size_t)len, 1, f) != 1) return 1;
+        p->len = p->cap = (size_t)len;
+        p->count = count;
+        p->last = (unsigned long)last;
+    }
+    return fgetc(f) == EOF ? 0 : 1;
+}
+
+HistoryIndex *history_index_load(const char *path) {
+    if (!path) return NULL;
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    HistoryIndex *idx = history_index_new();
+    if (idx && read_index(idx, f) != 0) {
+        history_index_free(idx);
+        idx = NULL;
+    }
+    fclose(f);
+    return idx;
+}
@@ -0,0 +1,216 @@
+/*
+ * history_loader.c - Background history load
+ *
+ * The worker walks the history log backwards (history_storage_scan_log)
+ * and collects index entries into a private batch. Each full batch is
+ * prepended to the shared history under the state lock. Batches grow with
+ * the size of the history, which keeps the total cost of the prepends linear
+ * while the first screenful still arrives almost at once. The full-text
+ * index, when on, is read by the same worker and installed the same way.
+ */
+
+
+#include "core/storage/history_loader.h"
+#include "core/storage/history.h"
+#include "core/storage/history_persistence.h"
+#include "core/storage/history_index.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define HISTORY_LOAD_FIRST_BATCH 64
+
+struct HistoryLoader {
+    AppState *state;
+    pthread_t thread;
+    char *path;
+    int last_segment;       /* Newest segment and its size when the load started */
+    off_t end;
+    int fulltext;           /* Full-text index still to be read and installed */
+
+    /* Worker-only from here on */
+    History batch;          /* Newest first, not yet published */
+    int batch_target;
+    int skipped;            /* Invalid lines not yet published */
+    int done;               /* Cancelled or max_entries reached */
+};
+
+static void batch_clear(HistoryLoader *l) {
+    history_free(&l->batch);
+    history_init(&l->batch);
+    l->skipped = 0;
+}
+
+/* Hand the pending batch to the UI; sets `done` when no more is wanted. */
+static void publish_batch(HistoryLoader *l) {
+    AppState *s = l->state;
+    History *pending = &l->batch;
+
+    app_state_lock(s);
+    History *h = s->history.history;
+    if (!s->history.loading || !h) {
+        l->done = 1;
+        app_state_unlock(s);
+        batch_clear(l);
+        return;
+    }
+
+    int room = s->history.max_entries - h->count;
+    int take = pending->count < room ? pending->count : room;
+    if (take < 0) take = 0;
+
+    /* The batch runs newest to oldest; the history wants the reverse. */
+    HistoryItem *ordered = take > 0 ? malloc((size_t)take * sizeof(*ordered)) : NULL;
+    if (ordered) {
+        for (int i = 0; i < take; i++) ordered[i] = *history_get(pending, take - 1 - i);
+        if (history_prepend(h, ordered, take) == 0) {
+            /* Ownership moved: drop the batch's copies without freeing them. */
+            for (int i = 0; i < take; i++) memset(history_get(pending, i), 0, sizeof(HistoryItem));
+            if (h->count > take) s->history.selected += take;
+            s->history.loaded_ok += take;
+        } else {
+            take = 0;
+        }
+        free(ordered);
+    } else {
+        take = 0;
+    }
+
+    s->history.skipped_invalid += l->skipped;
+    if (h->count >= s->history.max_entries) l->done = 1;
+    if (l->batch_target < h->count) l->batch_target = h->count;
+    app_state_mark_dirty(s, UI_DIRTY_HISTORY | UI_DIRTY_FOOTER);
+    app_state_unlock(s);
+
+    batch_clear(l);
+}
+
+/*
+ * Read the full-text index and install it unless the load was cancelled
+ * meanwhile. The index is saved only at exit, so after a crash the log can
+ * hold seqs it never saw: new entries start after `last_seq`, the highest
+ * one in the log. Seqs grow along the log, so that is the first the
+ * backward walk meets.
+ */
+static void publish_fulltext(HistoryLoader *l, unsigned long last_seq) {
+    AppState *s = l->state;
+    HistoryIndex *idx = history_storage_read_fulltext(l->path);
+    l->fulltext = 0;
+
+    app_state_lock(s);
+    if (idx && s->history.loading && s->history.history && !s->history.history->fulltext) {
+        history_note_seq(s->history.history, last_seq);
+        history_set_fulltext(s->history.history, idx);
+        idx = NULL;
+    }
+    app_state_unlock(s);
+    history_index_free(idx);
+}
+
+static int on_entry(const HistoryItem *meta, void *userdata) {
+    HistoryLoader *l = userdata;
+
+    if (l->fulltext && meta && meta->seq) publish_fulltext(l, meta->seq);
+    if (!meta) {
+        l->skipped++;
+    } else if (history_push_unloaded(&l->batch, meta) != 0) {
+        return 1;
+    }
+
+    if (l->batch.count + l->skipped >= l->batch_target) publish_batch(l);
+    return l->done;
+}
+
+static void *loader_main(void *arg) {
+    HistoryLoader *l = arg;
+
+    (void)history_storage_scan_log(l->path, l->last_segment, l->end, on_entry, l);
+    if (!l->done) publish_batch(l);
+    if (l->fulltext) publish_fulltext(l, 0);
+    batch_clear(l);
+
+    app_state_lock(l->state);
+    l->state->history.loading = 0;
+    app_state_mark_dirty(l->state, UI_DIRTY_FOOTER);
+    app_state_unlock(l->state);
+    return NULL;
+}
+
+static int start(AppState *s) {
+    if (!s->history.path) return 1;
+
+    int *seqs = NULL;
+    int nseg = 0;
+    if (history_storage_list_segments(s->history.path, &seqs, &nseg) != 0 || nseg == 0) {
+        free(seqs);
+        return 1;
+    }
+    int last_segment = seqs[nseg - 1];
+    free(seqs);
+
+    char *last_path = history_storage_segment_path(s->history.path, last_segment);
+    struct stat st;
+    int found = last_path && stat(last_path, &st) == 0;
+    free(last_path);
+    if (!found) return 1;
+
+    HistoryLoader *l = calloc(1, sizeof(*l));
+    if (!l) return 1;
+    l->state = s;
+    l->path = strdup(s->history.path);
+    l->last_segment = last_segment;
+    l->end = st.st_size;
+    l->fulltext = s->history.fulltext;
+    l->batch_target = HISTORY_LOAD_FIRST_BATCH;
+    history_init(&l->batch);
+
+    /* Offsets of loaded entries point into this file from now on. */
+    app_state_lock(s);
+    if (l->path && !s->history.history->backing_path) {
+        s->history.history->backing_path = strdup(l->path);
+    }
+    int ok = l->path && s->history.history->backing_path;
+    if (ok) s->history.loading = 1;
+    app_state_unlock(s);
+
+    if (!ok || pthread_create(&l->thread, NULL, loader_main, l) != 0) {
+        app_state_lock(s);
+        s->history.loading = 0;
+        app_state_unlock(s);
+        free(l->path);
+        free(l);
+        return 1;
+    }
+
+    s->history.loader = l;
+    return 0;
+}
+
+int history_loader_start(AppState *s) {
+    if (!s || !s->history.history || s->history.loader) return 1;
+    if (start(s) == 0) return 0;
+
+    /* Nothing on disk for a saved index to describe: start a new one */
+    if (s->history.fulltext) {
+        app_state_lock(s);
+        if (!s->history.history->fulltext) history_set_fulltext(s->history.history, history_index_new());
+        app_state_unlock(s);
+    }
+    return 1;
+}
+
+void history_loader_stop(AppState *s) {
+    if (!s || !s->history.loader) return;
+    HistoryLoader *l = s->history.loader;
+
+    app_state_lock(s);
+    s->history.loading = 0;
+    app_state_unlock(s);
+
+    (void)pthread_join(l->thread, NULL);
+    free(l->path);
+    free(l);
+    s->history.loader = NULL;
+}
@@ -8,21 +8,55 @@
  */
 
 #include "core/storage/history_persistence.h"
+#include "core/storage/history_index.h"
+#include "core/config/constants.h"
 #include "core/utils/utils.h"
 
 #include "state.h"
 #include "core/cjson_compat.h"
 #include "core/text/textbuf.h"
+#include "core/utils/base64.h"
+#include "core/utils/bytebuf.h"
+#include "core/utils/compress.h"
+#include "core/utils/line_reader.h"
 #include <ctype.h>
 #include <errno.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <dirent.h>
 #include <sys/types.h>
 #include <unistd.h>
 
-static int ensure_parent_dirs(const char *path) {
+/*
+ * Lines carry "v":2 since bodies may be compressed; lines without it come
+ * from older versions and hold every string as it is. Lines from a newer
+ * format are skipped rather than misread.
+ */
+#define HISTORY_LINE_VERSION 2
+
+/* Set once at startup, before any thread writes entries */
+static int compress_level = HISTORY_COMPRESS_LEVEL_DEFAULT;
+static size_t compress_min_bytes = HISTORY_COMPRESS_MIN_BYTES_DEFAULT;
+
+void history_storage_set_compression(int level, size_t min_bytes) {
+    compress_level = level >= 0 && level <= 9 ? level : HISTORY_COMPRESS_LEVEL_DEFAULT;
+    compress_min_bytes = min_bytes;
+}
+
+/* Deflate `data` into `out` if compression is on and pays off. @return 1 if it did */
+static int compress_body(const char *data, size_t len, ByteBuf *out) {
+    if (compress_level == 0 || len < compress_min_bytes) return 0;
+    if (compress_deflate(data, len, compress_level, out) != 0 || out->len >= len) {
+        bytebuf_free(out);
+        return 0;
+    }
+    return 1;
+}
+
+int history_storage_ensure_parent_dirs(const char *path) {
     char *tmp = strdup(path);
     if (!tmp) return 1;
 
@@ -99,6 +133,7 @@ static void json_get_timing(const cJSON *obj, const char *key, HttpTiming *out)
     out->ttfb_ms = json_get_double(timing, "ttfb_ms", 0.0);
     out->transfer_ms = json_get_double(timing, "transfer_ms", 0.0);
     out->total_ms = json_get_double(timing, "total_ms", 0.0);
+    out->connection_reused = json_get_int(timing, "connection_reused", 0);
 }
 
 char *history_storage_default_path(void) {
@@ -114,10 +149,431 @@ char *history_storage_default_path(void) {
     return out;
 }
 
+char *history_storage_segment_path(const char *base, int seq) {
+    if (!base || seq < 0) return NULL;
+    if (seq == 0) return strdup(base);
+
+    size_t n = strlen(base) + 16;
+    char *out = malloc(n);
+    if (!out) return NULL;
+    snprintf(out, n, "%s.%d", base, seq);
+    return out;
+}
+
+static int cmp_int(const void *a, const void *b) {
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+int history_storage_list_segments(const char *base, int **seqs_out, int *count_out) {
+    if (!base || !seqs_out || !count_out) return 1;
+    *seqs_out = NULL;
+    *count_out = 0;
+
+    char *dir = strdup(base);
+    if (!dir) return 1;
+    char *slash = strrchr(dir, '/');
+    const char *name = slash ? base + (slash - dir) + 1 : base;
+    if (slash) {
+        if (slash == dir) slash[1] = '\0';
+        else *slash = '\0';
+    }
+    size_t name_len = strlen(name);
+
+    int *seqs = NULL;
+    int count = 0;
+    int cap = 0;
+    int rc = 0;
+
+    struct stat st;
+    if (stat(base, &st) == 0) {
+        seqs = malloc(8 * sizeof(*seqs));
+        if (!seqs) rc = 1;
+        else {
+            cap = 8;
+            seqs[count++] = 0;
+        }
+    }
+
+    DIR *d = opendir(slash ? dir : ".");
+    while (rc == 0 && d) {
+        struct dirent *e = readdir(d);
+        if (!e) break;
+        if (strncmp(e->d_name, name, name_len) != 0 || e->d_name[name_len] != '.') continue;
+
+        const char *digits = e->d_name + name_len + 1;
+        char *end = NULL;
+        long seq = strtol(digits, &end, 10);
+        if (!isdigit((unsigned char)digits[0]) || *end != '\0' || seq <= 0 || seq > 1000000000L) continue;
+
+        if (count == cap) {
+            int newcap = cap ? cap * 2 : 8;
+            int *n = realloc(seqs, (size_t)newcap * sizeof(*n));
+            if (!n) {
+                rc = 1;
+                break;
+            }
+            seqs = n;
+            cap = newcap;
+        }
+        seqs[count++] = (int)seq;
+    }
+    if (d) closedir(d);
+    free(dir);
+
+    if (rc != 0) {
+        free(seqs);
+        return 1;
+    }
+    if (count > 1) qsort(seqs, (size_t)count, sizeof(*seqs), cmp_int);
+    *seqs_out = seqs;
+    *count_out = count;
+    return 0;
+}
+
 int history_storage_load(History *h, const char *path) {
     return history_storage_load_with_stats(h, path, NULL);
 }
 
+/*
+ * Minimal JSON scanner used by the loader to step over values without
+ * building them, so the large string fields of an entry are never copied.
+ * Input runs up to `end` and need not be NUL-terminated. Each function
+ * returns a pointer past what it consumed, or NULL if the input is
+ * malformed.
+ */
+static const char *json_skip_ws(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+    return p;
+}
+
+static const char *json_skip_string(const char *p, const char *end) {
+    if (p >= end || *p != '"') return NULL;
+    for (p++; p < end; p++) {
+        if (*p == '\\') {
+            if (end - p < 2) return NULL;
+            p++;
+        } else if (*p == '"') {
+            return p + 1;
+        }
+    }
+    return NULL;
+}
+
+static const char *json_skip_value(const char *p, const char *end) {
+    p = json_skip_ws(p, end);
+    if (p >= end) return NULL;
+    if (*p == '"') return json_skip_string(p, end);
+
+    if (*p == '{' || *p == '[') {
+        int depth = 0;
+        while (p < end) {
+            if (*p == '"') {
+                p = json_skip_string(p, end);
+                if (!p) return NULL;
+                continue;
+            }
+            if (*p == '{' || *p == '[') {
+                depth++;
+            } else if (*p == '}' || *p == ']') {
+                if (--depth == 0) return p + 1;
+            }
+            p++;
+        }
+        return NULL;
+    }
+
+    const char *start = p;
+    while (p < end && *p && *p != ',' && *p != '}' && *p != ']' && !isspace((unsigned char)*p)) p++;
+    return p > start ? p : NULL;
+}
+
+static int is_index_key(const char *key, size_t n) {
+    static const char *const keys[] = { "v", "seq", "method", "url", "status", "elapsed_ms", "is_json", "timing" };
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        if (strlen(keys[i]) == n && memcmp(keys[i], key, n) == 0) return 1;
+    }
+    return 0;
+}
+
+/* 1 if the `len` bytes at `line` are only whitespace */
+static int is_blank(const char *line, size_t len) {
+    return json_skip_ws(line, line + len) == line + len;
+}
+
+/*
+ * Parse only the index fields of the `len` bytes at `line`. The members
+ * accepted by is_index_key() are copied verbatim into a small object in
+ * `scratch` for cJSON; bodies and headers are stepped over in place.
+ */
+static cJSON *parse_index_fields(const char *line, size_t len, ByteBuf *scratch) {
+    const char *end = line + len;
+    const char *p = json_skip_ws(line, end);
+    if (p >= end || *p != '{') return NULL;
+    p = json_skip_ws(p + 1, end);
+
+    bytebuf_clear(scratch);
+    if (bytebuf_append_str(scratch, "{") != 0) return NULL;
+
+    int copied = 0;
+    int ok = 0;
+    if (p < end && *p == '}') {
+        ok = 1;
+        p++;
+    }
+    while (!ok) {
+        const char *key = p;
+        const char *key_end = json_skip_string(key, end);
+        if (!key_end) break;
+        p = json_skip_ws(key_end, end);
+        if (p >= end || *p != ':') break;
+        const char *val = json_skip_ws(p + 1, end);
+        const char *val_end = json_skip_value(val, end);
+        if (!val_end) break;
+
+        if (is_index_key(key + 1, (size_t)(key_end - key) - 2)) {
+            if ((copied && bytebuf_append_str(scratch, ",") != 0) ||
+                bytebuf_append(scratch, key, (size_t)(key_end - key)) != 0 ||
+                bytebuf_append_str(scratch, ":") != 0 ||
+                bytebuf_append(scratch, val, (size_t)(val_end - val)) != 0) {
+                break;
+            }
+            copied++;
+        }
+
+        p = json_skip_ws(val_end, end);
+        if (p < end && *p == ',') {
+            p = json_skip_ws(p + 1, end);
+            continue;
+        }
+        if (p < end && *p == '}') {
+            ok = 1;
+            p++;
+        }
+        break;
+    }
+
+    cJSON *root = NULL;
+    if (ok && json_skip_ws(p, end) == end && bytebuf_append_str(scratch, "}") == 0) {
+        root = cJSON_Parse(scratch->data);
+    }
+    if (root && json_get_int(root, "v", 1) > HISTORY_LINE_VERSION) {
+        cJSON_Delete(root);
+        root = NULL;
+    }
+    return root;
+}
+
+/* Fill `meta` from parse_index_fields() output; meta->url points into `root`. */
+static void index_fields_to_meta(const cJSON *root, int segment, off_t offset, HistoryItem *meta) {
+    memset(meta, 0, sizeof(*meta));
+    meta->method = json_get_int(root, "method", 0);
+    meta->status = json_get_long(root, "status", 0);
+    meta->elapsed_ms = json_get_double(root, "elapsed_ms", 0.0);
+    meta->is_json = json_get_int(root, "is_json", 0);
+    json_get_timing(root, "timing", &meta->timing);
+    meta->disk_segment = segment;
+    meta->disk_offset = offset;
+    long seq = json_get_long(root, "seq", 0);
+    meta->seq = seq > 0 ? (unsigned long)seq : 0;
+
+    const cJSON *url = cJSON_GetObjectItemCaseSensitive((cJSON *)root, "url");
+    meta->url = (cJSON_IsString(url) && url->valuestring) ? url->valuestring : "";
+}
+
+/*
+ * Index parsing is spread over worker threads: a window of whole lines is
+ * cut into chunks at newline boundaries, each chunk is parsed into its own
+ * array of entries, and the arrays are read back in file order. Windows
+ * keep memory bounded on large files; small ones are parsed inline.
+ */
+#define HISTORY_PARSE_MAX_THREADS 8
+#define HISTORY_PARSE_CHUNK_MIN_BYTES (128 * 1024)
+#define HISTORY_PARSE_WINDOW_BYTES (8 * 1024 * 1024)
+
+static int parse_threads = 0;
+
+void history_storage_set_parse_threads(int n) {
+    parse_threads = n > 0 ? n : 0;
+}
+
+static int parse_thread_count(void) {
+    long n = parse_threads > 0 ? parse_threads : sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) n = 1;
+    return n > HISTORY_PARSE_MAX_THREADS ? HISTORY_PARSE_MAX_THREADS : (int)n;
+}
+
+/* Entries of one chunk in file order; an entry with a NULL url is an invalid line. */
+typedef struct {
+    const char *file;   /* Start of the mapping, for offsets */
+    const char *data;
+    size_t len;
+    int segment;
+    HistoryItem *items;
+    int count;
+    int cap;
+    int failed;         /* Out of memory: the chunk is incomplete */
+} IndexChunk;
+
+static int chunk_add(IndexChunk *c, const HistoryItem *meta) {
+    if (c->count == c->cap) {
+        int newcap = c->cap ? c->cap * 2 : 256;
+        HistoryItem *n = realloc(c->items, (size_t)newcap * sizeof(*n));
+        if (!n) return 1;
+        c->items = n;
+        c->cap = newcap;
+    }
+    c->items[c->count++] = *meta;
+    return 0;
+}
+
+static void *parse_chunk(void *arg) {
+    IndexChunk *c = arg;
+    ByteBuf scratch;
+    bytebuf_init(&scratch);
+
+    const char *p = c->data;
+    const char *end = c->data + c->len;
+    while (p < end && !c->failed) {
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        size_t len = nl ? (size_t)(nl - p) : (size_t)(end - p);
+        if (!is_blank(p, len)) {
+            HistoryItem meta;
+            cJSON *root = parse_index_fields(p, len, &scratch);
+            if (root) {
+                index_fields_to_meta(root, c->segment, (off_t)(p - c->file), &meta);
+                meta.url = strdup(meta.url);
+                cJSON_Delete(root);
+                if (!meta.url) c->failed = 1;
+            } else {
+                memset(&meta, 0, sizeof(meta));
+                meta.disk_offset = -1;
+            }
+            if (!c->failed && chunk_add(c, &meta) != 0) {
+                free(meta.url);
+                c->failed = 1;
+            }
+        }
+        p = nl ? nl + 1 : end;
+    }
+
+    bytebuf_free(&scratch);
+    return NULL;
+}
+
+static void chunks_free(IndexChunk *chunks, int n) {
+    for (int i = 0; i < n; i++) {
+        for (int k = 0; k < chunks[i].count; k++) free(chunks[i].items[k].url);
+        free(chunks[i].items);
+    }
+    free(chunks);
+}
+
+/*
+ * Parse the whole lines in [file + lo, file + hi) across the workers.
+ *
+ * @return Chunks in file order (free with chunks_free()), or NULL if memory
+ *         ran out
+ */
+static IndexChunk *parse_window(const char *file, size_t lo, size_t hi, int segment, int *nchunks) {
+    size_t len = hi - lo;
+    int n = parse_thread_count();
+    if ((size_t)n > len / HISTORY_PARSE_CHUNK_MIN_BYTES) n = (int)(len / HISTORY_PARSE_CHUNK_MIN_BYTES);
+    if (n < 1) n = 1;
+
+    IndexChunk *chunks = calloc((size_t)n, sizeof(*chunks));
+    if (!chunks) return NULL;
+
+    /* Cut after the first newline past each even share */
+    size_t start = lo;
+    int used = 0;
+    for (int i = 0; i < n && start < hi; i++) {
+        size_t cut = hi;
+        if (i < n - 1) {
+            size_t target = lo + len / (size_t)n * (size_t)(i + 1);
+            if (target < start) target = start;
+            const char *nl = memchr(file + target, '\n', hi - target);
+            if (nl) cut = (size_t)(nl - file) + 1;
+        }
+        chunks[used] = (IndexChunk){ .file = file, .data = file + start, .len = cut - start, .segment = segment };
+        used++;
+        start = cut;
+    }
+
+    pthread_t threads[HISTORY_PARSE_MAX_THREADS];
+    int started[HISTORY_PARSE_MAX_THREADS] = { 0 };
+    for (int i = 1; i < used; i++) {
+        started[i] = pthread_create(&threads[i], NULL, parse_chunk, &chunks[i]) == 0;
+    }
+    parse_chunk(&chunks[0]);
+    int failed = chunks[0].failed;
+    for (int i = 1; i < used; i++) {
+        /* A worker that could not start is run here instead */
+        if (started[i]) pthread_join(threads[i], NULL);
+        else parse_chunk(&chunks[i]);
+        failed |= chunks[i].failed;
+    }
+
+    if (failed) {
+        chunks_free(chunks, used);
+        return NULL;
+    }
+    *nchunks = used;
+    return chunks;
+}
+
+/* End of the window starting at `lo`: the first line end past `lo + want`. */
+static size_t window_end(const char *file, size_t lo, size_t len, size_t want) {
+    if (want >= len - lo) return len;
+    const char *nl = memchr(file + lo + want, '\n', len - lo - want);
+    return nl ? (size_t)(nl - file) + 1 : len;
+}
+
+/* Start of the window ending at line start `hi`: a line start about `want` bytes back. */
+static size_t window_start(const char *file, size_t hi, size_t want) {
+    while (want < hi) {
+        size_t start = hi - want;
+        const char *nl = memchr(file + start - 1, '\n', hi - start);
+        if (nl) return (size_t)(nl - file) + 1;
+        want *= 2;
+    }
+    return 0;
+}
+
+static int load_segment(History *h, const char *path, int segment, HistoryLoadStats *stats) {
+    LineReader r;
+    if (line_reader_open(&r, path) != 0) return errno == ENOENT ? 0 : 1;
+
+    int rc = 0;
+    size_t lo = 0;
+    while (rc == 0 && lo < r.len) {
+        size_t hi = window_end(r.data, lo, r.len, HISTORY_PARSE_WINDOW_BYTES);
+        int nchunks = 0;
+        IndexChunk *chunks = parse_window(r.data, lo, hi, segment, &nchunks);
+        if (!chunks) {
+            rc = 1;
+            break;
+        }
+
+        for (int i = 0; i < nchunks; i++) {
+            for (int k = 0; k < chunks[i].count; k++) {
+                const HistoryItem *meta = &chunks[i].items[k];
+                if (!meta->url) {
+                    if (stats) stats->skipped_invalid++;
+                } else if (history_push_unloaded(h, meta) == 0 && stats) {
+                    stats->loaded_ok++;
+                }
+            }
+        }
+        chunks_free(chunks, nchunks);
+        lo = hi;
+    }
+
+    line_reader_close(&r);
+    return rc;
+}
+
 int history_storage_load_with_stats(History *h, const char *path, HistoryLoadStats *stats) {
     if (!h || !path) return 1;
 
@@ -126,83 +582,623 @@ int history_storage_load_with_stats(History *h, const char *path, HistoryLoadSta
         stats->skipped_invalid = 0;
     }
 
-    FILE *f = fopen(path, "r");
-    if (!f) {
-        if (errno == ENOENT) return 0;
+    int *seqs = NULL;
+    int nseg = 0;
+    if (history_storage_list_segments(path, &seqs, &nseg) != 0) return 1;
+    if (nseg == 0) return 0;
+
+    char *backing = strdup(path);
+    if (!backing) {
+        free(seqs);
         return 1;
     }
+    free(h->backing_path);
+    h->backing_path = backing;
 
-    char line[65536];
-    while (fgets(line, sizeof(line), f)) {
-        str_trim(line);
-        if (line[0] == '\0') continue;
+    int rc = 0;
+    for (int i = 0; rc == 0 && i < nseg; i++) {
+        char *seg_path = history_storage_segment_path(path, seqs[i]);
+        rc = seg_path ? load_segment(h, seg_path, seqs[i], stats) : 1;
+        free(seg_path);
+    }
 
-        cJSON *root = cJSON_Parse(line);
-        if (!root) {
-            if (stats) stats->skipped_invalid++;
-            continue;
+    free(seqs);
+    return rc;
+}
+
+#define HISTORY_SCAN_BLOCK (64 * 1024)
+
+/* Lines of a file handed out last to first. */
+typedef struct {
+    FILE *f;
+    off_t pos;          /* File offset of data[0] */
+    char *data;         /* Bytes [pos, pos + len) not handed out yet */
+    size_t len;
+} ReverseLines;
+
+/* Read the block before `pos` in front of the pending bytes. */
+static int reverse_lines_fill(ReverseLines *r) {
+    size_t want = r->len > HISTORY_SCAN_BLOCK ? r->len : HISTORY_SCAN_BLOCK;
+    if ((off_t)want > r->pos) want = (size_t)r->pos;
+
+    char *n = malloc(want + r->len + 1);
+    if (!n) return 1;
+    if (fseeko(r->f, r->pos - (off_t)want, SEEK_SET) != 0 || fread(n, 1, want, r->f) != want) {
+        free(n);
+        return 1;
+    }
+    if (r->len > 0) memcpy(n + want, r->data, r->len);
+    n[want + r->len] = '\0';
+
+    free(r->data);
+    r->data = n;
+    r->len += want;
+    r->pos -= (off_t)want;
+    return 0;
+}
+
+/*
+ * Next line going backwards, NUL-terminated in place, or NULL once the start
+ * of the file is reached (or on a read error, reported through `err`).
+ */
+static char *reverse_lines_next(ReverseLines *r, off_t *offset, int *err) {
+    for (;;) {
+        size_t end = r->len;
+        if (end > 0 && r->data[end - 1] == '\n') end--;
+
+        size_t i = end;
+        while (i > 0 && r->data[i - 1] != '\n') i--;
+
+        if (i > 0 || r->pos == 0) {
+            if (i == 0 && r->len == 0) return NULL;
+            r->data[end] = '\0';
+            *offset = r->pos + (off_t)i;
+            r->len = i;
+            return r->data + i;
         }
 
-        int method = json_get_int(root, "method", 0);
-        long status = json_get_long(root, "status", 0);
-        double elapsed_ms = json_get_double(root, "elapsed_ms", 0.0);
-        int is_json = json_get_int(root, "is_json", 0);
-
-        char *url = json_dup_string_or_empty(root, "url");
-        char *body = json_dup_string_or_empty(root, "body");
-        char *headers = json_dup_string_or_empty(root, "headers");
-        char *response_body = json_dup_string_or_null(root, "response_body");
-        char *response_body_view = json_dup_string_or_null(root, "response_body_view");
-        char *response_headers = json_dup_string_or_null(root, "response_headers");
-
-        TextBuffer body_tb;
-        TextBuffer headers_tb;
-        tb_init(&body_tb);
-        tb_init(&headers_tb);
-        tb_set_from_string(&body_tb, body);
-        tb_set_from_string(&headers_tb, headers);
-
-        HttpResponse resp;
-        memset(&resp, 0, sizeof(resp));
-        resp.status = status;
-        resp.elapsed_ms = elapsed_ms;
-        resp.is_json = is_json;
-        resp.body = response_body ? strdup(response_body) : NULL;
-        resp.body_view = response_body_view ? strdup(response_body_view) : NULL;
-        resp.response_headers = response_headers ? strdup(response_headers) : NULL;
-        resp.error = NULL;
-        json_get_timing(root, "timing", &resp.timing);
-
-        history_push(h, method, url, &body_tb, &headers_tb, &resp);
-        if (stats) stats->loaded_ok++;
-
-        tb_free(&body_tb);
-        tb_free(&headers_tb);
-
-        free(url);
-        free(body);
-        free(headers);
-        free(response_body);
-        free(response_body_view);
-        free(response_headers);
-        free(resp.body);
-        free(resp.body_view);
-        free(resp.response_headers);
+        if (reverse_lines_fill(r) != 0) {
+            *err = 1;
+            return NULL;
+        }
+    }
+}
+
+/*
+ * Windows of a backwards scan start small, so the newest entries reach the
+ * caller quickly, and double up to the parse window size.
+ */
+#define HISTORY_SCAN_FIRST_WINDOW (64 * 1024)
 
+static int scan_file(const char *path, off_t end, int segment, HistoryScanFn fn, void *userdata, int *stopped) {
+    LineReader r;
+    if (line_reader_open(&r, path) != 0) return errno == ENOENT ? 0 : 1;
+
+    size_t hi = end >= 0 && (size_t)end < r.len ? (size_t)end : r.len;
+    size_t want = HISTORY_SCAN_FIRST_WINDOW;
+    int rc = 0;
+    while (rc == 0 && !*stopped && hi > 0) {
+        size_t lo = window_start(r.data, hi, want);
+        int nchunks = 0;
+        IndexChunk *chunks = parse_window(r.data, lo, hi, segment, &nchunks);
+        if (!chunks) {
+            rc = 1;
+            break;
+        }
+
+        for (int i = nchunks - 1; i >= 0 && !*stopped; i--) {
+            for (int k = chunks[i].count - 1; k >= 0; k--) {
+                const HistoryItem *meta = &chunks[i].items[k];
+                if (fn(meta->url ? meta : NULL, userdata)) {
+                    *stopped = 1;
+                    break;
+                }
+            }
+        }
+        chunks_free(chunks, nchunks);
+
+        hi = lo;
+        if (want < HISTORY_PARSE_WINDOW_BYTES) want *= 2;
+    }
+
+    line_reader_close(&r);
+    return rc;
+}
+
+int history_storage_scan_newest(const char *path, off_t end, HistoryScanFn fn, void *userdata) {
+    if (!path || !fn) return 1;
+    int stopped = 0;
+    return scan_file(path, end, 0, fn, userdata, &stopped);
+}
+
+int history_storage_scan_log(const char *base, int last_segment, off_t last_end, HistoryScanFn fn, void *userdata) {
+    if (!base || !fn) return 1;
+
+    int *seqs = NULL;
+    int nseg = 0;
+    if (history_storage_list_segments(base, &seqs, &nseg) != 0) return 1;
+
+    int rc = 0;
+    int stopped = 0;
+    for (int i = nseg - 1; rc == 0 && !stopped && i >= 0; i--) {
+        if (seqs[i] > last_segment) continue;
+        char *seg_path = history_storage_segment_path(base, seqs[i]);
+        if (!seg_path) {
+            rc = 1;
+            break;
+        }
+        rc = scan_file(seg_path, seqs[i] == last_segment ? last_end : -1, seqs[i], fn, userdata, &stopped);
+        free(seg_path);
+    }
+
+    free(seqs);
+    return rc;
+}
+
+static int count_valid(const HistoryItem *meta, void *userdata) {
+    if (meta) (*(int *)userdata)++;
+    return 0;
+}
+
+int history_storage_count_entries(const char *path) {
+    int count = 0;
+    int stopped = 0;
+    if (!path || scan_file(path, -1, 0, count_valid, &count, &stopped) != 0) return -1;
+    return count;
+}
+
+/*
+ * The line without the response_body_view field that older versions
+ * stored next to the body it was derived from.
+ *
+ * @return Heap string without a newline, or NULL if there is nothing to drop
+ */
+static char *strip_legacy_view(const char *line) {
+    if (!strstr(line, "\"response_body_view")) return NULL;
+
+    cJSON *root = cJSON_Parse(line);
+    if (!root) return NULL;
+    cJSON_DeleteItemFromObjectCaseSensitive(root, "response_body_view");
+    cJSON_DeleteItemFromObjectCaseSensitive(root, "response_body_view_ref");
+    char *out = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return out;
+}
+
+int history_storage_copy_newest(const char *path, int keep, const char *dest, HistoryLineMove **moves, int *nmoves) {
+    if (!path || !dest || !moves || !nmoves || keep < 1) return 1;
+    *moves = NULL;
+    *nmoves = 0;
+
+    FILE *f = fopen(path, "r");
+    if (!f) return errno == ENOENT ? 0 : 1;
+
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0) {
+        fclose(f);
+        return 1;
+    }
+
+    /* Find where the keep-th newest entry starts; invalid lines do not count. */
+    ReverseLines r = { .f = f, .pos = st.st_size, .data = NULL, .len = 0 };
+    ByteBuf scratch;
+    bytebuf_init(&scratch);
+    int err = 0;
+    int seen = 0;
+    off_t offset = 0;
+    off_t cut = 0;
+    char *line;
+    while (seen < keep && (line = reverse_lines_next(&r, &offset, &err)) != NULL) {
+        size_t len = strlen(line);
+        if (is_blank(line, len)) continue;
+        cJSON *root = parse_index_fields(line, len, &scratch);
+        if (!root) continue;
         cJSON_Delete(root);
+        cut = offset;
+        seen++;
     }
+    bytebuf_free(&scratch);
+    free(r.data);
 
+    /* Nothing older than the kept entries: leave the file alone */
+    if (err || seen < keep || cut == 0) {
+        fclose(f);
+        return err;
+    }
+
+    FILE *out = fopen(dest, "w");
+    int rc = (!out || fseeko(f, cut, SEEK_SET) != 0) ? 1 : 0;
+    HistoryLineMove *list = NULL;
+    int count = 0;
+    int cap = 0;
+    char *buf = NULL;
+    size_t buf_cap = 0;
+    ssize_t n;
+    off_t from = cut;
+    while (rc == 0 && (n = getline(&buf, &buf_cap, f)) > 0) {
+        if (count == cap) {
+            int newcap = cap ? cap * 2 : 64;
+            HistoryLineMove *grown = realloc(list, (size_t)newcap * sizeof(*grown));
+            if (!grown) {
+                rc = 1;
+                break;
+            }
+            list = grown;
+            cap = newcap;
+        }
+        list[count].from = from;
+        list[count].to = ftello(out);
+        count++;
+        from += n;
+
+        char *stripped = strip_legacy_view(buf);
+        if (stripped) {
+            if (fputs(stripped, out) < 0 || fputc('\n', out) == EOF) rc = 1;
+            free(stripped);
+        } else if (fwrite(buf, 1, (size_t)n, out) != (size_t)n) {
+            rc = 1;
+        }
+    }
+    if (ferror(f)) rc = 1;
+    free(buf);
     fclose(f);
+
+    if (out) {
+        if (fflush(out) != 0 || fsync(fileno(out)) != 0) rc = 1;
+        if (fclose(out) != 0) rc = 1;
+    }
+    if (rc != 0) {
+        free(list);
+        unlink(dest);
+        return 1;
+    }
+
+    *moves = list;
+    *nmoves = count;
     return 0;
 }
 
-static int append_history_item(FILE *f, const HistoryItem *it) {
-    cJSON *root = cJSON_CreateObject();
+/* Read the line starting at `offset`, without its newline, whatever its length. */
+static int read_line_at(FILE *f, off_t offset, ByteBuf *out) {
+    if (fseeko(f, offset, SEEK_SET) != 0) return 1;
+
+    char chunk[8192];
+    while (fgets(chunk, sizeof(chunk), f)) {
+        size_t n = strlen(chunk);
+        int done = n > 0 && chunk[n - 1] == '\n';
+        if (done) n--;
+        if (bytebuf_append(out, chunk, n) != 0) return 1;
+        if (done) break;
+    }
+    if (ferror(f)) return 1;
+    if (!out->data && bytebuf_append(out, "", 0) != 0) return 1;
+    return 0;
+}
+
+/* Directory of the shared bodies of the log at `base`. */
+static char *bodies_dir(const char *base) {
+    size_t n = strlen(base) + 8;
+    char *out = malloc(n);
+    if (out) snprintf(out, n, "%s.bodies", base);
+    return out;
+}
+
+/* A body is kept in `<hash>`, or deflated in `<hash>.z`. */
+static char *body_path(const char *base, const BodyHash *hash, int compressed) {
+    char hex[BODY_HASH_HEX_LEN + 1];
+    body_hash_hex(hash, hex);
+
+    size_t n = strlen(base) + 8 + 1 + BODY_HASH_HEX_LEN + 2 + 1;
+    char *out = malloc(n);
+    if (out) snprintf(out, n, "%s.bodies/%s%s", base, hex, compressed ? ".z" : "");
+    return out;
+}
+
+int history_storage_has_body(const char *base, const BodyHash *hash) {
+    if (!base || !hash) return 0;
+
+    int found = 0;
+    for (int compressed = 0; !found && compressed <= 1; compressed++) {
+        char *path = body_path(base, hash, compressed);
+        found = path && access(path, F_OK) == 0;
+        free(path);
+    }
+    return found;
+}
+
+int history_storage_write_body(const char *base, const char *data, size_t len) {
+    if (!base || !data) return 1;
+
+    BodyHash hash;
+    body_hash(data, len, &hash);
+    return history_storage_write_body_hashed(base, data, len, &hash);
+}
+
+int history_storage_write_body_hashed(const char *base, const char *data, size_t len, const BodyHash *hash) {
+    if (!base || !data || !hash) return 1;
+    if (history_storage_has_body(base, hash)) return 0;
+
+    ByteBuf packed;
+    bytebuf_init(&packed);
+    int compressed = compress_body(data, len, &packed);
+    if (compressed) {
+        data = packed.data;
+        len = packed.len;
+    }
+
+    char *dir = bodies_dir(base);
+    char *path = body_path(base, hash, compressed);
+    if (!dir || !path || (mkdir(dir, 0700) != 0 && errno != EEXIST)) {
+        free(dir);
+        free(path);
+        bytebuf_free(&packed);
+        return 1;
+    }
+    free(dir);
+
+    size_t tlen = strlen(path) + 5;
+    char *tmp_path = malloc(tlen);
+    FILE *f = NULL;
+    if (tmp_path) {
+        snprintf(tmp_path, tlen, "%s.tmp", path);
+        f = fopen(tmp_path, "wb");
+    }
+    int rc = f ? 0 : 1;
+    if (f) {
+        if (fwrite(data, 1, len, f) != len) rc = 1;
+        if (fflush(f) != 0 || fsync(fileno(f)) != 0) rc = 1;
+        if (fclose(f) != 0) rc = 1;
+        if (rc == 0 && rename(tmp_path, path) != 0) rc = 1;
+        if (rc != 0) unlink(tmp_path);
+    }
+
+    free(tmp_path);
+    free(path);
+    bytebuf_free(&packed);
+    return rc;
+}
+
+static int read_file(const char *path, ByteBuf *out) {
+    FILE *f = path ? fopen(path, "rb") : NULL;
+    if (!f) return 1;
+
+    char chunk[8192];
+    size_t n;
+    int rc = 0;
+    while (rc == 0 && (n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        rc = bytebuf_append(out, chunk, n);
+    }
+    if (ferror(f)) rc = 1;
+    fclose(f);
+    if (rc == 0 && !out->data) rc = bytebuf_append(out, "", 0);
+    return rc;
+}
+
+/* The original bytes of a stored body, whichever way it was written. */
+static int read_body_file(const char *base, const BodyHash *hash, ByteBuf *out) {
+    char *path = body_path(base, hash, 1);
+    ByteBuf packed;
+    bytebuf_init(&packed);
+    int rc;
+    if (read_file(path, &packed) == 0) {
+        rc = compress_inflate(packed.data, packed.len, out);
+    } else {
+        free(path);
+        path = body_path(base, hash, 0);
+        rc = read_file(path, out);
+    }
+    bytebuf_free(&packed);
+    free(path);
+    return rc;
+}
+
+/* Read a shared body from disk into the history's store. */
+static char *read_stored_body(History *h, const BodyHash *hash) {
+    ByteBuf buf;
+    bytebuf_init(&buf);
+    char *body = NULL;
+    if (read_body_file(h->backing_path, hash, &buf) == 0) {
+        /* Stored bodies are named by their hash */
+        body = body_store_intern_hashed(&h->bodies, buf.data, buf.len, hash);
+    }
+    bytebuf_free(&buf);
+    return body;
+}
+
+/*
+ * A string field of a line, inflating its "<key>_z" form when the line's
+ * format has one.
+ *
+ * @return Heap string, or NULL if the field is missing or corrupt
+ */
+static char *load_text_field(const cJSON *root, int version, const char *key) {
+    if (version >= 2) {
+        char z_key[64];
+        snprintf(z_key, sizeof(z_key), "%s_z", key);
+        const cJSON *z = cJSON_GetObjectItemCaseSensitive(root, z_key);
+        if (cJSON_IsString(z) && z->valuestring) {
+            ByteBuf packed;
+            ByteBuf text;
+            bytebuf_init(&packed);
+            bytebuf_init(&text);
+            int rc = base64_decode(z->valuestring, strlen(z->valuestring), &packed);
+            if (rc == 0) rc = compress_inflate(packed.data, packed.len, &text);
+            bytebuf_free(&packed);
+            if (rc != 0 || memchr(text.data, '\0', text.len)) {
+                bytebuf_free(&text);
+                return NULL;
+            }
+            return bytebuf_take(&text);
+        }
+    }
+    return json_dup_string_or_null(root, key);
+}
+
+/* A response string of a line: inline, by reference, or NULL. */
+static char *load_response_string(History *h, const cJSON *root, int version, const char *key) {
+    char ref_key[64];
+    snprintf(ref_key, sizeof(ref_key), "%s_ref", key);
+
+    const cJSON *ref = cJSON_GetObjectItemCaseSensitive(root, ref_key);
+    if (cJSON_IsString(ref) && ref->valuestring) {
+        BodyHash hash;
+        if (body_hash_parse(ref->valuestring, &hash) != 0) return NULL;
+        char *body = body_store_find(&h->bodies, &hash);
+        return body ? body : read_stored_body(h, &hash);
+    }
+
+    char *text = load_text_field(root, version, key);
+    char *body = text ? body_store_intern(&h->bodies, text, strlen(text)) : NULL;
+    free(text);
+    return body;
+}
+
+/* The parsed log line of an entry that is not in memory, or NULL if it is gone. */
+static cJSON *read_entry_line(const History *h, const HistoryItem *it) {
+    if (!h->backing_path || it->disk_offset < 0) return NULL;
+
+    char *seg_path = history_storage_segment_path(h->backing_path, it->disk_segment);
+    FILE *f = seg_path ? fopen(seg_path, "r") : NULL;
+    free(seg_path);
+    if (!f) return NULL;
+
+    ByteBuf line;
+    bytebuf_init(&line);
+    int rc = read_line_at(f, it->disk_offset, &line);
+    fclose(f);
+
+    cJSON *root = rc == 0 ? cJSON_Parse(line.data) : NULL;
+    bytebuf_free(&line);
+    if (!root) return NULL;
+
+    const cJSON *url = cJSON_GetObjectItemCaseSensitive(root, "url");
+    if (!cJSON_IsString(url) || !url->valuestring || strcmp(url->valuestring, it->url ? it->url : "") != 0) {
+        cJSON_Delete(root);
+        return NULL;
+    }
+    return root;
+}
+
+int history_storage_page_in(History *h, HistoryItem *it) {
+    if (!h || !it) return 1;
+    if (it->paged_in) return 0;
+
+    cJSON *root = read_entry_line(h, it);
     if (!root) return 1;
 
+    int version = json_get_int(root, "v", 1);
+    it->body = load_text_field(root, version, "body");
+    if (!it->body) it->body = strdup("");
+    it->headers = json_dup_string_or_empty(root, "headers");
+    /* A "response_body_view" written by older versions is ignored */
+    it->response_body = load_response_string(h, root, version, "response_body");
+    it->response_headers = load_response_string(h, root, version, "response_headers");
+    it->paged_in = 1;
+
+    cJSON_Delete(root);
+    return 0;
+}
+
+/* Run `test` on a response string of a line without keeping it. */
+static int test_response_string(History *h, const cJSON *root, int version, const char *key,
+                                HistoryTextTest test, void *userdata) {
+    char ref_key[64];
+    snprintf(ref_key, sizeof(ref_key), "%s_ref", key);
+
+    const cJSON *ref = cJSON_GetObjectItemCaseSensitive(root, ref_key);
+    if (cJSON_IsString(ref) && ref->valuestring) {
+        BodyHash hash;
+        if (body_hash_parse(ref->valuestring, &hash) != 0) return 0;
+
+        char *body = body_store_find(&h->bodies, &hash);
+        if (body) {
+            int hit = test(body, strlen(body), userdata);
+            body_store_release(&h->bodies, body);
+            return hit;
+        }
+        ByteBuf buf;
+        bytebuf_init(&buf);
+        int hit = read_body_file(h->backing_path, &hash, &buf) == 0 && test(buf.data, buf.len, userdata);
+        bytebuf_free(&buf);
+        return hit;
+    }
+
+    char *text = load_text_field(root, version, key);
+    int hit = text && test(text, strlen(text), userdata);
+    free(text);
+    return hit;
+}
+
+int history_storage_test_text(History *h, const HistoryItem *it, HistoryTextTest test, void *userdata) {
+    if (!h || !it || !test || it->paged_in) return 0;
+
+    cJSON *root = read_entry_line(h, it);
+    if (!root) return 0;
+
+    int version = json_get_int(root, "v", 1);
+    char *body = load_text_field(root, version, "body");
+    const cJSON *headers = cJSON_GetObjectItemCaseSensitive(root, "headers");
+    int hit = (body && test(body, strlen(body), userdata)) ||
+              (cJSON_IsString(headers) && headers->valuestring &&
+               test(headers->valuestring, strlen(headers->valuestring), userdata)) ||
+              test_response_string(h, root, version, "response_body", test, userdata) ||
+              test_response_string(h, root, version, "response_headers", test, userdata);
+    free(body);
+    cJSON_Delete(root);
+    return hit;
+}
+
+/* A string field, deflated and base64-encoded as "<key>_z" when that is smaller. */
+static void add_text_field(cJSON *root, const char *key, const char *value, size_t len) {
+    ByteBuf packed;
+    bytebuf_init(&packed);
+    char *b64 = compress_body(value, len, &packed) ? base64_encode(packed.data, packed.len) : NULL;
+    bytebuf_free(&packed);
+
+    if (b64 && strlen(b64) < len) {
+        char z_key[64];
+        snprintf(z_key, sizeof(z_key), "%s_z", key);
+        cJSON_AddStringToObject(root, z_key, b64);
+    } else {
+        cJSON_AddStringToObject(root, key, value);
+    }
+    free(b64);
+}
+
+/* Long strings are written as a reference to their shared copy. */
+static void add_response_string(cJSON *root, const char *key, const char *value) {
+    if (!value) {
+        cJSON_AddNullToObject(root, key);
+        return;
+    }
+
+    size_t len = strlen(value);
+    if (len < HISTORY_SHARED_BODY_MIN_BYTES) {
+        add_text_field(root, key, value, len);
+        return;
+    }
+
+    BodyHash hash;
+    char hex[BODY_HASH_HEX_LEN + 1];
+    char ref_key[64];
+    body_hash(value, len, &hash);
+    body_hash_hex(&hash, hex);
+    snprintf(ref_key, sizeof(ref_key), "%s_ref", key);
+    cJSON_AddStringToObject(root, ref_key, hex);
+}
+
+char *history_storage_format_entry(const HistoryItem *it) {
+    if (!it) return NULL;
+
+    cJSON *root = cJSON_CreateObject();
+    if (!root) return NULL;
+
+    const char *body = it->body ? it->body : "";
+    cJSON_AddNumberToObject(root, "v", HISTORY_LINE_VERSION);
+    if (it->seq) cJSON_AddNumberToObject(root, "seq", (double)it->seq);
     cJSON_AddNumberToObject(root, "method", it->method);
     cJSON_AddStringToObject(root, "url", it->url ? it->url : "");
-    cJSON_AddStringToObject(root, "body", it->body ? it->body : "");
+    add_text_field(root, "body", body, strlen(body));
     cJSON_AddStringToObject(root, "headers", it->headers ? it->headers : "");
     cJSON_AddNumberToObject(root, "status", it->status);
     cJSON_AddNumberToObject(root, "elapsed_ms", it->elapsed_ms);
@@ -217,20 +1213,53 @@ static int append_history_item(FILE *f, const HistoryItem *it) {
         cJSON_AddNumberToObject(timing, "ttfb_ms", it->timing.ttfb_ms);
         cJSON_AddNumberToObject(timing, "transfer_ms", it->timing.transfer_ms);
         cJSON_AddNumberToObject(timing, "total_ms", it->timing.total_ms);
+        cJSON_AddNumberToObject(timing, "connection_reused", it->timing.connection_reused);
         cJSON_AddItemToObject(root, "timing", timing);
     }
 
-    if (it->response_body) cJSON_AddStringToObject(root, "response_body", it->response_body);
-    else cJSON_AddNullToObject(root, "response_body");
-
-    if (it->response_body_view) cJSON_AddStringToObject(root, "response_body_view", it->response_body_view);
-    else cJSON_AddNullToObject(root, "response_body_view");
-
-    if (it->response_headers) cJSON_AddStringToObject(root, "response_headers", it->response_headers);
-    else cJSON_AddNullToObject(root, "response_headers");
+    add_response_string(root, "response_body", it->response_body);
+    add_response_string(root, "response_headers", it->response_headers);
 
     char *line = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
+    return line;
+}
+
+char *history_storage_set_line_seq(char *line, unsigned long seq) {
+    if (!line || line[0] != '{') {
+        free(line);
+        return NULL;
+    }
+
+    char field[32];
+    int n = snprintf(field, sizeof(field), "\"seq\":%lu%s", seq, line[1] == '}' ? "" : ",");
+    size_t len = strlen(line);
+    char *out = malloc(len + (size_t)n + 1);
+    if (out) {
+        out[0] = '{';
+        memcpy(out + 1, field, (size_t)n);
+        memcpy(out + 1 + n, line + 1, len);
+    }
+    free(line);
+    return out;
+}
+
+static int write_entry_bodies(const char *base, const HistoryItem *it) {
+    const char *fields[] = { it->response_body, it->response_headers };
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        if (!fields[i]) continue;
+        size_t len = strlen(fields[i]);
+        if (len < HISTORY_SHARED_BODY_MIN_BYTES) continue;
+        if (history_storage_write_body(base, fields[i], len) != 0) return 1;
+    }
+    return 0;
+}
+
+/* Write an entry to the log at `base`, its shared bodies first. */
+static int append_history_item(FILE *f, const char *base, const HistoryItem *it) {
+    if (write_entry_bodies(base, it) != 0) return 1;
+
+    char *line = history_storage_format_entry(it);
     if (!line) return 1;
 
     int rc = 0;
@@ -239,21 +1268,266 @@ static int append_history_item(FILE *f, const HistoryItem *it) {
     return rc;
 }
 
-int history_storage_append_last(const History *h, const char *path) {
+static int is_backing_path(const History *h, const char *path) {
+    return !h->backing_path || strcmp(h->backing_path, path) == 0;
+}
+
+int history_storage_append_last(History *h, const char *path) {
     if (!h || !path) return 1;
     if (h->count <= 0) return 0;
-    if (ensure_parent_dirs(path) != 0) return 1;
+    if (history_storage_ensure_parent_dirs(path) != 0) return 1;
+
+    /* Append to the newest segment of the log */
+    int *seqs = NULL;
+    int nseg = 0;
+    if (history_storage_list_segments(path, &seqs, &nseg) != 0) return 1;
+    int segment = nseg > 0 ? seqs[nseg - 1] : 0;
+    free(seqs);
 
-    FILE *f = fopen(path, "a");
+    char *seg_path = history_storage_segment_path(path, segment);
+    FILE *f = seg_path ? fopen(seg_path, "a") : NULL;
+    free(seg_path);
     if (!f) return 1;
-    int rc = append_history_item(f, &h->items[h->count - 1]);
+
+    HistoryItem *it = history_get(h, h->count - 1);
+    off_t offset = -1;
+    if (fseeko(f, 0, SEEK_END) == 0) offset = ftello(f);
+    int rc = append_history_item(f, path, it);
     if (fclose(f) != 0) rc = 1;
+
+    if (rc == 0 && offset >= 0 && is_backing_path(h, path)) {
+        if (!h->backing_path) h->backing_path = strdup(path);
+        if (h->backing_path) {
+            it->disk_segment = segment;
+            it->disk_offset = offset;
+        }
+    }
+    return rc;
+}
+
+/* Open segment files of the backing log one at a time while saving. */
+typedef struct {
+    const char *base;
+    int segment;
+    FILE *f;
+} SegmentReader;
+
+static FILE *segment_reader_open(SegmentReader *r, int segment) {
+    if (r->f && r->segment == segment) return r->f;
+    if (r->f) fclose(r->f);
+    r->f = NULL;
+    r->segment = segment;
+    if (!r->base) return NULL;
+
+    char *seg_path = history_storage_segment_path(r->base, segment);
+    if (seg_path) r->f = fopen(seg_path, "r");
+    free(seg_path);
+    return r->f;
+}
+
+/*
+ * Next shared body referenced by a line, from `*p` on. A `_ref":"` can only
+ * be a key: quotes inside JSON strings are escaped.
+ */
+static int next_body_ref(const char **p, BodyHash *out) {
+    static const char marker[] = "_ref\":\"";
+
+    const char *m;
+    while ((m = strstr(*p, marker)) != NULL) {
+        const char *hex = m + sizeof(marker) - 1;
+        *p = hex;
+        char buf[BODY_HASH_HEX_LEN + 1];
+        if (strnlen(hex, BODY_HASH_HEX_LEN + 1) <= BODY_HASH_HEX_LEN || hex[BODY_HASH_HEX_LEN] != '"') continue;
+        memcpy(buf, hex, BODY_HASH_HEX_LEN);
+        buf[BODY_HASH_HEX_LEN] = '\0';
+        if (body_hash_parse(buf, out) == 0) {
+            *p = hex + BODY_HASH_HEX_LEN;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Give the log at `to` its own copy of the bodies a line from `from` refers to. */
+static int copy_line_bodies(const char *from, const char *to, const char *line) {
+    const char *p = line;
+    BodyHash hash;
+    int rc = 0;
+
+    while (rc == 0 && next_body_ref(&p, &hash)) {
+        if (history_storage_has_body(to, &hash)) continue;
+
+        ByteBuf body;
+        bytebuf_init(&body);
+        /* A body already missing stays missing; the entry still loads. */
+        if (read_body_file(from, &hash, &body) == 0) rc = history_storage_write_body(to, body.data, body.len);
+        bytebuf_free(&body);
+    }
+    return rc;
+}
+
+/*
+ * Write an entry that was never paged in by copying its line from the
+ * backing log. Falls back to the index fields alone if the line is gone.
+ */
+static int copy_unloaded_item(FILE *out, const char *base, SegmentReader *backing, const HistoryItem *it) {
+    FILE *f = it->disk_offset >= 0 ? segment_reader_open(backing, it->disk_segment) : NULL;
+    if (f) {
+        ByteBuf line;
+        bytebuf_init(&line);
+        int rc = read_line_at(f, it->disk_offset, &line);
+        if (rc == 0) {
+            if (strcmp(backing->base, base) != 0) rc = copy_line_bodies(backing->base, base, line.data);
+            char *stripped = rc == 0 ? strip_legacy_view(line.data) : NULL;
+            const char *text = stripped ? stripped : line.data;
+            size_t len = stripped ? strlen(stripped) : line.len;
+            if (rc == 0 && (fwrite(text, 1, len, out) != len || fputc('\n', out) == EOF)) rc = 1;
+            free(stripped);
+            bytebuf_free(&line);
+            return rc;
+        }
+        bytebuf_free(&line);
+    }
+    return append_history_item(out, base, it);
+}
+
+static int cmp_body_hash(const void *a, const void *b) {
+    const BodyHash *x = a;
+    const BodyHash *y = b;
+    return memcmp(x->bytes, y->bytes, sizeof(x->bytes));
+}
+
+static int collect_segment_refs(const char *path, BodyHash **refs, size_t *count, size_t *cap) {
+    FILE *f = fopen(path, "r");
+    if (!f) return errno == ENOENT ? 0 : 1;
+
+    char *line = NULL;
+    size_t line_cap = 0;
+    int rc = 0;
+    while (rc == 0 && getline(&line, &line_cap, f) >= 0) {
+        const char *p = line;
+        BodyHash hash;
+        while (next_body_ref(&p, &hash)) {
+            if (*count == *cap) {
+                size_t newcap = *cap ? *cap * 2 : 64;
+                BodyHash *n = realloc(*refs, newcap * sizeof(*n));
+                if (!n) {
+                    rc = 1;
+                    break;
+                }
+                *refs = n;
+                *cap = newcap;
+            }
+            (*refs)[(*count)++] = hash;
+        }
+    }
+    if (ferror(f)) rc = 1;
+    free(line);
+    fclose(f);
     return rc;
 }
 
-int history_storage_save(const History *h, const char *path) {
+int history_storage_body_refs(const char *base, BodyHash **refs_out, size_t *count_out) {
+    if (!base || !refs_out || !count_out) return 1;
+    *refs_out = NULL;
+    *count_out = 0;
+
+    int *seqs = NULL;
+    int nseg = 0;
+    if (history_storage_list_segments(base, &seqs, &nseg) != 0) return 1;
+
+    BodyHash *refs = NULL;
+    size_t count = 0;
+    size_t cap = 0;
+    int rc = 0;
+    for (int i = 0; rc == 0 && i < nseg; i++) {
+        char *seg_path = history_storage_segment_path(base, seqs[i]);
+        rc = seg_path ? collect_segment_refs(seg_path, &refs, &count, &cap) : 1;
+        free(seg_path);
+    }
+    free(seqs);
+
+    if (rc != 0) {
+        free(refs);
+        return 1;
+    }
+    if (count > 1) qsort(refs, count, sizeof(*refs), cmp_body_hash);
+    *refs_out = refs;
+    *count_out = count;
+    return 0;
+}
+
+int history_storage_sweep_bodies(const char *base, const BodyHash *refs, size_t nrefs, const BodyStore *live) {
+    if (!base) return 1;
+
+    char *dir = bodies_dir(base);
+    if (!dir) return 1;
+    DIR *d = opendir(dir);
+    if (!d) {
+        int rc = errno == ENOENT ? 0 : 1;
+        free(dir);
+        return rc;
+    }
+
+    size_t dir_len = strlen(dir);
+    int rc = 0;
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        if (e->d_name[0] == '.') continue;
+
+        BodyHash hash;
+        size_t n = strlen(e->d_name);
+        /* Leftovers of an interrupted write go too */
+        int stale = n > 4 && strcmp(e->d_name + n - 4, ".tmp") == 0;
+        if (!stale) {
+            char name[BODY_HASH_HEX_LEN + 1];
+            if (n == BODY_HASH_HEX_LEN + 2 && strcmp(e->d_name + BODY_HASH_HEX_LEN, ".z") == 0) {
+                memcpy(name, e->d_name, BODY_HASH_HEX_LEN);
+                name[BODY_HASH_HEX_LEN] = '\0';
+            } else if (n == BODY_HASH_HEX_LEN) {
+                memcpy(name, e->d_name, n + 1);
+            } else {
+                continue;
+            }
+            if (body_hash_parse(name, &hash) != 0) continue;
+            if (nrefs > 0 && bsearch(&hash, refs, nrefs, sizeof(*refs), cmp_body_hash)) continue;
+            if (body_store_contains(live, &hash)) continue;
+        }
+
+        char *path = malloc(dir_len + 1 + n + 1);
+        if (!path) {
+            rc = 1;
+            break;
+        }
+        snprintf(path, dir_len + 1 + n + 1, "%s/%s", dir, e->d_name);
+        if (unlink(path) != 0 && errno != ENOENT) rc = 1;
+        free(path);
+    }
+    closedir(d);
+
+    /* Only succeeds once nothing is left */
+    (void)rmdir(dir);
+    free(dir);
+    return rc;
+}
+
+/* Remove every numbered segment of the log at `base`, keeping `base` itself. */
+static void remove_numbered_segments(const char *base) {
+    int *seqs = NULL;
+    int nseg = 0;
+    if (history_storage_list_segments(base, &seqs, &nseg) != 0) return;
+    for (int i = 0; i < nseg; i++) {
+        if (seqs[i] == 0) continue;
+        char *seg_path = history_storage_segment_path(base, seqs[i]);
+        if (seg_path) unlink(seg_path);
+        free(seg_path);
+    }
+    free(seqs);
+}
+
+int history_storage_save(History *h, const char *path) {
     if (!h || !path) return 1;
-    if (ensure_parent_dirs(path) != 0) return 1;
+    if (history_storage_ensure_parent_dirs(path) != 0) return 1;
 
     size_t tlen = strlen(path) + 5;
     char *tmp_path = malloc(tlen);
@@ -266,33 +1540,105 @@ int history_storage_save(const History *h, const char *path) {
         return 1;
     }
 
-    int rc = 0;
-    for (int i = 0; i < h->count; i++) {
-        const HistoryItem *it = &h->items[i];
-        if (append_history_item(f, it) != 0) {
-            rc = 1;
-            break;
-        }
+    /* New offsets are only applied once the rename has succeeded. */
+    off_t *offsets = h->count > 0 ? malloc((size_t)h->count * sizeof(*offsets)) : NULL;
+    SegmentReader backing = { .base = h->backing_path, .segment = -1, .f = NULL };
+
+    int rc = (h->count > 0 && !offsets) ? 1 : 0;
+    for (int i = 0; rc == 0 && i < h->count; i++) {
+        const HistoryItem *it = history_get(h, i);
+        offsets[i] = ftello(f);
+        int item_rc = it->paged_in ? append_history_item(f, path, it) : copy_unloaded_item(f, path, &backing, it);
+        if (item_rc != 0) rc = 1;
     }
 
+    if (backing.f) fclose(backing.f);
     if (fclose(f) != 0) rc = 1;
 
+    /* The whole history now lives in the first segment. */
     if (rc == 0) {
         if (rename(tmp_path, path) != 0) rc = 1;
+        else remove_numbered_segments(path);
+    }
+    if (rc == 0) {
+        BodyHash *refs = NULL;
+        size_t nrefs = 0;
+        if (history_storage_body_refs(path, &refs, &nrefs) == 0) {
+            (void)history_storage_sweep_bodies(path, refs, nrefs, &h->bodies);
+        }
+        free(refs);
     } else {
         unlink(tmp_path);
     }
 
+    if (rc == 0 && is_backing_path(h, path)) {
+        if (!h->backing_path) h->backing_path = strdup(path);
+        for (int i = 0; h->backing_path && i < h->count; i++) {
+            HistoryItem *it = history_get(h, i);
+            it->disk_segment = 0;
+            it->disk_offset = offsets[i];
+        }
+    }
+
+    free(offsets);
     free(tmp_path);
     return rc;
 }
 
-int history_config_load_max_entries(const char *path, int fallback) {
-    int out = fallback > 0 ? fallback : 500;
-    if (!path) return out;
+char *history_storage_fulltext_path(const char *base) {
+    if (!base) return NULL;
+    size_t n = strlen(base) + 10;
+    char *out = malloc(n);
+    if (out) snprintf(out, n, "%s.fulltext", base);
+    return out;
+}
+
+HistoryIndex *history_storage_read_fulltext(const char *base) {
+    char *path = history_storage_fulltext_path(base);
+    HistoryIndex *idx = path ? history_index_load(path) : NULL;
+    free(path);
+    return idx ? idx : history_index_new();
+}
+
+int history_storage_load_fulltext(History *h, const char *base) {
+    if (!h) return 1;
+
+    HistoryIndex *idx = history_storage_read_fulltext(base);
+    if (!idx) return 1;
+
+    history_set_fulltext(h, idx);
+    return 0;
+}
+
+int history_storage_save_fulltext(History *h, const char *base) {
+    if (!h || !h->fulltext) return 0;
+    if (history_storage_ensure_parent_dirs(base) != 0) return 1;
+
+    char *path = history_storage_fulltext_path(base);
+    if (!path) return 1;
+    int rc = history_index_save(h->fulltext, path);
+    free(path);
+    return rc;
+}
+
+static int parse_config_long(const char *val, long min, long max, long *out) {
+    char *end = NULL;
+    long n = strtol(val, &end, 10);
+    if (end == val || *end != '\0' || n < min || n > max) return 1;
+    *out = n;
+    return 0;
+}
+
+void history_config_load(const char *path, HistoryConfig *out) {
+    if (!out) return;
+    out->max_entries = 500;
+    out->compress_level = HISTORY_COMPRESS_LEVEL_DEFAULT;
+    out->compress_min_bytes = HISTORY_COMPRESS_MIN_BYTES_DEFAULT;
+    out->fulltext_index = 0;
+    if (!path) return;
 
     FILE *f = fopen(path, "r");
-    if (!f) return out;
+    if (!f) return;
 
     char line[512];
     while (fgets(line, sizeof(line), f)) {
@@ -310,15 +1656,17 @@ int history_config_load_max_entries(const char *path, int fallback) {
         str_trim(key);
         str_trim(val);
 
-        if (strcmp(key, "max_entries") != 0) continue;
-
-        char *end = NULL;
-        long n = strtol(val, &end, 10);
-        if (end && *end == '\0' && n > 0 && n <= 1000000) {
-            out = (int)n;
+        long n;
+        if (strcmp(key, "max_entries") == 0) {
+            if (parse_config_long(val, 1, 1000000, &n) == 0) out->max_entries = (int)n;
+        } else if (strcmp(key, "compress_level") == 0) {
+            if (parse_config_long(val, 0, 9, &n) == 0) out->compress_level = (int)n;
+        } else if (strcmp(key, "compress_min_bytes") == 0) {
+            if (parse_config_long(val, 0, 1L << 30, &n) == 0) out->compress_min_bytes = (size_t)n;
+        } else if (strcmp(key, "fulltext_index") == 0) {
+            if (parse_config_long(val, 0, 1, &n) == 0) out->fulltext_index = (int)n;
         }
     }
 
     fclose(f);
-    return out;
 }
@@ -0,0 +1,480 @@
+/*
+ * history_writer.c - History persistence thread
+ *
+ * Jobs form a FIFO guarded by the writer's own mutex, which is never held
+ * together with the state lock. The thread takes the whole queue at once:
+ * appends go through one FILE and one fsync; a trim or clear first commits
+ * the appends before it so the log changes in queue order.
+ *
+ * Appends go to the newest segment of the log, rolled at
+ * HISTORY_SEGMENT_BYTES. A trim deletes whole oldest segments while the
+ * newer ones still hold `keep` entries, so steady-state cost per request
+ * does not depend on the history size. A large oldest segment that is
+ * mostly outside the kept window (typically a history.jsonl written before
+ * segments existed) is compacted: its kept tail is copied, less the fields
+ * older versions no longer need, and renamed into place under the state
+ * lock, together with a remap of the offsets of entries never paged in.
+ *
+ * Shared bodies are queued ahead of the entry that refers to them, as a
+ * pin on the history's interned copy (or the mapped file), never a copy.
+ * Pins are dropped under the state lock once the batch is written. Once
+ * segments are dropped, bodies nothing refers to any more are swept: the
+ * log is scanned for references without the state lock, and files are
+ * deleted under it, sparing whatever the in-memory history still holds.
+ */
+
+#include "core/storage/history_writer.h"
+#include "core/storage/history.h"
+#include "core/storage/history_persistence.h"
+#include "core/config/constants.h"
+#include "core/utils/mapped_body.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef enum {
+    WRITE_BODY,
+    WRITE_APPEND,
+    WRITE_TRIM,
+    WRITE_CLEAR
+} HistoryWriteKind;
+
+typedef struct HistoryWriteJob {
+    HistoryWriteKind kind;
+    char *line;             /* WRITE_APPEND */
+    char *body;             /* WRITE_BODY: pinned in the history's body store, or the text of `map` */
+    size_t body_len;
+    BodyHash hash;
+    MappedBody *map;
+    int keep;               /* WRITE_TRIM */
+    struct HistoryWriteJob *next;
+} HistoryWriteJob;
+
+struct HistoryWriter {
+    AppState *state;
+    char *path;
+    pthread_t thread;
+
+    pthread_mutex_t mu;     /* Guards the queue and `stopping` */
+    pthread_cond_t cv;
+    HistoryWriteJob *head;
+    HistoryWriteJob *tail;
+    int stopping;
+
+    /* Writer thread only: segments of the log, oldest first */
+    int log_listed;
+    int *seqs;
+    int *counts;            /* Valid entries per segment, -1 until counted */
+    int nseg;
+    int cap;
+    off_t newest_size;
+    FILE *out;              /* Open on the newest segment during a batch */
+};
+
+/* Pinned bodies are dropped by unpin_bodies() first, under the state lock. */
+static void job_free(HistoryWriteJob *job) {
+    if (!job) return;
+    free(job->line);
+    if (job->map) mapped_body_release(job->map);
+    free(job);
+}
+
+/* Call with the state lock held. */
+static void unpin_bodies(HistoryWriter *w, HistoryWriteJob *jobs) {
+    for (HistoryWriteJob *job = jobs; job; job = job->next) {
+        if (job->kind != WRITE_BODY || job->map || !job->body) continue;
+        body_store_unpin(&w->state->history.history->bodies, job->body);
+        job->body = NULL;
+    }
+}
+
+static int enqueue(HistoryWriter *w, HistoryWriteJob *job) {
+    if (!w || !job) {
+        job_free(job);
+        return 1;
+    }
+
+    job->next = NULL;
+    pthread_mutex_lock(&w->mu);
+    if (w->tail) w->tail->next = job;
+    else w->head = job;
+    w->tail = job;
+    pthread_cond_signal(&w->cv);
+    pthread_mutex_unlock(&w->mu);
+    return 0;
+}
+
+int history_writer_store_body(HistoryWriter *w, char *body, size_t len, const BodyHash *hash, MappedBody *map) {
+    if (!w || !body || !hash) return 1;
+    HistoryWriteJob *job = calloc(1, sizeof(*job));
+    if (!job) return 1;
+
+    job->kind = WRITE_BODY;
+    job->body_len = len;
+    job->hash = *hash;
+    job->map = map ? mapped_body_ref(map) : NULL;
+    job->body = map ? body : body_store_pin(body);
+    return enqueue(w, job);
+}
+
+int history_writer_append(HistoryWriter *w, char *line) {
+    HistoryWriteJob *job = calloc(1, sizeof(*job));
+    if (!job || !line) {
+        free(line);
+        free(job);
+        return 1;
+    }
+    job->kind = WRITE_APPEND;
+    job->line = line;
+    return enqueue(w, job);
+}
+
+int history_writer_trim(HistoryWriter *w, int keep) {
+    HistoryWriteJob *job = calloc(1, sizeof(*job));
+    if (!job) return 1;
+    job->kind = WRITE_TRIM;
+    job->keep = keep;
+    return enqueue(w, job);
+}
+
+int history_writer_clear(HistoryWriter *w) {
+    HistoryWriteJob *job = calloc(1, sizeof(*job));
+    if (!job) return 1;
+    job->kind = WRITE_CLEAR;
+    return enqueue(w, job);
+}
+
+/* Make pending appends durable and release the file. */
+static int commit_appends(HistoryWriter *w) {
+    if (!w->out) return 0;
+    int rc = 0;
+    if (fflush(w->out) != 0 || fsync(fileno(w->out)) != 0) rc = 1;
+    if (fclose(w->out) != 0) rc = 1;
+    w->out = NULL;
+    return rc;
+}
+
+static char *segment_path(const HistoryWriter *w, int index) {
+    return history_storage_segment_path(w->path, w->seqs[index]);
+}
+
+static int log_list(HistoryWriter *w) {
+    if (w->log_listed) return 0;
+
+    int *seqs = NULL;
+    int nseg = 0;
+    if (history_storage_list_segments(w->path, &seqs, &nseg) != 0) return 1;
+
+    int cap = nseg > 8 ? nseg : 8;
+    int *grown = realloc(seqs, (size_t)cap * sizeof(*grown));
+    int *counts = malloc((size_t)cap * sizeof(*counts));
+    if (!grown || !counts) {
+        free(grown ? grown : seqs);
+        free(counts);
+        return 1;
+    }
+    for (int i = 0; i < nseg; i++) counts[i] = -1;
+
+    w->seqs = grown;
+    w->counts = counts;
+    w->nseg = nseg;
+    w->cap = cap;
+    w->newest_size = 0;
+    if (nseg > 0) {
+        char *path = segment_path(w, nseg - 1);
+        struct stat st;
+        if (path && stat(path, &st) == 0) w->newest_size = st.st_size;
+        free(path);
+    }
+    w->log_listed = 1;
+    return 0;
+}
+
+static void log_forget(HistoryWriter *w) {
+    free(w->seqs);
+    free(w->counts);
+    w->seqs = NULL;
+    w->counts = NULL;
+    w->nseg = 0;
+    w->cap = 0;
+    w->log_listed = 0;
+}
+
+/* Start a new, empty newest segment. */
+static int log_roll(HistoryWriter *w) {
+    if (commit_appends(w) != 0) return 1;
+    if (w->nseg == w->cap) {
+        int newcap = w->cap * 2;
+        int *seqs = realloc(w->seqs, (size_t)newcap * sizeof(*seqs));
+        if (!seqs) return 1;
+        w->seqs = seqs;
+        int *counts = realloc(w->counts, (size_t)newcap * sizeof(*counts));
+        if (!counts) return 1;
+        w->counts = counts;
+        w->cap = newcap;
+    }
+    w->seqs[w->nseg] = w->nseg > 0 ? w->seqs[w->nseg - 1] + 1 : 1;
+    w->counts[w->nseg] = 0;
+    w->nseg++;
+    w->newest_size = 0;
+    return 0;
+}
+
+static int apply_append(HistoryWriter *w, const char *line) {
+    if (log_list(w) != 0) return 1;
+
+    if (w->nseg == 0 || w->newest_size >= HISTORY_SEGMENT_BYTES) {
+        if (log_roll(w) != 0) return 1;
+    }
+    if (!w->out) {
+        char *path = segment_path(w, w->nseg - 1);
+        w->out = path ? fopen(path, "a") : NULL;
+        free(path);
+        if (!w->out) return 1;
+    }
+
+    if (fputs(line, w->out) < 0 || fputc('\n', w->out) == EOF) return 1;
+    w->newest_size += (off_t)strlen(line) + 1;
+    if (w->counts[w->nseg - 1] >= 0) w->counts[w->nseg - 1]++;
+    return 0;
+}
+
+static void log_drop_oldest(HistoryWriter *w) {
+    char *path = segment_path(w, 0);
+    if (path) unlink(path);
+    free(path);
+
+    memmove(w->seqs, w->seqs + 1, (size_t)(w->nseg - 1) * sizeof(*w->seqs));
+    memmove(w->counts, w->counts + 1, (size_t)(w->nseg - 1) * sizeof(*w->counts));
+    w->nseg--;
+}
+
+static int cmp_move(const void *a, const void *b) {
+    off_t x = ((const HistoryLineMove *)a)->from;
+    off_t y = ((const HistoryLineMove *)b)->from;
+    return (x > y) - (x < y);
+}
+
+/* Rewrite the oldest segment with only its newest `live` entries. */
+static int log_compact_oldest(HistoryWriter *w, int live) {
+    char *path = segment_path(w, 0);
+    if (!path) return 1;
+    size_t tlen = strlen(path) + 5;
+    char *tmp_path = malloc(tlen);
+    if (!tmp_path) {
+        free(path);
+        return 1;
+    }
+    snprintf(tmp_path, tlen, "%s.tmp", path);
+
+    HistoryLineMove *moves = NULL;
+    int nmoves = 0;
+    int rc = history_storage_copy_newest(path, live, tmp_path, &moves, &nmoves);
+    if (rc == 0 && nmoves > 0) {
+        AppState *s = w->state;
+        app_state_lock(s);
+        if (rename(tmp_path, path) != 0) {
+            rc = 1;
+        } else if (s->history.history) {
+            History *h = s->history.history;
+            for (int i = 0; i < h->count; i++) {
+                HistoryItem *it = history_get(h, i);
+                if (it->disk_offset < 0 || it->disk_segment != w->seqs[0]) continue;
+                HistoryLineMove key = { .from = it->disk_offset, .to = 0 };
+                const HistoryLineMove *m = bsearch(&key, moves, (size_t)nmoves, sizeof(*moves), cmp_move);
+                it->disk_offset = m ? m->to : -1;
+            }
+        }
+        app_state_unlock(s);
+        if (rc != 0) unlink(tmp_path);
+    }
+    if (rc == 0) {
+        w->counts[0] = live;
+        struct stat st;
+        if (w->nseg == 1 && stat(path, &st) == 0) w->newest_size = st.st_size;
+    }
+
+    free(moves);
+    free(tmp_path);
+    free(path);
+    return rc;
+}
+
+/* Delete bodies that neither the log nor the in-memory history refer to. */
+static int sweep_bodies(HistoryWriter *w) {
+    BodyHash *refs = NULL;
+    size_t nrefs = 0;
+    if (history_storage_body_refs(w->path, &refs, &nrefs) != 0) return 1;
+
+    AppState *s = w->state;
+    app_state_lock(s);
+    const BodyStore *live = s->history.history ? &s->history.history->bodies : NULL;
+    int rc = history_storage_sweep_bodies(w->path, refs, nrefs, live);
+    app_state_unlock(s);
+
+    free(refs);
+    return rc;
+}
+
+static int apply_trim(HistoryWriter *w, int keep) {
+    if (log_list(w) != 0) return 1;
+
+    long total = 0;
+    for (int i = 0; i < w->nseg; i++) {
+        if (w->counts[i] < 0) {
+            char *path = segment_path(w, i);
+            w->counts[i] = path ? history_storage_count_entries(path) : -1;
+            free(path);
+            if (w->counts[i] < 0) return 1;
+        }
+        total += w->counts[i];
+    }
+
+    int dropped = 0;
+    while (w->nseg > 1 && total - w->counts[0] >= keep) {
+        total -= w->counts[0];
+        log_drop_oldest(w);
+        dropped = 1;
+    }
+
+    int live = w->nseg > 0 ? (int)(keep - (total - w->counts[0])) : 0;
+    if (w->nseg > 0 && live > 0 && live < w->counts[0] && live * 2 <= w->counts[0]) {
+        char *path = segment_path(w, 0);
+        struct stat st;
+        int big = path && stat(path, &st) == 0 && st.st_size > HISTORY_SEGMENT_BYTES;
+        free(path);
+        if (big) {
+            if (log_compact_oldest(w, live) != 0) return 1;
+            dropped = 1;
+        }
+    }
+
+    return dropped ? sweep_bodies(w) : 0;
+}
+
+static int apply_clear(HistoryWriter *w) {
+    if (log_list(w) != 0) return 1;
+
+    int rc = 0;
+    for (int i = 0; i < w->nseg; i++) {
+        char *path = segment_path(w, i);
+        if (!path || (unlink(path) != 0 && errno != ENOENT)) rc = 1;
+        free(path);
+    }
+    log_forget(w);
+    if (sweep_bodies(w) != 0) rc = 1;
+    return rc;
+}
+
+static int apply_batch(HistoryWriter *w, HistoryWriteJob *jobs) {
+    int rc = 0;
+
+    for (HistoryWriteJob *job = jobs; job; job = job->next) {
+        switch (job->kind) {
+            case WRITE_BODY:
+                if (history_storage_write_body_hashed(w->path, job->body, job->body_len, &job->hash) != 0) rc = 1;
+                break;
+            case WRITE_APPEND:
+                if (apply_append(w, job->line) != 0) rc = 1;
+                break;
+            case WRITE_TRIM:
+                if (commit_appends(w) != 0) rc = 1;
+                if (apply_trim(w, job->keep) != 0) rc = 1;
+                break;
+            case WRITE_CLEAR:
+                if (commit_appends(w) != 0) rc = 1;
+                if (apply_clear(w) != 0) rc = 1;
+                break;
+        }
+    }
+
+    if (commit_appends(w) != 0) rc = 1;
+
+    /* After a failure the cached listing may not match the disk any more */
+    if (rc != 0) log_forget(w);
+    return rc;
+}
+
+static void *writer_main(void *arg) {
+    HistoryWriter *w = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&w->mu);
+        while (!w->head && !w->stopping) pthread_cond_wait(&w->cv, &w->mu);
+        HistoryWriteJob *jobs = w->head;
+        w->head = NULL;
+        w->tail = NULL;
+        int stopping = w->stopping;
+        pthread_mutex_unlock(&w->mu);
+
+        if (!jobs) {
+            if (stopping) break;
+            continue;
+        }
+
+        int rc = apply_batch(w, jobs);
+
+        app_state_lock(w->state);
+        unpin_bodies(w, jobs);
+        w->state->history.last_save_error = rc;
+        app_state_mark_dirty(w->state, UI_DIRTY_FOOTER);
+        app_state_unlock(w->state);
+
+        while (jobs) {
+            HistoryWriteJob *next = jobs->next;
+            job_free(jobs);
+            jobs = next;
+        }
+    }
+    return NULL;
+}
+
+int history_writer_start(AppState *s) {
+    if (!s || !s->history.path || s->history.writer) return 1;
+
+    HistoryWriter *w = calloc(1, sizeof(*w));
+    if (!w) return 1;
+    w->state = s;
+    w->path = strdup(s->history.path);
+    if (!w->path || history_storage_ensure_parent_dirs(w->path) != 0) {
+        free(w->path);
+        free(w);
+        return 1;
+    }
+
+    pthread_mutex_init(&w->mu, NULL);
+    pthread_cond_init(&w->cv, NULL);
+    if (pthread_create(&w->thread, NULL, writer_main, w) != 0) {
+        pthread_cond_destroy(&w->cv);
+        pthread_mutex_destroy(&w->mu);
+        free(w->path);
+        free(w);
+        return 1;
+    }
+
+    s->history.writer = w;
+    return 0;
+}
+
+void history_writer_stop(AppState *s) {
+    if (!s || !s->history.writer) return;
+    HistoryWriter *w = s->history.writer;
+
+    pthread_mutex_lock(&w->mu);
+    w->stopping = 1;
+    pthread_cond_signal(&w->cv);
+    pthread_mutex_unlock(&w->mu);
+
+    (void)pthread_join(w->thread, NULL);
+    log_forget(w);
+    pthread_cond_destroy(&w->cv);
+    pthread_mutex_destroy(&w->mu);
+    free(w->path);
+    free(w);
+    s->history.writer = NULL;
+}
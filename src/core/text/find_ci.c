@@ -0,0 +1,154 @@
+/*
+ * find_ci.c - Case-insensitive substring search kernels
+ *
+ * The vector kernels fold a block of haystack to lower case, compare it
+ * with the needle's first byte and, `needle_n - 1` bytes further on, with
+ * its last byte. Only positions where both agree are verified in full, so
+ * most of the text is rejected 16 or 32 bytes at a time. Whatever is left
+ * at the end of the haystack goes through the scalar kernel.
+ */
+
+#include "core/text/find_ci.h"
+
+#include <stdint.h>
+
+/* SSE2 is part of the x86-64 baseline; AVX2 is checked at run time */
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define FIND_CI_X86 1
+#endif
+
+static unsigned char fold(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c | 0x20) : c;
+}
+
+/* 1 if the `n` bytes at `a` equal those at `b` ignoring ASCII case */
+static int equal_ci(const unsigned char *a, const unsigned char *b, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (fold(a[i]) != fold(b[i])) return 0;
+    }
+    return 1;
+}
+
+static const char *find_ci_scalar(const char *hay, size_t hay_n, const char *needle, size_t needle_n) {
+    const unsigned char *h = (const unsigned char *)hay;
+    const unsigned char *n = (const unsigned char *)needle;
+    unsigned char first = fold(n[0]);
+
+    for (size_t i = 0; i + needle_n <= hay_n; i++) {
+        if (fold(h[i]) == first && equal_ci(h + i + 1, n + 1, needle_n - 1)) return hay + i;
+    }
+    return NULL;
+}
+
+#ifdef FIND_CI_X86
+
+/* Lower-case A-Z: bytes in 'A'..'Z' map to 0x80..0x99 after the shift and
+   compare below the signed bound, so they get 0x20 or-ed in. */
+static __m128i fold_sse2(__m128i v) {
+    __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8((char)(0x80 - 'A')));
+    __m128i upper = _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(-128 + 26)));
+    return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+static const char *find_ci_sse2(const char *hay, size_t hay_n, const char *needle, size_t needle_n) {
+    const unsigned char *n = (const unsigned char *)needle;
+    const __m128i first = _mm_set1_epi8((char)fold(n[0]));
+    const __m128i last = _mm_set1_epi8((char)fold(n[needle_n - 1]));
+
+    size_t i = 0;
+    for (; i + needle_n - 1 + 16 <= hay_n; i += 16) {
+        __m128i a = fold_sse2(_mm_loadu_si128((const __m128i *)(hay + i)));
+        __m128i b = fold_sse2(_mm_loadu_si128((const __m128i *)(hay + i + needle_n - 1)));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        while (mask) {
+            int bit = __builtin_ctz(mask);
+            const unsigned char *cand = (const unsigned char *)hay + i + bit;
+            if (needle_n <= 2 || equal_ci(cand + 1, n + 1, needle_n - 2)) return (const char *)cand;
+            mask &= mask - 1;
+        }
+    }
+
+    return find_ci_scalar(hay + i, hay_n - i, needle, needle_n);
+}
+
+__attribute__((target("avx2")))
+static __m256i fold_avx2(__m256i v) {
+    __m256i shifted = _mm256_add_epi8(v, _mm256_set1_epi8((char)(0x80 - 'A')));
+    __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(-128 + 26)), shifted);
+    return _mm256_or_si256(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+__attribute__((target("avx2")))
+static const char *find_ci_avx2(const char *hay, size_t hay_n, const char *needle, size_t needle_n) {
+    const unsigned char *n = (const unsigned char *)needle;
+    const __m256i first = _mm256_set1_epi8((char)fold(n[0]));
+    const __m256i last = _mm256_set1_epi8((char)fold(n[needle_n - 1]));
+
+    size_t i = 0;
+    for (; i + needle_n - 1 + 32 <= hay_n; i += 32) {
+        __m256i a = fold_avx2(_mm256_loadu_si256((const __m256i *)(hay + i)));
+        __m256i b = fold_avx2(_mm256_loadu_si256((const __m256i *)(hay + i + needle_n - 1)));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+        while (mask) {
+            int bit = __builtin_ctz(mask);
+            const unsigned char *cand = (const unsigned char *)hay + i + bit;
+            if (needle_n <= 2 || equal_ci(cand + 1, n + 1, needle_n - 2)) return (const char *)cand;
+            mask &= mask - 1;
+        }
+    }
+
+    /* The SSE2 kernel takes the remainder 16 bytes at a time */
+    return find_ci_sse2(hay + i, hay_n - i, needle, needle_n);
+}
+
+#endif
+
+static int kernel_available(FindCiKernel kernel) {
+    switch (kernel) {
+        case FIND_CI_SCALAR: return 1;
+#ifdef FIND_CI_X86
+        case FIND_CI_SSE2: return 1;
+        case FIND_CI_AVX2: return __builtin_cpu_supports("avx2");
+#endif
+        default: return 0;
+    }
+}
+
+FindCiKernel find_ci_kernel(void) {
+    /* Resolved once; racing first callers all store the same answer */
+    static int chosen = -1;
+    int k = __atomic_load_n(&chosen, __ATOMIC_RELAXED);
+    if (k < 0) {
+        k = FIND_CI_AVX2;
+        while (k > FIND_CI_SCALAR && !kernel_available((FindCiKernel)k)) k--;
+        __atomic_store_n(&chosen, k, __ATOMIC_RELAXED);
+    }
+    return (FindCiKernel)k;
+}
+
+const char *find_ci_with(FindCiKernel kernel, const char *hay, size_t hay_n, const char *needle, size_t needle_n) {
+    if (needle_n == 0) return hay;
+    if (!hay || !needle || needle_n > hay_n) return NULL;
+
+    if (kernel > find_ci_kernel()) kernel = find_ci_kernel();
+    switch (kernel) {
+#ifdef FIND_CI_X86
+        case FIND_CI_AVX2: return find_ci_avx2(hay, hay_n, needle, needle_n);
+        case FIND_CI_SSE2: return find_ci_sse2(hay, hay_n, needle, needle_n);
+#endif
+        default: return find_ci_scalar(hay, hay_n, needle, needle_n);
+    }
+}
+
+const char *find_ci(const char *hay, size_t hay_n, const char *needle, size_t needle_n) {
+    return find_ci_with(find_ci_kernel(), hay, hay_n, needle, needle_n);
+}
+
+const char *find_ci_kernel_name(FindCiKernel kernel) {
+    switch (kernel) {
+        case FIND_CI_SSE2: return "sse2";
+        case FIND_CI_AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
@@ -29,6 +29,8 @@ static const char *const EN[I18N_COUNT] = {
     [I18N_PANEL_UNKNOWN] = "UNKNOWN",
 
     [I18N_SENDING_REQUEST] = "Sending request...",
+    [I18N_RECEIVING_META_FMT] = "Receiving... %s | %.1f KB/s | scroll:%d",
+    [I18N_STREAM_PREVIEW_FMT] = "-- first %.1f KB shown; the rest appears when the response completes --",
     [I18N_REQUEST_FAILED] = "Request failed:",
     [I18N_NO_RESPONSE_YET] = "No response yet",
     [I18N_RESPONSE_META_FMT] = "Status: %ld | Time: %.0f ms | Size: %.1f KB%s | scroll:%d",
@@ -39,6 +41,13 @@ static const char *const EN[I18N_COUNT] = {
     [I18N_TOPBAR_FMT] = " tcurl | %s | layout=%s ",
     [I18N_STATUS_NOT_FOUND_FMT] = " %s | focus=%s | env=%s | history_selected=%d | load_skipped=%d | not found: %s ",
     [I18N_STATUS_DEFAULT_FMT] = " %s | focus=%s | env=%s | history_selected=%d | load_skipped=%d | save_err=%d ",
+    [I18N_STATUS_LOADING_FMT] = " %s | focus=%s | env=%s | loading history: %d loaded | load_skipped=%d ",
+    [I18N_STATUS_MATCH_FMT] = " %s | focus=%s | env=%s | history_selected=%d | load_skipped=%d | match %d/%d: %s ",
+    [I18N_STATUS_SEARCHING_FMT] = " %s | focus=%s | env=%s | searching: %s ",
+    [I18N_STATUS_BAD_PATTERN_FMT] = " %s | focus=%s | env=%s | bad regex (%s): %s ",
+    [I18N_SEARCH_COUNT_FMT] = " %d matches ",
+    [I18N_SEARCH_BUSY] = " searching... ",
+    [I18N_SEARCH_BAD_PATTERN] = " bad regex ",
     [I18N_ENV_NONE] = "none",
     [I18N_HINT_FOOTER] = ":h help  :q quit  Move: h/j/k/l or arrows",
     [I18N_WIN_HISTORY] = " History ",
@@ -47,6 +56,7 @@ static const char *const EN[I18N_COUNT] = {
     [I18N_WIN_EDITOR_BODY] = " Editor [BODY] ",
     [I18N_WIN_EDITOR_HEADERS] = " Editor [HEADERS] ",
     [I18N_WIN_RESPONSE] = " Response ",
+    [I18N_WIN_RESPONSE_SLOT_FMT] = " Response #%d [%d/%d] ",
 
     [I18N_UNKNOWN_ERROR] = "Unknown error",
     [I18N_USAGE_THEME_NAME_SAVE] = "Usage: :theme <name> [-s|--save]",
@@ -71,12 +81,16 @@ static const char *const EN[I18N_COUNT] = {
     [I18N_AUTH_UPDATED] = "Authorization header updated",
     [I18N_AUTH_UPDATE_FAILED] = "Failed to update Authorization header",
     [I18N_USAGE_FIND] = "Usage: :find <term>",
-    [I18N_SETTINGS_FMT] = "Settings:\n- search_target=%s\n- history_max_entries=%d",
+    [I18N_SETTINGS_FMT] = "Settings:\n- search_target=%s\n- history_max_entries=%d\n- max_response_mb=%d\n- spill_mb=%d\n- timeout_ms=%ld\n- connect_timeout_ms=%ld",
     [I18N_USAGE_SET_SEARCH_TARGET] = "Usage: :set search_target auto|history|response",
     [I18N_SEARCH_TARGET_UPDATED] = "search_target updated",
     [I18N_USAGE_SET_MAX_ENTRIES] = "Usage: :set max_entries <int>",
     [I18N_MAX_ENTRIES_UPDATED_SESSION] = "max_entries updated (session only)",
-    [I18N_UNKNOWN_SETTING] = "Unknown setting. Use search_target or max_entries",
+    [I18N_USAGE_SET_MAX_RESPONSE_MB] = "Usage: :set max_response_mb <int> (0 = no limit)",
+    [I18N_MAX_RESPONSE_MB_UPDATED_SESSION] = "max_response_mb updated (session only)",
+    [I18N_USAGE_SET_SPILL_MB] = "Usage: :set spill_mb <int> (0 = keep bodies in memory)",
+    [I18N_SPILL_MB_UPDATED_SESSION] = "spill_mb updated (session only)",
+    [I18N_UNKNOWN_SETTING] = "Unknown setting. Use search_target, max_entries, max_response_mb, spill_mb, timeout_ms or connect_timeout_ms",
     [I18N_USAGE_LANG] = "Usage: :lang auto|en|pt | :lang list",
     [I18N_USAGE_LANG_LIST] = "Usage: :lang list",
     [I18N_UNKNOWN_LANGUAGE] = "Unknown language. Use auto, en, or pt",
@@ -94,7 +108,9 @@ static const char *const EN[I18N_COUNT] = {
     [I18N_HELP_HEADER_AUTH] = "\nAUTHENTICATION:\n",
     [I18N_HELP_HEADER_SEARCH] = "\nSEARCH:\n",
     [I18N_HELP_HEADER_HISTORY] = "\nHISTORY:\n",
-    [I18N_HELP_HEADER_SETTINGS] = "\nSETTINGS:\n",    [I18N_HELP_HEADER_COOKIES] = "\nCOOKIES:\n",    [I18N_HELP_CMD_QUIT] = "  :q | :quit              Quit application\n",
+    [I18N_HELP_HEADER_SETTINGS] = "\nSETTINGS:\n",    [I18N_HELP_HEADER_COOKIES] = "\nCOOKIES:\n",
+    [I18N_HELP_HEADER_BENCH] = "\nBENCHMARK:\n",
+    [I18N_HELP_CMD_QUIT] = "  :q | :quit              Quit application\n",
     [I18N_HELP_CMD_HELP] = "  :h | :help              Show this help\n",
     [I18N_HELP_CMD_LANG_LIST] = "  :lang list              List available languages\n",
     [I18N_HELP_CMD_LANG_SET] = "  :lang <auto|en|pt>      Set UI language for current session\n",
@@ -107,10 +123,12 @@ static const char *const EN[I18N_COUNT] = {
     [I18N_HELP_CMD_AUTH_BEARER] = "  :auth bearer <token>    Set Authorization bearer header\n",
     [I18N_HELP_CMD_AUTH_BASIC] = "  :auth basic <user>:<pass>  Set Authorization basic header\n",
     [I18N_HELP_CMD_FIND] = "  :find <term>            Run contextual search immediately\n",
-    [I18N_HELP_CMD_SET] = "  :set [key] [value]      Update runtime settings\n                          Keys: search_target, max_entries\n",
+    [I18N_HELP_CMD_SET] = "  :set [key] [value]      Update runtime settings\n                          Keys: search_target, max_entries,\n                          max_response_mb, spill_mb,\n                          timeout_ms, connect_timeout_ms\n",
+    [I18N_HELP_CMD_TIMEOUT] = "  :timeout <ms> [conn]    Timeouts for the current request (:timeout off)\n",
     [I18N_HELP_CMD_CLEAR] = "  :clear! | :ch!          Clear history (memory + storage)\n",
     [I18N_HELP_CMD_COOKIES_LIST] = "  :cookies list           List stored cookies\n",
     [I18N_HELP_CMD_COOKIES_CLEAR] = "  :cookies clear          Clear all cookies\n",
+    [I18N_HELP_CMD_BENCH] = "  :bench <n> <c>          Send current request n times, c at a time\n",
     [I18N_HELP_NAV_HEADER] = "\nNAVIGATION:\n",
     [I18N_HELP_NAV_LINE] = "  Arrow keys mirror h/l/k/j in normal mode\n",
     [I18N_HELP_KEYS_HEADER] = "\nKEY BINDINGS:\n",
@@ -139,8 +157,20 @@ static const char *const EN[I18N_COUNT] = {
     [I18N_ACT_SEARCH_NEXT_DESC] = "Go to next search match",
     [I18N_ACT_SEARCH_PREV_DESC] = "Go to previous search match",
     [I18N_ACT_TOGGLE_RESPONSE_VIEW_DESC] = "Toggle response headers/body view",
+    [I18N_ACT_NEXT_RESPONSE_DESC] = "Show next request response",
+    [I18N_ACT_PREV_RESPONSE_DESC] = "Show previous request response",
+    [I18N_ACT_CANCEL_REQUEST_DESC] = "Cancel the request in flight",
     
     [I18N_COOKIES_CLEARED] = "Cookies cleared successfully",
+
+    [I18N_USAGE_BENCH] = "Usage: :bench <count 1-100000> <concurrency 1-64>",
+    [I18N_BENCH_RUNNING_FMT] = "Benchmark running: %d requests, %d concurrent...",
+    [I18N_BENCH_ALREADY_RUNNING] = "A benchmark is already running",
+    [I18N_USAGE_TIMEOUT] = "Usage: :timeout <total_ms> [connect_ms] | :timeout off",
+    [I18N_TIMEOUT_FMT] = "Request timeouts (0 = environment or session default):\n- timeout_ms=%ld\n- connect_timeout_ms=%ld",
+    [I18N_TIMEOUT_UPDATED] = "Request timeouts updated",
+    [I18N_USAGE_SET_TIMEOUT_MS] = "Usage: :set timeout_ms|connect_timeout_ms <ms> (0 = no limit)",
+    [I18N_TIMEOUT_MS_UPDATED_SESSION] = "Timeout updated (session only)",
 };
 
 static const char *const PT[I18N_COUNT] = {
@@ -162,6 +192,8 @@ static const char *const PT[I18N_COUNT] = {
     [I18N_PANEL_UNKNOWN] = "DESCONHECIDO",
 
     [I18N_SENDING_REQUEST] = "Enviando requisição...",
+    [I18N_RECEIVING_META_FMT] = "Recebendo... %s | %.1f KB/s | scroll:%d",
+    [I18N_STREAM_PREVIEW_FMT] = "-- primeiros %.1f KB exibidos; o resto aparece quando a resposta terminar --",
     [I18N_REQUEST_FAILED] = "Requisição falhou:",
     [I18N_NO_RESPONSE_YET] = "Sem resposta ainda",
     [I18N_RESPONSE_META_FMT] = "Status: %ld | Tempo: %.0f ms | Tamanho: %.1f KB%s | rolagem:%d",
@@ -172,6 +204,13 @@ static const char *const PT[I18N_COUNT] = {
     [I18N_TOPBAR_FMT] = " tcurl | %s | layout=%s ",
     [I18N_STATUS_NOT_FOUND_FMT] = " %s | foco=%s | env=%s | histórico_sel=%d | load_skipped=%d | não encontrado: %s ",
     [I18N_STATUS_DEFAULT_FMT] = " %s | foco=%s | env=%s | histórico_sel=%d | load_skipped=%d | erro_save=%d ",
+    [I18N_STATUS_LOADING_FMT] = " %s | foco=%s | env=%s | carregando histórico: %d carregados | load_skipped=%d ",
+    [I18N_STATUS_MATCH_FMT] = " %s | foco=%s | env=%s | histórico_sel=%d | load_skipped=%d | ocorrência %d/%d: %s ",
+    [I18N_STATUS_SEARCHING_FMT] = " %s | foco=%s | env=%s | buscando: %s ",
+    [I18N_STATUS_BAD_PATTERN_FMT] = " %s | foco=%s | env=%s | regex inválida (%s): %s ",
+    [I18N_SEARCH_COUNT_FMT] = " %d ocorrências ",
+    [I18N_SEARCH_BUSY] = " buscando... ",
+    [I18N_SEARCH_BAD_PATTERN] = " regex inválida ",
     [I18N_ENV_NONE] = "nenhum",
     [I18N_HINT_FOOTER] = ":h ajuda  :q sair  Mover: h/j/k/l ou setas",
     [I18N_WIN_HISTORY] = " Histórico ",
@@ -180,6 +219,7 @@ static const char *const PT[I18N_COUNT] = {
     [I18N_WIN_EDITOR_BODY] = " Editor [CORPO] ",
     [I18N_WIN_EDITOR_HEADERS] = " Editor [HEADERS] ",
     [I18N_WIN_RESPONSE] = " Resposta ",
+    [I18N_WIN_RESPONSE_SLOT_FMT] = " Resposta #%d [%d/%d] ",
 
     [I18N_UNKNOWN_ERROR] = "Erro desconhecido",
     [I18N_USAGE_THEME_NAME_SAVE] = "Uso: :theme <name> [-s|--save]",
@@ -204,12 +244,16 @@ static const char *const PT[I18N_COUNT] = {
     [I18N_AUTH_UPDATED] = "Cabeçalho Authorization atualizado",
     [I18N_AUTH_UPDATE_FAILED] = "Falha ao atualizar cabeçalho Authorization",
     [I18N_USAGE_FIND] = "Uso: :find <term>",
-    [I18N_SETTINGS_FMT] = "Configurações:\n- search_target=%s\n- history_max_entries=%d",
+    [I18N_SETTINGS_FMT] = "Configurações:\n- search_target=%s\n- history_max_entries=%d\n- max_response_mb=%d\n- spill_mb=%d\n- timeout_ms=%ld\n- connect_timeout_ms=%ld",
     [I18N_USAGE_SET_SEARCH_TARGET] = "Uso: :set search_target auto|history|response",
     [I18N_SEARCH_TARGET_UPDATED] = "search_target atualizado",
     [I18N_USAGE_SET_MAX_ENTRIES] = "Uso: :set max_entries <int>",
     [I18N_MAX_ENTRIES_UPDATED_SESSION] = "max_entries atualizado (apenas sessão)",
-    [I18N_UNKNOWN_SETTING] = "Configuração desconhecida. Use search_target ou max_entries",
+    [I18N_USAGE_SET_MAX_RESPONSE_MB] = "Uso: :set max_response_mb <int> (0 = sem limite)",
+    [I18N_MAX_RESPONSE_MB_UPDATED_SESSION] = "max_response_mb atualizado (apenas sessão)",
+    [I18N_USAGE_SET_SPILL_MB] = "Uso: :set spill_mb <int> (0 = manter corpos em memória)",
+    [I18N_SPILL_MB_UPDATED_SESSION] = "spill_mb atualizado (apenas sessão)",
+    [I18N_UNKNOWN_SETTING] = "Configuração desconhecida. Use search_target, max_entries, max_response_mb, spill_mb, timeout_ms ou connect_timeout_ms",
     [I18N_USAGE_LANG] = "Uso: :lang auto|en|pt | :lang list",
     [I18N_USAGE_LANG_LIST] = "Uso: :lang list",
     [I18N_UNKNOWN_LANGUAGE] = "Linguagem desconhecida. Use auto, en ou pt",
@@ -229,6 +273,7 @@ static const char *const PT[I18N_COUNT] = {
     [I18N_HELP_HEADER_HISTORY] = "\nHISTORICO:\n",
     [I18N_HELP_HEADER_SETTINGS] = "\nCONFIGURACOES:\n",
     [I18N_HELP_HEADER_COOKIES] = "\nCOOKIES:\n",
+    [I18N_HELP_HEADER_BENCH] = "\nBENCHMARK:\n",
     [I18N_HELP_CMD_QUIT] = "  :q | :quit              Sair da aplicacao\n",
     [I18N_HELP_CMD_HELP] = "  :h | :help              Mostrar esta ajuda\n",
     [I18N_HELP_CMD_LANG_LIST] = "  :lang list              Listar linguagens disponiveis\n",
@@ -242,10 +287,12 @@ static const char *const PT[I18N_COUNT] = {
     [I18N_HELP_CMD_AUTH_BEARER] = "  :auth bearer <token>    Definir cabecalho Authorization bearer\n",
     [I18N_HELP_CMD_AUTH_BASIC] = "  :auth basic <user>:<pass>  Definir cabecalho Authorization basic\n",
     [I18N_HELP_CMD_FIND] = "  :find <term>            Executar busca contextual imediatamente\n",
-    [I18N_HELP_CMD_SET] = "  :set [chave] [valor]    Atualizar configuracoes de runtime\n                          Chaves: search_target, max_entries\n",
+    [I18N_HELP_CMD_SET] = "  :set [chave] [valor]    Atualizar configuracoes de runtime\n                          Chaves: search_target, max_entries,\n                          max_response_mb, spill_mb,\n                          timeout_ms, connect_timeout_ms\n",
+    [I18N_HELP_CMD_TIMEOUT] = "  :timeout <ms> [conn]    Timeouts da requisicao atual (:timeout off)\n",
     [I18N_HELP_CMD_CLEAR] = "  :clear! | :ch!          Limpar historico (memoria + armazenamento)\n",
     [I18N_HELP_CMD_COOKIES_LIST] = "  :cookies list           Listar cookies armazenados\n",
     [I18N_HELP_CMD_COOKIES_CLEAR] = "  :cookies clear          Limpar todos os cookies\n",
+    [I18N_HELP_CMD_BENCH] = "  :bench <n> <c>          Enviar requisicao atual n vezes, c por vez\n",
     [I18N_HELP_NAV_HEADER] = "\nNAVEGACAO:\n",
     [I18N_HELP_NAV_LINE] = "  Setas espelham h/l/k/j no modo normal\n",
     [I18N_HELP_KEYS_HEADER] = "\nATALHOS DE TECLADO:\n",
@@ -274,8 +321,20 @@ static const char *const PT[I18N_COUNT] = {
     [I18N_ACT_SEARCH_NEXT_DESC] = "Ir para a próxima ocorrência da busca",
     [I18N_ACT_SEARCH_PREV_DESC] = "Ir para a ocorrência anterior da busca",
     [I18N_ACT_TOGGLE_RESPONSE_VIEW_DESC] = "Alternar visualização de cabeçalhos/corpo da resposta",
+    [I18N_ACT_NEXT_RESPONSE_DESC] = "Mostrar resposta da próxima requisição",
+    [I18N_ACT_PREV_RESPONSE_DESC] = "Mostrar resposta da requisição anterior",
+    [I18N_ACT_CANCEL_REQUEST_DESC] = "Cancelar a requisição em andamento",
     
     [I18N_COOKIES_CLEARED] = "Cookies removidos com sucesso",
+
+    [I18N_USAGE_BENCH] = "Uso: :bench <quantidade 1-100000> <concorrencia 1-64>",
+    [I18N_BENCH_RUNNING_FMT] = "Benchmark em andamento: %d requisicoes, %d simultaneas...",
+    [I18N_BENCH_ALREADY_RUNNING] = "Um benchmark ja esta em andamento",
+    [I18N_USAGE_TIMEOUT] = "Uso: :timeout <total_ms> [conexao_ms] | :timeout off",
+    [I18N_TIMEOUT_FMT] = "Timeouts da requisição (0 = padrão do ambiente ou da sessão):\n- timeout_ms=%ld\n- connect_timeout_ms=%ld",
+    [I18N_TIMEOUT_UPDATED] = "Timeouts da requisição atualizados",
+    [I18N_USAGE_SET_TIMEOUT_MS] = "Uso: :set timeout_ms|connect_timeout_ms <ms> (0 = sem limite)",
+    [I18N_TIMEOUT_MS_UPDATED_SESSION] = "Timeout atualizado (apenas sessão)",
 };
 
 const char *i18n_get(UiLanguage lang, I18nKey key) {
@@ -0,0 +1,59 @@
+#include "core/text/line_index.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+LineIndex *line_index_build(const char *text, size_t len) {
+    if (!text) return NULL;
+
+    /* Count first so the offsets are allocated exactly once. */
+    size_t newlines = 0;
+    for (const char *p = text, *end = text + len; p < end; p++) {
+        p = memchr(p, '\n', (size_t)(end - p));
+        if (!p) break;
+        newlines++;
+    }
+    if (newlines >= (size_t)INT_MAX) return NULL;
+
+    LineIndex *idx = malloc(sizeof(*idx));
+    if (!idx) return NULL;
+
+    idx->count = (int)newlines + 1;
+    idx->starts = malloc(((size_t)idx->count + 1) * sizeof(*idx->starts));
+    if (!idx->starts) {
+        free(idx);
+        return NULL;
+    }
+
+    int n = 0;
+    idx->starts[n++] = 0;
+    for (const char *p = text, *end = text + len; p < end; p++) {
+        p = memchr(p, '\n', (size_t)(end - p));
+        if (!p) break;
+        idx->starts[n++] = (size_t)(p - text) + 1;
+    }
+    idx->starts[n] = len + 1;
+    idx->refs = 1;
+    return idx;
+}
+
+LineIndex *line_index_ref(LineIndex *idx) {
+    if (idx) __atomic_add_fetch(&idx->refs, 1, __ATOMIC_RELAXED);
+    return idx;
+}
+
+void line_index_release(LineIndex *idx) {
+    if (!idx) return;
+    if (__atomic_sub_fetch(&idx->refs, 1, __ATOMIC_ACQ_REL) != 0) return;
+    free(idx->starts);
+    free(idx);
+}
+
+const char *line_index_line(const LineIndex *idx, const char *text, int line, size_t *len) {
+    if (!idx || !text || line < 0 || line >= idx->count) return NULL;
+
+    size_t start = idx->starts[line];
+    if (len) *len = idx->starts[line + 1] - start - 1;
+    return text + start;
+}
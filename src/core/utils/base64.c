@@ -0,0 +1,58 @@
+#include "core/utils/base64.h"
+
+#include <stdlib.h>
+
+static const char tbl[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+char *base64_encode(const void *data, size_t len) {
+    const unsigned char *in = data;
+    size_t out_len = ((len + 2) / 3) * 4;
+    char *out = malloc(out_len + 1);
+    if (!out) return NULL;
+
+    size_t p = 0;
+    for (size_t i = 0; i < len; i += 3) {
+        unsigned v = (unsigned)in[i] << 16;
+        if (i + 1 < len) v |= (unsigned)in[i + 1] << 8;
+        if (i + 2 < len) v |= in[i + 2];
+
+        out[p++] = tbl[(v >> 18) & 0x3F];
+        out[p++] = tbl[(v >> 12) & 0x3F];
+        out[p++] = (i + 1 < len) ? tbl[(v >> 6) & 0x3F] : '=';
+        out[p++] = (i + 2 < len) ? tbl[v & 0x3F] : '=';
+    }
+    out[p] = '\0';
+    return out;
+}
+
+static int sextet(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+int base64_decode(const char *text, size_t len, ByteBuf *out) {
+    if (!text || !out || len % 4 != 0) return 1;
+    if (bytebuf_reserve(out, len / 4 * 3) != 0) return 1;
+
+    for (size_t i = 0; i < len; i += 4) {
+        int last = i + 4 == len;
+        int pad = 0;
+        if (last && text[i + 3] == '=') pad = text[i + 2] == '=' ? 2 : 1;
+
+        unsigned v = 0;
+        for (int k = 0; k < 4; k++) {
+            int s = k >= 4 - pad ? 0 : sextet(text[i + k]);
+            if (s < 0) return 1;
+            v = (v << 6) | (unsigned)s;
+        }
+
+        unsigned char bytes[3] = { (unsigned char)(v >> 16), (unsigned char)(v >> 8), (unsigned char)v };
+        if (bytebuf_append(out, bytes, (size_t)(3 - pad)) != 0) return 1;
+    }
+    if (!out->data) return bytebuf_append(out, "", 0) != 0;
+    return 0;
+}
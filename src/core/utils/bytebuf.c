@@ -0,0 +1,104 @@
+/*
+ * bytebuf.c - Growable byte buffer
+ *
+ * Capacity doubles on growth so appending n bytes in small pieces costs
+ * O(n) copies overall instead of one realloc per piece.
+ */
+
+#include "core/utils/bytebuf.h"
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BYTEBUF_MIN_CAP 256
+
+void bytebuf_init(ByteBuf *b) {
+    if (!b) return;
+    memset(b, 0, sizeof(*b));
+}
+
+void bytebuf_free(ByteBuf *b) {
+    if (!b) return;
+    free(b->data);
+    b->data = NULL;
+    b->len = 0;
+    b->cap = 0;
+}
+
+void bytebuf_clear(ByteBuf *b) {
+    if (!b) return;
+    b->len = 0;
+    if (b->data) b->data[0] = '\0';
+}
+
+int bytebuf_reserve(ByteBuf *b, size_t extra) {
+    if (!b) return -1;
+    if (extra > SIZE_MAX - b->len - 1) return -1;
+    if (b->limit && b->len + extra > b->limit) return -1;
+
+    size_t need = b->len + extra + 1;
+    if (need <= b->cap) return 0;
+
+    size_t cap = b->cap ? b->cap : BYTEBUF_MIN_CAP;
+    while (cap < need) {
+        if (cap > SIZE_MAX / 2) {
+            cap = need;
+            break;
+        }
+        cap *= 2;
+    }
+
+    char *p = realloc(b->data, cap);
+    if (!p) return -1;
+    if (!b->data) p[0] = '\0';
+    b->data = p;
+    b->cap = cap;
+    return 0;
+}
+
+int bytebuf_append(ByteBuf *b, const void *data, size_t n) {
+    if (!b || (!data && n > 0)) return -1;
+    if (bytebuf_reserve(b, n) != 0) return -1;
+
+    if (n > 0) memcpy(b->data + b->len, data, n);
+    b->len += n;
+    b->data[b->len] = '\0';
+    return 0;
+}
+
+int bytebuf_append_str(ByteBuf *b, const char *s) {
+    if (!s) return -1;
+    return bytebuf_append(b, s, strlen(s));
+}
+
+int bytebuf_appendf(ByteBuf *b, const char *fmt, ...) {
+    if (!b || !fmt) return -1;
+
+    va_list ap;
+    va_start(ap, fmt);
+    int need = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    if (need < 0) return -1;
+
+    if (bytebuf_reserve(b, (size_t)need) != 0) return -1;
+
+    va_start(ap, fmt);
+    vsnprintf(b->data + b->len, b->cap - b->len, fmt, ap);
+    va_end(ap);
+    b->len += (size_t)need;
+    return 0;
+}
+
+char *bytebuf_take(ByteBuf *b) {
+    if (!b) return NULL;
+
+    char *out = b->data;
+    if (!out) out = strdup("");
+    b->data = NULL;
+    b->len = 0;
+    b->cap = 0;
+    return out;
+}
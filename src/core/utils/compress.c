@@ -0,0 +1,96 @@
+#include "core/utils/compress.h"
+
+#include <limits.h>
+#include <zlib.h>
+
+/* zlib counts in uInt, so larger inputs are fed in slices */
+#define COMPRESS_SLICE ((size_t)UINT_MAX)
+
+int compress_deflate(const void *data, size_t len, int level, ByteBuf *out) {
+    if (!data || !out) return 1;
+    if (level < 1 || level > 9) level = Z_DEFAULT_COMPRESSION;
+
+    z_stream zs = { 0 };
+    if (deflateInit(&zs, level) != Z_OK) return 1;
+
+    const unsigned char *in = data;
+    size_t left = len;
+    int rc = 0;
+    int status = Z_OK;
+    while (status != Z_STREAM_END) {
+        if (zs.avail_in == 0 && left > 0) {
+            zs.next_in = (unsigned char *)in;
+            zs.avail_in = (uInt)(left < COMPRESS_SLICE ? left : COMPRESS_SLICE);
+            in += zs.avail_in;
+            left -= zs.avail_in;
+        }
+
+        size_t room = deflateBound(&zs, zs.avail_in) + 64;
+        if (bytebuf_reserve(out, room) != 0) {
+            rc = 1;
+            break;
+        }
+        zs.next_out = (unsigned char *)out->data + out->len;
+        zs.avail_out = (uInt)(room < COMPRESS_SLICE ? room : COMPRESS_SLICE);
+        uInt avail = zs.avail_out;
+
+        status = deflate(&zs, left > 0 ? Z_NO_FLUSH : Z_FINISH);
+        out->len += avail - zs.avail_out;
+        out->data[out->len] = '\0';
+        if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+            rc = 1;
+            break;
+        }
+    }
+
+    deflateEnd(&zs);
+    return rc;
+}
+
+int compress_inflate(const void *data, size_t len, ByteBuf *out) {
+    if (!data || !out) return 1;
+
+    z_stream zs = { 0 };
+    if (inflateInit(&zs) != Z_OK) return 1;
+
+    const unsigned char *in = data;
+    size_t left = len;
+    int rc = 0;
+    int status = Z_OK;
+    while (status != Z_STREAM_END) {
+        if (zs.avail_in == 0) {
+            if (left == 0) {
+                rc = 1;     /* Truncated */
+                break;
+            }
+            zs.next_in = (unsigned char *)in;
+            zs.avail_in = (uInt)(left < COMPRESS_SLICE ? left : COMPRESS_SLICE);
+            in += zs.avail_in;
+            left -= zs.avail_in;
+        }
+
+        /* Text typically inflates several times over */
+        size_t room = (size_t)zs.avail_in * 4 + 4096;
+        if (room > COMPRESS_SLICE) room = COMPRESS_SLICE;
+        if (bytebuf_reserve(out, room) != 0) {
+            rc = 1;
+            break;
+        }
+        zs.next_out = (unsigned char *)out->data + out->len;
+        zs.avail_out = (uInt)room;
+
+        status = inflate(&zs, Z_NO_FLUSH);
+        out->len += room - zs.avail_out;
+        out->data[out->len] = '\0';
+        if (status != Z_OK && status != Z_STREAM_END) {
+            rc = 1;
+            break;
+        }
+    }
+
+    /* Bytes after the end of the stream mean it is not what was written */
+    if (rc == 0 && (zs.avail_in > 0 || left > 0)) rc = 1;
+    inflateEnd(&zs);
+    if (rc == 0 && !out->data) rc = bytebuf_append(out, "", 0) != 0;
+    return rc;
+}
@@ -0,0 +1,68 @@
+#include "core/utils/line_reader.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int line_reader_open(LineReader *r, const char *path) {
+    if (!r || !path) {
+        errno = EINVAL;
+        return 1;
+    }
+    r->data = NULL;
+    r->len = 0;
+    r->pos = 0;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return 1;
+    }
+
+    /* mmap() rejects empty mappings; an empty file simply has no lines */
+    if (st.st_size > 0) {
+        void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            int err = errno;
+            close(fd);
+            errno = err;
+            return 1;
+        }
+        (void)posix_madvise(p, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+        r->data = p;
+        r->len = (size_t)st.st_size;
+    }
+
+    close(fd);
+    return 0;
+}
+
+const char *line_reader_next(LineReader *r, size_t *len, off_t *offset) {
+    if (!r || !r->data || r->pos >= r->len) return NULL;
+
+    const char *start = r->data + r->pos;
+    size_t left = r->len - r->pos;
+    const char *nl = memchr(start, '\n', left);
+    size_t n = nl ? (size_t)(nl - start) : left;
+
+    if (offset) *offset = (off_t)r->pos;
+    if (len) *len = n;
+    r->pos += nl ? n + 1 : n;
+    return start;
+}
+
+void line_reader_close(LineReader *r) {
+    if (!r) return;
+    if (r->data) munmap((void *)r->data, r->len);
+    r->data = NULL;
+    r->len = 0;
+    r->pos = 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * mapped_body.c - Spilled response bodies viewed through mmap
+ *
+ * The panel, search and history all read the same mapping; each holder
+ * takes a reference instead of copying the text.
+ */
+
+#include "core/utils/mapped_body.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+int mapped_body_tmpfile(void) {
+    const char *dir = getenv("TMPDIR");
+    if (!dir || !dir[0]) dir = "/tmp";
+
+    char path[4096];
+    int n = snprintf(path, sizeof(path), "%s/tcurl-body-XXXXXX", dir);
+    if (n < 0 || (size_t)n >= sizeof(path)) return -1;
+
+    int fd = mkstemp(path);
+    if (fd < 0) return -1;
+    (void)unlink(path);
+    return fd;
+}
+
+MappedBody *mapped_body_map(int fd, size_t len) {
+    if (fd < 0) return NULL;
+
+    MappedBody *m = calloc(1, sizeof(*m));
+    if (!m) return NULL;
+
+    void *p = mmap(NULL, len + 1, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+        free(m);
+        return NULL;
+    }
+
+    m->data = p;
+    m->len = len;
+    m->refs = 1;
+    return m;
+}
+
+MappedBody *mapped_body_adopt(char *data, size_t len) {
+    if (!data) return NULL;
+
+    MappedBody *m = calloc(1, sizeof(*m));
+    if (!m) return NULL;
+    m->data = data;
+    m->len = len;
+    m->refs = 1;
+    m->heap = 1;
+    return m;
+}
+
+MappedBody *mapped_body_ref(MappedBody *m) {
+    if (m) __atomic_add_fetch(&m->refs, 1, __ATOMIC_RELAXED);
+    return m;
+}
+
+void mapped_body_release(MappedBody *m) {
+    if (!m) return;
+    if (__atomic_sub_fetch(&m->refs, 1, __ATOMIC_ACQ_REL) != 0) return;
+
+    if (m->heap) free(m->data);
+    else (void)munmap(m->data, m->len + 1);
+    free(m);
+}
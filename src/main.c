@@ -1,15 +1,26 @@
 #include <locale.h>
 #include <ncurses.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
 #include <curl/curl.h>
 
 #include "state.h"
+#include "core/cli/batch.h"
 #include "core/config/keymap.h"
+#include "core/storage/history_loader.h"
+#include "core/storage/history_writer.h"
 #include "ui/panels/draw.h"
 #include "ui/input/input.h"
 
 void dispatch_action(AppState *s, Action a);
 
-int main(void) {
+int main(int argc, char **argv) {
+    /* Headless mode: no terminal, theme or history setup at all. */
+    if (argc > 1 && strcmp(argv[1], "run") == 0) {
+        return batch_main(argc - 1, argv + 1);
+    }
+
     setlocale(LC_ALL, "");
 
     AppState state;
@@ -27,18 +38,39 @@ int main(void) {
     noecho();
     keypad(stdscr, TRUE);
     curs_set(0);
-    timeout(100);
+    timeout(0);
     ui_draw_init_theme(&state);
 
     curl_global_init(CURL_GLOBAL_DEFAULT);
 
+    /* History fills in behind the UI, newest entries first, and is written
+       back by its own thread. */
+    (void)history_loader_start(&state);
+    (void)history_writer_start(&state);
+
+    /* Sleep until a key arrives or a worker publishes something; only while
+       a request is in flight does the loop also wake on a timer. */
     while (state.running) {
+        app_state_drain_wake(&state);
         ui_draw(&state);
 
-        int ch = getch();
-        if (ch == ERR) continue;
+        struct pollfd fds[2] = {
+            { .fd = STDIN_FILENO, .events = POLLIN },
+            { .fd = app_state_wake_fd(&state), .events = POLLIN },
+        };
+        int ready = poll(fds, fds[1].fd >= 0 ? 2 : 1, ui_draw_idle_timeout_ms(&state));
+
+        if (ready == 0) {
+            app_state_lock(&state);
+            state.ui.dirty |= UI_DIRTY_RESPONSE;
+            app_state_unlock(&state);
+        }
 
-        ui_handle_key(&state, &keymap, ch);
+        /* Also reached on EINTR, which is how a resize (KEY_RESIZE) shows up. */
+        int ch;
+        while (state.running && (ch = getch()) != ERR) {
+            ui_handle_key(&state, &keymap, ch);
+        }
     }
 
     endwin();
@@ -4,8 +4,11 @@
 #include "core/interaction/actions.h"
 #include "core/storage/history.h"
 #include "core/storage/history_persistence.h"
-#include <pthread.h>
 #include "core/http/request_thread.h"
+#include "core/http/request_slots.h"
+#include "core/http/http.h"
+#include "core/utils/mapped_body.h"
+#include "core/text/line_index.h"
 #include "orchestration/dispatch.h"
 #include "core/config/env.h"
 #include "core/config/layout.h"
@@ -14,6 +17,7 @@
 #include "core/interaction/auth.h"
 #include "core/utils/utils.h"
 #include "core/interaction/search.h"
+#include "core/interaction/fuzzy.h"
 #include "core/cli/command_handlers.h"
 #include "core/cli/help_builder.h"
 #include "core/cli/command_parser.h"
@@ -29,18 +33,14 @@
 #define KEY_SENTER 548
 #endif
 
-static void start_request_if_possible(AppState *s) {
-    if (s->response.is_request_in_flight) return;
-
-    s->response.is_request_in_flight = 1;
-    pthread_t t;
-    pthread_create(&t, NULL, request_thread, s);
-    pthread_detach(t);  /* Safe: is_request_in_flight prevents races; state_free() waits */
-}
-
-static int load_history_item_into_state(AppState *s, const HistoryItem *it) {
+static int load_history_item_into_state(AppState *s, HistoryItem *it) {
     if (!s || !it) return 0;
 
+    /* Entries loaded at startup keep their bodies on disk until now. */
+    if (!it->paged_in && s->history.history) {
+        (void)history_storage_page_in(s->history.history, it);
+    }
+
     s->editor.method = it->method;
 
     strncpy(s->editor.url, it->url ? it->url : "", sizeof(s->editor.url) - 1);
@@ -51,19 +51,25 @@ static int load_history_item_into_state(AppState *s, const HistoryItem *it) {
     tb_set_from_string(&s->editor.body, it->body);
     tb_set_from_string(&s->editor.headers, it->headers);
 
-    free(s->response.response.body);
-    free(s->response.response.body_view);
-    free(s->response.response.response_headers);
-    free(s->response.response.error);
+    request_slots_detach_view(&s->response);
+    http_response_free(&s->response.response);
 
     s->response.response.status = it->status;
     s->response.response.elapsed_ms = it->elapsed_ms;
     s->response.response.timing = it->timing;
     s->response.response.is_json = it->is_json;
-    s->response.response.body = it->response_body ? strdup(it->response_body) : NULL;
-    s->response.response.body_view = it->response_body_view ? strdup(it->response_body_view) : NULL;
+    if (it->response_map) {
+        s->response.response.body_map = mapped_body_ref(it->response_map);
+        s->response.response.body = it->response_body;
+        s->response.response.body_view = it->response_body;
+    } else {
+        const char *view = s->history.history ? history_item_view(s->history.history, it) : it->response_body;
+        s->response.response.body = it->response_body ? strdup(it->response_body) : NULL;
+        s->response.response.body_view = view ? strdup(view) : NULL;
+    }
     s->response.response.response_headers = it->response_headers ? strdup(it->response_headers) : NULL;
     s->response.response.error = NULL;
+    (void)http_response_index_view(&s->response.response);
     s->response.scroll = 0;
     s->editor.body_scroll = 0;
     s->editor.headers_scroll = 0;
@@ -98,6 +104,10 @@ void dispatch_action(AppState *s, Action a) {
             clear_prompt(s);
             break;
         case ACT_ENTER_NORMAL:
+            if (s->ui.mode == MODE_SEARCH) {
+                fuzzy_finder_cancel(s);
+                search_cancel(s);
+            }
             s->ui.mode = MODE_NORMAL;
             clear_prompt(s);
             break;
@@ -111,6 +121,7 @@ void dispatch_action(AppState *s, Action a) {
             begin_prompt(s, PROMPT_SEARCH);
             s->search.not_found = 0;
             s->search.target = search_get_effective_target(s);
+            fuzzy_finder_begin(s);
             break;
 
         case ACT_FOCUS_LEFT:
@@ -127,7 +138,11 @@ void dispatch_action(AppState *s, Action a) {
                     s->history.selected++;
                 }
             }else if (s->ui.focused_panel == PANEL_RESPONSE) {
-               s->response.scroll++;
+               const LineIndex *lines = s->response.response.view_lines;
+               /* Stop at the last line of an indexed body; other views are not clamped */
+               if (s->response.show_headers || !lines || s->response.scroll < lines->count - 1) {
+                   s->response.scroll++;
+               }
             }
             break;
 
@@ -148,7 +163,7 @@ void dispatch_action(AppState *s, Action a) {
             break;
 
         case ACT_SEND_REQUEST:
-            start_request_if_possible(s);
+            (void)request_start(s);
             break;
 
         case ACT_CYCLE_METHOD:
@@ -200,16 +215,31 @@ void dispatch_action(AppState *s, Action a) {
         case ACT_HISTORY_REPLAY: {
             if (s->ui.focused_panel != PANEL_HISTORY) break;
             if (!s->history.history) break;
-            if (s->response.is_request_in_flight) break;
 
             HistoryItem *it = history_get(s->history.history, s->history.selected);
             if (!it) break;
             if (!load_history_item_into_state(s, it)) break;
 
-            start_request_if_possible(s);
+            (void)request_start(s);
             break;
         }
 
+        case ACT_NEXT_RESPONSE:
+            if (s->ui.mode == MODE_NORMAL) {
+                (void)request_slots_cycle(&s->response, +1);
+            }
+            break;
+
+        case ACT_PREV_RESPONSE:
+            if (s->ui.mode == MODE_NORMAL) {
+                (void)request_slots_cycle(&s->response, -1);
+            }
+            break;
+
+        case ACT_CANCEL_REQUEST:
+            (void)request_cancel(s);
+            break;
+
         default:
             break;
     }
@@ -1,13 +1,21 @@
 #include "state.h"
+#include <fcntl.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include "core/storage/history.h"
 #include "core/storage/history_persistence.h"
+#include "core/storage/history_loader.h"
+#include "core/storage/history_writer.h"
 #include "core/config/env.h"
 #include "core/config/layout.h"
 #include "core/storage/paths.h"
 #include "core/text/textbuf.h"
-#include <unistd.h>
+#include "core/http/http_engine.h"
+#include "core/http/request_slots.h"
+#include "core/http/request_thread.h"
+#include "core/interaction/fuzzy.h"
+#include "core/interaction/search.h"
 
 void app_state_lock(AppState *s) {
     if (!s) return;
@@ -19,9 +27,45 @@ void app_state_unlock(AppState *s) {
     (void)pthread_mutex_unlock(&s->state_mu);
 }
 
+void app_state_mark_dirty(AppState *s, unsigned regions) {
+    if (!s) return;
+    s->ui.dirty |= regions;
+
+    /* fd 0 is stdin, never our pipe: a zeroed state simply has no wake-up. */
+    if (s->wake_fds[1] > 0) {
+        char b = 1;
+        ssize_t n = write(s->wake_fds[1], &b, 1); /* A full pipe already wakes the loop */
+        (void)n;
+    }
+}
+
+int app_state_wake_fd(const AppState *s) {
+    if (!s || s->wake_fds[0] <= 0) return -1;
+    return s->wake_fds[0];
+}
+
+void app_state_drain_wake(AppState *s) {
+    if (!s || s->wake_fds[0] <= 0) return;
+    char buf[64];
+    while (read(s->wake_fds[0], buf, sizeof(buf)) > 0) {
+    }
+}
+
+static void wake_pipe_open(AppState *s) {
+    int fds[2];
+    if (pipe(fds) != 0) return;
+    for (int i = 0; i < 2; i++) {
+        (void)fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+        (void)fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+    }
+    s->wake_fds[0] = fds[0];
+    s->wake_fds[1] = fds[1];
+}
+
 void app_state_init(AppState *s) {
     memset(s, 0, sizeof(*s));
     (void)pthread_mutex_init(&s->state_mu, NULL);
+    wake_pipe_open(s);
 
     /* Initialize Config State */
     paths_init(&s->config.paths);
@@ -33,6 +77,7 @@ void app_state_init(AppState *s) {
     s->running = 1;
 
     /* Initialize UI State */
+    s->ui.dirty = UI_DIRTY_ALL;
     s->ui.mode = MODE_NORMAL;
     s->ui.focused_panel = PANEL_HISTORY;
     s->ui.layout_profile = LAYOUT_PROFILE_CLASSIC;
@@ -76,6 +121,8 @@ void app_state_init(AppState *s) {
     tb_init(&s->editor.headers);
     s->editor.active_field = EDIT_FIELD_URL;
     s->editor.method = HTTP_GET;
+    s->editor.timeout_ms = 0;
+    s->editor.connect_timeout_ms = 0;
     s->editor.body_scroll = 0;
     s->editor.headers_scroll = 0;
 
@@ -83,17 +130,27 @@ void app_state_init(AppState *s) {
     s->response.response.status = 0;
     s->response.response.body = NULL;
     s->response.response.body_view = NULL;
+    s->response.response.view_map = NULL;
+    s->response.response.view_lines = NULL;
     s->response.response.elapsed_ms = 0.0;
     s->response.response.error = NULL;
     s->response.response.is_json = 0;
-    s->response.is_request_in_flight = 0;
+    s->response.engine = NULL;
+    s->response.max_body_mb = 0;
+    s->response.spill_mb = HTTP_SPILL_MB_DEFAULT;
+    s->response.timeout_ms = HTTP_TIMEOUT_MS_DEFAULT;
+    s->response.connect_timeout_ms = HTTP_CONNECT_TIMEOUT_MS_DEFAULT;
+    request_slots_init(&s->response);
     s->response.scroll = 0;
 
     /* Initialize History State */
-    s->history.max_entries = history_config_load_max_entries(
+    HistoryConfig history_conf;
+    history_config_load(
         s->config.paths.history_conf ? s->config.paths.history_conf : "config/history.conf",
-        500
+        &history_conf
     );
+    s->history.max_entries = history_conf.max_entries;
+    history_storage_set_compression(history_conf.compress_level, history_conf.compress_min_bytes);
     s->history.path = history_storage_default_path();
     if (!s->history.path) {
         s->history.path = strdup("./history.jsonl");
@@ -102,15 +159,15 @@ void app_state_init(AppState *s) {
     s->history.loaded_ok = 0;
     s->history.skipped_invalid = 0;
     s->history.last_save_error = 0;
+    s->history.loading = 0;
+    s->history.loader = NULL;
+    s->history.writer = NULL;
     s->history.history = malloc(sizeof(*s->history.history));
     if (s->history.history) {
-        HistoryLoadStats hs = {0};
         history_init(s->history.history);
-        (void)history_storage_load_with_stats(s->history.history, s->history.path, &hs);
-        s->history.loaded_ok = hs.loaded_ok;
-        s->history.skipped_invalid = hs.skipped_invalid;
-        history_trim_oldest(s->history.history, s->history.max_entries);
+        history_set_limit(s->history.history, s->history.max_entries);
     }
+    s->history.fulltext = history_conf.fulltext_index;
     s->history.selected = 0;
 
     /* Initialize Config State - Environments and Suggestions */
@@ -147,17 +204,18 @@ void app_state_init(AppState *s) {
     s->search.target_override = -1;
     s->search.match_index = -1;
     s->search.not_found = 0;
+    memset(&s->search.matches, 0, sizeof(s->search.matches));
+    memset(&s->search.fuzzy, 0, sizeof(s->search.fuzzy));
 }
 
 void app_state_destroy(AppState *s) {
-    /* Wait for any in-flight requests to complete */
-    for (;;) {
-        app_state_lock(s);
-        int inflight = s->response.is_request_in_flight;
-        app_state_unlock(s);
-        if (!inflight) break;
-        usleep(1000);
-    }
+    /* Stop the I/O thread first; in-flight requests are dropped unpublished. */
+    http_engine_destroy(s->response.engine);
+    s->response.engine = NULL;
+    request_thread_stop(s);
+
+    /* The search worker publishes into the state as well. */
+    search_state_free(s);
 
     /* Destroy Editor State */
     tb_free(&s->editor.body);
@@ -166,13 +224,13 @@ void app_state_destroy(AppState *s) {
     s->editor.headers_scroll = 0;
 
     /* Destroy Response State */
-    free(s->response.response.body);
-    free(s->response.response.body_view);
-    free(s->response.response.response_headers);
-    free(s->response.response.error);
+    request_slots_free(&s->response);
 
     /* Destroy History State */
+    history_loader_stop(s);
+    history_writer_stop(s);
     if (s->history.history) {
+        (void)history_storage_save_fulltext(s->history.history, s->history.path);
         history_free(s->history.history);
         free(s->history.history);
         s->history.history = NULL;
@@ -207,6 +265,12 @@ void app_state_destroy(AppState *s) {
     s->search.target_override = -1;
     s->search.match_index = -1;
     s->search.not_found = 0;
+    fuzzy_finder_free(&s->search.fuzzy);
+
+    if (s->wake_fds[0] > 0) close(s->wake_fds[0]);
+    if (s->wake_fds[1] > 0) close(s->wake_fds[1]);
+    s->wake_fds[0] = 0;
+    s->wake_fds[1] = 0;
 
     (void)pthread_mutex_destroy(&s->state_mu);
 }
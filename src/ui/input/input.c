@@ -7,6 +7,7 @@
 #include "core/interaction/actions.h"
 #include "orchestration/dispatch.h"
 #include "core/interaction/search.h"
+#include "core/interaction/fuzzy.h"
 
 #define CTRL(x) ((x) & 0x1f)
 
@@ -392,9 +393,20 @@ static void handle_command_mode_key(AppState *s, Keymap *km, int ch) {
     prompt_insert_char(s, ch);
 }
 
+/* History searches rank entries as the query is typed, and regex queries
+   on the response are matched ahead; either way the scan for the previous
+   query is cancelled. */
+static void search_query_changed(AppState *s) {
+    const char *query = s->prompt.input;
+    int regex = search_is_regex(query);
+    if (s->search.target == SEARCH_TARGET_HISTORY) fuzzy_finder_update(s, regex ? "" : query);
+    search_preview(s, query);
+}
+
 static void handle_search_mode_key(AppState *s, int ch) {
     if (ch == KEY_BACKSPACE || ch == 127 || ch == 8) {
         prompt_backspace(s);
+        search_query_changed(s);
         return;
     }
 
@@ -404,6 +416,7 @@ static void handle_search_mode_key(AppState *s, int ch) {
                     &s->prompt.input[s->prompt.cursor + 1],
                     (size_t)(s->prompt.len - s->prompt.cursor));
             s->prompt.len--;
+            search_query_changed(s);
         }
         return;
     }
@@ -420,8 +433,19 @@ static void handle_search_mode_key(AppState *s, int ch) {
         return;
     }
 
+    /* Walk the ranked entries, best first */
+    if (ch == KEY_UP || ch == CTRL('p')) { fuzzy_finder_move(s, -1); return; }
+    if (ch == KEY_DOWN || ch == CTRL('n')) { fuzzy_finder_move(s, +1); return; }
+
     if (ch == '\n' || ch == '\r' || ch == KEY_ENTER) {
+        int picked = fuzzy_finder_accept(s);
         search_apply(s, s->prompt.input);
+        /* The ranked pick wins over the first substring match */
+        if (picked >= 0) {
+            s->history.selected = picked;
+            s->search.match_index = picked;
+            s->search.not_found = 0;
+        }
         s->ui.mode = MODE_NORMAL;
         s->prompt.kind = PROMPT_NONE;
         s->prompt.input[0] = '\0';
@@ -430,35 +454,39 @@ static void handle_search_mode_key(AppState *s, int ch) {
         return;
     }
 
+    int len_before = s->prompt.len;
     prompt_insert_char(s, ch);
+    if (s->prompt.len != len_before) search_query_changed(s);
 }
 
 void ui_handle_key(AppState *state, Keymap *keymap, int ch) {
     app_state_lock(state);
 
+    Mode mode_before = state->ui.mode;
     Action a = keymap_resolve(keymap, state->ui.mode, ch);
 
-    if (a != ACT_NONE) {
+    /* Actions, resizes and mode switches may touch any region; text entry
+       only repaints the field being edited. */
+    if (ch == KEY_RESIZE) {
+        app_state_mark_dirty(state, UI_DIRTY_ALL);
+    } else if (a != ACT_NONE) {
         dispatch_action(state, a);
-        app_state_unlock(state);
-        return;
-    }
-
-    if (state->ui.mode == MODE_INSERT) {
+        app_state_mark_dirty(state, UI_DIRTY_ALL);
+    } else if (state->ui.mode == MODE_INSERT) {
         editor_handle_insert_key(state, ch);
-        app_state_unlock(state);
-        return;
-    }
-
-    if (state->ui.mode == MODE_COMMAND) {
-        handle_command_mode_key(state, keymap, ch);
-        app_state_unlock(state);
-        return;
-    }
-
-    if (state->ui.mode == MODE_SEARCH) {
-        handle_search_mode_key(state, ch);
+        app_state_mark_dirty(state, UI_DIRTY_EDITOR);
+    } else if (state->ui.mode == MODE_COMMAND || state->ui.mode == MODE_SEARCH) {
+        int submit = (ch == '\n' || ch == '\r' || ch == KEY_ENTER);
+        int dirty = submit ? UI_DIRTY_ALL : UI_DIRTY_FOOTER;
+        if (state->ui.mode == MODE_COMMAND) {
+            handle_command_mode_key(state, keymap, ch);
+        } else {
+            handle_search_mode_key(state, ch);
+            if (state->search.target == SEARCH_TARGET_HISTORY) dirty |= UI_DIRTY_HISTORY;
+        }
+        app_state_mark_dirty(state, dirty);
     }
 
+    if (state->ui.mode != mode_before) app_state_mark_dirty(state, UI_DIRTY_ALL);
     app_state_unlock(state);
 }
@@ -7,10 +7,17 @@
 #include "core/storage/history.h"
 #include "core/text/i18n.h"
 #include "core/config/constants.h"
+#include "core/http/http_engine.h"
+#include "core/http/request_slots.h"
+#include "core/utils/mapped_body.h"
+#include "core/text/line_index.h"
+#include "core/interaction/search.h"
+#include "core/interaction/fuzzy.h"
 
 #include <ncurses.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 enum {
     PAIR_FOCUS = 1,
@@ -280,20 +287,29 @@ static void draw_history_content(WINDOW *w, const AppState *state) {
         return;
     }
 
+    /* While a fuzzy search is typed, show only the matches, best first */
+    const FuzzyFinder *fz = &state->search.fuzzy;
+    int ranked = state->ui.mode == MODE_SEARCH && fz->active;
+    int count = state->history.history->count;
+    int rows = ranked ? fz->count : count;
+    int cursor = ranked ? fz->cursor : state->history.selected;
+
     int start = 0;
-    if (state->history.selected >= visible) {
-        start = state->history.selected - visible + 1;
+    if (cursor >= visible) {
+        start = cursor - visible + 1;
     }
-    if (start > state->history.history->count - visible) {
-        start = state->history.history->count - visible;
+    if (start > rows - visible) {
+        start = rows - visible;
     }
     if (start < 0) start = 0;
 
     for (int i = 0; i < visible; i++) {
-        int idx = start + i;
-        if (idx >= state->history.history->count) break;
+        int row = start + i;
+        if (row >= rows) break;
+        int idx = ranked ? fuzzy_finder_entry(state, row) : row;
+        if (idx < 0 || idx >= count) continue;
 
-        const HistoryItem *it = &state->history.history->items[idx];
+        const HistoryItem *it = history_get(state->history.history, idx);
 
         if (idx == state->history.selected) {
             if (g_theme_colors) wattron(w, COLOR_PAIR(PAIR_TAB_ACTIVE));
@@ -321,16 +337,88 @@ static void draw_history_content(WINDOW *w, const AppState *state) {
     wnoutrefresh(w);
 }
 
-static void draw_response_content(WINDOW *w, const AppState *state) {
+/* `lines` indexes `text` when available; otherwise the text is scanned up to `scroll`. */
+static void draw_text_lines(WINDOW *w, const char *text, const LineIndex *lines, int scroll, int row, int h, int wd) {
+    int clip = wd - 4;
+    if (clip < 0) clip = 0;
+
+    if (lines) {
+        for (int n = scroll; row < h - 1; n++, row++) {
+            size_t len = 0;
+            const char *line = line_index_line(lines, text, n, &len);
+            if (!line) break;
+            mvwaddnstr(w, row, 2, line, len > (size_t)clip ? clip : (int)len);
+        }
+        return;
+    }
+
+    const char *p = skip_lines(text, scroll);
+    while (*p && row < h - 1) {
+        const char *nl = strchr(p, '\n');
+        if (!nl) {
+            mvwaddnstr(w, row, 2, p, clip);
+            break;
+        }
+
+        int len = (int)(nl - p);
+        if (len > clip) len = clip;
+
+        mvwaddnstr(w, row, 2, p, len);
+        p = nl + 1;
+        row++;
+    }
+}
+
+/* Body bytes of the viewed request shown as they arrive */
+static void draw_streaming_response(WINDOW *w, const AppState *state, const RequestSlot *slot) {
     int h, wd;
     getmaxyx(w, h, wd);
 
-    if (state->response.is_request_in_flight) {
+    HttpProgress progress;
+    int have_progress = http_engine_progress(state->response.engine, slot->id, &progress) == 0;
+
+    if (!slot->stream || slot->stream_len == 0) {
         mvwaddnstr(w, 1, 2, i18n_get(state->ui.language, I18N_SENDING_REQUEST), wd - 4);
         wnoutrefresh(w);
         return;
     }
 
+    char size[64];
+    if (have_progress && progress.bytes_expected > 0) {
+        snprintf(size, sizeof(size), "%.1f/%.1f KB",
+                 slot->received / 1024.0, progress.bytes_expected / 1024.0);
+    } else {
+        snprintf(size, sizeof(size), "%.1f KB", slot->received / 1024.0);
+    }
+
+    char meta[UI_META_MAX];
+    snprintf(meta, sizeof(meta), i18n_get(state->ui.language, I18N_RECEIVING_META_FMT),
+             size, slot->rate_bps / 1024.0, state->response.scroll);
+    mvwaddnstr(w, 1, 2, meta, wd - 4);
+    mvwhline(w, 2, 1, ACS_HLINE, wd - 2);
+
+    /* The rest of a large body shows once it has arrived */
+    int cut = slot->received > slot->stream_len;
+    if (3 < h - 1) draw_text_lines(w, slot->stream, NULL, state->response.scroll, 3, cut ? h - 1 : h, wd);
+    if (cut && 3 < h - 2) {
+        char note[UI_META_MAX];
+        snprintf(note, sizeof(note), i18n_get(state->ui.language, I18N_STREAM_PREVIEW_FMT),
+                 slot->stream_len / 1024.0);
+        mvwaddnstr(w, h - 2, 2, note, wd - 4);
+    }
+    wnoutrefresh(w);
+}
+
+static void draw_response_content(WINDOW *w, const AppState *state) {
+    int h, wd;
+    getmaxyx(w, h, wd);
+
+    const RequestSlot *viewed = request_slots_viewed(&state->response);
+    if (viewed && viewed->state == REQUEST_SLOT_IN_FLIGHT) {
+        draw_streaming_response(w, state, viewed);
+        return;
+    }
+
     if (state->response.response.error) {
         if (g_theme_colors) wattron(w, COLOR_PAIR(PAIR_ERROR) | A_BOLD);
         else wattron(w, A_BOLD);
@@ -349,7 +437,10 @@ static void draw_response_content(WINDOW *w, const AppState *state) {
         return;
     }
 
-    size_t bytes = strlen(state->response.response.body_view);
+    const HttpResponse *resp = &state->response.response;
+    size_t bytes = (resp->body_map && resp->body_view == resp->body)
+        ? resp->body_map->len
+        : strlen(resp->body_view);
 
     char meta[512];
     const HttpTiming *t = &state->response.response.timing;
@@ -359,13 +450,14 @@ static void draw_response_content(WINDOW *w, const AppState *state) {
         snprintf(
             meta,
             sizeof(meta),
-            "Status: %ld | DNS:%.0fms TCP:%.0fms TLS:%.0fms TTFB:%.0fms Total:%.0fms | %.1f KB%s | scroll:%d",
+            "Status: %ld | DNS:%.0fms TCP:%.0fms TLS:%.0fms TTFB:%.0fms Total:%.0fms | conn:%s | %.1f KB%s | scroll:%d",
             state->response.response.status,
             t->dns_ms,
             t->tcp_ms,
             t->tls_ms,
             t->ttfb_ms,
             t->total_ms,
+            t->connection_reused ? "reused" : "new",
             bytes / 1024.0,
             state->response.response.is_json ? i18n_get(state->ui.language, I18N_RESPONSE_META_JSON) : "",
             state->response.scroll
@@ -374,12 +466,13 @@ static void draw_response_content(WINDOW *w, const AppState *state) {
         snprintf(
             meta,
             sizeof(meta),
-            "Status: %ld | DNS:%.0fms TCP:%.0fms TTFB:%.0fms Total:%.0fms | %.1f KB%s | scroll:%d",
+            "Status: %ld | DNS:%.0fms TCP:%.0fms TTFB:%.0fms Total:%.0fms | conn:%s | %.1f KB%s | scroll:%d",
             state->response.response.status,
             t->dns_ms,
             t->tcp_ms,
             t->ttfb_ms,
             t->total_ms,
+            t->connection_reused ? "reused" : "new",
             bytes / 1024.0,
             state->response.response.is_json ? i18n_get(state->ui.language, I18N_RESPONSE_META_JSON) : "",
             state->response.scroll
@@ -399,30 +492,11 @@ static void draw_response_content(WINDOW *w, const AppState *state) {
     const char *content = state->response.show_headers 
         ? state->response.response.response_headers 
         : state->response.response.body_view;
+    const LineIndex *lines = state->response.show_headers ? NULL : state->response.response.view_lines;
     
     if (!content) content = state->response.show_headers ? "(no headers)" : "(no body)";
 
-    const char *p = skip_lines(content, state->response.scroll);
-
-    int row = body_start;
-    int clip = wd - 4;
-    if (clip < 0) clip = 0;
-
-    while (*p && row < h - 1) {
-        const char *nl = strchr(p, '\n');
-        if (!nl) {
-            mvwaddnstr(w, row, 2, p, clip);
-            break;
-        }
-
-        int len = (int)(nl - p);
-        if (len > clip) len = clip;
-
-        mvwaddnstr(w, row, 2, p, len);
-        p = nl + 1;
-        row++;
-    }
-
+    draw_text_lines(w, content, lines, state->response.scroll, body_start, h, wd);
     wnoutrefresh(w);
 }
 
@@ -758,70 +832,7 @@ static void draw_editor_content(WINDOW *w, AppState *state) {
     wnoutrefresh(w);
 }
 
-void ui_draw(AppState *state) {
-    static WINDOW *w_history = NULL;
-    static WINDOW *w_editor = NULL;
-    static WINDOW *w_response = NULL;
-
-    static int last_rows = -1;
-    static int last_cols = -1;
-    static LayoutProfile last_profile = -1;
-    static LayoutSlot last_h_slot = -1;
-    static LayoutSlot last_e_slot = -1;
-    static LayoutSlot last_r_slot = -1;
-
-    int rows, cols;
-    getmaxyx(stdscr, rows, cols);
-    app_state_lock(state);
-    g_editor_cursor_abs_y = -1;
-    g_editor_cursor_abs_x = -1;
-
-    int layout_changed =
-        rows != last_rows ||
-        cols != last_cols ||
-        state->ui.layout_profile != last_profile ||
-        state->ui.quad_history_slot != last_h_slot ||
-        state->ui.quad_editor_slot != last_e_slot ||
-        state->ui.quad_response_slot != last_r_slot;
-
-    if (layout_changed) {
-        if (w_history) {
-            delwin(w_history);
-            w_history = NULL;
-        }
-        if (w_editor) {
-            delwin(w_editor);
-            w_editor = NULL;
-        }
-        if (w_response) {
-            delwin(w_response);
-            w_response = NULL;
-        }
-
-        last_rows = rows;
-        last_cols = cols;
-        last_profile = state->ui.layout_profile;
-        last_h_slot = state->ui.quad_history_slot;
-        last_e_slot = state->ui.quad_editor_slot;
-        last_r_slot = state->ui.quad_response_slot;
-
-        Rect rh = {0};
-        Rect re = {0};
-        Rect rr = {0};
-        if (build_panel_rects(state, rows, cols, &rh, &re, &rr)) {
-            w_history = newwin(rh.h, rh.w, rh.y, rh.x);
-            w_editor = newwin(re.h, re.w, re.y, re.x);
-            w_response = newwin(rr.h, rr.w, rr.y, rr.x);
-
-            if (w_history) leaveok(w_history, TRUE);
-            if (w_editor) leaveok(w_editor, FALSE);
-            if (w_response) leaveok(w_response, TRUE);
-        }
-    }
-
-    erase();
-    box(stdscr, 0, 0);
-
+static void draw_top_bar(const AppState *state, int cols) {
     char top[256];
     snprintf(
         top,
@@ -835,10 +846,42 @@ void ui_draw(AppState *state) {
     mvaddnstr(0, 2, top, cols - 4);
     if (g_theme_colors) attroff(COLOR_PAIR(PAIR_FOCUS) | A_BOLD);
     else attroff(A_BOLD);
+}
+
+/* Status line, or the command/search prompt, on the bottom border */
+static void draw_footer(const AppState *state, int rows, int cols) {
+    mvhline(rows - 1, 1, ACS_HLINE, cols - 2);
 
     if (state->ui.mode == MODE_COMMAND || state->ui.mode == MODE_SEARCH) {
         char prefix = (state->ui.mode == MODE_COMMAND) ? ':' : '/';
         int prompt_space = cols - 4;
+
+        /* Regex queries are matched as they are typed; say how it went */
+        if (state->ui.mode == MODE_SEARCH) {
+            char tag[64] = "";
+            int total = 0;
+            switch (search_status(state, state->prompt.input, NULL, &total)) {
+                case SEARCH_BUSY:
+                    snprintf(tag, sizeof(tag), "%s", i18n_get(state->ui.language, I18N_SEARCH_BUSY));
+                    break;
+                case SEARCH_BAD_PATTERN:
+                    snprintf(tag, sizeof(tag), "%s", i18n_get(state->ui.language, I18N_SEARCH_BAD_PATTERN));
+                    break;
+                case SEARCH_READY:
+                    snprintf(tag, sizeof(tag), i18n_get(state->ui.language, I18N_SEARCH_COUNT_FMT), total);
+                    break;
+                default:
+                    break;
+            }
+            int tag_len = (int)strlen(tag);
+            if (tag_len > 0 && prompt_space - tag_len > 12) {
+                attron(A_DIM);
+                mvaddnstr(rows - 1, cols - 2 - tag_len, tag, tag_len);
+                attroff(A_DIM);
+                prompt_space -= tag_len + 1;
+            }
+        }
+
         int prefix_len = 2;  // " :" or " /"
         int text_space = prompt_space - prefix_len;
         
@@ -878,7 +921,33 @@ void ui_draw(AppState *state) {
         int status_x = 2;
         int status_limit_x = cols - 2;
 
-        if (state->search.not_found && state->search.query[0] != '\0') {
+        int match_pos = 0;
+        int match_total = 0;
+        SearchStatus search = search_status(state, state->search.query, &match_pos, &match_total);
+
+        if (search == SEARCH_BAD_PATTERN) {
+            snprintf(
+                status,
+                sizeof(status),
+                i18n_get(state->ui.language, I18N_STATUS_BAD_PATTERN_FMT),
+                mode_label(state->ui.mode, state->ui.language),
+                panel_label(state->ui.focused_panel, state->ui.language),
+                env_name ? env_name : i18n_get(state->ui.language, I18N_ENV_NONE),
+                state->search.regex_error,
+                state->search.query
+            );
+            status_warn = 1;
+        } else if (search == SEARCH_BUSY) {
+            snprintf(
+                status,
+                sizeof(status),
+                i18n_get(state->ui.language, I18N_STATUS_SEARCHING_FMT),
+                mode_label(state->ui.mode, state->ui.language),
+                panel_label(state->ui.focused_panel, state->ui.language),
+                env_name ? env_name : i18n_get(state->ui.language, I18N_ENV_NONE),
+                state->search.query
+            );
+        } else if (state->search.not_found && state->search.query[0] != '\0') {
             snprintf(
                 status,
                 sizeof(status),
@@ -891,6 +960,31 @@ void ui_draw(AppState *state) {
                 state->search.query
             );
             status_warn = 1;
+        } else if (search == SEARCH_READY && match_pos > 0) {
+            snprintf(
+                status,
+                sizeof(status),
+                i18n_get(state->ui.language, I18N_STATUS_MATCH_FMT),
+                mode_label(state->ui.mode, state->ui.language),
+                panel_label(state->ui.focused_panel, state->ui.language),
+                env_name ? env_name : i18n_get(state->ui.language, I18N_ENV_NONE),
+                state->history.selected,
+                state->history.skipped_invalid,
+                match_pos,
+                match_total,
+                state->search.query
+            );
+        } else if (state->history.loading) {
+            snprintf(
+                status,
+                sizeof(status),
+                i18n_get(state->ui.language, I18N_STATUS_LOADING_FMT),
+                mode_label(state->ui.mode, state->ui.language),
+                panel_label(state->ui.focused_panel, state->ui.language),
+                env_name ? env_name : i18n_get(state->ui.language, I18N_ENV_NONE),
+                state->history.loaded_ok,
+                state->history.skipped_invalid
+            );
         } else {
             snprintf(
                 status,
@@ -929,30 +1023,139 @@ void ui_draw(AppState *state) {
             if (status_warn && g_theme_colors) attroff(COLOR_PAIR(PAIR_WARN) | A_BOLD);
         }
     }
+}
 
-    wnoutrefresh(stdscr);
+static double monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1e6;
+}
+
+int ui_draw_idle_timeout_ms(AppState *state) {
+    app_state_lock(state);
+    int streaming = state->response.requests_in_flight > 0;
+    app_state_unlock(state);
+    return streaming ? UI_STREAM_REDRAW_MS : -1;
+}
+
+void ui_draw(AppState *state) {
+    static WINDOW *w_history = NULL;
+    static WINDOW *w_editor = NULL;
+    static WINDOW *w_response = NULL;
+
+    static int last_rows = -1;
+    static int last_cols = -1;
+    static LayoutProfile last_profile = -1;
+    static LayoutSlot last_h_slot = -1;
+    static LayoutSlot last_e_slot = -1;
+    static LayoutSlot last_r_slot = -1;
+
+    int rows, cols;
+    getmaxyx(stdscr, rows, cols);
+    app_state_lock(state);
+    unsigned dirty = state->ui.dirty;
+    state->ui.dirty = 0;
+    if (request_slots_pump(&state->response, monotonic_ms())) dirty |= UI_DIRTY_RESPONSE;
+
+    int layout_changed =
+        rows != last_rows ||
+        cols != last_cols ||
+        state->ui.layout_profile != last_profile ||
+        state->ui.quad_history_slot != last_h_slot ||
+        state->ui.quad_editor_slot != last_e_slot ||
+        state->ui.quad_response_slot != last_r_slot;
+
+    if (layout_changed) {
+        if (w_history) {
+            delwin(w_history);
+            w_history = NULL;
+        }
+        if (w_editor) {
+            delwin(w_editor);
+            w_editor = NULL;
+        }
+        if (w_response) {
+            delwin(w_response);
+            w_response = NULL;
+        }
+
+        last_rows = rows;
+        last_cols = cols;
+        last_profile = state->ui.layout_profile;
+        last_h_slot = state->ui.quad_history_slot;
+        last_e_slot = state->ui.quad_editor_slot;
+        last_r_slot = state->ui.quad_response_slot;
+        dirty = UI_DIRTY_ALL;
+
+        Rect rh = {0};
+        Rect re = {0};
+        Rect rr = {0};
+        if (build_panel_rects(state, rows, cols, &rh, &re, &rr)) {
+            w_history = newwin(rh.h, rh.w, rh.y, rh.x);
+            w_editor = newwin(re.h, re.w, re.y, re.x);
+            w_response = newwin(rr.h, rr.w, rr.y, rr.x);
+
+            if (w_history) leaveok(w_history, TRUE);
+            if (w_editor) leaveok(w_editor, FALSE);
+            if (w_response) leaveok(w_response, TRUE);
+        }
+    }
+
+    if (!dirty) {
+        app_state_unlock(state);
+        return;
+    }
+
+    if (dirty & UI_DIRTY_CHROME) {
+        /* Clearing stdscr blanks what lies under the panels too. */
+        dirty = UI_DIRTY_ALL;
+        erase();
+        box(stdscr, 0, 0);
+        draw_top_bar(state, cols);
+    }
+    if (dirty & UI_DIRTY_FOOTER) draw_footer(state, rows, cols);
+    if (dirty & (UI_DIRTY_CHROME | UI_DIRTY_FOOTER)) wnoutrefresh(stdscr);
 
     if (w_history && w_editor && w_response) {
-        draw_boxed_window(w_history, i18n_get(state->ui.language, I18N_WIN_HISTORY), state->ui.focused_panel == PANEL_HISTORY);
-        draw_history_content(w_history, state);
-
-        draw_boxed_window(
-            w_editor,
-            state->ui.layout_profile == LAYOUT_PROFILE_FOCUS_EDITOR
-                ? i18n_get(state->ui.language, I18N_WIN_EDITOR_TABS)
-                : (state->editor.active_field == EDIT_FIELD_URL
-                       ? i18n_get(state->ui.language, I18N_WIN_EDITOR_URL)
-                       : (state->editor.active_field == EDIT_FIELD_BODY
-                              ? i18n_get(state->ui.language, I18N_WIN_EDITOR_BODY)
-                              : i18n_get(state->ui.language, I18N_WIN_EDITOR_HEADERS))),
-            state->ui.focused_panel == PANEL_EDITOR
-        );
-        draw_editor_content(w_editor, state);
+        if (dirty & UI_DIRTY_HISTORY) {
+            draw_boxed_window(w_history, i18n_get(state->ui.language, I18N_WIN_HISTORY), state->ui.focused_panel == PANEL_HISTORY);
+            draw_history_content(w_history, state);
+        }
 
-        draw_boxed_window(w_response, i18n_get(state->ui.language, I18N_WIN_RESPONSE), state->ui.focused_panel == PANEL_RESPONSE);
-        draw_response_content(w_response, state);
+        if (dirty & UI_DIRTY_EDITOR) {
+            g_editor_cursor_abs_y = -1;
+            g_editor_cursor_abs_x = -1;
+            draw_boxed_window(
+                w_editor,
+                state->ui.layout_profile == LAYOUT_PROFILE_FOCUS_EDITOR
+                    ? i18n_get(state->ui.language, I18N_WIN_EDITOR_TABS)
+                    : (state->editor.active_field == EDIT_FIELD_URL
+                           ? i18n_get(state->ui.language, I18N_WIN_EDITOR_URL)
+                           : (state->editor.active_field == EDIT_FIELD_BODY
+                                  ? i18n_get(state->ui.language, I18N_WIN_EDITOR_BODY)
+                                  : i18n_get(state->ui.language, I18N_WIN_EDITOR_HEADERS))),
+                state->ui.focused_panel == PANEL_EDITOR
+            );
+            draw_editor_content(w_editor, state);
+        }
+
+        if (dirty & UI_DIRTY_RESPONSE) {
+            char response_title[UI_META_MAX];
+            const RequestSlot *viewed = request_slots_viewed(&state->response);
+            if (viewed) {
+                int total = 0;
+                int pos = request_slots_position(&state->response, state->response.view_slot, &total);
+                snprintf(response_title, sizeof(response_title),
+                         i18n_get(state->ui.language, I18N_WIN_RESPONSE_SLOT_FMT), viewed->id, pos, total);
+            } else {
+                snprintf(response_title, sizeof(response_title), "%s", i18n_get(state->ui.language, I18N_WIN_RESPONSE));
+            }
+            draw_boxed_window(w_response, response_title, state->ui.focused_panel == PANEL_RESPONSE);
+            draw_response_content(w_response, state);
+        }
     }
 
+    /* Park the cursor last; refreshing an untouched stdscr only moves it. */
     if (state->ui.mode == MODE_COMMAND || state->ui.mode == MODE_SEARCH) {
         int cx = 4 + state->prompt.cursor;
         if (cx < 2) cx = 2;
@@ -968,6 +1171,7 @@ void ui_draw(AppState *state) {
     } else {
         curs_set(0);
     }
+    wnoutrefresh(stdscr);
 
     app_state_unlock(state);
     doupdate();
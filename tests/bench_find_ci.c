@@ -0,0 +1,118 @@
+/*
+ * bench_find_ci.c - Throughput of the case-insensitive search kernels
+ *
+ * Builds a few multi-MB bodies shaped like API responses, searches each for
+ * a needle placed at the very end, and prints GB/s for the byte loop that
+ * search used before the kernels and for every kernel this CPU supports.
+ * Run with `make bench-search`.
+ */
+
+#include "core/text/find_ci.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* The loop search.c ran before find_ci */
+static const char *byte_loop(const char *hay, size_t hay_n, const char *needle, size_t needle_n) {
+    for (size_t i = 0; i + needle_n <= hay_n; i++) {
+        size_t j = 0;
+        while (j < needle_n) {
+            if (tolower((unsigned char)hay[i + j]) != tolower((unsigned char)needle[j])) break;
+            j++;
+        }
+        if (j == needle_n) return hay + i;
+    }
+    return NULL;
+}
+
+typedef const char *(*SearchFn)(const char *, size_t, const char *, size_t);
+
+static FindCiKernel bench_kernel;
+
+static const char *with_kernel(const char *hay, size_t hay_n, const char *needle, size_t needle_n) {
+    return find_ci_with(bench_kernel, hay, hay_n, needle, needle_n);
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Repeats the search for at least a quarter second; returns GB/s scanned */
+static double measure(SearchFn fn, const char *hay, size_t hay_n, const char *needle) {
+    size_t needle_n = strlen(needle);
+    double start = now_seconds();
+    double elapsed = 0;
+    size_t bytes = 0;
+    do {
+        const char *hit = fn(hay, hay_n, needle, needle_n);
+        if (!hit) {
+            fprintf(stderr, "needle not found\n");
+            exit(1);
+        }
+        bytes += (size_t)(hit - hay) + needle_n;
+        elapsed = now_seconds() - start;
+    } while (elapsed < 0.25);
+    return (double)bytes / elapsed / 1e9;
+}
+
+/* JSON-ish records: mostly lower-case keys, mixed-case values, digits */
+static char *make_body(size_t n, const char *tail) {
+    static const char *words[] = {
+        "\"id\": ", "\"name\": \"Widget\", ", "\"status\": \"Active\", ",
+        "\"createdAt\": \"2024-01-01T00:00:00Z\", ", "\"tags\": [\"a\", \"B\"], ", "}\n{"
+    };
+    char *body = malloc(n + 1);
+    if (!body) return NULL;
+
+    size_t tail_n = strlen(tail);
+    size_t pos = 0;
+    unsigned seed = 7;
+    while (pos + tail_n < n) {
+        seed = seed * 1103515245u + 12345u;
+        const char *w = words[(seed >> 16) % (sizeof(words) / sizeof(words[0]))];
+        size_t len = strlen(w);
+        if (pos + len > n - tail_n) len = n - tail_n - pos;
+        memcpy(body + pos, w, len);
+        pos += len;
+    }
+    memcpy(body + pos, tail, tail_n);
+    body[n] = '\0';
+    return body;
+}
+
+int main(void) {
+    static const size_t sizes[] = { 1u << 20, 8u << 20, 32u << 20 };
+    /* Neither occurs in the generated records, only in the closing tail */
+    static const char *needles[] = { "X-Request-Id", "zq" };
+    static const char *tail = "\"x-request-id\": \"ZQ\"";
+
+    printf("dispatch: %s\n", find_ci_kernel_name(find_ci_kernel()));
+    printf("%-8s %-14s %10s", "size", "needle", "byte loop");
+    for (int k = FIND_CI_SCALAR; k <= (int)find_ci_kernel(); k++) {
+        printf(" %10s", find_ci_kernel_name((FindCiKernel)k));
+    }
+    printf("   (GB/s)\n");
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (size_t q = 0; q < sizeof(needles) / sizeof(needles[0]); q++) {
+            const char *needle = needles[q];
+            char *body = make_body(sizes[s], tail);
+            if (!body) return 1;
+
+            printf("%-8s %-14s", s == 0 ? "1 MiB" : s == 1 ? "8 MiB" : "32 MiB", needle);
+            printf(" %10.2f", measure(byte_loop, body, sizes[s], needle));
+            for (int k = FIND_CI_SCALAR; k <= (int)find_ci_kernel(); k++) {
+                bench_kernel = (FindCiKernel)k;
+                printf(" %10.2f", measure(with_kernel, body, sizes[s], needle));
+            }
+            printf("\n");
+            free(body);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,160 @@
+#include "test.h"
+#include "core/cli/batch.h"
+#include "core/config/env.h"
+#include <string.h>
+
+static char *read_stream_all(FILE *f) {
+    rewind(f);
+    static char buf[8192];
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    buf[n] = '\0';
+    return buf;
+}
+
+static int count_lines(const char *s) {
+    int n = 0;
+    for (; *s; s++) {
+        if (*s == '\n') n++;
+    }
+    return n;
+}
+
+/* Test: single objects, arrays and {"requests": [...]} are accepted */
+static int test_batch_collection_parse(void) {
+    BatchCollection c;
+    batch_collection_init(&c);
+
+    TEST_ASSERT(batch_collection_parse(&c,
+        "{\"method\":\"POST\",\"url\":\"http://a\",\"body\":\"{}\","
+        "\"headers\":\"Content-Type: application/json\",\"environment\":\"dev\"}") == 0);
+    TEST_ASSERT(c.count == 1);
+    TEST_ASSERT(c.items[0].method == HTTP_POST);
+    TEST_ASSERT_STR_EQ(c.items[0].body_text, "{}");
+    TEST_ASSERT_STR_EQ(c.items[0].env_name, "dev");
+
+    TEST_ASSERT(batch_collection_parse(&c,
+        "[{\"url\":\"http://b\"},"
+        "{\"method\":3,\"url\":\"http://c\",\"headers\":[\"A: 1\",\"B: 2\"],\"timeout_ms\":250}]") == 0);
+    TEST_ASSERT(c.count == 3);
+    TEST_ASSERT(c.items[1].method == HTTP_GET);
+    TEST_ASSERT_STR_EQ(c.items[1].headers_text, "");
+    TEST_ASSERT(c.items[2].method == HTTP_DELETE);
+    TEST_ASSERT_STR_EQ(c.items[2].headers_text, "A: 1\nB: 2");
+    TEST_ASSERT(c.items[2].timeout_ms == 250);
+
+    TEST_ASSERT(batch_collection_parse(&c, "{\"requests\":[{\"method\":\"patch\",\"url\":\"http://d\"}]}") == 0);
+    TEST_ASSERT(c.count == 4);
+    TEST_ASSERT(c.items[3].method == HTTP_PATCH);
+
+    /* A bad entry rejects the whole document */
+    TEST_ASSERT(batch_collection_parse(&c, "[{\"url\":\"http://e\"},{\"method\":\"BREW\",\"url\":\"http://f\"}]") == 1);
+    TEST_ASSERT(batch_collection_parse(&c, "[{\"body\":\"no url\"}]") == 1);
+    TEST_ASSERT(batch_collection_parse(&c, "not json") == 1);
+    TEST_ASSERT(c.count == 4);
+
+    batch_collection_free(&c);
+    TEST_ASSERT(c.count == 0);
+    return 0;
+}
+
+/* Test: every request yields one result line, template errors included */
+static int test_batch_run_jsonl(void) {
+    TEST_ASSERT(write_text_file("/tmp/tcurl_batch_a.txt", "alpha") == 0);
+    TEST_ASSERT(write_text_file("/tmp/tcurl_batch_b.txt", "beta") == 0);
+    TEST_ASSERT(write_text_file("/tmp/tcurl_batch_envs.json",
+        "{\"dev\":{\"DIR\":\"/tmp\"},\"prod\":{\"DIR\":\"/nonexistent\"}}") == 0);
+
+    EnvStore envs;
+    env_store_init(&envs);
+    TEST_ASSERT(env_store_load_file(&envs, "/tmp/tcurl_batch_envs.json") == 0);
+
+    BatchCollection c;
+    batch_collection_init(&c);
+    TEST_ASSERT(batch_collection_parse(&c,
+        "[{\"url\":\"file://{{DIR}}/tcurl_batch_a.txt\"},"
+        "{\"url\":\"file:///tmp/tcurl_batch_b.txt\"},"
+        "{\"url\":\"file://{{DIR}}/tcurl_batch_a.txt\",\"environment\":\"prod\"},"
+        "{\"url\":\"{{MISSING}}/x\"}]") == 0);
+
+    BatchOptions opt = { .concurrency = 2, .timeout_ms = 5000, .include_body = 1 };
+    FILE *out = tmpfile();
+    TEST_ASSERT(out != NULL);
+    TEST_ASSERT(batch_run(&c, &envs, &opt, out) == BATCH_EXIT_FAILED);
+
+    const char *text = read_stream_all(out);
+    TEST_ASSERT(count_lines(text) == 4);
+    TEST_ASSERT(strstr(text, "\"url\":\"file:///tmp/tcurl_batch_a.txt\"") != NULL);
+    TEST_ASSERT(strstr(text, "\"body\":\"alpha\"") != NULL);
+    TEST_ASSERT(strstr(text, "\"body\":\"beta\"") != NULL);
+    TEST_ASSERT(strstr(text, "\"ttfb_ms\":") != NULL);
+    TEST_ASSERT(strstr(text, "/nonexistent/tcurl_batch_a.txt") != NULL);
+    TEST_ASSERT(strstr(text, "Missing variable: MISSING") != NULL);
+    for (int i = 0; i < 4; i++) {
+        char key[32];
+        snprintf(key, sizeof(key), "{\"index\":%d,", i);
+        TEST_ASSERT(strstr(text, key) != NULL);
+    }
+    fclose(out);
+
+    /* Forcing an environment overrides the per-request one */
+    batch_collection_free(&c);
+    TEST_ASSERT(batch_collection_parse(&c,
+        "{\"url\":\"file://{{DIR}}/tcurl_batch_b.txt\",\"environment\":\"prod\"}") == 0);
+    opt.env_name = "dev";
+    opt.include_body = 0;
+    out = tmpfile();
+    TEST_ASSERT(out != NULL);
+    TEST_ASSERT(batch_run(&c, &envs, &opt, out) == BATCH_EXIT_OK);
+    text = read_stream_all(out);
+    TEST_ASSERT(count_lines(text) == 1);
+    TEST_ASSERT(strstr(text, "\"bytes\":4") != NULL);
+    TEST_ASSERT(strstr(text, "\"error\":null") != NULL);
+    TEST_ASSERT(strstr(text, "\"body\"") == NULL);
+    fclose(out);
+
+    batch_collection_free(&c);
+    env_store_free(&envs);
+    return 0;
+}
+
+/* Test: bad arguments are rejected before anything runs */
+static int test_batch_main_usage(void) {
+    FILE *saved = stderr;
+    FILE *sink = fopen("/dev/null", "w");
+    TEST_ASSERT(sink != NULL);
+    stderr = sink;
+
+    char *no_files[] = { "run" };
+    char *bad_conc[] = { "run", "-c", "0", "x.json" };
+    char *bad_flag[] = { "run", "--nope", "x.json" };
+    char *missing[] = { "run", "--envs", "/tmp/tcurl_batch_envs.json", "/tmp/tcurl_batch_missing.json" };
+    char *bad_env[] = { "run", "--envs", "/tmp/tcurl_batch_envs.json", "-e", "qa", "x.json" };
+    int rc1 = batch_main(1, no_files);
+    int rc2 = batch_main(4, bad_conc);
+    int rc3 = batch_main(3, bad_flag);
+    int rc4 = batch_main(4, missing);
+    int rc5 = batch_main(6, bad_env);
+
+    stderr = saved;
+    fclose(sink);
+    TEST_ASSERT(rc1 == BATCH_EXIT_USAGE);
+    TEST_ASSERT(rc2 == BATCH_EXIT_USAGE);
+    TEST_ASSERT(rc3 == BATCH_EXIT_USAGE);
+    TEST_ASSERT(rc4 == BATCH_EXIT_USAGE);
+    TEST_ASSERT(rc5 == BATCH_EXIT_USAGE);
+    return 0;
+}
+
+int test_batch(void) {
+    int failed = 0;
+    failed += test_batch_collection_parse();
+    failed += test_batch_run_jsonl();
+    failed += test_batch_main_usage();
+
+    if (failed) {
+        printf("test_batch: FAILED (%d tests)\n", failed);
+        return 1;
+    }
+    printf("test_batch: OK\n");
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include "test.h"
+#include "state.h"
+#include "core/http/bench.h"
+#include "core/http/http_engine.h"
+#include "core/http/request_slots.h"
+#include "core/cli/command_handlers.h"
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+static int near(double got, double want, double rel) {
+    double diff = got > want ? got - want : want - got;
+    return diff <= want * rel;
+}
+
+/* Test: percentiles stay within the bucket precision */
+static int test_bench_histogram_percentiles(void) {
+    LatencyHistogram h;
+    latency_hist_init(&h);
+    TEST_ASSERT(latency_hist_percentile(&h, 50.0) == 0.0);
+
+    for (int i = 1; i <= 1000; i++) {
+        latency_hist_record(&h, (double)i);
+    }
+    TEST_ASSERT(h.total == 1000);
+    TEST_ASSERT(h.max_ms == 1000.0);
+
+    TEST_ASSERT(near(latency_hist_percentile(&h, 50.0), 500.0, 0.04));
+    TEST_ASSERT(near(latency_hist_percentile(&h, 90.0), 900.0, 0.04));
+    TEST_ASSERT(near(latency_hist_percentile(&h, 99.0), 990.0, 0.04));
+    TEST_ASSERT(latency_hist_percentile(&h, 100.0) == 1000.0);
+
+    /* Sub-millisecond samples use the exact range */
+    LatencyHistogram fast;
+    latency_hist_init(&fast);
+    latency_hist_record(&fast, 0.010);
+    latency_hist_record(&fast, 0.020);
+    TEST_ASSERT(latency_hist_percentile(&fast, 50.0) <= 0.011);
+    return 0;
+}
+
+/* Test: failed transfers are counted but not timed */
+static int test_bench_stats_report(void) {
+    BenchStats st;
+    bench_stats_init(&st, 3, 2);
+
+    HttpResponse ok;
+    memset(&ok, 0, sizeof(ok));
+    ok.status = 200;
+    ok.timing.total_ms = 12.0;
+    ok.timing.ttfb_ms = 8.0;
+    bench_stats_record(&st, &ok);
+
+    HttpResponse not_found = ok;
+    not_found.status = 404;
+    bench_stats_record(&st, &not_found);
+
+    HttpResponse failed;
+    memset(&failed, 0, sizeof(failed));
+    failed.error = "Couldn't connect";
+    bench_stats_record(&st, &failed);
+
+    TEST_ASSERT(st.completed == 2);
+    TEST_ASSERT(st.failed == 1);
+    TEST_ASSERT(st.http_errors == 1);
+    TEST_ASSERT(st.phases[BENCH_PHASE_TOTAL].total == 2);
+
+    st.wall_ms = 100.0;
+    char *report = bench_format_report(&st, HTTP_POST, "https://api.example.com");
+    TEST_ASSERT(report != NULL);
+    TEST_ASSERT(strstr(report, "POST https://api.example.com") != NULL);
+    TEST_ASSERT(strstr(report, "Throughput: 20.0 req/s") != NULL);
+    TEST_ASSERT(strstr(report, "p99") != NULL);
+    TEST_ASSERT(strstr(report, "ttfb") != NULL);
+    free(report);
+    return 0;
+}
+
+/* Test: :bench runs to completion and reports in the response panel */
+static int test_bench_end_to_end(void) {
+    TEST_ASSERT(write_text_file("/tmp/tcurl_bench_body.txt", "bench") == 0);
+
+    AppState s;
+    memset(&s, 0, sizeof(s));
+    (void)pthread_mutex_init(&s.state_mu, NULL);
+    tb_init(&s.editor.body);
+    tb_init(&s.editor.headers);
+    request_slots_init(&s.response);
+    s.ui.language = UI_LANG_EN;
+    strcpy(s.editor.url, "file:///tmp/tcurl_bench_body.txt");
+
+    app_state_lock(&s);
+    cmd_bench(&s, "0", "1");
+    TEST_ASSERT(s.response.response.error != NULL);
+    cmd_bench(&s, "6", "2");
+    TEST_ASSERT(s.response.bench_running == 1);
+    TEST_ASSERT(s.response.response.body != NULL);
+    cmd_bench(&s, "1", "1");
+    TEST_ASSERT(s.response.response.error != NULL);
+    app_state_unlock(&s);
+
+    int running = 1;
+    for (int i = 0; i < 5000 && running; i++) {
+        app_state_lock(&s);
+        running = s.response.bench_running;
+        app_state_unlock(&s);
+        if (running) usleep(1000);
+    }
+    TEST_ASSERT(running == 0);
+
+    app_state_lock(&s);
+    TEST_ASSERT(s.response.response.body != NULL);
+    TEST_ASSERT(strstr(s.response.response.body, "Completed: 6") != NULL);
+    TEST_ASSERT(strstr(s.response.response.body, "Failed: 0") != NULL);
+    app_state_unlock(&s);
+
+    http_engine_destroy(s.response.engine);
+    request_slots_free(&s.response);
+    tb_free(&s.editor.body);
+    tb_free(&s.editor.headers);
+    (void)pthread_mutex_destroy(&s.state_mu);
+    return 0;
+}
+
+int test_bench(void) {
+    int failed = 0;
+    failed += test_bench_histogram_percentiles();
+    failed += test_bench_stats_report();
+    failed += test_bench_end_to_end();
+
+    if (failed) {
+        printf("test_bench: FAILED (%d tests)\n", failed);
+        return 1;
+    }
+    printf("test_bench: OK\n");
+    return 0;
+}
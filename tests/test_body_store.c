@@ -0,0 +1,169 @@
+#include "test.h"
+#include "core/storage/body_store.h"
+
+#include <string.h>
+
+/* Test: identical strings share one copy until the last reference goes */
+static int test_body_store_sharing(void) {
+    BodyStore bs;
+    body_store_init(&bs);
+
+    char text[] = "{\"id\":1}";
+    char *a = body_store_intern(&bs, text, strlen(text));
+    text[6] = '2';
+    char *b = body_store_intern(&bs, text, strlen(text));
+    text[6] = '1';
+    char *c = body_store_intern(&bs, text, strlen(text));
+    TEST_ASSERT(a != NULL && b != NULL);
+    TEST_ASSERT(a == c);
+    TEST_ASSERT(a != b);
+    TEST_ASSERT_STR_EQ(a, "{\"id\":1}");
+    TEST_ASSERT_STR_EQ(b, "{\"id\":2}");
+    TEST_ASSERT(bs.count == 2);
+
+    /* Prefixes and the empty string are distinct bodies */
+    char *prefix = body_store_intern(&bs, text, 3);
+    char *empty = body_store_intern(&bs, "", 0);
+    TEST_ASSERT_STR_EQ(prefix, "{\"i");
+    TEST_ASSERT_STR_EQ(empty, "");
+    TEST_ASSERT(bs.count == 4);
+
+    BodyHash hash;
+    body_hash(a, strlen(a), &hash);
+    TEST_ASSERT(body_store_contains(&bs, &hash));
+    body_store_release(&bs, a);
+    TEST_ASSERT(body_store_contains(&bs, &hash));
+    char *found = body_store_find(&bs, &hash);
+    TEST_ASSERT(found == c);
+    body_store_release(&bs, found);
+    body_store_release(&bs, c);
+    TEST_ASSERT(!body_store_contains(&bs, &hash));
+    TEST_ASSERT(body_store_find(&bs, &hash) == NULL);
+    TEST_ASSERT(bs.count == 3);
+
+    body_store_release(&bs, b);
+    body_store_release(&bs, prefix);
+    body_store_release(&bs, empty);
+    TEST_ASSERT(bs.count == 0);
+    body_store_free(&bs);
+    return 0;
+}
+
+/* Test: the table keeps every body reachable as it grows */
+static int test_body_store_growth(void) {
+    BodyStore bs;
+    body_store_init(&bs);
+
+    char *bodies[1000];
+    for (int i = 0; i < 1000; i++) {
+        char text[32];
+        snprintf(text, sizeof(text), "body %d", i);
+        bodies[i] = body_store_intern(&bs, text, strlen(text));
+        TEST_ASSERT(bodies[i] != NULL);
+    }
+    TEST_ASSERT(bs.count == 1000);
+    TEST_ASSERT(bs.nbuckets >= 1000);
+    for (int i = 0; i < 1000; i++) {
+        char text[32];
+        snprintf(text, sizeof(text), "body %d", i);
+        TEST_ASSERT(body_store_intern(&bs, text, strlen(text)) == bodies[i]);
+    }
+
+    /* body_store_free() also drops bodies still referenced */
+    body_store_free(&bs);
+    TEST_ASSERT(bs.count == 0 && bs.buckets == NULL);
+    return 0;
+}
+
+/* Test: a pinned body stays readable after the store is freed */
+static int test_body_store_pin(void) {
+    BodyStore bs;
+    body_store_init(&bs);
+
+    const char *text = "pinned body";
+    char *a = body_store_intern(&bs, text, strlen(text));
+    TEST_ASSERT(body_store_pin(a) == a);
+    body_store_unpin(&bs, a);
+    TEST_ASSERT(bs.count == 1);
+
+    /* While the store lives, unpinning the last reference removes it */
+    body_store_pin(a);
+    body_store_release(&bs, a);
+    TEST_ASSERT(bs.count == 1);
+    body_store_unpin(&bs, a);
+    TEST_ASSERT(bs.count == 0);
+
+    char *b = body_store_intern(&bs, text, strlen(text));
+    body_store_pin(b);
+    body_store_pin(b);
+    body_store_free(&bs);
+    TEST_ASSERT_STR_EQ(b, text);
+    body_store_unpin(&bs, b);
+    TEST_ASSERT_STR_EQ(b, text);
+    body_store_unpin(&bs, b);
+    return 0;
+}
+
+/* Test: hashes round-trip through their hex form and reject anything else */
+static int test_body_hash_hex(void) {
+    BodyHash h1;
+    BodyHash h2;
+    body_hash("abc", 3, &h1);
+    body_hash("abd", 3, &h2);
+    TEST_ASSERT(!body_hash_equal(&h1, &h2));
+
+    char hex[BODY_HASH_HEX_LEN + 1];
+    body_hash_hex(&h1, hex);
+    TEST_ASSERT(strlen(hex) == BODY_HASH_HEX_LEN);
+
+    BodyHash back;
+    TEST_ASSERT(body_hash_parse(hex, &back) == 0);
+    TEST_ASSERT(body_hash_equal(&back, &h1));
+
+    TEST_ASSERT(body_hash_parse("0123", &back) == 1);
+    TEST_ASSERT(body_hash_parse("0123456789abcdef0123456789abcdef", &back) == 1);
+    TEST_ASSERT(body_hash_parse("0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdeg", &back) == 1);
+    TEST_ASSERT(body_hash_parse("0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0", &back) == 1);
+    return 0;
+}
+
+static int hash_is(const char *data, size_t len, const char *want) {
+    BodyHash h;
+    char hex[BODY_HASH_HEX_LEN + 1];
+    body_hash(data, len, &h);
+    body_hash_hex(&h, hex);
+    return strcmp(hex, want) == 0;
+}
+
+/* Test: the hash is SHA-256, including across block and padding edges */
+static int test_body_hash_sha256(void) {
+    TEST_ASSERT(hash_is("", 0, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"));
+    TEST_ASSERT(hash_is("abc", 3, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+
+    const char *two = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    TEST_ASSERT(hash_is(two, strlen(two), "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"));
+
+    size_t n = 1000000;
+    char *a = malloc(n);
+    TEST_ASSERT(a != NULL);
+    memset(a, 'a', n);
+    TEST_ASSERT(hash_is(a, n, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"));
+    free(a);
+    return 0;
+}
+
+int test_body_store(void) {
+    int failed = 0;
+    failed += test_body_store_sharing();
+    failed += test_body_store_growth();
+    failed += test_body_store_pin();
+    failed += test_body_hash_hex();
+    failed += test_body_hash_sha256();
+
+    if (failed) {
+        printf("test_body_store: FAILED (%d tests)\n", failed);
+        return 1;
+    }
+    printf("test_body_store: OK\n");
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include "test.h"
+#include "core/utils/bytebuf.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+static int test_bytebuf_append(void) {
+    ByteBuf b;
+    bytebuf_init(&b);
+    TEST_ASSERT(b.data == NULL);
+
+    TEST_ASSERT(bytebuf_append(&b, "abc", 3) == 0);
+    TEST_ASSERT(bytebuf_append_str(&b, "def") == 0);
+    TEST_ASSERT(bytebuf_appendf(&b, "-%d-%s", 42, "x") == 0);
+    TEST_ASSERT(b.len == 11);
+    TEST_ASSERT_STR_EQ(b.data, "abcdef-42-x");
+
+    /* Embedded NULs are kept; the buffer stays terminated */
+    TEST_ASSERT(bytebuf_append(&b, "\0z", 2) == 0);
+    TEST_ASSERT(b.len == 13);
+    TEST_ASSERT(b.data[11] == '\0' && b.data[12] == 'z' && b.data[13] == '\0');
+
+    /* Clearing keeps the memory for the next round */
+    char *data = b.data;
+    size_t cap = b.cap;
+    bytebuf_clear(&b);
+    TEST_ASSERT(b.len == 0 && b.data == data && b.cap == cap);
+    TEST_ASSERT_STR_EQ(b.data, "");
+
+    bytebuf_free(&b);
+    TEST_ASSERT(b.data == NULL && b.len == 0 && b.cap == 0);
+    return 0;
+}
+
+static int test_bytebuf_growth(void) {
+    ByteBuf b;
+    bytebuf_init(&b);
+
+    size_t reallocs = 0;
+    size_t last_cap = 0;
+    for (int i = 0; i < 100000; i++) {
+        TEST_ASSERT(bytebuf_append(&b, "0123456789", 10) == 0);
+        if (b.cap != last_cap) {
+            reallocs++;
+            last_cap = b.cap;
+        }
+    }
+    TEST_ASSERT(b.len == 1000000);
+    TEST_ASSERT(reallocs < 20);
+
+    /* Reserving up front means no further growth */
+    ByteBuf pre;
+    bytebuf_init(&pre);
+    TEST_ASSERT(bytebuf_reserve(&pre, 4096) == 0);
+    size_t cap = pre.cap;
+    TEST_ASSERT(cap >= 4097);
+    for (int i = 0; i < 4096; i++) TEST_ASSERT(bytebuf_append(&pre, "x", 1) == 0);
+    TEST_ASSERT(pre.cap == cap);
+
+    bytebuf_free(&pre);
+    bytebuf_free(&b);
+    return 0;
+}
+
+static int test_bytebuf_limit(void) {
+    ByteBuf b;
+    bytebuf_init(&b);
+    b.limit = 8;
+
+    TEST_ASSERT(bytebuf_append_str(&b, "12345") == 0);
+    TEST_ASSERT(bytebuf_append_str(&b, "6789") == -1);
+    TEST_ASSERT(b.len == 5);
+    TEST_ASSERT_STR_EQ(b.data, "12345");
+    TEST_ASSERT(bytebuf_append_str(&b, "678") == 0);
+    TEST_ASSERT(bytebuf_appendf(&b, "%d", 9) == -1);
+    TEST_ASSERT(b.len == 8);
+
+    bytebuf_free(&b);
+    return 0;
+}
+
+static int test_bytebuf_take(void) {
+    ByteBuf b;
+    bytebuf_init(&b);
+
+    char *empty = bytebuf_take(&b);
+    TEST_ASSERT(empty != NULL);
+    TEST_ASSERT_STR_EQ(empty, "");
+    free(empty);
+
+    TEST_ASSERT(bytebuf_append_str(&b, "owned") == 0);
+    char *s = bytebuf_take(&b);
+    TEST_ASSERT_STR_EQ(s, "owned");
+    TEST_ASSERT(b.data == NULL && b.len == 0);
+    free(s);
+    return 0;
+}
+
+int test_bytebuf(void) {
+    int rc = 0;
+
+    printf("Running test_bytebuf...\n");
+    rc |= test_bytebuf_append();
+    rc |= test_bytebuf_growth();
+    rc |= test_bytebuf_limit();
+    rc |= test_bytebuf_take();
+
+    if (rc == 0) {
+        printf("  test_bytebuf: OK\n");
+    } else {
+        printf("  test_bytebuf: FAILED\n");
+    }
+
+    return rc;
+}
@@ -287,6 +287,64 @@ int test_cmd_set_max_entries(void) {
     return 0;
 }
 
+/* Test: per-request timeouts and the session defaults */
+int test_cmd_timeout(void) {
+    AppState s;
+    init_minimal_state(&s);
+
+    cmd_timeout(&s, "2000", "500");
+    TEST_ASSERT(s.editor.timeout_ms == 2000);
+    TEST_ASSERT(s.editor.connect_timeout_ms == 500);
+
+    cmd_timeout(&s, NULL, NULL);
+    TEST_ASSERT(s.response.response.body != NULL);
+    TEST_ASSERT(strstr(s.response.response.body, "timeout_ms=2000") != NULL);
+
+    cmd_timeout(&s, "soon", NULL);
+    TEST_ASSERT(s.response.response.error != NULL);
+    TEST_ASSERT(s.editor.timeout_ms == 2000);
+
+    cmd_timeout(&s, "off", NULL);
+    TEST_ASSERT(s.editor.timeout_ms == 0);
+    TEST_ASSERT(s.editor.connect_timeout_ms == 0);
+
+    cmd_set(&s, "timeout_ms", "0");
+    TEST_ASSERT(s.response.timeout_ms == 0);
+    cmd_set(&s, "connect_timeout_ms", "1500");
+    TEST_ASSERT(s.response.connect_timeout_ms == 1500);
+    cmd_set(&s, "connect_timeout_ms", NULL);
+    TEST_ASSERT(s.response.response.error != NULL);
+
+    cleanup_state(&s);
+    return 0;
+}
+
+/* Test: cmd_set with max_response_mb and spill_mb */
+int test_cmd_set_max_response_mb(void) {
+    AppState s;
+    init_minimal_state(&s);
+
+    cmd_set(&s, "max_response_mb", "25");
+    TEST_ASSERT(s.response.max_body_mb == 25);
+    TEST_ASSERT(s.response.response.body != NULL);
+
+    cmd_set(&s, "max_response_mb", "-1");
+    TEST_ASSERT(s.response.max_body_mb == 25);
+    TEST_ASSERT(s.response.response.error != NULL);
+
+    cmd_set(&s, "max_response_mb", "0");
+    TEST_ASSERT(s.response.max_body_mb == 0);
+
+    cmd_set(&s, "spill_mb", "8");
+    TEST_ASSERT(s.response.spill_mb == 8);
+    cmd_set(&s, "spill_mb", "lots");
+    TEST_ASSERT(s.response.spill_mb == 8);
+    TEST_ASSERT(s.response.response.error != NULL);
+
+    cleanup_state(&s);
+    return 0;
+}
+
 /* Test: cmd_set with invalid setting */
 int test_cmd_set_invalid_setting(void) {
     AppState s;
@@ -416,6 +474,8 @@ int test_command_handlers(void) {
     rc |= test_cmd_set_no_args();
     rc |= test_cmd_set_search_target();
     rc |= test_cmd_set_max_entries();
+    rc |= test_cmd_set_max_response_mb();
+    rc |= test_cmd_timeout();
     rc |= test_cmd_set_invalid_setting();
     rc |= test_cmd_lang_list();
     rc |= test_cmd_lang_set();
@@ -0,0 +1,103 @@
+#include "test.h"
+#include "core/utils/base64.h"
+#include "core/utils/compress.h"
+
+#include <string.h>
+
+/* Test: deflated text inflates back to the same bytes, empty input included */
+static int test_compress_roundtrip(void) {
+    ByteBuf text;
+    bytebuf_init(&text);
+    for (int i = 0; i < 2000; i++) {
+        TEST_ASSERT(bytebuf_appendf(&text, "{\"id\":%d,\"name\":\"item\"},", i) == 0);
+    }
+
+    ByteBuf packed;
+    ByteBuf back;
+    bytebuf_init(&packed);
+    bytebuf_init(&back);
+    TEST_ASSERT(compress_deflate(text.data, text.len, 6, &packed) == 0);
+    TEST_ASSERT(packed.len > 0 && packed.len < text.len / 5);
+    TEST_ASSERT(compress_inflate(packed.data, packed.len, &back) == 0);
+    TEST_ASSERT(back.len == text.len);
+    TEST_ASSERT(memcmp(back.data, text.data, text.len) == 0);
+    bytebuf_free(&packed);
+    bytebuf_free(&back);
+    bytebuf_free(&text);
+
+    TEST_ASSERT(compress_deflate("", 0, 1, &packed) == 0);
+    TEST_ASSERT(compress_inflate(packed.data, packed.len, &back) == 0);
+    TEST_ASSERT(back.data != NULL && back.len == 0);
+    bytebuf_free(&packed);
+    bytebuf_free(&back);
+    return 0;
+}
+
+/* Test: truncated, extended and foreign streams are rejected */
+static int test_compress_corrupt(void) {
+    const char *text = "hello hello hello hello hello hello";
+    ByteBuf packed;
+    ByteBuf back;
+    bytebuf_init(&packed);
+    bytebuf_init(&back);
+    TEST_ASSERT(compress_deflate(text, strlen(text), 9, &packed) == 0);
+
+    TEST_ASSERT(compress_inflate(packed.data, packed.len - 1, &back) == 1);
+    bytebuf_free(&back);
+    TEST_ASSERT(bytebuf_append(&packed, "x", 1) == 0);
+    TEST_ASSERT(compress_inflate(packed.data, packed.len, &back) == 1);
+    bytebuf_free(&back);
+    TEST_ASSERT(compress_inflate(text, strlen(text), &back) == 1);
+    bytebuf_free(&back);
+    TEST_ASSERT(compress_inflate("", 0, &back) == 1);
+
+    bytebuf_free(&back);
+    bytebuf_free(&packed);
+    return 0;
+}
+
+/* Test: base64 round-trips every padding length and rejects malformed text */
+static int test_base64(void) {
+    const unsigned char bytes[] = { 0x00, 0xff, 0x10, 0x80, 0x7f };
+    for (size_t n = 0; n <= sizeof(bytes); n++) {
+        char *b64 = base64_encode(bytes, n);
+        TEST_ASSERT(b64 != NULL);
+        TEST_ASSERT(strlen(b64) == (n + 2) / 3 * 4);
+
+        ByteBuf back;
+        bytebuf_init(&back);
+        TEST_ASSERT(base64_decode(b64, strlen(b64), &back) == 0);
+        TEST_ASSERT(back.len == n);
+        TEST_ASSERT(memcmp(back.data, bytes, n) == 0);
+        bytebuf_free(&back);
+        free(b64);
+    }
+
+    char *b64 = base64_encode("user:pass", 9);
+    TEST_ASSERT_STR_EQ(b64, "dXNlcjpwYXNz");
+    free(b64);
+
+    ByteBuf out;
+    bytebuf_init(&out);
+    TEST_ASSERT(base64_decode("abc", 3, &out) == 1);
+    bytebuf_free(&out);
+    TEST_ASSERT(base64_decode("ab!d", 4, &out) == 1);
+    bytebuf_free(&out);
+    TEST_ASSERT(base64_decode("a=bc", 4, &out) == 1);
+    bytebuf_free(&out);
+    return 0;
+}
+
+int test_compress(void) {
+    int failed = 0;
+    failed += test_compress_roundtrip();
+    failed += test_compress_corrupt();
+    failed += test_base64();
+
+    if (failed) {
+        printf("test_compress: FAILED (%d tests)\n", failed);
+        return 1;
+    }
+    printf("test_compress: OK\n");
+    return 0;
+}
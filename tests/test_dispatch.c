@@ -3,7 +3,14 @@
 #include "orchestration/dispatch.h"
 #include "core/interaction/actions.h"
 #include "core/storage/history.h"
+#include "core/http/http.h"
+#include "core/http/http_engine.h"
+#include "core/http/request_slots.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
 #include <string.h>
+#include <unistd.h>
 
 static void init_minimal_state(AppState *s) {
     memset(s, 0, sizeof(*s));
@@ -191,6 +198,118 @@ static int test_dispatch_response_scroll(void) {
     return 0;
 }
 
+/* Test: scrolling an indexed body stops at its last line */
+static int test_dispatch_response_scroll_clamp(void) {
+    AppState s;
+    init_minimal_state(&s);
+    s.ui.focused_panel = PANEL_RESPONSE;
+    s.response.response.body_view = strdup("a\nb\nc");
+    TEST_ASSERT(http_response_index_view(&s.response.response) == 0);
+
+    for (int i = 0; i < 5; i++) dispatch_action(&s, ACT_MOVE_DOWN);
+    TEST_ASSERT(s.response.scroll == 2);
+
+    /* The headers view is not indexed and keeps scrolling freely */
+    s.response.show_headers = 1;
+    dispatch_action(&s, ACT_MOVE_DOWN);
+    TEST_ASSERT(s.response.scroll == 3);
+
+    http_response_free(&s.response.response);
+    cleanup_state(&s);
+    return 0;
+}
+
+static int wait_for_responses(AppState *s) {
+    for (int i = 0; i < 5000; i++) {
+        app_state_lock(s);
+        int pending = s->response.requests_in_flight;
+        app_state_unlock(s);
+        if (pending == 0) return 0;
+        usleep(1000);
+    }
+    return 1;
+}
+
+/* Test: sends do not wait for each other; each lands in its own slot */
+static int test_dispatch_concurrent_sends(void) {
+    TEST_ASSERT(write_text_file("/tmp/tcurl_dispatch_a.txt", "alpha") == 0);
+    TEST_ASSERT(write_text_file("/tmp/tcurl_dispatch_b.txt", "beta") == 0);
+
+    AppState s;
+    init_minimal_state(&s);
+    (void)pthread_mutex_init(&s.state_mu, NULL);
+    request_slots_init(&s.response);
+
+    app_state_lock(&s);
+    strcpy(s.editor.url, "file:///tmp/tcurl_dispatch_a.txt");
+    dispatch_action(&s, ACT_SEND_REQUEST);
+    int first_slot = s.response.view_slot;
+    strcpy(s.editor.url, "file:///tmp/tcurl_dispatch_b.txt");
+    dispatch_action(&s, ACT_SEND_REQUEST);
+    TEST_ASSERT(s.response.view_slot != first_slot);
+    TEST_ASSERT(s.response.slots[first_slot].id > 0);
+    app_state_unlock(&s);
+
+    TEST_ASSERT(wait_for_responses(&s) == 0);
+
+    app_state_lock(&s);
+    TEST_ASSERT(s.response.response.body != NULL);
+    TEST_ASSERT_STR_EQ(s.response.response.body, "beta");
+    dispatch_action(&s, ACT_PREV_RESPONSE);
+    TEST_ASSERT(s.response.view_slot == first_slot);
+    TEST_ASSERT(s.response.response.body != NULL);
+    TEST_ASSERT_STR_EQ(s.response.response.body, "alpha");
+    app_state_unlock(&s);
+
+    http_engine_destroy(s.response.engine);
+    request_slots_free(&s.response);
+    (void)pthread_mutex_destroy(&s.state_mu);
+    cleanup_state(&s);
+    return 0;
+}
+
+static int wake_readable(AppState *s) {
+    struct pollfd p = { .fd = app_state_wake_fd(s), .events = POLLIN };
+    return poll(&p, 1, 0) == 1;
+}
+
+/* Test: a completed request flags the response for repaint and wakes the loop */
+static int test_dispatch_completion_wakes_loop(void) {
+    TEST_ASSERT(write_text_file("/tmp/tcurl_dispatch_wake.txt", "wake") == 0);
+
+    AppState s;
+    init_minimal_state(&s);
+    (void)pthread_mutex_init(&s.state_mu, NULL);
+    request_slots_init(&s.response);
+    TEST_ASSERT(app_state_wake_fd(&s) == -1);
+    TEST_ASSERT(pipe(s.wake_fds) == 0);
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT(fcntl(s.wake_fds[i], F_SETFL, O_NONBLOCK) == 0);
+    }
+
+    app_state_lock(&s);
+    strcpy(s.editor.url, "file:///tmp/tcurl_dispatch_wake.txt");
+    dispatch_action(&s, ACT_SEND_REQUEST);
+    app_state_unlock(&s);
+    TEST_ASSERT(wait_for_responses(&s) == 0);
+
+    app_state_lock(&s);
+    TEST_ASSERT((s.ui.dirty & UI_DIRTY_RESPONSE) != 0);
+    TEST_ASSERT((s.ui.dirty & UI_DIRTY_EDITOR) == 0);
+    app_state_unlock(&s);
+    TEST_ASSERT(wake_readable(&s));
+    app_state_drain_wake(&s);
+    TEST_ASSERT(!wake_readable(&s));
+
+    http_engine_destroy(s.response.engine);
+    request_slots_free(&s.response);
+    close(s.wake_fds[0]);
+    close(s.wake_fds[1]);
+    (void)pthread_mutex_destroy(&s.state_mu);
+    cleanup_state(&s);
+    return 0;
+}
+
 int test_dispatch(void) {
     int failed = 0;
     failed += test_dispatch_quit();
@@ -200,6 +319,9 @@ int test_dispatch(void) {
     failed += test_dispatch_editor_field_toggle();
     failed += test_dispatch_history_navigation();
     failed += test_dispatch_response_scroll();
+    failed += test_dispatch_response_scroll_clamp();
+    failed += test_dispatch_concurrent_sends();
+    failed += test_dispatch_completion_wakes_loop();
     
     if (failed) {
         printf("test_dispatch: FAILED (%d tests)\n", failed);
@@ -0,0 +1,128 @@
+#include "test.h"
+#include "core/text/find_ci.h"
+
+#include <ctype.h>
+#include <string.h>
+#include <stdlib.h>
+
+static const FindCiKernel kernels[] = { FIND_CI_SCALAR, FIND_CI_SSE2, FIND_CI_AVX2 };
+#define KERNEL_COUNT (sizeof(kernels) / sizeof(kernels[0]))
+
+/* Reference the kernels must agree with */
+static const char *naive(const char *hay, size_t hay_n, const char *needle, size_t needle_n) {
+    if (needle_n == 0) return hay;
+    for (size_t i = 0; i + needle_n <= hay_n; i++) {
+        size_t j = 0;
+        while (j < needle_n && tolower((unsigned char)hay[i + j]) == tolower((unsigned char)needle[j])) j++;
+        if (j == needle_n) return hay + i;
+    }
+    return NULL;
+}
+
+static int all_agree(const char *hay, size_t hay_n, const char *needle, size_t needle_n) {
+    const char *want = naive(hay, hay_n, needle, needle_n);
+    for (size_t k = 0; k < KERNEL_COUNT; k++) {
+        if (find_ci_with(kernels[k], hay, hay_n, needle, needle_n) != want) {
+            fprintf(stderr, "find_ci %s disagrees: needle '%.*s' hay_n %zu\n",
+                    find_ci_kernel_name(kernels[k]), (int)needle_n, needle, hay_n);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Test: basic matches, case folding and edge cases */
+static int test_find_ci_basics(void) {
+    const char *hay = "Content-Type: Application/JSON";
+    size_t n = strlen(hay);
+
+    TEST_ASSERT(find_ci(hay, n, "application/json", 16) == hay + 14);
+    TEST_ASSERT(find_ci(hay, n, "CONTENT", 7) == hay);
+    TEST_ASSERT(find_ci(hay, n, "n", 1) == hay + 2);
+    TEST_ASSERT(find_ci(hay, n, "xml", 3) == NULL);
+    TEST_ASSERT(find_ci(hay, n, "", 0) == hay);
+    TEST_ASSERT(find_ci(hay, 3, "content", 7) == NULL);
+
+    /* Only ASCII letters fold: '@' '[' '`' '{' sit next to the letter ranges */
+    TEST_ASSERT(find_ci("x@y", 3, "`", 1) == NULL);
+    TEST_ASSERT(find_ci("x[y", 3, "{", 1) == NULL);
+    TEST_ASSERT(find_ci("\xc3\x89t\xc3\xa9", 5, "\xc3\xa9", 2) != NULL);
+
+    for (size_t k = 0; k < KERNEL_COUNT; k++) {
+        TEST_ASSERT(find_ci_with(kernels[k], hay, n, "json", 4) == hay + 26);
+    }
+    return 0;
+}
+
+/* Test: every kernel agrees with the naive search across block boundaries */
+static int test_find_ci_matches_naive(void) {
+    enum { HAY = 300 };
+    char *hay = malloc(HAY);
+    TEST_ASSERT(hay != NULL);
+
+    /* Small alphabet with mixed case and bytes next to the letter ranges,
+       so partial first/last byte hits are common */
+    const char alphabet[] = "aAbB@[`{zZ\xc1\xe1";
+    unsigned seed = 12345;
+    for (int round = 0; round < 400; round++) {
+        for (size_t i = 0; i < HAY; i++) {
+            seed = seed * 1103515245u + 12345u;
+            hay[i] = alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+        }
+        size_t hay_n = (size_t)(round % HAY) + 1;
+        size_t needle_n = (size_t)(round % 7) + 1;
+        if (needle_n > hay_n) needle_n = hay_n;
+        size_t at = (seed >> 8) % (hay_n - needle_n + 1);
+
+        char needle[8];
+        for (size_t j = 0; j < needle_n; j++) {
+            char c = hay[at + j];
+            needle[j] = (round & 1) ? (char)toupper((unsigned char)c) : c;
+        }
+        TEST_ASSERT(all_agree(hay, hay_n, needle, needle_n));
+
+        /* A needle that cannot occur */
+        TEST_ASSERT(all_agree(hay, hay_n, "q", 1));
+    }
+
+    /* Matches that end exactly at the haystack end, for every tail length */
+    for (size_t hay_n = 1; hay_n <= 100; hay_n++) {
+        memset(hay, 'x', hay_n);
+        hay[hay_n - 1] = 'Z';
+        TEST_ASSERT(all_agree(hay, hay_n, "xz", hay_n >= 2 ? 2 : 1));
+        TEST_ASSERT(all_agree(hay, hay_n, "z", 1));
+    }
+
+    free(hay);
+    return 0;
+}
+
+/* Test: long needles and haystacks that only just hold them */
+static int test_find_ci_long_needle(void) {
+    char hay[200];
+    char needle[70];
+    memset(hay, 'a', sizeof(hay));
+    memset(needle, 'A', sizeof(needle));
+    needle[sizeof(needle) - 1] = 'B';
+    hay[sizeof(hay) - 1] = 'b';
+
+    TEST_ASSERT(all_agree(hay, sizeof(hay), needle, sizeof(needle)));
+    TEST_ASSERT(find_ci(hay, sizeof(hay), needle, sizeof(needle)) == hay + sizeof(hay) - sizeof(needle));
+    TEST_ASSERT(all_agree(hay, sizeof(needle), needle, sizeof(needle)));
+    TEST_ASSERT(all_agree(hay, sizeof(hay) - 1, needle, sizeof(needle)));
+    return 0;
+}
+
+int test_find_ci(void) {
+    int failed = 0;
+    failed += test_find_ci_basics();
+    failed += test_find_ci_matches_naive();
+    failed += test_find_ci_long_needle();
+
+    if (failed) {
+        printf("test_find_ci: FAILED (%d tests)\n", failed);
+        return 1;
+    }
+    printf("test_find_ci: OK\n");
+    return 0;
+}
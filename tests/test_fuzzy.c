@@ -0,0 +1,276 @@
+#include "test.h"
+#include "core/interaction/fuzzy.h"
+#include "core/storage/history.h"
+#include "core/text/textbuf.h"
+#include "core/http/http.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+static int score(const char *text, const char *pattern) {
+    return fuzzy_score(text, strlen(text), pattern, strlen(pattern));
+}
+
+static void push(History *h, int method, const char *url) {
+    TextBuffer empty;
+    tb_init(&empty);
+    history_push(h, method, url, &empty, &empty, NULL);
+    tb_free(&empty);
+}
+
+static void setup(AppState *s, History *h) {
+    memset(s, 0, sizeof(*s));
+    history_init(h);
+    s->history.history = h;
+    s->search.target = SEARCH_TARGET_HISTORY;
+}
+
+static void teardown(AppState *s, History *h) {
+    fuzzy_finder_free(&s->search.fuzzy);
+    history_free(h);
+}
+
+// Test the score of matches and misses
+static int test_fuzzy_score_basics(void) {
+    TEST_ASSERT(score("GET /users", "") == 0);
+    TEST_ASSERT(score("GET /users", "usx") == FUZZY_NO_MATCH);
+    TEST_ASSERT(score("GET /users", "sru") == FUZZY_NO_MATCH);
+    TEST_ASSERT(score("ab", "abc") == FUZZY_NO_MATCH);
+    TEST_ASSERT(score("GET /users", "usr") >= 0);
+    TEST_ASSERT(score("GET /users", "USR") == score("GET /users", "usr"));
+    TEST_ASSERT(score("get /Users", "gus") == score("GET /users", "GUS"));
+    return 0;
+}
+
+// Test that runs, word starts and short windows rank higher
+static int test_fuzzy_score_ranking(void) {
+    /* A run beats the same letters spread out */
+    TEST_ASSERT(score("/users", "user") > score("/u-s-e-r", "user"));
+    /* The start of a word beats its middle */
+    TEST_ASSERT(score("/api/orders", "ord") > score("/api/records", "ord"));
+    /* The shortest window is scored, not the first one */
+    TEST_ASSERT(score("u/user", "user") == score("/user", "user"));
+    return 0;
+}
+
+// Test ranking the history, best first and newest first among equals
+static int test_fuzzy_finder_ranks_history(void) {
+    AppState s;
+    History h;
+    setup(&s, &h);
+
+    push(&h, HTTP_GET, "https://api.example.com/users");        /* 0 */
+    push(&h, HTTP_POST, "https://api.example.com/posts");       /* 1 */
+    push(&h, HTTP_GET, "https://api.example.com/u/s/e/r/s");    /* 2 */
+    push(&h, HTTP_DELETE, "https://api.example.com/users");     /* 3 */
+    s.history.selected = 1;
+
+    fuzzy_finder_begin(&s);
+    fuzzy_finder_update(&s, "users");
+
+    FuzzyFinder *f = &s.search.fuzzy;
+    TEST_ASSERT(f->active == 1);
+    TEST_ASSERT(f->count == 3);
+    TEST_ASSERT(f->items[0] == 3);
+    TEST_ASSERT(f->items[1] == 0);
+    TEST_ASSERT(f->items[2] == 2);
+    TEST_ASSERT(f->cursor == 0);
+    TEST_ASSERT(s.history.selected == 3);
+
+    /* The method is part of the text */
+    fuzzy_finder_update(&s, "post");
+    TEST_ASSERT(f->count == 1);
+    TEST_ASSERT(f->items[0] == 1);
+
+    fuzzy_finder_update(&s, "zzz");
+    TEST_ASSERT(f->active == 1);
+    TEST_ASSERT(f->count == 0);
+
+    teardown(&s, &h);
+    return 0;
+}
+
+/* 0 if the ranking in `s` is the one a fresh search for `query` gives */
+static int same_as_fresh(const AppState *s, History *h, const char *query) {
+    AppState fresh;
+    memset(&fresh, 0, sizeof(fresh));
+    fresh.history.history = h;
+    fuzzy_finder_begin(&fresh);
+    fuzzy_finder_update(&fresh, query);
+
+    const FuzzyFinder *a = &s->search.fuzzy;
+    const FuzzyFinder *b = &fresh.search.fuzzy;
+    int same = a->count == b->count &&
+               (a->count == 0 || memcmp(a->items, b->items, (size_t)a->count * sizeof(int)) == 0);
+    fuzzy_finder_free(&fresh.search.fuzzy);
+    return same ? 0 : 1;
+}
+
+// Test that refining a longer query agrees with ranking it from scratch
+static int test_fuzzy_finder_refine(void) {
+    AppState s;
+    History h;
+    setup(&s, &h);
+
+    char url[128];
+    for (int i = 0; i < 300; i++) {
+        snprintf(url, sizeof(url), "https://svc%d.example.com/v%d/items/%d", i % 7, i % 3, i);
+        push(&h, (i % 2) ? HTTP_POST : HTTP_GET, url);
+    }
+
+    /* Typed one character at a time, then one in the middle, then erased */
+    const char *steps[] = { "s", "sv", "sv1", "sv1i", "sv1ite", "sv6ite", "sv61ite", "sv1", "v1ite" };
+    fuzzy_finder_begin(&s);
+    for (size_t k = 0; k < sizeof(steps) / sizeof(steps[0]); k++) {
+        fuzzy_finder_update(&s, steps[k]);
+        TEST_ASSERT(s.search.fuzzy.count > 0);
+        TEST_ASSERT(same_as_fresh(&s, &h, steps[k]) == 0);
+    }
+
+    teardown(&s, &h);
+    return 0;
+}
+
+// Test that entries added during a search are ranked
+static int test_fuzzy_finder_sees_new_entries(void) {
+    AppState s;
+    History h;
+    setup(&s, &h);
+
+    push(&h, HTTP_GET, "https://a.example.com/orders");
+    fuzzy_finder_begin(&s);
+    fuzzy_finder_update(&s, "ord");
+    TEST_ASSERT(s.search.fuzzy.count == 1);
+
+    push(&h, HTTP_GET, "https://b.example.com/orders");
+    fuzzy_finder_update(&s, "orde");
+    TEST_ASSERT(s.search.fuzzy.count == 2);
+    TEST_ASSERT(s.search.fuzzy.items[0] == 1);
+
+    teardown(&s, &h);
+    return 0;
+}
+
+// Test moving through, accepting and cancelling the ranked list
+static int test_fuzzy_finder_move_accept_cancel(void) {
+    AppState s;
+    History h;
+    setup(&s, &h);
+
+    push(&h, HTTP_GET, "https://api.example.com/orders/1");
+    push(&h, HTTP_GET, "https://api.example.com/health");
+    push(&h, HTTP_GET, "https://api.example.com/orders/2");
+    s.history.selected = 1;
+
+    fuzzy_finder_begin(&s);
+    fuzzy_finder_update(&s, "orders");
+    TEST_ASSERT(s.history.selected == 2);
+
+    fuzzy_finder_move(&s, 1);
+    TEST_ASSERT(s.search.fuzzy.cursor == 1);
+    TEST_ASSERT(s.history.selected == 0);
+    fuzzy_finder_move(&s, 1);
+    TEST_ASSERT(s.search.fuzzy.cursor == 1);
+    fuzzy_finder_move(&s, -1);
+    TEST_ASSERT(s.history.selected == 2);
+
+    /* Cancel puts the selection back */
+    fuzzy_finder_cancel(&s);
+    TEST_ASSERT(s.search.fuzzy.active == 0);
+    TEST_ASSERT(s.history.selected == 1);
+
+    /* An empty query shows the history as it was */
+    fuzzy_finder_begin(&s);
+    fuzzy_finder_update(&s, "ord");
+    TEST_ASSERT(s.history.selected == 2);
+    fuzzy_finder_update(&s, "");
+    TEST_ASSERT(s.search.fuzzy.active == 0);
+    TEST_ASSERT(s.history.selected == 1);
+
+    /* Accept keeps it */
+    fuzzy_finder_update(&s, "ord");
+    fuzzy_finder_move(&s, 1);
+    TEST_ASSERT(fuzzy_finder_accept(&s) == 0);
+    TEST_ASSERT(s.search.fuzzy.active == 0);
+    TEST_ASSERT(s.history.selected == 0);
+
+    fuzzy_finder_begin(&s);
+    fuzzy_finder_update(&s, "zzz");
+    TEST_ASSERT(fuzzy_finder_accept(&s) == -1);
+
+    teardown(&s, &h);
+    return 0;
+}
+
+// Test that the ranked rows follow their entries when the history shifts
+static int test_fuzzy_finder_history_shifts(void) {
+    AppState s;
+    History h;
+    setup(&s, &h);
+
+    push(&h, HTTP_GET, "https://api.example.com/orders/1");
+    push(&h, HTTP_GET, "https://api.example.com/health");
+    push(&h, HTTP_GET, "https://api.example.com/orders/2");
+    s.history.selected = 1;
+
+    fuzzy_finder_begin(&s);
+    fuzzy_finder_update(&s, "orders");
+    TEST_ASSERT(s.history.selected == 2);
+
+    /* The loader prepends older entries and shifts the selection */
+    HistoryItem older[2] = {
+        { .url = strdup("https://api.example.com/health/a"), .disk_offset = -1 },
+        { .url = strdup("https://api.example.com/health/b"), .disk_offset = -1 },
+    };
+    TEST_ASSERT(history_prepend(&h, older, 2) == 0);
+    s.history.selected += 2;
+    TEST_ASSERT(fuzzy_finder_entry(&s, 0) == 4);
+    TEST_ASSERT(fuzzy_finder_entry(&s, 1) == 2);
+
+    fuzzy_finder_move(&s, 1);
+    TEST_ASSERT(s.history.selected == 2);
+    TEST_ASSERT_STR_EQ(history_get(&h, 2)->url, "https://api.example.com/orders/1");
+
+    fuzzy_finder_cancel(&s);
+    TEST_ASSERT_STR_EQ(history_get(&h, s.history.selected)->url, "https://api.example.com/health");
+
+    /* A new request evicts the oldest entry */
+    fuzzy_finder_begin(&s);
+    fuzzy_finder_update(&s, "orders");
+    history_set_limit(&h, 5);
+    push(&h, HTTP_GET, "https://api.example.com/status");
+    TEST_ASSERT(fuzzy_finder_entry(&s, 0) == 3);
+
+    int picked = fuzzy_finder_accept(&s);
+    TEST_ASSERT(picked == 3);
+    TEST_ASSERT(s.history.selected == 3);
+    TEST_ASSERT_STR_EQ(history_get(&h, picked)->url, "https://api.example.com/orders/2");
+
+    /* Entries dropped since the ranking are skipped */
+    fuzzy_finder_begin(&s);
+    fuzzy_finder_update(&s, "health/b");
+    TEST_ASSERT(s.search.fuzzy.count == 1);
+    push(&h, HTTP_GET, "https://api.example.com/status");
+    TEST_ASSERT(fuzzy_finder_entry(&s, 0) == -1);
+    TEST_ASSERT(fuzzy_finder_accept(&s) == -1);
+
+    teardown(&s, &h);
+    return 0;
+}
+
+int test_fuzzy(void) {
+    int failed = 0;
+
+    failed += test_fuzzy_score_basics();
+    failed += test_fuzzy_score_ranking();
+    failed += test_fuzzy_finder_ranks_history();
+    failed += test_fuzzy_finder_refine();
+    failed += test_fuzzy_finder_sees_new_entries();
+    failed += test_fuzzy_finder_move_accept_cancel();
+    failed += test_fuzzy_finder_history_shifts();
+
+    if (failed == 0) {
+        printf("test_fuzzy: OK\n");
+    }
+    return failed;
+}
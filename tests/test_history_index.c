@@ -0,0 +1,164 @@
+#include "test.h"
+#include "core/storage/history_index.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static int add_text(HistoryIndex *idx, unsigned long seq, const char *text) {
+    return history_index_add(idx, seq, text, strlen(text));
+}
+
+/* 1 if `query` gives exactly the `n` seqs in `want` */
+static int query_is(const HistoryIndex *idx, const char *query, const unsigned long *want, size_t n) {
+    unsigned long *seqs = NULL;
+    size_t count = 0;
+    if (history_index_query(idx, query, strlen(query), &seqs, &count) != 0) return 0;
+    int ok = count == n && (n == 0 || memcmp(seqs, want, n * sizeof(*want)) == 0);
+    free(seqs);
+    return ok;
+}
+
+/* Test: substring queries find entries by any field, ignoring case */
+static int test_history_index_query(void) {
+    HistoryIndex *idx = history_index_new();
+    TEST_ASSERT(idx != NULL);
+    TEST_ASSERT(history_index_next_seq(idx) == 1);
+
+    TEST_ASSERT(add_text(idx, 1, "{\"orderId\":\"A7F3-22\"}") == 0);
+    TEST_ASSERT(add_text(idx, 1, "Content-Type: application/json") == 0);
+    TEST_ASSERT(add_text(idx, 2, "{\"orderId\":\"B9C1-04\"}") == 0);
+    TEST_ASSERT(add_text(idx, 4, "X-Request-Id: a7f3-22") == 0);
+    TEST_ASSERT(history_index_count(idx) == 3);
+    TEST_ASSERT(history_index_next_seq(idx) == 5);
+
+    const unsigned long both[] = { 1, 4 };
+    const unsigned long all_orders[] = { 1, 2 };
+    const unsigned long first[] = { 1 };
+    TEST_ASSERT(query_is(idx, "a7f3-22", both, 2));
+    TEST_ASSERT(query_is(idx, "A7F3", both, 2));
+    TEST_ASSERT(query_is(idx, "orderid", all_orders, 2));
+    TEST_ASSERT(query_is(idx, "application/JSON", first, 1));
+    TEST_ASSERT(query_is(idx, "zzz", NULL, 0));
+
+    /* Trigrams do not span the end of one field and the start of the next */
+    TEST_ASSERT(query_is(idx, "22\"}Co", NULL, 0));
+
+    /* Too short to use the index */
+    TEST_ASSERT(query_is(idx, "a7", NULL, 0));
+
+    /* Seqs only grow */
+    TEST_ASSERT(add_text(idx, 3, "late") == 1);
+    TEST_ASSERT(history_index_contains(idx, 2));
+    TEST_ASSERT(!history_index_contains(idx, 3));
+
+    history_index_free(idx);
+    return 0;
+}
+
+/* Test: pruned entries stop matching, before and after compaction */
+static int test_history_index_prune(void) {
+    HistoryIndex *idx = history_index_new();
+    TEST_ASSERT(idx != NULL);
+
+    for (unsigned long seq = 1; seq <= 300; seq++) {
+        char text[64];
+        snprintf(text, sizeof(text), "common entry-%lu%s", seq, seq % 100 == 0 ? " rare" : "");
+        TEST_ASSERT(add_text(idx, seq, text) == 0);
+    }
+    const unsigned long rare[] = { 100, 200, 300 };
+    TEST_ASSERT(query_is(idx, "rare", rare, 3));
+
+    /* Lazily: nothing is compacted yet */
+    history_index_prune(idx, 101, 0);
+    TEST_ASSERT(history_index_count(idx) == 200);
+    TEST_ASSERT(query_is(idx, "rare", rare + 1, 2));
+    TEST_ASSERT(!history_index_contains(idx, 100));
+    TEST_ASSERT(history_index_contains(idx, 101));
+
+    history_index_prune(idx, 250, 1);
+    TEST_ASSERT(history_index_count(idx) == 51);
+    TEST_ASSERT(query_is(idx, "rare", rare + 2, 1));
+    TEST_ASSERT(query_is(idx, "entry-99", NULL, 0));
+
+    unsigned long *seqs = NULL;
+    size_t count = 0;
+    TEST_ASSERT(history_index_query(idx, "common", 6, &seqs, &count) == 0);
+    TEST_ASSERT(count == 51 && seqs[0] == 250 && seqs[50] == 300);
+    free(seqs);
+
+    /* New entries keep going after compaction */
+    TEST_ASSERT(add_text(idx, 301, "rare again") == 0);
+    const unsigned long tail[] = { 300, 301 };
+    TEST_ASSERT(query_is(idx, "rare", tail, 2));
+
+    /* Everything pruned */
+    history_index_prune(idx, 1000, 1);
+    TEST_ASSERT(history_index_count(idx) == 0);
+    TEST_ASSERT(query_is(idx, "common", NULL, 0));
+    TEST_ASSERT(history_index_next_seq(idx) == 302);
+
+    history_index_free(idx);
+    return 0;
+}
+
+/* Test: the index survives a save and load; damaged files are refused */
+static int test_history_index_persist(void) {
+    char path[] = "/tmp/tcurl_index_XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT(fd >= 0);
+    close(fd);
+
+    HistoryIndex *idx = history_index_new();
+    TEST_ASSERT(idx != NULL);
+    for (unsigned long seq = 1; seq <= 50; seq++) {
+        char text[64];
+        snprintf(text, sizeof(text), "{\"id\":\"req-%04lu\"}", seq * 37);
+        TEST_ASSERT(add_text(idx, seq, text) == 0);
+    }
+    history_index_prune(idx, 11, 0);
+    TEST_ASSERT(history_index_save(idx, path) == 0);
+
+    HistoryIndex *loaded = history_index_load(path);
+    TEST_ASSERT(loaded != NULL);
+    TEST_ASSERT(history_index_count(loaded) == 40);
+    TEST_ASSERT(history_index_next_seq(loaded) == 51);
+    const unsigned long one[] = { 20 };
+    TEST_ASSERT(query_is(loaded, "REQ-0740", one, 1));
+    TEST_ASSERT(query_is(loaded, "req-0037", NULL, 0));
+    TEST_ASSERT(add_text(loaded, 51, "{\"id\":\"req-0740\"}") == 0);
+    const unsigned long two[] = { 20, 51 };
+    TEST_ASSERT(query_is(loaded, "req-0740", two, 2));
+    history_index_free(loaded);
+
+    /* Cut short */
+    FILE *f = fopen(path, "r+");
+    TEST_ASSERT(f != NULL);
+    TEST_ASSERT(fseek(f, 0, SEEK_END) == 0);
+    long size = ftell(f);
+    fclose(f);
+    TEST_ASSERT(truncate(path, size - 3) == 0);
+    TEST_ASSERT(history_index_load(path) == NULL);
+
+    TEST_ASSERT(write_text_file(path, "not an index") == 0);
+    TEST_ASSERT(history_index_load(path) == NULL);
+    unlink(path);
+    TEST_ASSERT(history_index_load(path) == NULL);
+
+    history_index_free(idx);
+    return 0;
+}
+
+int test_history_index(void) {
+    int failed = 0;
+    failed += test_history_index_query();
+    failed += test_history_index_prune();
+    failed += test_history_index_persist();
+
+    if (failed) {
+        printf("test_history_index: FAILED (%d tests)\n", failed);
+        return 1;
+    }
+    printf("test_history_index: OK\n");
+    return 0;
+}
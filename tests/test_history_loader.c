@@ -0,0 +1,284 @@
+#include "test.h"
+#include "state.h"
+#include "core/storage/history.h"
+#include "core/storage/history_loader.h"
+#include "core/storage/history_persistence.h"
+#include "core/storage/history_index.h"
+#include "core/text/textbuf.h"
+#include "core/http/http.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <time.h>
+
+static int write_history(const char *path, int entries, int bad_every) {
+    FILE *f = fopen(path, "w");
+    if (!f) return 1;
+    for (int i = 0; i < entries; i++) {
+        if (bad_every && i % bad_every == 0) fputs("{bad\n", f);
+        fprintf(f, "{\"method\":0,\"url\":\"https://h/%d\",\"body\":\"b%d\",\"status\":200}\n", i, i);
+    }
+    return fclose(f) != 0;
+}
+
+static void state_setup(AppState *s, const char *path, int max_entries) {
+    memset(s, 0, sizeof(*s));
+    pthread_mutex_init(&s->state_mu, NULL);
+    s->history.history = malloc(sizeof(*s->history.history));
+    history_init(s->history.history);
+    s->history.path = strdup(path);
+    s->history.max_entries = max_entries;
+}
+
+static void state_teardown(AppState *s) {
+    history_loader_stop(s);
+    history_free(s->history.history);
+    free(s->history.history);
+    free(s->history.path);
+    pthread_mutex_destroy(&s->state_mu);
+}
+
+static int wait_loaded(AppState *s) {
+    for (int i = 0; i < 2000; i++) {
+        app_state_lock(s);
+        int loading = s->history.loading;
+        app_state_unlock(s);
+        if (!loading) return 0;
+        struct timespec ts = { 0, 1000000 };
+        nanosleep(&ts, NULL);
+    }
+    return 1;
+}
+
+static int scan_collect(const HistoryItem *meta, void *userdata) {
+    char *out = userdata;
+    size_t n = strlen(out);
+    snprintf(out + n, 256 - n, "%s;", meta ? meta->url : "!");
+    return 0;
+}
+
+// Test: the file is walked newest first, with no line length limit
+static int test_scan_newest(void) {
+    const char *path = "/tmp/tcurl_history_scan.jsonl";
+    size_t big = 200000;
+    char *body = malloc(big + 1);
+    TEST_ASSERT(body != NULL);
+    memset(body, 'x', big);
+    body[big] = '\0';
+
+    FILE *f = fopen(path, "w");
+    TEST_ASSERT(f != NULL);
+    fprintf(f, "{\"url\":\"a\"}\n{oops\n\n{\"url\":\"b\",\"body\":\"%s\"}\n{\"url\":\"c\"}", body);
+    TEST_ASSERT(fclose(f) == 0);
+    free(body);
+
+    struct stat st;
+    TEST_ASSERT(stat(path, &st) == 0);
+
+    char seen[256] = "";
+    TEST_ASSERT(history_storage_scan_newest(path, st.st_size, scan_collect, seen) == 0);
+    TEST_ASSERT_STR_EQ(seen, "c;b;!;a;");
+
+    /* Bytes past `end` are not visited */
+    seen[0] = '\0';
+    TEST_ASSERT(history_storage_scan_newest(path, 12, scan_collect, seen) == 0);
+    TEST_ASSERT_STR_EQ(seen, "a;");
+
+    seen[0] = '\0';
+    TEST_ASSERT(history_storage_scan_newest("/tmp/tcurl_history_scan_missing.jsonl", 0, scan_collect, seen) == 0);
+    TEST_ASSERT_STR_EQ(seen, "");
+    return 0;
+}
+
+// Test: a full background load matches the file, oldest entry first
+static int test_loader_full(void) {
+    const char *path = "/tmp/tcurl_history_bg.jsonl";
+    TEST_ASSERT(write_history(path, 300, 100) == 0);
+
+    AppState s;
+    state_setup(&s, path, 1000);
+    TEST_ASSERT(history_loader_start(&s) == 0);
+    TEST_ASSERT(wait_loaded(&s) == 0);
+
+    History *h = s.history.history;
+    TEST_ASSERT(h->count == 300);
+    TEST_ASSERT(s.history.loaded_ok == 300);
+    TEST_ASSERT(s.history.skipped_invalid == 3);
+    TEST_ASSERT_STR_EQ(h->backing_path, path);
+    TEST_ASSERT_STR_EQ(history_get(h, 0)->url, "https://h/0");
+    TEST_ASSERT_STR_EQ(history_get(h, 299)->url, "https://h/299");
+
+    TEST_ASSERT(history_storage_page_in(h, history_get(h, 150)) == 0);
+    TEST_ASSERT_STR_EQ(history_get(h, 150)->body, "b150");
+
+    state_teardown(&s);
+    return 0;
+}
+
+// Test: only the newest max_entries are read
+static int test_loader_stops_at_max(void) {
+    const char *path = "/tmp/tcurl_history_bg_max.jsonl";
+    TEST_ASSERT(write_history(path, 500, 0) == 0);
+
+    AppState s;
+    state_setup(&s, path, 10);
+    TEST_ASSERT(history_loader_start(&s) == 0);
+    TEST_ASSERT(wait_loaded(&s) == 0);
+
+    History *h = s.history.history;
+    TEST_ASSERT(h->count == 10);
+    TEST_ASSERT(s.history.loaded_ok == 10);
+    TEST_ASSERT_STR_EQ(history_get(h, 0)->url, "https://h/490");
+    TEST_ASSERT_STR_EQ(history_get(h, 9)->url, "https://h/499");
+
+    state_teardown(&s);
+    return 0;
+}
+
+// Test: the load walks every segment of the log, newest segment first
+static int test_loader_segments(void) {
+    const char *path = "/tmp/tcurl_history_bg_seg.jsonl";
+    TEST_ASSERT(write_text_file(path, "{\"url\":\"s0-a\"}\n{\"url\":\"s0-b\"}\n") == 0);
+    TEST_ASSERT(write_text_file("/tmp/tcurl_history_bg_seg.jsonl.1", "{\"url\":\"s1-a\"}\n") == 0);
+    TEST_ASSERT(write_text_file("/tmp/tcurl_history_bg_seg.jsonl.3", "{\"url\":\"s3-a\"}\n{\"url\":\"s3-b\"}\n") == 0);
+
+    AppState s;
+    state_setup(&s, path, 4);
+    TEST_ASSERT(history_loader_start(&s) == 0);
+    TEST_ASSERT(wait_loaded(&s) == 0);
+
+    History *h = s.history.history;
+    TEST_ASSERT(h->count == 4);
+    TEST_ASSERT_STR_EQ(history_get(h, 0)->url, "s0-b");
+    TEST_ASSERT_STR_EQ(history_get(h, 1)->url, "s1-a");
+    TEST_ASSERT_STR_EQ(history_get(h, 3)->url, "s3-b");
+    TEST_ASSERT(history_get(h, 0)->disk_segment == 0);
+    TEST_ASSERT(history_get(h, 3)->disk_segment == 3);
+    TEST_ASSERT(history_storage_page_in(h, history_get(h, 3)) == 0);
+
+    state_teardown(&s);
+    unlink("/tmp/tcurl_history_bg_seg.jsonl.1");
+    unlink("/tmp/tcurl_history_bg_seg.jsonl.3");
+    return 0;
+}
+
+// Test: stopping right away is safe and a missing file starts nothing
+static int test_loader_cancel(void) {
+    const char *path = "/tmp/tcurl_history_bg_cancel.jsonl";
+    TEST_ASSERT(write_history(path, 2000, 0) == 0);
+
+    AppState s;
+    state_setup(&s, path, 100000);
+    TEST_ASSERT(history_loader_start(&s) == 0);
+    history_loader_stop(&s);
+    TEST_ASSERT(!s.history.loading);
+    TEST_ASSERT(s.history.history->count <= 2000);
+    TEST_ASSERT(s.history.loaded_ok == s.history.history->count);
+    state_teardown(&s);
+
+    state_setup(&s, "/tmp/tcurl_history_bg_missing.jsonl", 100);
+    TEST_ASSERT(history_loader_start(&s) == 1);
+    TEST_ASSERT(!s.history.loading);
+    state_teardown(&s);
+    return 0;
+}
+
+// Test: the saved full-text index is installed by the worker
+static int test_loader_fulltext(void) {
+    const char *path = "/tmp/tcurl_history_bg_fulltext.jsonl";
+    char *index_path = history_storage_fulltext_path(path);
+    TEST_ASSERT(index_path != NULL);
+    TEST_ASSERT(write_text_file(path, "{\"seq\":1,\"url\":\"a\"}\n{\"seq\":2,\"url\":\"b\"}\n") == 0);
+
+    HistoryIndex *saved = history_index_new();
+    TEST_ASSERT(saved != NULL);
+    TEST_ASSERT(history_index_add(saved, 1, "invoice", 7) == 0);
+    TEST_ASSERT(history_index_add(saved, 2, "receipt", 7) == 0);
+    TEST_ASSERT(history_index_save(saved, index_path) == 0);
+    history_index_free(saved);
+
+    AppState s;
+    state_setup(&s, path, 100);
+    s.history.fulltext = 1;
+    TEST_ASSERT(history_loader_start(&s) == 0);
+    TEST_ASSERT(wait_loaded(&s) == 0);
+
+    History *h = s.history.history;
+    TEST_ASSERT(h->count == 2);
+    TEST_ASSERT(h->fulltext != NULL);
+    TEST_ASSERT(history_index_count(h->fulltext) == 2);
+    TEST_ASSERT(h->next_seq == 3);
+    state_teardown(&s);
+
+    /* Without a log there is nothing to read: an empty index is started */
+    state_setup(&s, "/tmp/tcurl_history_bg_fulltext_missing.jsonl", 100);
+    s.history.fulltext = 1;
+    TEST_ASSERT(history_loader_start(&s) == 1);
+    TEST_ASSERT(s.history.history->fulltext != NULL);
+    TEST_ASSERT(history_index_count(s.history.history->fulltext) == 0);
+    state_teardown(&s);
+
+    unlink(index_path);
+    free(index_path);
+    return 0;
+}
+
+// Test: seqs in the log that the saved index missed are not handed out again
+static int test_loader_fulltext_behind(void) {
+    const char *path = "/tmp/tcurl_history_bg_behind.jsonl";
+    char *index_path = history_storage_fulltext_path(path);
+    TEST_ASSERT(index_path != NULL);
+    /* Saved with seqs 1-2; seqs 3-4 were logged before a crash, and the
+       newest entries, the only ones loaded, were recorded with it off */
+    TEST_ASSERT(write_text_file(path,
+        "{\"seq\":1,\"url\":\"a\"}\n{\"seq\":2,\"url\":\"b\"}\n"
+        "{\"seq\":3,\"url\":\"c\",\"body\":\"invoice\"}\n{\"seq\":4,\"url\":\"d\"}\n"
+        "{\"url\":\"e\"}\n{\"url\":\"f\"}\n") == 0);
+
+    HistoryIndex *saved = history_index_new();
+    TEST_ASSERT(saved != NULL);
+    TEST_ASSERT(history_index_add(saved, 2, "receipt", 7) == 0);
+    TEST_ASSERT(history_index_save(saved, index_path) == 0);
+    history_index_free(saved);
+
+    AppState s;
+    state_setup(&s, path, 2);
+    s.history.fulltext = 1;
+    TEST_ASSERT(history_loader_start(&s) == 0);
+    TEST_ASSERT(wait_loaded(&s) == 0);
+
+    History *h = s.history.history;
+    TEST_ASSERT(h->count == 2);
+    TEST_ASSERT(h->fulltext != NULL);
+    TEST_ASSERT(h->next_seq == 5);
+
+    TextBuffer body;
+    tb_init(&body);
+    tb_set_from_string(&body, "invoice");
+    history_push(h, HTTP_POST, "g", &body, &body, NULL);
+    tb_free(&body);
+    TEST_ASSERT(history_get(h, h->count - 1)->seq == 5);
+
+    state_teardown(&s);
+    unlink(index_path);
+    free(index_path);
+    return 0;
+}
+
+int test_history_loader(void) {
+    int failed = 0;
+    failed += test_scan_newest();
+    failed += test_loader_full();
+    failed += test_loader_stops_at_max();
+    failed += test_loader_segments();
+    failed += test_loader_cancel();
+    failed += test_loader_fulltext();
+    failed += test_loader_fulltext_behind();
+
+    if (failed) {
+        printf("test_history_loader: FAILED (%d tests)\n", failed);
+        return 1;
+    }
+    printf("test_history_loader: OK\n");
+    return 0;
+}
@@ -1,10 +1,516 @@
 #include "test.h"
 
 #include "core/storage/history.h"
+#include "core/storage/history_index.h"
 #include "core/storage/history_persistence.h"
 #include "core/text/textbuf.h"
 #include "state.h"
 
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Test: loading keeps bodies on disk until an entry is paged in */
+static int test_history_storage_lazy(void) {
+    const char *path = "/tmp/tcurl_history_lazy.jsonl";
+    TEST_ASSERT(write_text_file(path,
+        "{\"method\":0,\"url\":\"https://a\",\"body\":\"\",\"headers\":\"\",\"status\":200,"
+        "\"elapsed_ms\":1,\"is_json\":0,\"response_body\":\"ok\",\"response_body_view\":\"ok\"}\n"
+        "\n"
+        "{\"body\":\"{\\\"k\\\":[1,\\\"}\\\"]}\",\"url\":\"https://b\",\"method\":1,\"status\":201,"
+        "\"timing\":{\"ttfb_ms\":3.5,\"connection_reused\":1},\"response_body\":null}\n"
+        "{\"method\":0,\"url\":\"https://c\"} trailing\n") == 0);
+
+    History h;
+    history_init(&h);
+    HistoryLoadStats stats;
+    TEST_ASSERT(history_storage_load_with_stats(&h, path, &stats) == 0);
+    TEST_ASSERT(stats.loaded_ok == 2);
+    TEST_ASSERT(stats.skipped_invalid == 1);
+    TEST_ASSERT(h.count == 2);
+    TEST_ASSERT_STR_EQ(h.backing_path, path);
+
+    HistoryItem *b = history_get(&h, 1);
+    TEST_ASSERT(!b->paged_in);
+    TEST_ASSERT(b->body == NULL && b->response_body == NULL);
+    TEST_ASSERT_STR_EQ(b->url, "https://b");
+    TEST_ASSERT(b->method == 1 && b->status == 201);
+    TEST_ASSERT(b->timing.ttfb_ms == 3.5 && b->timing.connection_reused == 1);
+
+    TEST_ASSERT(history_storage_page_in(&h, b) == 0);
+    TEST_ASSERT(b->paged_in);
+    TEST_ASSERT_STR_EQ(b->body, "{\"k\":[1,\"}\"]}");
+    TEST_ASSERT_STR_EQ(b->headers, "");
+    TEST_ASSERT(b->response_body == NULL);
+
+    /* Rewriting the backing file keeps unloaded entries and moves their offsets */
+    history_trim_oldest(&h, 1);
+    TextBuffer body;
+    tb_init(&body);
+    tb_set_from_string(&body, "new");
+    HttpResponse r;
+    memset(&r, 0, sizeof(r));
+    r.status = 204;
+    history_push(&h, HTTP_PUT, "https://d", &body, &body, &r);
+    tb_free(&body);
+
+    TEST_ASSERT(history_storage_save(&h, path) == 0);
+    TEST_ASSERT(history_storage_append_last(&h, path) == 0);
+    TEST_ASSERT(history_get(&h, 1)->disk_offset > history_get(&h, 0)->disk_offset);
+    history_free(&h);
+
+    history_init(&h);
+    TEST_ASSERT(history_storage_load_with_stats(&h, path, &stats) == 0);
+    TEST_ASSERT(stats.loaded_ok == 3);
+    TEST_ASSERT(stats.skipped_invalid == 0);
+    for (int i = 0; i < h.count; i++) {
+        TEST_ASSERT(history_storage_page_in(&h, history_get(&h, i)) == 0);
+    }
+    TEST_ASSERT_STR_EQ(history_get(&h, 0)->body, "{\"k\":[1,\"}\"]}");
+    TEST_ASSERT_STR_EQ(history_get(&h, 1)->body, "new");
+    TEST_ASSERT_STR_EQ(history_get(&h, 2)->url, "https://d");
+
+    /* A file rewritten behind our back is detected, not misread */
+    HistoryItem *first = history_get(&h, 0);
+    free(first->body);
+    first->body = NULL;
+    first->paged_in = 0;
+    first->disk_offset = history_get(&h, 1)->disk_offset;
+    TEST_ASSERT(history_storage_page_in(&h, first) == 1);
+    TEST_ASSERT(!first->paged_in);
+
+    history_free(&h);
+    return 0;
+}
+
+/* Test: a capped history overwrites its oldest entries in place */
+static int test_history_ring(void) {
+    History h;
+    history_init(&h);
+    history_set_limit(&h, 4);
+
+    char url[32];
+    HistoryItem meta = { .disk_offset = -1 };
+    meta.url = url;
+    for (int i = 0; i < 10; i++) {
+        snprintf(url, sizeof(url), "https://r/%d", i);
+        TEST_ASSERT(history_push_unloaded(&h, &meta) == 0);
+    }
+    TEST_ASSERT(h.count == 4);
+    TEST_ASSERT(h.capacity == 4);
+    TEST_ASSERT_STR_EQ(history_get(&h, 0)->url, "https://r/6");
+    TEST_ASSERT_STR_EQ(history_get(&h, 3)->url, "https://r/9");
+    TEST_ASSERT(history_get(&h, 4) == NULL);
+
+    /* Prepending wraps around the start of the array */
+    history_trim_oldest(&h, 1);
+    HistoryItem older[2] = { { .url = strdup("https://r/a") }, { .url = strdup("https://r/b") } };
+    TEST_ASSERT(history_prepend(&h, older, 2) == 0);
+    TEST_ASSERT(h.count == 3);
+    TEST_ASSERT_STR_EQ(history_get(&h, 0)->url, "https://r/a");
+    TEST_ASSERT_STR_EQ(history_get(&h, 1)->url, "https://r/b");
+    TEST_ASSERT_STR_EQ(history_get(&h, 2)->url, "https://r/9");
+
+    /* Entries beyond the limit are refused rather than partly inserted */
+    HistoryItem extra[2] = { { .url = NULL }, { .url = NULL } };
+    TEST_ASSERT(history_prepend(&h, extra, 2) == 1);
+    TEST_ASSERT(h.count == 3);
+
+    /* Lowering the limit drops the oldest and shrinks the array */
+    history_set_limit(&h, 2);
+    TEST_ASSERT(h.count == 2 && h.capacity == 2);
+    TEST_ASSERT_STR_EQ(history_get(&h, 0)->url, "https://r/b");
+    TEST_ASSERT_STR_EQ(history_get(&h, 1)->url, "https://r/9");
+
+    history_free(&h);
+    return 0;
+}
+
+static int file_contains(const char *path, const char *needle) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+    char buf[4096];
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+    return strstr(buf, needle) != NULL;
+}
+
+static void push_response(History *h, const char *url, const char *body, int is_json) {
+    TextBuffer empty;
+    tb_init(&empty);
+    HttpResponse r;
+    memset(&r, 0, sizeof(r));
+    r.status = 200;
+    r.is_json = is_json;
+    r.body = strdup(body);
+    r.body_view = strdup(body);
+    history_push(h, HTTP_GET, url, &empty, &empty, &r);
+    free(r.body);
+    free(r.body_view);
+    tb_free(&empty);
+}
+
+/* Test: repeated responses are held and written once, and dropped with their last entry */
+static int test_history_shared_bodies(void) {
+    const char *path = "/tmp/tcurl_history_shared.jsonl";
+    unlink(path);
+    (void)history_storage_sweep_bodies(path, NULL, 0, NULL);
+
+    char big[4096];
+    memset(big, 'a', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    BodyHash old_hash;
+    body_hash(big, strlen(big), &old_hash);
+
+    History h;
+    history_init(&h);
+    for (int i = 0; i < 5; i++) push_response(&h, "https://poll", big, 0);
+    TEST_ASSERT(h.bodies.count == 1);
+    TEST_ASSERT(history_get(&h, 0)->response_body == history_get(&h, 4)->response_body);
+
+    TEST_ASSERT(history_storage_save(&h, path) == 0);
+    struct stat st;
+    TEST_ASSERT(stat(path, &st) == 0);
+    TEST_ASSERT(st.st_size < (off_t)sizeof(big));
+    TEST_ASSERT(history_storage_has_body(path, &old_hash));
+
+    /* Paging in shares the copy too */
+    History loaded;
+    history_init(&loaded);
+    TEST_ASSERT(history_storage_load(&loaded, path) == 0);
+    TEST_ASSERT(loaded.count == 5);
+    TEST_ASSERT(history_storage_page_in(&loaded, history_get(&loaded, 0)) == 0);
+    TEST_ASSERT(history_storage_page_in(&loaded, history_get(&loaded, 3)) == 0);
+    TEST_ASSERT_STR_EQ(history_get(&loaded, 3)->response_body, big);
+    TEST_ASSERT(history_get(&loaded, 0)->response_body == history_get(&loaded, 3)->response_body);
+    TEST_ASSERT(loaded.bodies.count == 1);
+    history_free(&loaded);
+
+    /* Once no entry refers to a body, saving deletes it */
+    big[0] = 'b';
+    BodyHash new_hash;
+    body_hash(big, strlen(big), &new_hash);
+    push_response(&h, "https://poll", big, 0);
+    history_trim_oldest(&h, 1);
+    TEST_ASSERT(h.bodies.count == 1);
+    TEST_ASSERT(history_storage_save(&h, path) == 0);
+    TEST_ASSERT(history_storage_has_body(path, &new_hash));
+    TEST_ASSERT(!history_storage_has_body(path, &old_hash));
+
+    history_trim_oldest(&h, 0);
+    TEST_ASSERT(history_storage_save(&h, path) == 0);
+    TEST_ASSERT(!history_storage_has_body(path, &new_hash));
+    TEST_ASSERT(access("/tmp/tcurl_history_shared.jsonl.bodies", F_OK) != 0);
+
+    history_free(&h);
+    return 0;
+}
+
+/* Test: views are derived from the body when shown, and only the last few are kept */
+static int test_history_views(void) {
+    const char *path = "/tmp/tcurl_history_views.jsonl";
+    TEST_ASSERT(write_text_file(path,
+        "{\"method\":0,\"url\":\"https://j\",\"status\":200,\"is_json\":1,"
+        "\"response_body\":\"{\\\"a\\\":1}\",\"response_body_view\":\"stale\"}\n") == 0);
+
+    History h;
+    history_init(&h);
+    TEST_ASSERT(history_storage_load(&h, path) == 0);
+    HistoryItem *it = history_get(&h, 0);
+    TEST_ASSERT(history_item_view(&h, it) == NULL);
+    TEST_ASSERT(history_storage_page_in(&h, it) == 0);
+    const char *view = history_item_view(&h, it);
+    TEST_ASSERT(view != NULL && strchr(view, '\n') != NULL);
+    TEST_ASSERT(strstr(view, "stale") == NULL);
+    TEST_ASSERT(history_item_view(&h, it) == view);
+
+    /* Files from older versions lose the stored view when rewritten */
+    TEST_ASSERT(history_storage_save(&h, path) == 0);
+    TEST_ASSERT(file_contains(path, "https://j"));
+    TEST_ASSERT(!file_contains(path, "response_body_view"));
+
+    char body[32];
+    for (int i = 0; i < HISTORY_VIEW_CACHE_ENTRIES + 1; i++) {
+        snprintf(body, sizeof(body), "{\"n\":%d}", i);
+        push_response(&h, "https://j", body, 1);
+    }
+    for (int i = 1; i < h.count; i++) TEST_ASSERT(history_item_view(&h, history_get(&h, i)) != NULL);
+    TEST_ASSERT(h.nviews == HISTORY_VIEW_CACHE_ENTRIES);
+    for (int i = 0; i < h.nviews; i++) {
+        TEST_ASSERT(h.views[i].body != history_get(&h, 0)->response_body);
+        TEST_ASSERT(h.views[i].body != history_get(&h, 1)->response_body);
+    }
+    TEST_ASSERT(h.views[0].body == history_get(&h, h.count - 1)->response_body);
+
+    /* Identical bodies share a view; other bodies are shown as they are */
+    push_response(&h, "https://j", body, 1);
+    TEST_ASSERT(history_item_view(&h, history_get(&h, h.count - 1)) == h.views[0].view);
+    push_response(&h, "https://t", "plain", 0);
+    TEST_ASSERT(history_item_view(&h, history_get(&h, h.count - 1)) == history_get(&h, h.count - 1)->response_body);
+
+    history_free(&h);
+    return 0;
+}
+
+/* Test: bodies are compressed per entry, and older and newer lines are told apart */
+static int test_history_compression(void) {
+    const char *path = "/tmp/tcurl_history_compress.jsonl";
+    unlink(path);
+    (void)history_storage_sweep_bodies(path, NULL, 0, NULL);
+    history_storage_set_compression(6, 64);
+
+    char request[2048];
+    char response[8192];
+    size_t n = 0;
+    for (int i = 0; n + 32 < sizeof(request); i++) n += (size_t)snprintf(request + n, sizeof(request) - n, "{\"id\":%d},", i);
+    n = 0;
+    for (int i = 0; n + 32 < sizeof(response); i++) n += (size_t)snprintf(response + n, sizeof(response) - n, "line %d ok\n", i);
+
+    TextBuffer b;
+    TextBuffer hd;
+    tb_init(&b);
+    tb_init(&hd);
+    tb_set_from_string(&b, request);
+    HttpResponse r;
+    memset(&r, 0, sizeof(r));
+    r.status = 200;
+    r.body = response;
+    r.body_view = response;
+    History h;
+    history_init(&h);
+    history_push(&h, HTTP_POST, "https://z", &b, &hd, &r);
+    tb_free(&b);
+    tb_free(&hd);
+
+    TEST_ASSERT(history_storage_save(&h, path) == 0);
+    history_free(&h);
+    struct stat st;
+    TEST_ASSERT(stat(path, &st) == 0);
+    TEST_ASSERT(st.st_size < (off_t)strlen(request) / 2);
+    TEST_ASSERT(file_contains(path, "\"v\":2"));
+    TEST_ASSERT(file_contains(path, "\"body_z\":\""));
+
+    BodyHash hash;
+    char hex[BODY_HASH_HEX_LEN + 1];
+    char blob[256];
+    body_hash(response, strlen(response), &hash);
+    body_hash_hex(&hash, hex);
+    snprintf(blob, sizeof(blob), "%s.bodies/%s.z", path, hex);
+    TEST_ASSERT(stat(blob, &st) == 0);
+    TEST_ASSERT(st.st_size < (off_t)strlen(response) / 2);
+
+    history_init(&h);
+    TEST_ASSERT(history_storage_load(&h, path) == 0);
+    TEST_ASSERT(history_storage_page_in(&h, history_get(&h, 0)) == 0);
+    TEST_ASSERT_STR_EQ(history_get(&h, 0)->body, request);
+    TEST_ASSERT_STR_EQ(history_get(&h, 0)->response_body, response);
+
+    /* With compression off, entries are written as they are */
+    history_storage_set_compression(0, 0);
+    char *line = history_storage_format_entry(history_get(&h, 0));
+    TEST_ASSERT(line != NULL && strstr(line, "_z\"") == NULL && strstr(line, "\"body\":\"{") != NULL);
+    free(line);
+    history_trim_oldest(&h, 0);
+    TEST_ASSERT(history_storage_save(&h, path) == 0);
+    history_free(&h);
+
+    /* Unversioned lines hold plain strings only; newer formats are skipped */
+    TEST_ASSERT(write_text_file(path,
+        "{\"method\":0,\"url\":\"https://old\",\"body\":\"plain\",\"body_z\":\"eJw=\",\"response_body\":\"ok\"}\n"
+        "{\"v\":3,\"method\":0,\"url\":\"https://new\"}\n") == 0);
+    HistoryLoadStats stats;
+    history_init(&h);
+    TEST_ASSERT(history_storage_load_with_stats(&h, path, &stats) == 0);
+    TEST_ASSERT(stats.loaded_ok == 1 && stats.skipped_invalid == 1);
+    TEST_ASSERT(history_storage_page_in(&h, history_get(&h, 0)) == 0);
+    TEST_ASSERT_STR_EQ(history_get(&h, 0)->body, "plain");
+    TEST_ASSERT_STR_EQ(history_get(&h, 0)->response_body, "ok");
+    history_free(&h);
+
+    history_storage_set_compression(HISTORY_COMPRESS_LEVEL_DEFAULT, HISTORY_COMPRESS_MIN_BYTES_DEFAULT);
+    return 0;
+}
+
+/* Test: history.conf settings are read, and out-of-range values keep their defaults */
+static int test_history_config(void) {
+    const char *path = "/tmp/tcurl_history_test.conf";
+    HistoryConfig conf;
+
+    history_config_load("/tmp/tcurl_no_such_history.conf", &conf);
+    TEST_ASSERT(conf.max_entries == 500);
+    TEST_ASSERT(conf.compress_level == HISTORY_COMPRESS_LEVEL_DEFAULT);
+    TEST_ASSERT(conf.compress_min_bytes == HISTORY_COMPRESS_MIN_BYTES_DEFAULT);
+
+    TEST_ASSERT(write_text_file(path,
+        "max_entries = 42\n"
+        "compress_level = 0   # off\n"
+        "compress_min_bytes = 4096\n") == 0);
+    history_config_load(path, &conf);
+    TEST_ASSERT(conf.max_entries == 42);
+    TEST_ASSERT(conf.compress_level == 0);
+    TEST_ASSERT(conf.compress_min_bytes == 4096);
+
+    TEST_ASSERT(write_text_file(path,
+        "compress_level = 10\n"
+        "compress_min_bytes = -1\n") == 0);
+    history_config_load(path, &conf);
+    TEST_ASSERT(conf.compress_level == HISTORY_COMPRESS_LEVEL_DEFAULT);
+    TEST_ASSERT(conf.compress_min_bytes == HISTORY_COMPRESS_MIN_BYTES_DEFAULT);
+    TEST_ASSERT(conf.fulltext_index == 0);
+
+    TEST_ASSERT(write_text_file(path, "fulltext_index = 1\n") == 0);
+    history_config_load(path, &conf);
+    TEST_ASSERT(conf.fulltext_index == 1);
+    unlink(path);
+    return 0;
+}
+
+/* Test: seqs of indexed entries survive the log, and the index its file */
+static int test_history_fulltext(void) {
+    const char *path = "/tmp/tcurl_history_fulltext.jsonl";
+    char *index_path = history_storage_fulltext_path(path);
+    TEST_ASSERT(index_path != NULL);
+    unlink(path);
+    unlink(index_path);
+
+    History h;
+    history_init(&h);
+    TEST_ASSERT(history_storage_load_fulltext(&h, path) == 0);
+    TEST_ASSERT(h.fulltext != NULL);
+
+    TextBuffer body;
+    tb_init(&body);
+    HttpResponse r;
+    memset(&r, 0, sizeof(r));
+    r.status = 200;
+    for (int i = 0; i < 3; i++) {
+        char text[64];
+        snprintf(text, sizeof(text), "{\"invoice\":\"INV-%d\"}", 500 + i);
+        tb_set_from_string(&body, text);
+        history_push(&h, HTTP_POST, "https://pay", &body, &body, &r);
+    }
+    tb_free(&body);
+    TEST_ASSERT(history_get(&h, 2)->seq == 3);
+    TEST_ASSERT(history_storage_save(&h, path) == 0);
+    TEST_ASSERT(history_storage_save_fulltext(&h, path) == 0);
+    history_free(&h);
+
+    /* Loaded entries keep their seq; new ones continue after them */
+    history_init(&h);
+    TEST_ASSERT(history_storage_load(&h, path) == 0);
+    TEST_ASSERT(history_storage_load_fulltext(&h, path) == 0);
+    TEST_ASSERT(h.count == 3);
+    TEST_ASSERT(history_get(&h, 0)->seq == 1 && history_get(&h, 2)->seq == 3);
+    TEST_ASSERT(h.next_seq == 4);
+    TEST_ASSERT(history_index_count(h.fulltext) == 3);
+
+    unsigned long *seqs = NULL;
+    size_t n = 0;
+    TEST_ASSERT(history_index_query(h.fulltext, "inv-501", 7, &seqs, &n) == 0);
+    TEST_ASSERT(n == 1 && seqs[0] == 2);
+    free(seqs);
+    history_free(&h);
+
+    /* Lines formatted before the entry had a seq get it added */
+    char *line = history_storage_set_line_seq(strdup("{\"v\":2,\"url\":\"x\"}"), 42);
+    TEST_ASSERT(line != NULL);
+    TEST_ASSERT_STR_EQ(line, "{\"seq\":42,\"v\":2,\"url\":\"x\"}");
+    free(line);
+    line = history_storage_set_line_seq(strdup("{}"), 7);
+    TEST_ASSERT_STR_EQ(line, "{\"seq\":7}");
+    free(line);
+
+    unlink(path);
+    unlink(index_path);
+    free(index_path);
+    return 0;
+}
+
+/* Test: entries longer than any read buffer load and page in whole */
+static int test_history_long_lines(void) {
+    const char *path = "/tmp/tcurl_history_long.jsonl";
+    size_t n = 200 * 1024;
+    char *text = malloc(n + 256);
+    TEST_ASSERT(text != NULL);
+    int head = snprintf(text, 256, "{\"method\":1,\"url\":\"https://long\",\"status\":201,\"body\":\"");
+    memset(text + head, 'q', n);
+    snprintf(text + head + n, 256, "\"}\n  \n{\"method\":0,\"url\":\"https://short\"}");
+    TEST_ASSERT(write_text_file(path, text) == 0);
+    free(text);
+
+    History h;
+    history_init(&h);
+    HistoryLoadStats stats;
+    TEST_ASSERT(history_storage_load_with_stats(&h, path, &stats) == 0);
+    TEST_ASSERT(stats.loaded_ok == 2 && stats.skipped_invalid == 0);
+    TEST_ASSERT(history_get(&h, 0)->status == 201);
+    TEST_ASSERT_STR_EQ(history_get(&h, 1)->url, "https://short");
+    TEST_ASSERT(history_storage_page_in(&h, history_get(&h, 0)) == 0);
+    TEST_ASSERT(strlen(history_get(&h, 0)->body) == n);
+    history_free(&h);
+    return 0;
+}
+
+typedef struct {
+    int next;           /* Index expected from the callback */
+    int invalid;
+    int misordered;
+} ScanCheck;
+
+static int check_scan_order(const HistoryItem *meta, void *userdata) {
+    ScanCheck *c = userdata;
+    char want[32];
+    if (!meta) {
+        c->invalid++;
+        return 0;
+    }
+    snprintf(want, sizeof(want), "https://p/%d", c->next--);
+    if (strcmp(meta->url, want) != 0) c->misordered++;
+    return 0;
+}
+
+/* Test: a log parsed by several threads loads and scans in file order */
+static int test_history_parallel_parse(void) {
+    const char *path = "/tmp/tcurl_history_parallel.jsonl";
+    const int n = 30000;
+    FILE *f = fopen(path, "w");
+    TEST_ASSERT(f != NULL);
+    for (int i = 0; i < n; i++) {
+        fprintf(f, "{\"method\":%d,\"url\":\"https://p/%d\",\"status\":%d,\"body\":\"b%d\"}\n", i % 4, i, 200 + i % 3, i);
+        if (i % 1000 == 500) fputs("{broken\n\n", f);
+    }
+    TEST_ASSERT(fclose(f) == 0);
+
+    for (int threads = 1; threads <= 4; threads += 3) {
+        history_storage_set_parse_threads(threads);
+
+        History h;
+        history_init(&h);
+        HistoryLoadStats stats;
+        TEST_ASSERT(history_storage_load_with_stats(&h, path, &stats) == 0);
+        TEST_ASSERT(stats.loaded_ok == n && stats.skipped_invalid == n / 1000);
+        for (int i = 0; i < n; i += 997) {
+            char want[32];
+            snprintf(want, sizeof(want), "https://p/%d", i);
+            HistoryItem *it = history_get(&h, i);
+            TEST_ASSERT_STR_EQ(it->url, want);
+            TEST_ASSERT(it->method == i % 4 && it->status == 200 + i % 3);
+        }
+        HistoryItem *last = history_get(&h, n - 1);
+        TEST_ASSERT(history_storage_page_in(&h, last) == 0);
+        TEST_ASSERT_STR_EQ(last->body, "b29999");
+        history_free(&h);
+
+        ScanCheck check = { .next = n - 1, .invalid = 0, .misordered = 0 };
+        TEST_ASSERT(history_storage_scan_newest(path, -1, check_scan_order, &check) == 0);
+        TEST_ASSERT(check.next == -1 && check.misordered == 0 && check.invalid == n / 1000);
+    }
+
+    history_storage_set_parse_threads(0);
+    unlink(path);
+    return 0;
+}
+
 int test_history_storage(void) {
     const char *fixture = "tests/fixtures/history_corrupt.jsonl";
     const char *path = "/tmp/tcurl_history_runtime.jsonl";
@@ -28,6 +534,10 @@ int test_history_storage(void) {
     TEST_ASSERT(stats.loaded_ok == 2);
     TEST_ASSERT(stats.skipped_invalid == 1);
     TEST_ASSERT(h.count == 2);
+    TEST_ASSERT(!history_get(&h, 0)->paged_in);
+    TEST_ASSERT(history_get(&h, 0)->response_body == NULL);
+    TEST_ASSERT(history_storage_page_in(&h, history_get(&h, 0)) == 0);
+    TEST_ASSERT_STR_EQ(history_get(&h, 0)->response_body, "ok");
 
     TextBuffer b;
     TextBuffer hd;
@@ -53,5 +563,13 @@ int test_history_storage(void) {
     tb_free(&b);
     tb_free(&hd);
     history_free(&h);
-    return 0;
+    if (test_history_ring() != 0) return 1;
+    if (test_history_shared_bodies() != 0) return 1;
+    if (test_history_views() != 0) return 1;
+    if (test_history_compression() != 0) return 1;
+    if (test_history_config() != 0) return 1;
+    if (test_history_fulltext() != 0) return 1;
+    if (test_history_long_lines() != 0) return 1;
+    if (test_history_parallel_parse() != 0) return 1;
+    return test_history_storage_lazy();
 }
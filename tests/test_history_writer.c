@@ -0,0 +1,322 @@
+#include "test.h"
+#include "state.h"
+#include "core/storage/history.h"
+#include "core/storage/history_persistence.h"
+#include "core/storage/history_writer.h"
+
+#include <unistd.h>
+
+/* An entry whose body is "body <i>", padded with spaces to `pad` bytes. */
+static char *entry_line_padded(int i, size_t pad) {
+    char url[64];
+    snprintf(url, sizeof(url), "https://w/%d", i);
+    char *body = malloc(pad + 32);
+    if (!body) return NULL;
+    int n = snprintf(body, 32, "body %d", i);
+    if ((size_t)n < pad) {
+        /* Noise after a space, so the padding survives compression */
+        unsigned r = (unsigned)i * 2654435761u + 1;
+        body[n] = ' ';
+        for (size_t k = (size_t)n + 1; k < pad; k++) {
+            r = r * 1103515245u + 12345u;
+            char c = (char)('#' + (r >> 16) % 92);
+            body[k] = c == '\\' ? '!' : c;
+        }
+        body[pad] = '\0';
+    }
+
+    HistoryItem it;
+    memset(&it, 0, sizeof(it));
+    it.url = url;
+    it.body = body;
+    it.status = 200;
+    char *line = history_storage_format_entry(&it);
+    free(body);
+    return line;
+}
+
+static char *entry_line(int i) {
+    return entry_line_padded(i, 0);
+}
+
+static int body_is(const char *body, int i) {
+    char want[32];
+    snprintf(want, sizeof(want), "body %d", i);
+    size_t n = strlen(want);
+    return body && strncmp(body, want, n) == 0 && (body[n] == '\0' || body[n] == ' ');
+}
+
+static int file_contains(const char *path, const char *needle) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    rewind(f);
+    char *data = malloc((size_t)size + 1);
+    size_t n = data ? fread(data, 1, (size_t)size, f) : 0;
+    fclose(f);
+    if (!data) return 0;
+    data[n] = '\0';
+    int found = strstr(data, needle) != NULL;
+    free(data);
+    return found;
+}
+
+static void remove_log(const char *path) {
+    int *seqs = NULL;
+    int nseg = 0;
+    if (history_storage_list_segments(path, &seqs, &nseg) != 0) return;
+    for (int i = 0; i < nseg; i++) {
+        char *seg = history_storage_segment_path(path, seqs[i]);
+        if (seg) unlink(seg);
+        free(seg);
+    }
+    free(seqs);
+}
+
+static void state_setup(AppState *s, const char *path) {
+    memset(s, 0, sizeof(*s));
+    pthread_mutex_init(&s->state_mu, NULL);
+    s->history.history = malloc(sizeof(*s->history.history));
+    history_init(s->history.history);
+    s->history.path = strdup(path);
+    s->history.max_entries = 100;
+}
+
+static void state_teardown(AppState *s) {
+    history_writer_stop(s);
+    history_free(s->history.history);
+    free(s->history.history);
+    free(s->history.path);
+    pthread_mutex_destroy(&s->state_mu);
+}
+
+// Test: queued appends reach the file in order by the time the writer stops
+static int test_writer_append_flush(void) {
+    const char *path = "/tmp/tcurl_writer_dir/history.jsonl";
+    remove_log(path);
+    rmdir("/tmp/tcurl_writer_dir");
+
+    AppState s;
+    state_setup(&s, path);
+    TEST_ASSERT(history_writer_start(&s) == 0);
+    app_state_lock(&s);
+    for (int i = 0; i < 50; i++) {
+        TEST_ASSERT(history_writer_append(s.history.writer, entry_line(i)) == 0);
+    }
+    app_state_unlock(&s);
+    history_writer_stop(&s);
+    TEST_ASSERT(s.history.last_save_error == 0);
+
+    History h;
+    history_init(&h);
+    HistoryLoadStats stats;
+    TEST_ASSERT(history_storage_load_with_stats(&h, path, &stats) == 0);
+    TEST_ASSERT(stats.loaded_ok == 50 && stats.skipped_invalid == 0);
+    TEST_ASSERT_STR_EQ(history_get(&h, 0)->url, "https://w/0");
+    TEST_ASSERT_STR_EQ(history_get(&h, 49)->url, "https://w/49");
+    history_free(&h);
+
+    state_teardown(&s);
+    return 0;
+}
+
+// Test: a large single-file history is compacted in place on trim, less its stored views
+static int test_writer_compacts_legacy_file(void) {
+    const char *path = "/tmp/tcurl_writer_trim.jsonl";
+    remove_log(path);
+
+    /* 60 KB entries: 1.2 MB in all, above the segment size */
+    FILE *f = fopen(path, "w");
+    TEST_ASSERT(f != NULL);
+    for (int i = 0; i < 20; i++) {
+        char *line = entry_line_padded(i, 60 * 1024);
+        line[strlen(line) - 1] = '\0';
+        fprintf(f, "%s,\"response_body_view\":\"view %d\"}\n%s", line, i, i == 4 ? "{junk\n" : "");
+        free(line);
+    }
+    TEST_ASSERT(fclose(f) == 0);
+
+    AppState s;
+    state_setup(&s, path);
+    TEST_ASSERT(history_storage_load(s.history.history, path) == 0);
+    TEST_ASSERT(history_writer_start(&s) == 0);
+
+    app_state_lock(&s);
+    history_trim_oldest(s.history.history, 4);
+    TEST_ASSERT(history_writer_trim(s.history.writer, 4) == 0);
+    app_state_unlock(&s);
+    history_writer_stop(&s);
+    TEST_ASSERT(s.history.last_save_error == 0);
+
+    History *h = s.history.history;
+    TEST_ASSERT(h->count == 4);
+    TEST_ASSERT(history_get(h, 0)->disk_offset == 0);
+    for (int i = 0; i < h->count; i++) {
+        TEST_ASSERT(history_storage_page_in(h, history_get(h, i)) == 0);
+        TEST_ASSERT(body_is(history_get(h, i)->body, 16 + i));
+    }
+
+    History check;
+    history_init(&check);
+    HistoryLoadStats stats;
+    TEST_ASSERT(history_storage_load_with_stats(&check, path, &stats) == 0);
+    TEST_ASSERT(stats.loaded_ok == 4 && stats.skipped_invalid == 0);
+    history_free(&check);
+    TEST_ASSERT(!file_contains(path, "response_body_view"));
+
+    state_teardown(&s);
+    return 0;
+}
+
+// Test: appends roll segments, trims drop whole old ones, clear removes all
+static int test_writer_segments(void) {
+    const char *path = "/tmp/tcurl_writer_seg.jsonl";
+    remove_log(path);
+
+    AppState s;
+    state_setup(&s, path);
+    TEST_ASSERT(history_writer_start(&s) == 0);
+
+    /* 60 KB entries: about 2.3 MB, so at least three segments */
+    app_state_lock(&s);
+    for (int i = 0; i < 40; i++) {
+        TEST_ASSERT(history_writer_append(s.history.writer, entry_line_padded(i, 60 * 1024)) == 0);
+    }
+    app_state_unlock(&s);
+    history_writer_stop(&s);
+
+    int *seqs = NULL;
+    int nseg = 0;
+    TEST_ASSERT(history_storage_list_segments(path, &seqs, &nseg) == 0);
+    TEST_ASSERT(nseg >= 3 && seqs[0] == 1);
+    int last = seqs[nseg - 1];
+    free(seqs);
+
+    History check;
+    history_init(&check);
+    TEST_ASSERT(history_storage_load(&check, path) == 0);
+    TEST_ASSERT(check.count == 40);
+    int in_last = 0;
+    for (int i = 0; i < check.count; i++) {
+        if (history_get(&check, i)->disk_segment == last) in_last++;
+    }
+    TEST_ASSERT(in_last > 0 && in_last < 40);
+    TEST_ASSERT(history_storage_page_in(&check, history_get(&check, 39)) == 0);
+    TEST_ASSERT(body_is(history_get(&check, 39)->body, 39));
+    history_free(&check);
+
+    /* Only segments whose entries are all outside the window are dropped */
+    TEST_ASSERT(history_writer_start(&s) == 0);
+    app_state_lock(&s);
+    TEST_ASSERT(history_writer_trim(s.history.writer, 40) == 0);
+    TEST_ASSERT(history_writer_trim(s.history.writer, in_last) == 0);
+    app_state_unlock(&s);
+    history_writer_stop(&s);
+    TEST_ASSERT(s.history.last_save_error == 0);
+
+    TEST_ASSERT(history_storage_list_segments(path, &seqs, &nseg) == 0);
+    TEST_ASSERT(nseg == 1 && seqs[0] == last);
+    free(seqs);
+
+    TEST_ASSERT(history_writer_start(&s) == 0);
+    app_state_lock(&s);
+    TEST_ASSERT(history_writer_clear(s.history.writer) == 0);
+    TEST_ASSERT(history_writer_append(s.history.writer, entry_line(42)) == 0);
+    app_state_unlock(&s);
+    history_writer_stop(&s);
+
+    history_init(&check);
+    TEST_ASSERT(history_storage_load(&check, path) == 0);
+    TEST_ASSERT(check.count == 1);
+    TEST_ASSERT_STR_EQ(history_get(&check, 0)->url, "https://w/42");
+    history_free(&check);
+
+    state_teardown(&s);
+    return 0;
+}
+
+// Test: shared bodies are written once and swept when the log no longer needs them
+static int test_writer_shared_bodies(void) {
+    const char *path = "/tmp/tcurl_writer_shared.jsonl";
+    remove_log(path);
+    (void)history_storage_sweep_bodies(path, NULL, 0, NULL);
+
+    char big[1024];
+    memset(big, 'z', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    BodyHash hash;
+    body_hash(big, strlen(big), &hash);
+
+    HistoryItem it;
+    memset(&it, 0, sizeof(it));
+    it.url = "https://w/shared";
+    it.response_body = big;
+
+    AppState s;
+    state_setup(&s, path);
+    TEST_ASSERT(history_writer_start(&s) == 0);
+    app_state_lock(&s);
+    for (int i = 0; i < 3; i++) {
+        /* The job pins the interned copy, which outlives a clear of the history */
+        char *interned = body_store_intern(&s.history.history->bodies, big, strlen(big));
+        TEST_ASSERT(history_writer_store_body(s.history.writer, interned, strlen(big), &hash, NULL) == 0);
+        if (i == 1) {
+            history_free(s.history.history);
+            history_init(s.history.history);
+        } else {
+            body_store_release(&s.history.history->bodies, interned);
+        }
+        TEST_ASSERT(history_writer_append(s.history.writer, history_storage_format_entry(&it)) == 0);
+    }
+    app_state_unlock(&s);
+    history_writer_stop(&s);
+    TEST_ASSERT(s.history.last_save_error == 0);
+    TEST_ASSERT(history_storage_has_body(path, &hash));
+    TEST_ASSERT(s.history.history->bodies.count == 0);
+
+    History check;
+    history_init(&check);
+    TEST_ASSERT(history_storage_load(&check, path) == 0);
+    TEST_ASSERT(check.count == 3);
+    TEST_ASSERT(history_storage_page_in(&check, history_get(&check, 2)) == 0);
+    TEST_ASSERT_STR_EQ(history_get(&check, 2)->response_body, big);
+    history_free(&check);
+
+    /* A body still held in memory survives the sweep of a clear */
+    app_state_lock(&s);
+    char *held = body_store_intern(&s.history.history->bodies, big, strlen(big));
+    app_state_unlock(&s);
+    TEST_ASSERT(history_writer_start(&s) == 0);
+    app_state_lock(&s);
+    TEST_ASSERT(history_writer_clear(s.history.writer) == 0);
+    app_state_unlock(&s);
+    history_writer_stop(&s);
+    TEST_ASSERT(history_storage_has_body(path, &hash));
+
+    body_store_release(&s.history.history->bodies, held);
+    TEST_ASSERT(history_writer_start(&s) == 0);
+    app_state_lock(&s);
+    TEST_ASSERT(history_writer_clear(s.history.writer) == 0);
+    app_state_unlock(&s);
+    history_writer_stop(&s);
+    TEST_ASSERT(!history_storage_has_body(path, &hash));
+
+    state_teardown(&s);
+    return 0;
+}
+
+int test_history_writer(void) {
+    int failed = 0;
+    failed += test_writer_append_flush();
+    failed += test_writer_compacts_legacy_file();
+    failed += test_writer_segments();
+    failed += test_writer_shared_bodies();
+
+    if (failed) {
+        printf("test_history_writer: FAILED (%d tests)\n", failed);
+        return 1;
+    }
+    printf("test_history_writer: OK\n");
+    return 0;
+}
@@ -0,0 +1,531 @@
+#include "test.h"
+#include "core/http/http.h"
+#include "core/http/http_engine.h"
+#include "core/storage/history.h"
+#include "core/utils/mapped_body.h"
+#include "state.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+static HttpRequestSpec get_spec(const char *url) {
+    HttpRequestSpec spec = {
+        .method = HTTP_GET,
+        .url = url,
+        .body = NULL,
+        .headers_text = "",
+        .cookie_jar_path = NULL,
+    };
+    return spec;
+}
+
+typedef struct {
+    pthread_mutex_t mu;
+    pthread_cond_t cv;
+    int done;
+    HttpResponse result;
+} Fetch;
+
+static void on_fetched(int id, HttpResponse *result, void *userdata) {
+    (void)id;
+    Fetch *f = userdata;
+    (void)pthread_mutex_lock(&f->mu);
+    if (result) {
+        f->result = *result;
+        memset(result, 0, sizeof(*result));
+    }
+    f->done = 1;
+    (void)pthread_cond_signal(&f->cv);
+    (void)pthread_mutex_unlock(&f->mu);
+}
+
+/* Submit `spec` to `e` and wait for it. 0 if it completed without error */
+static int fetch(HttpEngine *e, const HttpRequestSpec *spec, HttpResponse *out) {
+    Fetch f;
+    memset(&f, 0, sizeof(f));
+    (void)pthread_mutex_init(&f.mu, NULL);
+    (void)pthread_cond_init(&f.cv, NULL);
+
+    int rc = -1;
+    if (http_engine_submit(e, spec, on_fetched, &f) > 0) {
+        (void)pthread_mutex_lock(&f.mu);
+        while (!f.done) (void)pthread_cond_wait(&f.cv, &f.mu);
+        (void)pthread_mutex_unlock(&f.mu);
+        *out = f.result;
+        rc = out->error ? -1 : 0;
+    }
+    (void)pthread_cond_destroy(&f.cv);
+    (void)pthread_mutex_destroy(&f.mu);
+    return rc;
+}
+
+/* Test: repeated sends through one engine reuse pooled handles */
+static int test_http_engine_reuses_handles(void) {
+    const char *path = "/tmp/tcurl_engine_body.txt";
+    TEST_ASSERT(write_text_file(path, "hello engine") == 0);
+
+    HttpEngine *e = http_engine_create();
+    TEST_ASSERT(e != NULL);
+
+    HttpRequestSpec spec = get_spec("file:///tmp/tcurl_engine_body.txt");
+
+    for (int i = 0; i < 3; i++) {
+        HttpResponse r;
+        memset(&r, 0, sizeof(r));
+        TEST_ASSERT(fetch(e, &spec, &r) == 0);
+        TEST_ASSERT(r.body != NULL);
+        TEST_ASSERT_STR_EQ(r.body, "hello engine");
+        TEST_ASSERT(r.error == NULL);
+        TEST_ASSERT(r.timing.connection_reused == 0);
+        http_response_free(&r);
+    }
+
+    /* A released handle comes back from the pool */
+    CURL *first = http_engine_acquire(e, 0);
+    TEST_ASSERT(first != NULL);
+    http_engine_release(e, first, 0);
+    CURL *second = http_engine_acquire(e, 0);
+    TEST_ASSERT(second == first);
+    http_engine_release(e, second, 1);
+
+    /* One that used the cookie jar is kept for requests that do */
+    CURL *plain = http_engine_acquire(e, 0);
+    TEST_ASSERT(plain != NULL && plain != first);
+    http_engine_release(e, plain, 0);
+    CURL *jar = http_engine_acquire(e, 1);
+    TEST_ASSERT(jar == first || jar == plain);
+    http_engine_release(e, jar, 1);
+
+    http_engine_destroy(e);
+    return 0;
+}
+
+typedef struct {
+    pthread_mutex_t mu;
+    int done;
+    int ok;
+    int ids[4];
+    int errors;
+    char last_error[64];
+} AsyncResults;
+
+static void on_done(int id, HttpResponse *result, void *userdata) {
+    AsyncResults *res = userdata;
+    (void)pthread_mutex_lock(&res->mu);
+    if (result && result->body && strcmp(result->body, "hello engine") == 0) res->ok++;
+    if (res->done < 4) res->ids[res->done] = id;
+    if (result && result->error) {
+        res->errors++;
+        snprintf(res->last_error, sizeof(res->last_error), "%s", result->error);
+    }
+    res->done++;
+    (void)pthread_mutex_unlock(&res->mu);
+    if (result) http_response_free(result);
+}
+
+static int wait_done(AsyncResults *res, int want) {
+    for (int i = 0; i < 5000; i++) {
+        (void)pthread_mutex_lock(&res->mu);
+        int done = res->done;
+        (void)pthread_mutex_unlock(&res->mu);
+        if (done >= want) return done;
+        usleep(1000);
+    }
+    return -1;
+}
+
+/* Test: concurrent submits each complete once with their own id */
+static int test_http_engine_async_submit(void) {
+    const char *path = "/tmp/tcurl_engine_body.txt";
+    TEST_ASSERT(write_text_file(path, "hello engine") == 0);
+
+    HttpEngine *e = http_engine_create();
+    TEST_ASSERT(e != NULL);
+
+    AsyncResults res;
+    memset(&res, 0, sizeof(res));
+    (void)pthread_mutex_init(&res.mu, NULL);
+
+    HttpRequestSpec spec = get_spec("file:///tmp/tcurl_engine_body.txt");
+    int id1 = http_engine_submit(e, &spec, on_done, &res);
+    int id2 = http_engine_submit(e, &spec, on_done, &res);
+    int id3 = http_engine_submit(e, &spec, on_done, &res);
+    TEST_ASSERT(id1 > 0 && id2 > id1 && id3 > id2);
+
+    TEST_ASSERT(wait_done(&res, 3) == 3);
+    TEST_ASSERT(res.ok == 3);
+    TEST_ASSERT(http_engine_in_flight(e) == 0);
+
+    HttpProgress progress;
+    TEST_ASSERT(http_engine_progress(e, id1, &progress) == 1);
+
+    /* Failed transfers complete with an error instead of a body */
+    spec.url = "file:///tmp/tcurl_engine_missing_file";
+    TEST_ASSERT(http_engine_submit(e, &spec, on_done, &res) > 0);
+    TEST_ASSERT(wait_done(&res, 4) == 4);
+    TEST_ASSERT(res.ok == 3);
+
+    http_engine_destroy(e);
+    (void)pthread_mutex_destroy(&res.mu);
+    return 0;
+}
+
+/* Test: submit rejects a missing engine */
+static int test_http_engine_submit_null(void) {
+    HttpRequestSpec spec = get_spec("file:///tmp/tcurl_engine_body.txt");
+    TEST_ASSERT(http_engine_submit(NULL, &spec, on_done, NULL) == -1);
+    TEST_ASSERT(http_engine_in_flight(NULL) == 0);
+    return 0;
+}
+
+/* Test: a body over max_body_bytes fails the request, a large one is kept whole */
+static int test_http_engine_body_limit(void) {
+    const char *path = "/tmp/tcurl_engine_large.txt";
+    FILE *f = fopen(path, "w");
+    TEST_ASSERT(f != NULL);
+    for (int i = 0; i < 200000; i++) fputs("0123456789", f);
+    TEST_ASSERT(fclose(f) == 0);
+
+    HttpEngine *e = http_engine_create();
+    TEST_ASSERT(e != NULL);
+    HttpRequestSpec spec = get_spec("file:///tmp/tcurl_engine_large.txt");
+
+    HttpResponse r;
+    memset(&r, 0, sizeof(r));
+    TEST_ASSERT(fetch(e, &spec, &r) == 0);
+    TEST_ASSERT(r.body != NULL);
+    TEST_ASSERT(strlen(r.body) == 2000000);
+    http_response_free(&r);
+
+    spec.max_body_bytes = 1024 * 1024;
+    TEST_ASSERT(fetch(e, &spec, &r) == -1);
+    TEST_ASSERT(r.body == NULL);
+    TEST_ASSERT(r.error != NULL);
+    TEST_ASSERT(strstr(r.error, "limit") != NULL);
+    http_response_free(&r);
+
+    spec.max_body_bytes = 2000000;
+    TEST_ASSERT(fetch(e, &spec, &r) == 0);
+    TEST_ASSERT(strlen(r.body) == 2000000);
+    http_response_free(&r);
+    http_engine_destroy(e);
+    return 0;
+}
+
+/* Test: a body over the spill threshold is mapped from a temp file and
+   shared with history rather than copied */
+static int test_http_engine_spill(void) {
+    HttpEngine *e = http_engine_create();
+    TEST_ASSERT(e != NULL);
+    HttpRequestSpec spec = get_spec("file:///tmp/tcurl_engine_large.txt");
+    spec.spill_threshold_bytes = 64 * 1024;
+
+    HttpResponse r;
+    memset(&r, 0, sizeof(r));
+    TEST_ASSERT(fetch(e, &spec, &r) == 0);
+    TEST_ASSERT(r.body_map != NULL);
+    TEST_ASSERT(r.body == r.body_map->data);
+    TEST_ASSERT(r.body_map->len == 2000000);
+    TEST_ASSERT(strlen(r.body) == 2000000);
+    TEST_ASSERT(strncmp(r.body + 1999990, "0123456789", 10) == 0);
+    r.body_view = r.body;
+
+    History h;
+    history_init(&h);
+    TextBuffer empty;
+    tb_init(&empty);
+    history_push(&h, HTTP_GET, "file:///tmp/tcurl_engine_large.txt", &empty, &empty, &r);
+    HistoryItem *it = history_get(&h, 0);
+    TEST_ASSERT(it != NULL);
+    TEST_ASSERT(it->response_map == r.body_map);
+    TEST_ASSERT(it->response_body == r.body);
+    TEST_ASSERT(history_item_view(&h, it) == r.body);
+    TEST_ASSERT(r.body_map->refs == 2);
+
+    /* History keeps the mapping alive after the response is gone */
+    http_response_free(&r);
+    TEST_ASSERT(it->response_map->refs == 1);
+    TEST_ASSERT(strlen(it->response_body) == 2000000);
+    history_free(&h);
+    tb_free(&empty);
+
+    /* Below the threshold the body stays on the heap */
+    spec = get_spec("file:///tmp/tcurl_engine_body.txt");
+    spec.spill_threshold_bytes = 64 * 1024;
+    TEST_ASSERT(fetch(e, &spec, &r) == 0);
+    TEST_ASSERT(r.body_map == NULL);
+    TEST_ASSERT_STR_EQ(r.body, "hello engine");
+    http_response_free(&r);
+    http_engine_destroy(e);
+    return 0;
+}
+
+/* Loopback listener that never answers: connects succeed, responses never come */
+static int silent_listener(char *url, size_t url_sz) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t alen = sizeof(addr);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(fd, 4) != 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &alen) != 0) {
+        close(fd);
+        return -1;
+    }
+    snprintf(url, url_sz, "http://127.0.0.1:%d/", ntohs(addr.sin_port));
+    return fd;
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+/* Test: cancelling a stalled request completes it right away */
+static int test_http_engine_cancel(void) {
+    char url[64];
+    int lfd = silent_listener(url, sizeof(url));
+    TEST_ASSERT(lfd >= 0);
+
+    HttpEngine *e = http_engine_create();
+    TEST_ASSERT(e != NULL);
+
+    AsyncResults res;
+    memset(&res, 0, sizeof(res));
+    (void)pthread_mutex_init(&res.mu, NULL);
+
+    HttpRequestSpec spec = get_spec(url);
+    int id = http_engine_submit(e, &spec, on_done, &res);
+    TEST_ASSERT(id > 0);
+    usleep(20000);
+    TEST_ASSERT(http_engine_in_flight(e) == 1);
+
+    double start = now_ms();
+    TEST_ASSERT(http_engine_cancel(e, id) == 0);
+    TEST_ASSERT(wait_done(&res, 1) == 1);
+    TEST_ASSERT(now_ms() - start < 500.0);
+
+    (void)pthread_mutex_lock(&res.mu);
+    TEST_ASSERT(res.ids[0] == id);
+    TEST_ASSERT(res.errors == 1);
+    TEST_ASSERT_STR_EQ(res.last_error, "Request cancelled");
+    (void)pthread_mutex_unlock(&res.mu);
+
+    TEST_ASSERT(http_engine_cancel(e, id) == -1);
+    TEST_ASSERT(http_engine_cancel(NULL, id) == -1);
+
+    http_engine_destroy(e);
+    (void)pthread_mutex_destroy(&res.mu);
+    close(lfd);
+    return 0;
+}
+
+/* Test: the transfer timeout comes from the spec */
+static int test_http_engine_timeout(void) {
+    char url[64];
+    int lfd = silent_listener(url, sizeof(url));
+    TEST_ASSERT(lfd >= 0);
+
+    HttpEngine *e = http_engine_create();
+    TEST_ASSERT(e != NULL);
+    HttpRequestSpec spec = get_spec(url);
+    spec.timeout_ms = 150;
+
+    HttpResponse r;
+    memset(&r, 0, sizeof(r));
+    double start = now_ms();
+    TEST_ASSERT(fetch(e, &spec, &r) == -1);
+    double took = now_ms() - start;
+    TEST_ASSERT(took >= 100.0 && took < 3000.0);
+    TEST_ASSERT(r.error != NULL);
+    http_response_free(&r);
+    http_engine_destroy(e);
+
+    close(lfd);
+    return 0;
+}
+
+/* Loopback server: /set/NAME sets a cookie, every path answers with the
+   Cookie header it got. One request per connection. */
+typedef struct {
+    int fd;
+    int requests;
+} CookieServer;
+
+static void *cookie_server_main(void *arg) {
+    CookieServer *srv = arg;
+    for (int i = 0; i < srv->requests; i++) {
+        int c = accept(srv->fd, NULL, NULL);
+        if (c < 0) break;
+
+        char req[2048];
+        size_t len = 0;
+        while (len < sizeof(req) - 1) {
+            ssize_t n = read(c, req + len, sizeof(req) - 1 - len);
+            if (n <= 0) break;
+            len += (size_t)n;
+            req[len] = '\0';
+            if (strstr(req, "\r\n\r\n")) break;
+        }
+        req[len] = '\0';
+
+        char cookie[256] = "";
+        const char *h = strstr(req, "\r\nCookie: ");
+        if (h) sscanf(h + 10, "%255[^\r]", cookie);
+
+        char set[128] = "";
+        char name[32];
+        if (sscanf(req, "GET /set/%31[a-z]", name) == 1) {
+            snprintf(set, sizeof(set), "Set-Cookie: %s=1; Path=/\r\n", name);
+            usleep(50000); /* Keep the transfers in flight together */
+        }
+
+        char resp[512];
+        int n = snprintf(resp, sizeof(resp),
+                         "HTTP/1.1 200 OK\r\n%sContent-Length: %zu\r\nConnection: close\r\n\r\n%s",
+                         set, strlen(cookie), cookie);
+        (void)write(c, resp, (size_t)n);
+        close(c);
+    }
+    return NULL;
+}
+
+typedef struct {
+    pthread_mutex_t mu;
+    int done;
+    char body[4][256];
+} CookieResults;
+
+static void on_cookie_done(int id, HttpResponse *result, void *userdata) {
+    (void)id;
+    CookieResults *res = userdata;
+    (void)pthread_mutex_lock(&res->mu);
+    if (res->done < 4) {
+        snprintf(res->body[res->done], sizeof(res->body[0]), "%s",
+                 (result && result->body) ? result->body : "");
+    }
+    res->done++;
+    (void)pthread_mutex_unlock(&res->mu);
+    if (result) http_response_free(result);
+}
+
+static int wait_cookie_done(CookieResults *res, int want) {
+    for (int i = 0; i < 5000; i++) {
+        (void)pthread_mutex_lock(&res->mu);
+        int done = res->done;
+        (void)pthread_mutex_unlock(&res->mu);
+        if (done >= want) return done;
+        usleep(1000);
+    }
+    return -1;
+}
+
+/* 0 once the jar holds both cookie lines */
+static int wait_jar(const char *jar, const char *a, const char *b) {
+    for (int i = 0; i < 5000; i++) {
+        char saved[1024] = "";
+        FILE *f = fopen(jar, "r");
+        if (f) {
+            saved[fread(saved, 1, sizeof(saved) - 1, f)] = '\0';
+            fclose(f);
+        }
+        if (strstr(saved, a) && strstr(saved, b)) return 0;
+        usleep(1000);
+    }
+    return 1;
+}
+
+/* Test: concurrent transfers share cookies and keep all of them in the jar */
+static int test_http_engine_cookie_jar(void) {
+    const char *jar = "/tmp/tcurl_engine_cookies.txt";
+    (void)remove(jar);
+
+    char base[64];
+    CookieServer srv = { .requests = 5 };
+    srv.fd = silent_listener(base, sizeof(base));
+    TEST_ASSERT(srv.fd >= 0);
+    pthread_t th;
+    TEST_ASSERT(pthread_create(&th, NULL, cookie_server_main, &srv) == 0);
+
+    char set_a[96], set_b[96], echo[96];
+    snprintf(set_a, sizeof(set_a), "%sset/a", base);
+    snprintf(set_b, sizeof(set_b), "%sset/b", base);
+    snprintf(echo, sizeof(echo), "%secho", base);
+
+    HttpEngine *e = http_engine_create();
+    TEST_ASSERT(e != NULL);
+
+    CookieResults res;
+    memset(&res, 0, sizeof(res));
+    (void)pthread_mutex_init(&res.mu, NULL);
+
+    HttpRequestSpec spec = get_spec(set_a);
+    spec.cookie_jar_path = jar;
+    TEST_ASSERT(http_engine_submit(e, &spec, on_cookie_done, &res) > 0);
+    spec.url = set_b;
+    TEST_ASSERT(http_engine_submit(e, &spec, on_cookie_done, &res) > 0);
+    TEST_ASSERT(wait_cookie_done(&res, 2) == 2);
+
+    /* Both cookies reach the jar, written after the callbacks ran */
+    TEST_ASSERT(wait_jar(jar, "\ta\t1", "\tb\t1") == 0);
+
+    /* ... and are sent together */
+    spec.url = echo;
+    TEST_ASSERT(http_engine_submit(e, &spec, on_cookie_done, &res) > 0);
+    TEST_ASSERT(wait_cookie_done(&res, 3) == 3);
+    TEST_ASSERT(strstr(res.body[2], "a=1") != NULL);
+    TEST_ASSERT(strstr(res.body[2], "b=1") != NULL);
+
+    /* A request without the jar sends none, even on a reused handle */
+    spec.cookie_jar_path = NULL;
+    TEST_ASSERT(http_engine_submit(e, &spec, on_cookie_done, &res) > 0);
+    TEST_ASSERT(wait_cookie_done(&res, 4) == 4);
+    TEST_ASSERT_STR_EQ(res.body[3], "");
+    http_engine_destroy(e);
+
+    /* A new engine reads them back from the jar */
+    e = http_engine_create();
+    TEST_ASSERT(e != NULL);
+    spec.cookie_jar_path = jar;
+    HttpResponse r;
+    memset(&r, 0, sizeof(r));
+    TEST_ASSERT(fetch(e, &spec, &r) == 0);
+    TEST_ASSERT(r.body && strstr(r.body, "a=1") && strstr(r.body, "b=1"));
+    http_response_free(&r);
+    http_engine_destroy(e);
+
+    pthread_join(th, NULL);
+    close(srv.fd);
+    (void)pthread_mutex_destroy(&res.mu);
+    (void)remove(jar);
+    return 0;
+}
+
+int test_http_engine(void) {
+    int failed = 0;
+    failed += test_http_engine_reuses_handles();
+    failed += test_http_engine_async_submit();
+    failed += test_http_engine_submit_null();
+    failed += test_http_engine_body_limit();
+    failed += test_http_engine_spill();
+    failed += test_http_engine_cancel();
+    failed += test_http_engine_timeout();
+    failed += test_http_engine_cookie_jar();
+
+    if (failed) {
+        printf("test_http_engine: FAILED (%d tests)\n", failed);
+        return 1;
+    }
+    printf("test_http_engine: OK\n");
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "test.h"
+#include "state.h"
+#include "core/text/line_index.h"
+#include "core/http/http.h"
+#include "core/utils/mapped_body.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+static int line_is(const LineIndex *idx, const char *text, int n, const char *want) {
+    size_t len = 0;
+    const char *line = line_index_line(idx, text, n, &len);
+    return line && len == strlen(want) && memcmp(line, want, len) == 0;
+}
+
+static int test_line_index_lines(void) {
+    const char *text = "first\nsecond\n\nlast";
+    LineIndex *idx = line_index_build(text, strlen(text));
+    TEST_ASSERT(idx != NULL);
+    TEST_ASSERT(idx->count == 4);
+    TEST_ASSERT(line_is(idx, text, 0, "first"));
+    TEST_ASSERT(line_is(idx, text, 1, "second"));
+    TEST_ASSERT(line_is(idx, text, 2, ""));
+    TEST_ASSERT(line_is(idx, text, 3, "last"));
+    TEST_ASSERT(line_index_line(idx, text, 4, NULL) == NULL);
+    TEST_ASSERT(line_index_line(idx, text, -1, NULL) == NULL);
+    line_index_release(idx);
+
+    /* A trailing newline ends with an empty line, like the scanning renderer */
+    idx = line_index_build("a\n", 2);
+    TEST_ASSERT(idx != NULL);
+    TEST_ASSERT(idx->count == 2);
+    TEST_ASSERT(line_is(idx, "a\n", 1, ""));
+    line_index_release(idx);
+
+    idx = line_index_build("", 0);
+    TEST_ASSERT(idx != NULL);
+    TEST_ASSERT(idx->count == 1);
+    TEST_ASSERT(line_is(idx, "", 0, ""));
+    line_index_release(idx);
+
+    TEST_ASSERT(line_index_build(NULL, 0) == NULL);
+    line_index_release(NULL);
+    return 0;
+}
+
+/* Test: publishing a view indexes it, and freeing the response drops the index */
+static int test_line_index_response_view(void) {
+    HttpResponse r;
+    memset(&r, 0, sizeof(r));
+    TEST_ASSERT(http_response_index_view(&r) == 0);
+    TEST_ASSERT(r.view_lines == NULL);
+
+    r.body = strdup("{\"a\":1}");
+    r.body_view = strdup("{\n  \"a\": 1\n}");
+    TEST_ASSERT(http_response_index_view(&r) == 0);
+    TEST_ASSERT(r.view_lines != NULL);
+    TEST_ASSERT(r.view_lines->count == 3);
+    TEST_ASSERT(line_is(r.view_lines, r.body_view, 1, "  \"a\": 1"));
+
+    TEST_ASSERT(r.view_map != NULL);
+    TEST_ASSERT(r.view_map->data == r.body_view);
+    TEST_ASSERT(r.view_map->len == strlen(r.body_view));
+
+    /* Re-indexing replaces the previous index and drops the old text */
+    r.body_view = strdup("one line");
+    TEST_ASSERT(http_response_index_view(&r) == 0);
+    TEST_ASSERT(r.view_lines->count == 1);
+    TEST_ASSERT(r.view_map->data == r.body_view);
+
+    http_response_free(&r);
+    TEST_ASSERT(r.view_lines == NULL);
+    TEST_ASSERT(r.view_map == NULL);
+    return 0;
+}
+
+int test_line_index(void) {
+    int failed = 0;
+    failed += test_line_index_lines();
+    failed += test_line_index_response_view();
+
+    if (failed) {
+        printf("test_line_index: FAILED (%d tests)\n", failed);
+        return 1;
+    }
+    printf("test_line_index: OK\n");
+    return 0;
+}
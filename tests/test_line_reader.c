@@ -0,0 +1,85 @@
+#include "test.h"
+#include "core/utils/line_reader.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Test: lines come back in place with their offsets, the last one unterminated */
+static int test_line_reader_lines(void) {
+    const char *path = "/tmp/tcurl_line_reader.txt";
+    TEST_ASSERT(write_text_file(path, "one\n\nthree\r\nfour") == 0);
+
+    LineReader r;
+    TEST_ASSERT(line_reader_open(&r, path) == 0);
+    const char *want[] = { "one", "", "three\r", "four" };
+    const off_t offsets[] = { 0, 4, 5, 12 };
+    const char *line;
+    size_t len;
+    off_t offset;
+    for (int i = 0; i < 4; i++) {
+        line = line_reader_next(&r, &len, &offset);
+        TEST_ASSERT(line != NULL);
+        TEST_ASSERT(len == strlen(want[i]) && memcmp(line, want[i], len) == 0);
+        TEST_ASSERT(offset == offsets[i]);
+    }
+    TEST_ASSERT(line_reader_next(&r, &len, &offset) == NULL);
+    line_reader_close(&r);
+    unlink(path);
+    return 0;
+}
+
+/* Test: a line far longer than any fixed buffer is returned whole */
+static int test_line_reader_long_line(void) {
+    const char *path = "/tmp/tcurl_line_reader_long.txt";
+    size_t n = 300 * 1024;
+    char *text = malloc(n + 8);
+    TEST_ASSERT(text != NULL);
+    memset(text, 'x', n);
+    memcpy(text + n, "\nend\n", 6);
+    TEST_ASSERT(write_text_file(path, text) == 0);
+    free(text);
+
+    LineReader r;
+    size_t len;
+    TEST_ASSERT(line_reader_open(&r, path) == 0);
+    const char *line = line_reader_next(&r, &len, NULL);
+    TEST_ASSERT(line != NULL && len == n && line[n - 1] == 'x');
+    line = line_reader_next(&r, &len, NULL);
+    TEST_ASSERT(line != NULL && len == 3 && memcmp(line, "end", 3) == 0);
+    TEST_ASSERT(line_reader_next(&r, &len, NULL) == NULL);
+    line_reader_close(&r);
+    unlink(path);
+    return 0;
+}
+
+/* Test: empty files have no lines and missing files report ENOENT */
+static int test_line_reader_empty(void) {
+    const char *path = "/tmp/tcurl_line_reader_empty.txt";
+    TEST_ASSERT(write_text_file(path, "") == 0);
+
+    LineReader r;
+    size_t len;
+    TEST_ASSERT(line_reader_open(&r, path) == 0);
+    TEST_ASSERT(line_reader_next(&r, &len, NULL) == NULL);
+    line_reader_close(&r);
+    unlink(path);
+
+    TEST_ASSERT(line_reader_open(&r, path) == 1);
+    TEST_ASSERT(errno == ENOENT);
+    return 0;
+}
+
+int test_line_reader(void) {
+    int failed = 0;
+    failed += test_line_reader_lines();
+    failed += test_line_reader_long_line();
+    failed += test_line_reader_empty();
+
+    if (failed) {
+        printf("test_line_reader: FAILED (%d tests)\n", failed);
+        return 1;
+    }
+    printf("test_line_reader: OK\n");
+    return 0;
+}
@@ -4,17 +4,31 @@ int test_keymap(void);
 int test_layout(void);
 int test_env(void);
 int test_history_storage(void);
+int test_history_loader(void);
+int test_history_writer(void);
+int test_body_store(void);
+int test_history_index(void);
 int test_format(void);
 int test_export_auth(void);
 int test_i18n(void);
 int test_utils(void);
+int test_bytebuf(void);
+int test_compress(void);
+int test_line_reader(void);
 int test_textbuf_navigation(void);
+int test_line_index(void);
+int test_find_ci(void);
 int test_search(void);
+int test_fuzzy(void);
 int test_command_handlers(void);
 int test_help_builder(void);
 int test_request_snapshot(void);
 int test_actions(void);
 int test_dispatch(void);
+int test_http_engine(void);
+int test_request_slots(void);
+int test_bench(void);
+int test_batch(void);
 
 int main(void) {
     int rc = 0;
@@ -23,17 +37,31 @@ int main(void) {
     rc |= test_layout();
     rc |= test_env();
     rc |= test_history_storage();
+    rc |= test_history_loader();
+    rc |= test_history_writer();
+    rc |= test_body_store();
+    rc |= test_history_index();
     rc |= test_format();
     rc |= test_export_auth();
     rc |= test_i18n();
     rc |= test_utils();
+    rc |= test_bytebuf();
+    rc |= test_compress();
+    rc |= test_line_reader();
     rc |= test_textbuf_navigation();
+    rc |= test_line_index();
+    rc |= test_find_ci();
     rc |= test_search();
+    rc |= test_fuzzy();
     rc |= test_command_handlers();
     rc |= test_help_builder();
     rc |= test_request_snapshot();
     rc |= test_actions();
     rc |= test_dispatch();
+    rc |= test_http_engine();
+    rc |= test_request_slots();
+    rc |= test_bench();
+    rc |= test_batch();
 
     if (rc == 0) {
         printf("All tests passed.\n");
@@ -0,0 +1,370 @@
+#include "test.h"
+#include "state.h"
+#include "core/http/http.h"
+#include "core/http/http_engine.h"
+#include "core/http/request_slots.h"
+#include "core/http/request_thread.h"
+#include "core/text/textbuf.h"
+#include "core/config/constants.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static HttpResponse make_response(long status, const char *body) {
+    HttpResponse r;
+    memset(&r, 0, sizeof(r));
+    r.status = status;
+    r.body = strdup(body);
+    r.body_view = strdup(body);
+    return r;
+}
+
+/* Test: a begun request is viewed and its result lands in the panel */
+static int test_request_slots_begin_complete(void) {
+    ResponseState r;
+    memset(&r, 0, sizeof(r));
+    request_slots_init(&r);
+
+    int slot = request_slots_reserve(&r);
+    TEST_ASSERT(slot == 0);
+    request_slots_begin(&r, slot, 1, HTTP_GET, "http://a");
+    TEST_ASSERT(r.requests_in_flight == 1);
+
+    const RequestSlot *viewed = request_slots_viewed(&r);
+    TEST_ASSERT(viewed != NULL);
+    TEST_ASSERT(viewed->id == 1);
+    TEST_ASSERT(viewed->state == REQUEST_SLOT_IN_FLIGHT);
+    TEST_ASSERT_STR_EQ(viewed->url, "http://a");
+
+    HttpResponse res = make_response(200, "one");
+    HttpResponse *stored = request_slots_complete(&r, 1, &res);
+    TEST_ASSERT(stored == &r.response);
+    TEST_ASSERT(res.body == NULL);
+    TEST_ASSERT(r.response.status == 200);
+    TEST_ASSERT_STR_EQ(r.response.body, "one");
+    TEST_ASSERT(r.requests_in_flight == 0);
+
+    /* Unknown ids are dropped */
+    res = make_response(500, "stray");
+    TEST_ASSERT(request_slots_complete(&r, 42, &res) == NULL);
+    TEST_ASSERT(res.body == NULL);
+
+    request_slots_free(&r);
+    return 0;
+}
+
+/* Test: results of background slots are kept and can be cycled to */
+static int test_request_slots_cycle(void) {
+    ResponseState r;
+    memset(&r, 0, sizeof(r));
+    request_slots_init(&r);
+
+    request_slots_begin(&r, request_slots_reserve(&r), 1, HTTP_GET, "http://a");
+    request_slots_begin(&r, request_slots_reserve(&r), 2, HTTP_POST, "http://b");
+    TEST_ASSERT(r.requests_in_flight == 2);
+    TEST_ASSERT(request_slots_viewed(&r)->id == 2);
+
+    HttpResponse res = make_response(201, "first");
+    HttpResponse *stored = request_slots_complete(&r, 1, &res);
+    TEST_ASSERT(stored != NULL && stored != &r.response);
+    TEST_ASSERT(r.response.body == NULL);
+
+    TEST_ASSERT(request_slots_cycle(&r, -1) == 1);
+    TEST_ASSERT(request_slots_viewed(&r)->id == 1);
+    TEST_ASSERT_STR_EQ(r.response.body, "first");
+
+    int total = 0;
+    TEST_ASSERT(request_slots_position(&r, r.view_slot, &total) == 1);
+    TEST_ASSERT(total == 2);
+
+    /* Wraps around from the newest back to the oldest */
+    TEST_ASSERT(request_slots_cycle(&r, +1) == 1);
+    TEST_ASSERT(request_slots_viewed(&r)->id == 2);
+    TEST_ASSERT(request_slots_cycle(&r, +1) == 1);
+    TEST_ASSERT(request_slots_viewed(&r)->id == 1);
+    TEST_ASSERT_STR_EQ(r.response.body, "first");
+
+    /* Replacing the panel content keeps the slot's result */
+    request_slots_detach_view(&r);
+    TEST_ASSERT(request_slots_viewed(&r) == NULL);
+    TEST_ASSERT(r.response.body == NULL);
+    TEST_ASSERT(request_slots_cycle(&r, -1) == 1);
+    TEST_ASSERT(request_slots_viewed(&r)->id == 2);
+    TEST_ASSERT(request_slots_cycle(&r, -1) == 1);
+    TEST_ASSERT_STR_EQ(r.response.body, "first");
+
+    request_slots_free(&r);
+    return 0;
+}
+
+/* Test: when every slot is used the oldest finished one is recycled */
+static int test_request_slots_reserve_reuse(void) {
+    ResponseState r;
+    memset(&r, 0, sizeof(r));
+    request_slots_init(&r);
+
+    for (int i = 0; i < REQUEST_SLOTS_MAX; i++) {
+        int slot = request_slots_reserve(&r);
+        TEST_ASSERT(slot == i);
+        request_slots_begin(&r, slot, i + 1, HTTP_GET, "http://x");
+    }
+    TEST_ASSERT(request_slots_reserve(&r) == -1);
+
+    HttpResponse res = make_response(200, "three");
+    TEST_ASSERT(request_slots_complete(&r, 3, &res) != NULL);
+    res = make_response(200, "five");
+    TEST_ASSERT(request_slots_complete(&r, 5, &res) != NULL);
+    TEST_ASSERT(request_slots_reserve(&r) == 2);
+
+    request_slots_free(&r);
+    TEST_ASSERT(r.view_slot == -1);
+    return 0;
+}
+
+/* Loopback server that sends half the body, then waits to be released */
+typedef struct {
+    int listen_fd;
+    volatile int release;
+} SlowServer;
+
+static void *slow_server_main(void *arg) {
+    SlowServer *srv = arg;
+    int fd = accept(srv->listen_fd, NULL, NULL);
+    if (fd < 0) return NULL;
+
+    char req[1024];
+    (void)recv(fd, req, sizeof(req), 0);
+
+    const char *head = "HTTP/1.1 200 OK\r\nContent-Length: 10\r\nConnection: close\r\n\r\nhello";
+    (void)send(fd, head, strlen(head), 0);
+    for (int i = 0; i < 5000 && !srv->release; i++) usleep(1000);
+    (void)send(fd, "world", 5, 0);
+    close(fd);
+    return NULL;
+}
+
+/* Sends most of a body larger than the preview, then the rest when released */
+#define BIG_BODY_FIRST (STREAM_PREVIEW_MAX_BYTES + 512 * 1024)
+#define BIG_BODY_TOTAL (BIG_BODY_FIRST + 10)
+
+static void send_all(int fd, const char *p, size_t n) {
+    while (n > 0) {
+        ssize_t k = send(fd, p, n, 0);
+        if (k <= 0) return;
+        p += k;
+        n -= (size_t)k;
+    }
+}
+
+static void *big_server_main(void *arg) {
+    SlowServer *srv = arg;
+    int fd = accept(srv->listen_fd, NULL, NULL);
+    if (fd < 0) return NULL;
+
+    char req[1024];
+    (void)recv(fd, req, sizeof(req), 0);
+
+    char head[128];
+    snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Length: %d\r\nConnection: close\r\n\r\n", BIG_BODY_TOTAL);
+    send_all(fd, head, strlen(head));
+    char *body = malloc(BIG_BODY_FIRST);
+    if (body) {
+        memset(body, 'x', BIG_BODY_FIRST);
+        send_all(fd, body, BIG_BODY_FIRST);
+        free(body);
+    }
+    for (int i = 0; i < 5000 && !srv->release; i++) usleep(1000);
+    send_all(fd, "0123456789", 10);
+    close(fd);
+    return NULL;
+}
+
+/* Listen on a loopback port and `run` the server for one connection */
+static int serve(SlowServer *srv, void *(*run)(void *), pthread_t *th, char *url, size_t url_size) {
+    srv->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    srv->release = 0;
+    if (srv->listen_fd < 0) return 1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t alen = sizeof(addr);
+    if (bind(srv->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(srv->listen_fd, 1) != 0 ||
+        getsockname(srv->listen_fd, (struct sockaddr *)&addr, &alen) != 0 ||
+        pthread_create(th, NULL, run, srv) != 0) {
+        close(srv->listen_fd);
+        return 1;
+    }
+    snprintf(url, url_size, "http://127.0.0.1:%d/", ntohs(addr.sin_port));
+    return 0;
+}
+
+static void on_stream_done(int id, HttpResponse *result, void *userdata) {
+    (void)id;
+    if (result) http_response_free(result);
+    *(volatile int *)userdata = 1;
+}
+
+/* Test: bytes of an in-flight body reach the viewed slot before it completes */
+static int test_request_slots_pump_streams(void) {
+    SlowServer srv = { .listen_fd = socket(AF_INET, SOCK_STREAM, 0), .release = 0 };
+    TEST_ASSERT(srv.listen_fd >= 0);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t alen = sizeof(addr);
+    TEST_ASSERT(bind(srv.listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    TEST_ASSERT(listen(srv.listen_fd, 1) == 0);
+    TEST_ASSERT(getsockname(srv.listen_fd, (struct sockaddr *)&addr, &alen) == 0);
+
+    pthread_t th;
+    TEST_ASSERT(pthread_create(&th, NULL, slow_server_main, &srv) == 0);
+
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/", ntohs(addr.sin_port));
+
+    ResponseState r;
+    memset(&r, 0, sizeof(r));
+    request_slots_init(&r);
+    r.engine = http_engine_create();
+    TEST_ASSERT(r.engine != NULL);
+
+    volatile int done = 0;
+    HttpRequestSpec spec = { .method = HTTP_GET, .url = url };
+    int id = http_engine_submit(r.engine, &spec, on_stream_done, (void *)&done);
+    TEST_ASSERT(id > 0);
+    request_slots_begin(&r, request_slots_reserve(&r), id, HTTP_GET, url);
+
+    const RequestSlot *slot = request_slots_viewed(&r);
+    double now = 1000.0;
+    for (int i = 0; i < 5000 && slot->stream_len < 5; i++) {
+        (void)request_slots_pump(&r, now);
+        usleep(1000);
+    }
+    TEST_ASSERT(slot->stream_len == 5);
+    TEST_ASSERT_STR_EQ(slot->stream, "hello");
+    TEST_ASSERT(done == 0);
+
+    /* Nothing new until the server is released */
+    TEST_ASSERT(request_slots_pump(&r, now + 500.0) == 0);
+
+    srv.release = 1;
+    for (int i = 0; i < 5000 && !done; i++) usleep(1000);
+    TEST_ASSERT(done == 1);
+    TEST_ASSERT(http_engine_stream_read(r.engine, id, 0, url, sizeof(url)) == -1);
+
+    (void)pthread_join(th, NULL);
+    close(srv.listen_fd);
+    http_engine_destroy(r.engine);
+    request_slots_free(&r);
+    return 0;
+}
+
+/* Test: past the preview, bytes of the viewed body are counted, not copied */
+static int test_request_slots_pump_bounded(void) {
+    SlowServer srv;
+    pthread_t th;
+    char url[64];
+    TEST_ASSERT(serve(&srv, big_server_main, &th, url, sizeof(url)) == 0);
+
+    ResponseState r;
+    memset(&r, 0, sizeof(r));
+    request_slots_init(&r);
+    r.engine = http_engine_create();
+    TEST_ASSERT(r.engine != NULL);
+
+    volatile int done = 0;
+    HttpRequestSpec spec = { .method = HTTP_GET, .url = url };
+    int id = http_engine_submit(r.engine, &spec, on_stream_done, (void *)&done);
+    TEST_ASSERT(id > 0);
+    request_slots_begin(&r, request_slots_reserve(&r), id, HTTP_GET, url);
+
+    const RequestSlot *slot = request_slots_viewed(&r);
+    for (int i = 0; i < 5000 && slot->received < BIG_BODY_FIRST; i++) {
+        (void)request_slots_pump(&r, 1000.0);
+        usleep(1000);
+    }
+    TEST_ASSERT(slot->received == BIG_BODY_FIRST);
+    TEST_ASSERT(slot->stream_len == STREAM_PREVIEW_MAX_BYTES);
+    TEST_ASSERT(slot->stream_cap <= STREAM_PREVIEW_MAX_BYTES + 1);
+    TEST_ASSERT(strlen(slot->stream) == STREAM_PREVIEW_MAX_BYTES);
+
+    srv.release = 1;
+    for (int i = 0; i < 5000 && !done; i++) usleep(1000);
+    TEST_ASSERT(done == 1);
+
+    (void)pthread_join(th, NULL);
+    close(srv.listen_fd);
+    http_engine_destroy(r.engine);
+    request_slots_free(&r);
+    return 0;
+}
+
+/* Test: a sent response is formatted off the I/O thread and then published */
+static int test_request_start_finishes(void) {
+    TEST_ASSERT(write_text_file("/tmp/tcurl_finish_body.json", "{\"a\":1}") == 0);
+
+    AppState s;
+    memset(&s, 0, sizeof(s));
+    (void)pthread_mutex_init(&s.state_mu, NULL);
+    tb_init(&s.editor.body);
+    tb_init(&s.editor.headers);
+    request_slots_init(&s.response);
+    strcpy(s.editor.url, "file:///tmp/tcurl_finish_body.json");
+
+    app_state_lock(&s);
+    int id = request_start(&s);
+    TEST_ASSERT(id > 0);
+    TEST_ASSERT(s.response.finisher != NULL);
+    app_state_unlock(&s);
+
+    int in_flight = 1;
+    for (int i = 0; i < 5000 && in_flight; i++) {
+        app_state_lock(&s);
+        in_flight = s.response.requests_in_flight;
+        app_state_unlock(&s);
+        if (in_flight) usleep(1000);
+    }
+    TEST_ASSERT(in_flight == 0);
+
+    app_state_lock(&s);
+    TEST_ASSERT(s.response.response.is_json == 1);
+    TEST_ASSERT(s.response.response.body_view != NULL);
+    TEST_ASSERT(strchr(s.response.response.body_view, '\n') != NULL);
+    TEST_ASSERT(s.response.response.view_lines != NULL);
+    app_state_unlock(&s);
+
+    http_engine_destroy(s.response.engine);
+    request_thread_stop(&s);
+    TEST_ASSERT(s.response.finisher == NULL);
+    request_slots_free(&s.response);
+    tb_free(&s.editor.body);
+    tb_free(&s.editor.headers);
+    (void)pthread_mutex_destroy(&s.state_mu);
+    return 0;
+}
+
+int test_request_slots(void) {
+    int failed = 0;
+    failed += test_request_slots_begin_complete();
+    failed += test_request_slots_cycle();
+    failed += test_request_slots_reserve_reuse();
+    failed += test_request_slots_pump_streams();
+    failed += test_request_slots_pump_bounded();
+    failed += test_request_start_finishes();
+
+    if (failed) {
+        printf("test_request_slots: FAILED (%d tests)\n", failed);
+        return 1;
+    }
+    printf("test_request_slots: OK\n");
+    return 0;
+}
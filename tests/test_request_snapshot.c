@@ -90,12 +90,50 @@ static int test_snapshot_free_clears_memory(void) {
     return 0;
 }
 
+/* Test: request timeouts win over the environment's, which win over none */
+static int test_snapshot_resolve_timeouts(void) {
+    TEST_ASSERT(write_text_file("/tmp/tcurl_env_timeouts.json",
+                                "{\"dev\": {\"HOST\": \"example.com\", "
+                                "\"TCURL_TIMEOUT_MS\": \"2500\", "
+                                "\"TCURL_CONNECT_TIMEOUT_MS\": \"oops\"}}") == 0);
+
+    AppState s;
+    init_minimal_state(&s);
+    env_store_init(&s.config.envs);
+    TEST_ASSERT(env_store_load_file(&s.config.envs, "/tmp/tcurl_env_timeouts.json") == 0);
+    strcpy(s.editor.url, "https://{{HOST}}/");
+
+    RequestSnapshot snap;
+    TEST_ASSERT(request_snapshot_build(&s, &snap) == 0);
+    ResolvedRequest resolved;
+    TEST_ASSERT(request_snapshot_resolve(&snap, &s.config.envs, &resolved, NULL) == 0);
+    TEST_ASSERT_STR_EQ(resolved.url, "https://example.com/");
+    TEST_ASSERT(resolved.timeout_ms == 2500);
+    TEST_ASSERT(resolved.connect_timeout_ms == 0);
+    resolved_request_free(&resolved);
+    request_snapshot_free(&snap);
+
+    s.editor.timeout_ms = 700;
+    s.editor.connect_timeout_ms = 300;
+    TEST_ASSERT(request_snapshot_build(&s, &snap) == 0);
+    TEST_ASSERT(request_snapshot_resolve(&snap, &s.config.envs, &resolved, NULL) == 0);
+    TEST_ASSERT(resolved.timeout_ms == 700);
+    TEST_ASSERT(resolved.connect_timeout_ms == 300);
+    resolved_request_free(&resolved);
+    request_snapshot_free(&snap);
+
+    env_store_free(&s.config.envs);
+    cleanup_state(&s);
+    return 0;
+}
+
 int test_request_snapshot(void) {
     int failed = 0;
     failed += test_snapshot_null_checks();
     failed += test_snapshot_basic();
     failed += test_snapshot_empty_fields();
     failed += test_snapshot_free_clears_memory();
+    failed += test_snapshot_resolve_timeouts();
     
     if (failed) {
         printf("test_request_snapshot: FAILED (%d tests)\n", failed);
@@ -1,10 +1,18 @@
 #include "test.h"
 #include "core/interaction/search.h"
 #include "core/storage/history.h"
+#include "core/storage/history_index.h"
+#include "core/storage/history_persistence.h"
 #include "core/text/textbuf.h"
+#include "core/http/http.h"
+#include "core/utils/bytebuf.h"
+#include "core/utils/mapped_body.h"
+#include "core/text/line_index.h"
+#include "core/config/constants.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <unistd.h>
 
 // Test search_get_effective_target
 static int test_search_effective_target(void) {
@@ -310,6 +318,29 @@ static int test_search_step_response(void) {
     return 0;
 }
 
+// Test that an indexed response body yields the same matches as scanning it
+static int test_search_step_response_indexed(void) {
+    AppState s;
+    memset(&s, 0, sizeof(s));
+
+    s.response.response.body_view = strdup("test\nother\n\nTEST\n");
+    TEST_ASSERT(http_response_index_view(&s.response.response) == 0);
+    s.search.target = SEARCH_TARGET_RESPONSE;
+
+    search_apply(&s, "test");
+    TEST_ASSERT(s.response.scroll == 0);
+    search_step(&s, +1);
+    TEST_ASSERT(s.response.scroll == 3);
+    search_step(&s, +1);
+    TEST_ASSERT(s.response.scroll == 0);
+
+    search_apply(&s, "missing");
+    TEST_ASSERT(s.search.not_found == 1);
+
+    http_response_free(&s.response.response);
+    return 0;
+}
+
 // Test search_step with no query
 static int test_search_step_no_query(void) {
     AppState s;
@@ -331,6 +362,415 @@ static int test_search_step_no_query(void) {
     return 0;
 }
 
+// Test n/N reuse one match set until the response or the history changes
+static int test_search_step_cached(void) {
+    AppState s;
+    memset(&s, 0, sizeof(s));
+
+    /* Every third of 3000 lines matches */
+    ByteBuf text;
+    bytebuf_init(&text);
+    for (int i = 0; i < 3000; i++) TEST_ASSERT(bytebuf_appendf(&text, "%s %d\n", i % 3 ? "row" : "hit", i) == 0);
+    s.response.response.body_view = bytebuf_take(&text);
+    TEST_ASSERT(http_response_index_view(&s.response.response) == 0);
+    s.search.target = SEARCH_TARGET_RESPONSE;
+
+    search_apply(&s, "hit");
+    const int *items = s.search.matches.items;
+    TEST_ASSERT(s.search.matches.count == 1000);
+    search_step(&s, -1);
+    TEST_ASSERT(s.response.scroll == 2997);
+    search_step(&s, -1);
+    TEST_ASSERT(s.response.scroll == 2994);
+    s.search.match_index = 1500;
+    search_step(&s, +1);
+    TEST_ASSERT(s.response.scroll == 1503);
+    search_step(&s, -1);
+    TEST_ASSERT(s.response.scroll == 1500);
+    TEST_ASSERT(s.search.matches.items == items);
+
+    /* A new view is searched afresh */
+    http_response_free(&s.response.response);
+    s.response.response.body_view = strdup("none\nhit\n");
+    TEST_ASSERT(http_response_index_view(&s.response.response) == 0);
+    search_step(&s, +1);
+    TEST_ASSERT(s.search.matches.count == 1);
+    TEST_ASSERT(s.response.scroll == 1);
+    http_response_free(&s.response.response);
+
+    /* So is a history that gained an entry */
+    History h;
+    history_init(&h);
+    TextBuffer empty_tb;
+    tb_init(&empty_tb);
+    history_push(&h, HTTP_GET, "https://a/hit", &empty_tb, &empty_tb, NULL);
+    s.history.history = &h;
+    s.search.target = SEARCH_TARGET_HISTORY;
+    search_apply(&s, "hit");
+    TEST_ASSERT(s.search.matches.count == 1);
+    history_push(&h, HTTP_GET, "https://b/hit", &empty_tb, &empty_tb, NULL);
+    search_step(&s, +1);
+    TEST_ASSERT(s.search.matches.count == 2);
+    TEST_ASSERT(s.history.selected == 1);
+    tb_free(&empty_tb);
+
+    history_free(&h);
+    free(s.search.matches.items);
+    return 0;
+}
+
+// Test full-text history search finds text in bodies and headers
+static int test_search_history_fulltext(void) {
+    AppState s;
+    memset(&s, 0, sizeof(s));
+
+    History h;
+    history_init(&h);
+    history_set_fulltext(&h, history_index_new());
+    TEST_ASSERT(h.fulltext != NULL);
+
+    TextBuffer body;
+    TextBuffer empty_tb;
+    tb_init(&body);
+    tb_init(&empty_tb);
+    tb_set_from_string(&body, "{\"customer\":\"c-1001\"}");
+
+    HttpResponse resp;
+    memset(&resp, 0, sizeof(resp));
+    resp.status = 200;
+    resp.body = "{\"orderId\":\"ORD-7731\"}";
+    resp.response_headers = "X-Trace: ab-12 12-ab";
+
+    history_push(&h, HTTP_GET, "https://api.example.com/a", &empty_tb, &empty_tb, NULL);
+    history_push(&h, HTTP_POST, "https://api.example.com/orders", &body, &empty_tb, &resp);
+    resp.body = "{\"orderId\":\"ORD-9000\"}";
+    resp.response_headers = NULL;
+    history_push(&h, HTTP_GET, "https://api.example.com/b", &empty_tb, &empty_tb, &resp);
+    tb_free(&body);
+    tb_free(&empty_tb);
+    TEST_ASSERT(history_get(&h, 1)->seq == 2);
+
+    s.history.history = &h;
+    s.search.target = SEARCH_TARGET_HISTORY;
+
+    search_apply(&s, "ord-7731");
+    TEST_ASSERT(s.search.not_found == 0);
+    TEST_ASSERT(s.search.matches.count == 1);
+    TEST_ASSERT(s.history.selected == 1);
+
+    search_apply(&s, "C-1001");
+    TEST_ASSERT(s.search.matches.count == 1);
+    search_apply(&s, "x-trace");
+    TEST_ASSERT(s.search.matches.count == 1);
+    search_apply(&s, "orderid");
+    TEST_ASSERT(s.search.matches.count == 2);
+
+    /* Every trigram occurs, but not the whole query */
+    search_apply(&s, "ab-12-ab");
+    TEST_ASSERT(s.search.not_found == 1);
+
+    /* URLs still match as before */
+    search_apply(&s, "POST");
+    TEST_ASSERT(s.search.matches.count == 1);
+
+    /* Dropped entries leave the index */
+    history_trim_oldest(&h, 1);
+    search_apply(&s, "ord-7731");
+    TEST_ASSERT(s.search.not_found == 1);
+    TEST_ASSERT(!history_index_contains(h.fulltext, 2));
+
+    history_free(&h);
+    free(s.search.matches.items);
+    return 0;
+}
+
+// Test full-text candidates still on disk are checked against their text
+static int test_search_history_fulltext_on_disk(void) {
+    const char *path = "/tmp/tcurl_search_fulltext.jsonl";
+    unlink(path);
+
+    History h;
+    history_init(&h);
+    history_set_fulltext(&h, history_index_new());
+
+    TextBuffer empty_tb;
+    tb_init(&empty_tb);
+    HttpResponse resp;
+    memset(&resp, 0, sizeof(resp));
+    resp.status = 200;
+    resp.response_headers = "X-Trace: ab-12 12-ab";
+
+    /* Large enough to be stored beside the log and referred to */
+    ByteBuf big;
+    bytebuf_init(&big);
+    while (big.len < HISTORY_SHARED_BODY_MIN_BYTES) {
+        TEST_ASSERT(bytebuf_append_str(&big, "{\"line\":\"filler\"}\n") == 0);
+    }
+    TEST_ASSERT(bytebuf_append_str(&big, "{\"orderId\":\"ORD-7731\"}") == 0);
+    resp.body = big.data;
+    history_push(&h, HTTP_GET, "https://api.example.com/a", &empty_tb, &empty_tb, &resp);
+    tb_free(&empty_tb);
+
+    TEST_ASSERT(history_storage_save(&h, path) == 0);
+    HistoryIndex *idx = h.fulltext;
+    h.fulltext = NULL;
+    history_free(&h);
+    bytebuf_free(&big);
+
+    history_init(&h);
+    TEST_ASSERT(history_storage_load(&h, path) == 0);
+    history_set_fulltext(&h, idx);
+    TEST_ASSERT(h.count == 1 && !history_get(&h, 0)->paged_in);
+
+    AppState s;
+    memset(&s, 0, sizeof(s));
+    s.history.history = &h;
+    s.search.target = SEARCH_TARGET_HISTORY;
+
+    search_apply(&s, "ord-7731");
+    TEST_ASSERT(s.search.matches.count == 1);
+    search_apply(&s, "x-trace");
+    TEST_ASSERT(s.search.matches.count == 1);
+
+    /* Every trigram occurs, but not the whole query */
+    search_apply(&s, "ab-12-ab");
+    TEST_ASSERT(s.search.not_found == 1);
+    search_apply(&s, "ord-77311");
+    TEST_ASSERT(s.search.not_found == 1);
+
+    /* Checking did not page the entry in */
+    TEST_ASSERT(!history_get(&h, 0)->paged_in);
+
+    history_free(&h);
+    free(s.search.matches.items);
+    unlink(path);
+    return 0;
+}
+
+// Test regex queries over history method and URL
+static int test_search_regex_history(void) {
+    AppState s;
+    memset(&s, 0, sizeof(s));
+
+    History h;
+    history_init(&h);
+    TextBuffer empty_tb;
+    tb_init(&empty_tb);
+    history_push(&h, HTTP_GET, "https://api.example.com/users", &empty_tb, &empty_tb, NULL);
+    history_push(&h, HTTP_POST, "https://api.example.com/users/7", &empty_tb, &empty_tb, NULL);
+    history_push(&h, HTTP_GET, "https://api.example.com/users/42", &empty_tb, &empty_tb, NULL);
+    tb_free(&empty_tb);
+
+    s.history.history = &h;
+    s.search.target = SEARCH_TARGET_HISTORY;
+
+    search_apply(&s, "re:^get .*/users/[0-9]+$");
+    TEST_ASSERT(s.search.not_found == 0);
+    TEST_ASSERT(s.history.selected == 2);
+
+    int pos = 0;
+    int total = 0;
+    TEST_ASSERT(search_status(&s, s.search.query, &pos, &total) == SEARCH_READY);
+    TEST_ASSERT(pos == 1 && total == 1);
+
+    /* Literal queries keep their meaning: "re" is just text there */
+    search_apply(&s, "users/[0-9]");
+    TEST_ASSERT(s.search.not_found == 1);
+
+    search_state_free(&s);
+    history_free(&h);
+    return 0;
+}
+
+// Test regex queries over response lines, and reuse of the compiled pattern
+static int test_search_regex_response(void) {
+    AppState s;
+    memset(&s, 0, sizeof(s));
+
+    s.response.response.body_view = strdup("id: 1\nname: a\nid: 22\nID: x\n");
+    TEST_ASSERT(http_response_index_view(&s.response.response) == 0);
+    s.search.target = SEARCH_TARGET_RESPONSE;
+
+    search_apply(&s, "re:^id: [0-9]+$");
+    TEST_ASSERT(s.response.scroll == 0);
+    const SearchRegex *compiled = s.search.regex;
+    TEST_ASSERT(compiled != NULL);
+
+    search_step(&s, +1);
+    TEST_ASSERT(s.response.scroll == 2);
+    int pos = 0;
+    int total = 0;
+    TEST_ASSERT(search_status(&s, s.search.query, &pos, &total) == SEARCH_READY);
+    TEST_ASSERT(pos == 2 && total == 2);
+
+    /* A new response is matched with the pattern compiled before */
+    TEST_ASSERT(http_response_index_view(&s.response.response) == 0);
+    search_apply(&s, "re:^id: [0-9]+$");
+    TEST_ASSERT(s.search.regex == compiled);
+
+    /* Patterns ignore case, like plain queries */
+    search_apply(&s, "re:^id: x");
+    TEST_ASSERT(s.response.scroll == 3);
+
+    search_apply(&s, "re:id: (");
+    TEST_ASSERT(s.search.match_index == -1);
+    TEST_ASSERT(s.search.regex_error[0] != '\0');
+    TEST_ASSERT(search_status(&s, s.search.query, NULL, NULL) == SEARCH_BAD_PATTERN);
+
+    search_state_free(&s);
+    http_response_free(&s.response.response);
+    return 0;
+}
+
+/* Wait for the background scan to publish its matches */
+static int wait_for_scan(AppState *s) {
+    for (int i = 0; i < 30000; i++) {
+        app_state_lock(s);
+        int busy = s->search.scanning;
+        app_state_unlock(s);
+        if (!busy) return 0;
+        usleep(1000);
+    }
+    return 1;
+}
+
+/* A body of SEARCH_ASYNC_MIN_BYTES or more, and at least 13 needles, with
+   "needle-<n>" on line n*1000 */
+static char *large_body(int *lines_out) {
+    int lines = SEARCH_ASYNC_MIN_BYTES / 24;
+    if (lines < 13000) lines = 13000;
+    char *body = malloc((size_t)lines * 48);
+    if (!body) return NULL;
+    size_t len = 0;
+    for (int i = 0; i < lines; i++) {
+        if (i > 0 && i % 1000 == 0) len += (size_t)sprintf(body + len, "needle-%d in the haystack\n", i / 1000);
+        else len += (size_t)sprintf(body + len, "line %d of plain filler text\n", i);
+    }
+    *lines_out = lines;
+    return body;
+}
+
+// Test that regex scans of large responses run in the background
+static int test_search_regex_background(void) {
+    AppState s;
+    memset(&s, 0, sizeof(s));
+
+    int lines = 0;
+    s.response.response.body_view = large_body(&lines);
+    TEST_ASSERT(s.response.response.body_view != NULL);
+    TEST_ASSERT(http_response_index_view(&s.response.response) == 0);
+    s.search.target = SEARCH_TARGET_RESPONSE;
+    s.response.scroll = 5;
+
+    app_state_lock(&s);
+    search_apply(&s, "re:needle-(7|9)[0-9]* ");
+    int scanning = s.search.scanning;
+    app_state_unlock(&s);
+    TEST_ASSERT(scanning == 1);
+    TEST_ASSERT(wait_for_scan(&s) == 0);
+
+    /* The first match is shown once the scan is done */
+    app_state_lock(&s);
+    TEST_ASSERT(s.response.scroll == 7000);
+    int pos = 0;
+    int total = 0;
+    TEST_ASSERT(search_status(&s, s.search.query, &pos, &total) == SEARCH_READY);
+    TEST_ASSERT(pos == 1);
+    int expected = 0;
+    for (int n = 1; n <= (lines - 1) / 1000; n++) {
+        char digits[16];
+        snprintf(digits, sizeof(digits), "%d", n);
+        if (digits[0] == '7' || digits[0] == '9') expected++;
+    }
+    TEST_ASSERT(total == expected);
+    search_step(&s, +1);
+    TEST_ASSERT(s.response.scroll == 9000);
+    app_state_unlock(&s);
+
+    search_state_free(&s);
+    http_response_free(&s.response.response);
+    return 0;
+}
+
+// Test that a scan keeps its view alive when the response is replaced
+static int test_search_regex_view_replaced(void) {
+    AppState s;
+    memset(&s, 0, sizeof(s));
+
+    int lines = 0;
+    s.response.response.body_view = large_body(&lines);
+    TEST_ASSERT(s.response.response.body_view != NULL);
+    TEST_ASSERT(http_response_index_view(&s.response.response) == 0);
+    s.search.target = SEARCH_TARGET_RESPONSE;
+
+    app_state_lock(&s);
+    search_apply(&s, "re:needle-5");
+    TEST_ASSERT(s.search.scanning == 1);
+    /* The scan shares the view rather than copying it */
+    TEST_ASSERT(s.response.response.view_map->refs > 1);
+    TEST_ASSERT(s.response.response.view_lines->refs > 1);
+    http_response_free(&s.response.response);
+    s.response.response.body_view = strdup("needle-5");
+    TEST_ASSERT(http_response_index_view(&s.response.response) == 0);
+    app_state_unlock(&s);
+    TEST_ASSERT(wait_for_scan(&s) == 0);
+
+    /* Its matches were for the old view and are dropped */
+    app_state_lock(&s);
+    TEST_ASSERT(s.response.scroll == 0);
+    TEST_ASSERT(s.search.matches.count == 0);
+    app_state_unlock(&s);
+
+    search_state_free(&s);
+    http_response_free(&s.response.response);
+    return 0;
+}
+
+// Test that a new query cancels the scan of the previous one
+static int test_search_regex_cancel(void) {
+    AppState s;
+    memset(&s, 0, sizeof(s));
+
+    int lines = 0;
+    s.response.response.body_view = large_body(&lines);
+    TEST_ASSERT(s.response.response.body_view != NULL);
+    TEST_ASSERT(http_response_index_view(&s.response.response) == 0);
+    s.search.target = SEARCH_TARGET_RESPONSE;
+
+    /* Typing: each keystroke replaces the scan of the one before */
+    app_state_lock(&s);
+    search_preview(&s, "re:needle-1");
+    search_preview(&s, "re:needle-12");
+    TEST_ASSERT(search_status(&s, "re:needle-12", NULL, NULL) == SEARCH_BUSY);
+    TEST_ASSERT(search_status(&s, "re:needle-1", NULL, NULL) == SEARCH_IDLE);
+    app_state_unlock(&s);
+    TEST_ASSERT(wait_for_scan(&s) == 0);
+
+    app_state_lock(&s);
+    int total = 0;
+    TEST_ASSERT(search_status(&s, "re:needle-12", NULL, &total) == SEARCH_READY);
+    TEST_ASSERT(total == 1);
+    /* Previewing does not move the view */
+    TEST_ASSERT(s.response.scroll == 0);
+
+    /* A plain query is answered at once and the scan is dropped */
+    search_preview(&s, "re:needle-3");
+    search_apply(&s, "needle-2 ");
+    TEST_ASSERT(s.search.scanning == 0);
+    TEST_ASSERT(s.response.scroll == 2000);
+    app_state_unlock(&s);
+
+    usleep(50 * 1000);
+    app_state_lock(&s);
+    TEST_ASSERT(strcmp(s.search.matches.query, "needle-2 ") == 0);
+    TEST_ASSERT(s.response.scroll == 2000);
+    app_state_unlock(&s);
+
+    search_state_free(&s);
+    http_response_free(&s.response.response);
+    return 0;
+}
+
 int test_search(void) {
     int rc = 0;
     
@@ -345,7 +785,16 @@ int test_search(void) {
     rc |= test_search_step_history_forward();
     rc |= test_search_step_history_backward();
     rc |= test_search_step_response();
+    rc |= test_search_step_response_indexed();
     rc |= test_search_step_no_query();
+    rc |= test_search_step_cached();
+    rc |= test_search_history_fulltext();
+    rc |= test_search_history_fulltext_on_disk();
+    rc |= test_search_regex_history();
+    rc |= test_search_regex_response();
+    rc |= test_search_regex_background();
+    rc |= test_search_regex_view_replaced();
+    rc |= test_search_regex_cancel();
 
     if (rc == 0) {
         printf("  test_search: OK\n");